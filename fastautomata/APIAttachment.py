@@ -1,5 +1,7 @@
 from .BaseClasses import IControlledAttachment
 import fastapi, uvicorn
+import asyncio, threading
+from starlette.concurrency import run_in_threadpool
 from . import Board, Agents, ClassTypes
 from pydantic import BaseModel
 from typing import Any
@@ -7,6 +9,48 @@ from pydantic import BaseModel
 from typing import Any
 from . import Agents, Board
 
+class StreamClient:
+    '''
+    A viewer of /stream: its event loop, and the messages waiting to be sent to it (at most limit).
+
+    A viewer that falls behind does not get the frames it missed: they get dropped, and it gets a keyframe instead.
+    '''
+    def __init__(self, api: 'API', limit: int) -> None:
+        self.api = api
+        self.loop = asyncio.get_running_loop()
+        self.queue = asyncio.Queue(limit)
+
+        # set when the queue overflowed: frames get dropped until the keyframe arrives
+        self.behind = False
+        self.resync = None
+
+    def put(self, frames: bytes, keyframe: bool = False) -> None:
+        '''
+        Queue a message. Runs in the event loop of the viewer (see send).
+        '''
+        if keyframe:
+            # the whole board, nothing before it is needed
+            self.drop()
+            self.behind = False
+        elif self.behind:
+            return
+        elif self.queue.full():
+            self.drop()
+            self.behind = True
+            self.resync = asyncio.ensure_future(run_in_threadpool(self.api.streamKeyframe, self, False))
+            return
+        self.queue.put_nowait(frames)
+
+    def send(self, frames: bytes, keyframe: bool = False) -> None:
+        '''
+        Queue a message from any thread.
+        '''
+        self.loop.call_soon_threadsafe(self.put, frames, keyframe)
+
+    def drop(self) -> None:
+        while not self.queue.empty():
+            self.queue.get_nowait()
+
 class API(IControlledAttachment):
     router: fastapi.APIRouter
     def __init__(self, board: Board.SimulatedBoard) -> None:
@@ -16,10 +60,19 @@ class API(IControlledAttachment):
         router.add_api_route("/reset", self.boardReset, methods=["POST"])
         router.add_api_route("/setVar", self.setVar, methods=["POST"])
         router.add_api_route("/state", self.getCurrentState, methods=["GET"])
+        router.add_api_websocket_route("/stream", self.stream)
 
         self.router = router
         self.board = board
 
+        # the viewers of /stream (StreamClient), the messages each one can have waiting, and the lock of the board while stepping and streaming
+        self.streams = []
+        self.streamQueueLimit = 64
+        self.lock = threading.Lock()
+
+        # the most steps a "step n" command of a viewer runs
+        self.streamStepLimit = 1000
+
     def run(self, reset: bool = True, host: str = "0.0.0.0", port: int = 8000) -> None:
         self.app = fastapi.FastAPI()
         self.app.include_router(self.router)
@@ -29,25 +82,129 @@ class API(IControlledAttachment):
 
         uvicorn.run(self.app, host=host, port=port)
 
+    # routes run in a thread pool, next to the steps of the viewers: everything that touches the board takes the lock
+
     def setVar(self, varName: str, varValue: Any):
-        self.board.specialValues[varName] = varValue
+        with self.lock:
+            self.board.specialValues[varName] = varValue
 
     def getCurrentState(self) -> 'BoardModel':
         return self.buildModel()
 
     def boardReset(self) -> 'BoardModel':
-        self.board.reset()
+        self.streamReset()
 
         return self.buildModel()
     
     def step(self) -> 'BoardModel':
-        self.board.step()
+        self.streamStep(1)
 
         return self.buildModel()
+
+    async def stream(self, websocket: fastapi.WebSocket) -> None:
+        '''
+        Binary frames of the board, built natively (see SimulatedBoard.stream_take), instead of a BoardModel per step.
+
+        The first message is the header and a keyframe (the whole board), then every step sends the changes (agents and changed cells) and the state counts.
+        Send "step" (or "step n", up to streamStepLimit) to step the board, "reset" to reset it, and "keyframe" to get the whole board again. Other messages get ignored.
+        Steps from /step and /reset get streamed too.
+        '''
+        await websocket.accept()
+        client = StreamClient(self, self.streamQueueLimit)
+        await run_in_threadpool(self.streamKeyframe, client, True)
+        sender = asyncio.create_task(self.streamWrite(websocket, client.queue))
+
+        try:
+            while True:
+                message = await websocket.receive()
+                if message["type"] == "websocket.disconnect":
+                    break
+                command = (message.get("text") or "").split()
+                if command[:1] == ["step"]:
+                    n = self.streamSteps(command[1:])
+                    if n > 0:
+                        await run_in_threadpool(self.streamStep, n)
+                elif command[:1] == ["reset"]:
+                    await run_in_threadpool(self.streamReset)
+                elif command[:1] == ["keyframe"]:
+                    await run_in_threadpool(self.streamKeyframe, client, False)
+        except fastapi.WebSocketDisconnect:
+            pass
+        finally:
+            sender.cancel()
+            await run_in_threadpool(self.streamLeave, client)
+
+    async def streamWrite(self, websocket: fastapi.WebSocket, queue: asyncio.Queue) -> None:
+        try:
+            while True:
+                await websocket.send_bytes(await queue.get())
+        except (fastapi.WebSocketDisconnect, RuntimeError):
+            pass
+
+    def streamSteps(self, arguments: list) -> int:
+        '''
+        The amount of steps of a "step" command (1 without an argument), capped at streamStepLimit. 0 if the argument is not a positive number.
+        '''
+        if not arguments:
+            return 1
+        if len(arguments) > 1:
+            return 0
+        try:
+            n = int(arguments[0])
+        except ValueError:
+            return 0
+        return max(0, min(n, self.streamStepLimit))
+
+    def streamStep(self, n: int) -> None:
+        # the lock gets released between steps, so other requests do not wait for the whole run
+        for _ in range(n):
+            with self.lock:
+                self.board.step()
+                self.streamSend()
+
+    def streamReset(self) -> None:
+        with self.lock:
+            self.board.reset()
+            self.streamSend()
+
+    def streamSend(self) -> None:
+        '''
+        Send the changes since the last frame to every viewer. Call it with the lock.
+        '''
+        if not self.streams:
+            return
+        frames = self.board.stream_take()
+        for client in self.streams:
+            client.send(frames)
+
+    def streamKeyframe(self, client: StreamClient, join: bool) -> None:
+        '''
+        Send the whole board to a viewer. When it joins, the header of the recording goes first.
+        '''
+        with self.lock:
+            if not join and client not in self.streams:
+                # it left while waiting for the lock
+                return
+            # the others get what changed first, so every viewer continues from the same frame
+            if self.streams:
+                self.streamSend()
+            else:
+                self.board.stream_enable()
+            frames = self.board.stream_keyframe(join)
+            if join:
+                self.streams.append(client)
+            client.send(frames, True)
+
+    def streamLeave(self, client: StreamClient) -> None:
+        with self.lock:
+            self.streams.remove(client)
+            if not self.streams:
+                self.board.stream_enable(False)
     
 
     def buildModel(self) -> 'BoardModel':
-        return BoardModel.makeNew(self.board)
+        with self.lock:
+            return BoardModel.makeNew(self.board)
     
 class BoardModel(BaseModel):
     board: dict[str, tuple[int, int, int]]
@@ -11,39 +11,50 @@ import logging
 
 logger = logging.getLogger(__name__)
 
+# The agent lists of the last initialized board. Each board keeps its own lists (so many boards can run at once)
 simulatedAgentList: list[fastautomata_clib.Agent] = []
 staticAgentList: list[fastautomata_clib.BaseAgent] = []
 
+def _agent_lists(board: Board) -> tuple[list, list]:
+    '''
+    Returns the (simulated, static) agent lists of a board. Boards that are not a Board wrapper use the module lists.
+    '''
+    return getattr(board, "simulatedAgentList", simulatedAgentList), getattr(board, "staticAgentList", staticAgentList)
+
 def initialize_agents(board: Board):
     '''
     sets the board reset function to resetAgents
     '''
+    global simulatedAgentList, staticAgentList
+    simulatedAgentList, staticAgentList = _agent_lists(board)
+
     board.append_on_reset(resetAgents)
     board.python_on_delete = deleteAgent
-    board.python_delete_agents = delete_agents
+    # only the lists get captured (capturing the board would keep it alive)
+    board.python_delete_agents = lambda agentLists=_agent_lists(board): delete_agents(agentLists)
 
-def delete_agents():
+def delete_agents(agentLists: tuple[list, list] = None):
     '''
     deletes all agents from the board
     '''
-    simulatedAgentList.clear()
-    staticAgentList.clear()
+    for agentList in agentLists or (simulatedAgentList, staticAgentList):
+        agentList.clear()
 
 def resetAgents(board: Board):
     '''
     Clears the agent lists
     '''
-    simulatedAgentList.clear()
-    staticAgentList.clear()
+    for agentList in _agent_lists(board):
+        agentList.clear()
 
 def deleteAgent(agent: fastautomata_clib.BaseAgent):
     '''
     Deletes an agent from the agent lists
     '''
-    if isinstance(agent, SimulatedAgent):
-        simulatedAgentList.remove(agent)
-    else:
-        staticAgentList.remove(agent)
+    agentList = getattr(agent, "agentList", None)
+    if agentList is None:
+        agentList = simulatedAgentList if isinstance(agent, SimulatedAgent) else staticAgentList
+    agentList.remove(agent)
 
 class SimulatedAgent(fastautomata_clib.Agent):
     '''
@@ -52,7 +63,8 @@ class SimulatedAgent(fastautomata_clib.Agent):
 
     def __init__(self, board: Board, pos: Pos, state: str, layer: int = 0, allowOverriding: bool = False):
         super().__init__(board, pos, state, layer, allowOverriding)
-        simulatedAgentList.append(self)
+        self.agentList = _agent_lists(board)[0]
+        self.agentList.append(self)
 
     def kill(self):
         # simulatedAgentList.remove(self)
@@ -73,7 +85,8 @@ class StaticAgent(fastautomata_clib.BaseAgent):
     '''
     def __init__(self, board: Board, pos: Pos, state: int, layer: int = 0, allowOverriding: bool = False):
         super().__init__(board, pos, state, layer, allowOverriding)
-        staticAgentList.append(self)
+        self.agentList = _agent_lists(board)[1]
+        self.agentList.append(self)
 
     def kill(self):
         # staticAgentList.remove(self)
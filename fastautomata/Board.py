@@ -8,22 +8,25 @@ class SimulatedBoard(fastautomata_clib.SimulatedBoard):
     '''
     specialValues: dict[str, any] = {}
 
-    simulated: bool = True
-
     python_delete_agents: typing.Callable[[], None] = None
 
     def __init__(self, width: int, height: int, layers: int):
         super().__init__(width, height, layers)
         self.specialValues = {}
-        self.simulated = True
+        self.simulatedAgentList = []
+        self.staticAgentList = []
 
     def step(self) -> None:
         if self.simulated:
             return super().step()
         return None
+
+    def step_n(self, n: int) -> None:
+        if self.simulated:
+            return super().step_n(n)
+        return None
     
     def reset(self) -> None:
-        self.simulated = True
         return super().reset()
 
     def __str__(self) -> str:
@@ -63,13 +63,12 @@ class LocalDraw(IControlledAttachment):
         self.window.push_handlers(self.on_key_press)
 
         self.layered_batch = [pyg.graphics.Batch() for _ in range(board.getLayerCount())]
-        self.drawn_agents: dict[int, shapes.Rectangle] = {}
+        # by (ChangeEntity, id): agents and entities have their own ids
+        self.drawn_agents: dict[tuple[int, int], shapes.Rectangle] = {}
         #pyg.clock.schedule_interval(self.update, 1.0/60.0)
 
-        self.board.append_on_add(self.add_agent)
-        # self.board.on_add.append(other)
-        self.board.append_on_delete(self.remove_agent)
-        self.board.append_on_reset(self.reset)
+        # the changes of the board get read once per frame (no callback per agent)
+        self.board.journal_enable(True)
 
         self.board.specialValues["draw_framerate"] = 0.5
 
@@ -86,6 +85,8 @@ class LocalDraw(IControlledAttachment):
         '''
         Draw the screen
         '''
+        self.apply_changes()
+
         gl.glClearColor(255, 255, 255, 1)  # Set background color to white
         self.window.clear()
         self.base_board.draw()
@@ -106,27 +107,46 @@ class LocalDraw(IControlledAttachment):
         self.draw()
         # logger.debug(f"Step took {((time.time() - start) / 1000):.4f}ms")
 
-    def add_agent(self, agent: fastautomata_clib.BaseAgent):
+    def apply_changes(self):
         '''
-        Add an agent to the board.
+        Update the drawn agents with the changes of the board since the last frame (its journal).
 
-        Will get called automatically by the agent.
+        Will get called automatically before drawing.
         '''
 
-        newDrawnAgent = shapes.Rectangle(
-            x       = agent.pos.x * self.cellSize.x + self.padding, 
-            y       = agent.pos.y * self.cellSize.y + self.padding, 
-            width   = self.cellSize.x - self.padding * 2, 
-            height  = self.cellSize.y - self.padding * 2, 
-            color   = self.board.color_map[agent.state], 
-            batch   = self.layered_batch[agent.getLayer()]
-        )
+        for (step, id, x_old, y_old, x_new, y_new, state_old, state_new, layer_old, layer_new, kind, entity) in self.board.journal_take().tolist():
+            kind = fastautomata_clib.ChangeKind(kind)
+            key = (entity, id)
+
+            if kind == fastautomata_clib.ChangeKind.RESET:
+                self.reset(self.board)
+            elif kind == fastautomata_clib.ChangeKind.ADD:
+                self.drawn_agents[key] = shapes.Rectangle(
+                    x       = x_new * self.cellSize.x + self.padding, 
+                    y       = y_new * self.cellSize.y + self.padding, 
+                    width   = self.cellSize.x - self.padding * 2, 
+                    height  = self.cellSize.y - self.padding * 2, 
+                    color   = self.state_color(state_new), 
+                    batch   = self.layered_batch[layer_new]
+                )
+            elif kind == fastautomata_clib.ChangeKind.REMOVE:
+                drawn = self.drawn_agents.pop(key, None)
+                if drawn is not None:
+                    drawn.delete()
+            elif key in self.drawn_agents:
+                drawn = self.drawn_agents[key]
+                drawn.x = x_new * self.cellSize.x + self.padding
+                drawn.y = y_new * self.cellSize.y + self.padding
+                drawn.color = self.state_color(state_new)
+                if layer_new != layer_old:
+                    drawn.batch = self.layered_batch[layer_new]
 
-        self.drawn_agents[agent.getId()] = newDrawnAgent
+    def state_color(self, state: int):
+        '''
+        Get the color of a state id
+        '''
 
-        if isinstance(agent, fastautomata_clib.Agent):
-            # logger.debug(f"Agent {agent.getId()} added")
-            agent.append_on_update(self.update_agent)
+        return self.board.getColor(self.board.getStateName(state))
 
     def on_key_press(self, symbol, modifiers):
         '''
@@ -145,28 +165,11 @@ class LocalDraw(IControlledAttachment):
                 pyg.clock.schedule_interval(self.step, self.board.specialValues['draw_framerate']) # Call step method every 0.5 seconds
                 self.playing = True
 
-    def update_agent(self, agent: Agents.SimulatedAgent):
-        '''
-        Called by an agent when it's updated. 
-        '''
-
-        self.drawn_agents[agent.getId()].color = self.board.color_map[agent.state]
-        self.drawn_agents[agent.getId()].x = agent.pos.x * self.cellSize.x
-        self.drawn_agents[agent.getId()].y = agent.pos.y * self.cellSize.y
-
-    def remove_agent(self, agent: fastautomata_clib.BaseAgent):
-        '''
-        Gets called when agent kills itself.
-        '''
-
-        self.drawn_agents[agent.getId()].delete()
-        self.drawn_agents.pop(agent.getId())
-
     def reset(self, board: Board.SimulatedBoard):
         '''
-        Resets the board.
+        Removes every drawn agent.
 
-        Will get called automatically by the board.
+        Will get called automatically when the board gets reset.
         '''
 
         for key in self.drawn_agents:
@@ -174,8 +177,6 @@ class LocalDraw(IControlledAttachment):
         
         self.drawn_agents = {}
 
-        self.draw()
-
     def boardReset(self):
         '''
         Resets the board.
@@ -184,6 +185,7 @@ class LocalDraw(IControlledAttachment):
         '''
 
         self.board.reset()
+        self.draw()
 
     def run(self):
         '''
@@ -1,4 +1,4 @@
-from . import BaseClasses, Board, ClassTypes, Agents
+from . import BaseClasses, Board, ClassTypes, Agents, fastautomata_clib
 from typing import Callable
 import csv, timeit, itertools
 
@@ -8,10 +8,12 @@ class Tester(BaseClasses.IBaseAttachment):
 
     Results will be stored as a csv file in the current directory, named results.csv.
 
-    Results will include: run #, board.color_map_count, board.specialValues
+    Results will include: run #, seed, steps, timings, board.color_map_count, board.specialValues
+
+    Boards run in parallel (see fastautomata_clib.Ensemble), so every run gets its own board.
     '''
 
-    def __init__(self, data: dict[str, list[any]], boardSizes: list[ClassTypes.Pos], boardConstructor: Callable[[dict[str, any]], Board.SimulatedBoard], repetitions: int = 1, filename: str = "results.csv"):
+    def __init__(self, data: dict[str, list[any]], boardSizes: list[ClassTypes.Pos], boardConstructor: Callable[[dict[str, any]], Board.SimulatedBoard], repetitions: int = 1, filename: str = "results.csv", threads: int = 0, maxSteps: int = 0, seed: int = 0, batchSize: int = 0, stop: Callable[[Board.SimulatedBoard], bool] = None):
         '''
         Make a new tester attachment.
 
@@ -21,111 +23,109 @@ class Tester(BaseClasses.IBaseAttachment):
             data (dict[str, any]): The data to use to create the board. Call the boardConstructor with every possible combination from data.
                 - any (list): the list of data value
             boardSizes (list[ClassTypes.Pos]): The board sizes to use
-            boardConstructor (Callable[[dict[str, any]], Board.SimulatedBoard]): The board constructor to use
+            boardConstructor (Callable[[dict[str, any]], Board.SimulatedBoard]): The board constructor to use. Called once per run, since boards run at the same time.
             repetitions (int): The amount of times to repeat each board
+            threads (int): The amount of boards that run at once. 0 uses every core
+            maxSteps (int): The step limit of every run. 0 runs until board.simulated is False
+            seed (int): The seed of the first run. Every run gets seed + run
+            batchSize (int): The amount of boards built and run at once. 0 uses 4 per thread
+            stop (Callable[[Board.SimulatedBoard], bool]): [optional] Called after every step, the run stops if it returns True. A python function makes the boards wait for each other (GIL)
         '''
         self.data = data
         self.repetitions = repetitions
         self.boardSizes = boardSizes
         self.boardConstructor = boardConstructor
         self.filename = filename
+        self.threads = threads
+        self.maxSteps = maxSteps
+        self.seed = seed
+        self.batchSize = batchSize
+        self.stop = stop
 
     def run(self):
-        print("Starting test suite. Please do not stop the program until it finishes with the message 'Finished!'. \nSaves to results.csv take a while, and are the last step.")
+        print("Starting test suite. Please do not stop the program until it finishes with the message 'Finished!'. \nResults get saved to the csv at the end.")
         print("Planed stages: Initializing, Running, Saving")
         print(">>>>>>>>>> Stage: Initializing <<<<<<<<<<")
         # calculate amount of runs
         runs = 1
-        totalRuns = 0
 
         for key, value in self.data.items():
             runs *= len(value)
 
-        totalRuns = runs * self.repetitions
-
-        print(f"To run:\n> Total runs: {totalRuns * len(self.boardSizes)}\n> Unique combinations: {runs * len(self.boardSizes)}\n> Dictionary combinations: {runs}\n> Repetitions: {self.repetitions}")
-
-        headers = ["run", "steps", "time"]
-
-        dummyData = {}
+        totalRuns = runs * self.repetitions * len(self.boardSizes)
 
-        for key in self.data.keys():
-            dummyData[key] = self.data[key][0]
+        print(f"To run:\n> Total runs: {totalRuns}\n> Unique combinations: {runs * len(self.boardSizes)}\n> Dictionary combinations: {runs}\n> Repetitions: {self.repetitions}")
 
-        dummyData["board_width"] = 1
-        dummyData["board_height"] = 1
+        threads = fastautomata_clib.Ensemble(self.threads).getThreadCount()
+        batchSize = self.batchSize if self.batchSize > 0 else threads * 4
 
-        dummyBoard = self.boardConstructor(dummyData)
-        for key in dummyData.keys():
-            headers.append(f"data.{key}")
+        print(f"Threads: {threads}, batch size: {batchSize}")
 
-        for key in dummyBoard.specialValues.keys():
-            headers.append(f"specialValues.{key}")
-        
-        for key in dummyBoard.color_map_count.keys():
-            headers.append(f"state.{key}")
-
-        print(f"Headers: {headers}")
-
-        # initialize csv
-        with open(self.filename, "w", newline="") as file:
-            writer = csv.DictWriter(file, fieldnames=headers)
-            writer.writeheader()
-
-        dummyBoard = None
-
-        # boards: list[Board.SimulatedBoard] = [] # TODO remove this and make it a single var. When the memory issue gets fixed.
-
-        # start testing
-        print(">>>>>>>>>> Stage: Running <<<<<<<<<<")
-        timePerStep = 1
+        # every run to do, as (run, localData)
+        pending: list[tuple[int, dict[str, any]]] = []
         for dimension in self.boardSizes:
-            print(f"\n\n>>> Dimension: {dimension} (from {self.boardSizes})")
-
-            step = 0
-
             for values in itertools.product(*self.data.values()):
-                
-
                 localData = dict(zip(self.data.keys(), values))
                 localData["board_width"] = dimension.x
                 localData["board_height"] = dimension.y
 
-                board = self.boardConstructor(localData)
-
                 for i in range(self.repetitions):
-                    print(f"\rStep: {step * self.repetitions + 1 + i}/{runs * self.repetitions}. ETA: {round(runs * timePerStep * self.repetitions / 10) * 10} seconds", end="")
-                    start = timeit.default_timer()
-                    board.reset()
-
-                    while board.simulated:
-                        board.step()
-                    
-                    end = timeit.default_timer()
-
-                    # TODO calculate data and add to csv
-                    with open(self.filename, "a", newline="") as file:
-                        writer = csv.DictWriter(file, fieldnames=headers)
-
-                        # Add prefix to keys in board.specialValues
-                        prefixed_specialValues = {f"specialValues.{k}": v for k, v in board.specialValues.items()}
-
-                        # Add prefix to keys in board.color_map_count
-                        prefixed_color_map_count = {f"state.{k}": v for k, v in board.color_map_count.items()}
-
-                        # Add prefix to keys in localData
-                        prefixed_localData = {f"data.{k}": v for k, v in localData.items()}
-
-                        writer.writerow({
-                            "run": step * self.repetitions + i,
-                            "steps": board.step_count,
-                            "time": end - start,
-                            **prefixed_specialValues,
-                            **prefixed_color_map_count,
-                            **prefixed_localData
-                        })
-
-                    timePerStep = (timePerStep + (timeit.default_timer() - start)) / 2
+                    pending.append((len(pending), localData))
 
+        # start testing
+        print(">>>>>>>>>> Stage: Running <<<<<<<<<<")
+        rows: list[dict[str, any]] = []
+        start = timeit.default_timer()
+        for batchStart in range(0, len(pending), batchSize):
+            batch = pending[batchStart:batchStart + batchSize]
+
+            # the ensemble keeps its boards alive, so a new one per batch lets the previous boards get freed
+            ensemble = fastautomata_clib.Ensemble(threads)
+            if self.stop is not None:
+                ensemble.setStop(self.stop)
+
+            boards = []
+            for run, localData in batch:
+                board = self.boardConstructor(localData)
+                ensemble.add(board, self.seed + run, self.maxSteps)
+                boards.append(board)
+
+            result = ensemble.run()
+            columns = result.columns()
+
+            for index, (run, localData) in enumerate(batch):
+                board = boards[index]
+                row = {
+                    "run": run,
+                    "seed": self.seed + run,
+                    "steps": int(result.steps[index]),
+                    "time": float(result.time[index]),
+                    "step_time_mean": float(result.step_time_mean[index]),
+                    "step_time_max": float(result.step_time_max[index]),
+                }
+                row.update({f"data.{k}": v for k, v in localData.items()})
+                row.update({f"specialValues.{k}": v for k, v in board.specialValues.items()})
+                row.update({k: int(v[index]) for k, v in columns.items() if k.startswith("state.")})
+                rows.append(row)
+
+            ensemble = None
+            boards = None
+
+            done = batchStart + len(batch)
+            elapsed = timeit.default_timer() - start
+            print(f"\rRuns: {done}/{len(pending)}. ETA: {round(elapsed / done * (len(pending) - done))} seconds", end="")
+
+        print("\n>>>>>>>>>> Stage: Saving <<<<<<<<<<")
+        headers = ["run", "seed", "steps", "time", "step_time_mean", "step_time_max"]
+        for row in rows:
+            for key in row.keys():
+                if key not in headers:
+                    headers.append(key)
+
+        # states not known by a board were never counted
+        with open(self.filename, "w", newline="") as file:
+            writer = csv.DictWriter(file, fieldnames=headers, restval=0)
+            writer.writeheader()
+            writer.writerows(rows)
 
-                step += 1
\ No newline at end of file
+        print("Finished!")
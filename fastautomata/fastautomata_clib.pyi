@@ -1,9 +1,19 @@
-from typing import Any, Callable, ClassVar, Dict, List
+from typing import Any, Callable, ClassVar, Dict, List, Optional
 
 from typing import overload
+import numpy
 NONE: CollisionType
 SOLID: CollisionType
 TRIGGER: CollisionType
+CAPI_VERSION: int
+'''The version of the layout of fa_board and fa_agent (see fastautomata_capi.h)'''
+
+def kernel_load(path: str, symbol: str) -> int: ...
+'''
+Load a function from a shared library (a .so, .dylib or .dll), and return its address. The library stays loaded.
+
+Use the address with SimulatedBoard.kernel_add, KernelAgent or agents_spawn(kernel=...). Declare the function extern "C" in c++.
+'''
 
 class Agent(BaseAgent):
     on_update: List[Callable[[Agent],None]]
@@ -21,6 +31,28 @@ class Agent(BaseAgent):
     If wrap is true, the board will wrap around the edges. 
     If layer is -1, it will consider itself.
     '''
+    def wake(self) -> None: ...
+    '''
+    Ask to be stepped in the next step, even if nothing changes around the agent. Only does something with active scheduling (see SimulatedBoard.setActiveScheduling).
+    '''
+    def random(self) -> float: ...
+    '''
+    Returns a random float in [0, 1).
+
+    Keyed by (board seed, step, agent id), so the same simulation gives the same numbers, no matter the amount of threads or the order of the agents. Use it instead of python's random.
+    '''
+    def random_int(self, low: int, high: int) -> int: ...
+    '''
+    Returns a random integer in [low, high] (both included, like random.randint). See random.
+    '''
+    def random_normal(self, mean: float = 0.0, deviation: float = 1.0) -> float: ...
+    '''
+    Returns a normally distributed random float. See random.
+    '''
+    state_id: int
+    '''
+    Get and set the state of the agent by id (see SimulatedBoard.getStateId). Works like state, without the string lookup.
+    '''
     def step(self) -> None: ...
     '''
     Called by the board every step.
@@ -32,6 +64,74 @@ class Agent(BaseAgent):
     The final step called by the board. All changes get applied.
     '''
 
+class KernelAgent(Agent):
+    '''
+    A simulated agent stepped by a C function (a fa_agent_kernel, see fastautomata_capi.h) instead of step(). It does not call into python, so the board can stay native.
+
+    The kernel gets a view of the agent and the board, and writes the state and move it wants (they get queued like setting state and pos).
+    '''
+    def __init__(self, board: SimulatedBoard, pos: Pos, state: str, layer: int, kernel: int, userData: int = 0, allowOverriding: bool = False) -> None: ...
+    '''
+    Parameters:
+        kernel: The address of the function (numba cfunc .address, kernel_load, ...).
+        userData: A pointer the kernel gets called with.
+    '''
+    def setKernel(self, kernel: int, userData: int = 0) -> None: ...
+    '''
+    Change the kernel of the agent (0 to do nothing).
+    '''
+    @property
+    def kernel(self) -> int: ...
+    '''readonly, the address of the kernel'''
+
+class AgentStore:
+    '''
+    The native entities of a board (see SimulatedBoard.entities). Every property is stored by column, and entities get stepped by c++ kernels.
+    Entities collide with agents. Their index changes when other entities get removed, use the id to keep track of one.
+    '''
+    def spawn(self, pos: Pos, state: str, layer: int = ...) -> int: ...
+    '''
+    Adds an entity (the cell must be free) and returns its id.
+    '''
+    def spawn_id(self, pos: Pos, state: int, layer: int = ...) -> int: ...
+    '''
+    Same as spawn, with a state id.
+    '''
+    def kill(self, id: int) -> None: ...
+    '''
+    Removes an entity at the end of the step.
+    '''
+    def size(self) -> int: ...
+    '''The amount of entities.'''
+    def __len__(self) -> int: ...
+    def index(self, id: int) -> int: ...
+    '''The index of an entity in the columns, -1 if it does not exist.'''
+    def attribute_add(self, name: str, value: float = ...) -> int: ...
+    '''
+    Declares a numeric attribute (every entity gets value). Returns the column of the attribute.
+    '''
+    def attribute_get(self, id: int, name: str) -> float: ...
+    def attribute_set(self, id: int, name: str, value: float) -> None: ...
+    def getPos(self, id: int) -> Pos: ...
+    def getState(self, id: int) -> str: ...
+    def getStateId(self, id: int) -> int: ...
+    def kernel_flush(self) -> None: ...
+    '''Removes every kernel.'''
+
+class AgentRecord:
+    '''
+    An agent stored in a checkpoint, given to the restore callback of SimulatedBoard.load. Read only.
+    '''
+    id: int
+    pos: Pos
+    layer: int
+    state: int
+    '''The state id (already translated to the ids of the board)'''
+    type: int
+    '''0 for static agents, 1 for native simulated agents, 2 for python agents'''
+    awake: bool
+    '''True if the agent called wake() in the last step (active scheduling)'''
+
 class BaseAgent:
     @overload
     def __init__(self) -> None: ...
@@ -43,7 +143,7 @@ class BaseAgent:
     '''
     def getId(self) -> int: ...
     '''
-    readonly ID
+    readonly ID. Unique inside the board, and starts again from 0 when the board gets reset.
     '''
     def getLayer(self) -> int: ...
     '''
@@ -72,6 +172,11 @@ class BaseAgent:
 
     The state will set a temporary state_next, and will get updated on step_end.
     '''
+    @property
+    def state_id(self) -> int: ...
+    '''
+    readonly id of the current state. See SimulatedBoard.getStateId.
+    '''
 
 class CollisionList:
     '''
@@ -124,6 +229,14 @@ class CollisionMap:
         layer_start: The layer from which the collision will get rendered from.
         layer_end: The layer to which the collision will get rendered to.
     '''
+    def getLength(self) -> int: ...
+    '''
+    Get the amount of layers of the map.
+    '''
+    def getRevision(self) -> int: ...
+    '''
+    Get the revision of the map. It changes every time a collision gets added.
+    '''
 
 class CollisionType:
     __members__: ClassVar[dict] = ...  # read-only
@@ -147,6 +260,323 @@ class CollisionType:
     @property
     def value(self) -> int: ...
 
+class MovePolicy:
+    __members__: ClassVar[dict] = ...  # read-only
+    SEQUENTIAL: ClassVar[MovePolicy] = ...
+    '''Agents move one after the other, in the order they got added. The first one to ask gets the cell.'''
+    LOWEST_ID: ClassVar[MovePolicy] = ...
+    '''All moves get resolved together. If several agents want the same cell, the lowest id wins.'''
+    RANDOM: ClassVar[MovePolicy] = ...
+    '''All moves get resolved together. If several agents want the same cell, a random one (depends on the board seed and step) wins.'''
+    __entries: ClassVar[dict] = ...
+    def __init__(self, value: int) -> None: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __hash__(self) -> int: ...
+    def __index__(self) -> int: ...
+    def __int__(self) -> int: ...
+    @property
+    def name(self) -> str: ...
+    @property
+    def value(self) -> int: ...
+
+class ChangeKind:
+    __members__: ClassVar[dict] = ...  # read-only
+    ADD: ClassVar[ChangeKind] = ...
+    '''Added to the board. The old values are the same as the new ones.'''
+    REMOVE: ClassVar[ChangeKind] = ...
+    '''Deleted from the board. The new values are the same as the old ones.'''
+    MOVE: ClassVar[ChangeKind] = ...
+    '''Moved to another cell.'''
+    STATE: ClassVar[ChangeKind] = ...
+    '''Changed state.'''
+    LAYER: ClassVar[ChangeKind] = ...
+    '''Moved to another layer.'''
+    RESET: ClassVar[ChangeKind] = ...
+    '''The board got reset: every agent and entity before this change is gone. The id is -1.'''
+    __entries: ClassVar[dict] = ...
+    def __init__(self, value: int) -> None: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __hash__(self) -> int: ...
+    def __index__(self) -> int: ...
+    def __int__(self) -> int: ...
+    @property
+    def name(self) -> str: ...
+    @property
+    def value(self) -> int: ...
+
+class ChangeEntity:
+    __members__: ClassVar[dict] = ...  # read-only
+    AGENT: ClassVar[ChangeEntity] = ...
+    '''The id is of an agent (Agent or BaseAgent).'''
+    ENTITY: ClassVar[ChangeEntity] = ...
+    '''The id is of an entity (see entities()).'''
+    __entries: ClassVar[dict] = ...
+    def __init__(self, value: int) -> None: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __hash__(self) -> int: ...
+    def __index__(self) -> int: ...
+    def __int__(self) -> int: ...
+    @property
+    def name(self) -> str: ...
+    @property
+    def value(self) -> int: ...
+
+class EnsembleResult:
+    '''
+    The results of Ensemble.run, by column (one element per run, in the order the boards got added).
+
+    Columns are read only numpy arrays viewing the result (not copies), they keep it alive.
+    '''
+    run: numpy.ndarray
+    seed: numpy.ndarray
+    steps: numpy.ndarray
+    '''The amount of steps each board ran'''
+    time: numpy.ndarray
+    '''The total time of each run (reset included), in seconds'''
+    step_time_mean: numpy.ndarray
+    step_time_max: numpy.ndarray
+    state_counts: Dict[str, numpy.ndarray]
+    '''The count of each state at the end of each run'''
+    def columns(self) -> Dict[str, List[float]]: ...
+    '''
+    Return every column. The state columns get a "state." prefix.
+    '''
+    def to_csv(self, filename: str, append: bool = False) -> None: ...
+    '''
+    Write every run to a csv file, in one go. If append is True, the rows get added to the end of the file (without header).
+    '''
+    def __len__(self) -> int: ...
+
+class Ensemble:
+    '''
+    Steps many boards in parallel (one board per thread) and collects their results.
+
+    A board stops when it reaches its step limit, when board.simulated is False, or when the stop function returns True.
+    Boards with python agents or python step instructions work, but wait for each other to use python (GIL).
+    '''
+    def __init__(self, threads: int = 0) -> None: ...
+    '''
+    Parameters:
+        threads: The amount of boards stepped at once. 0 uses every core.
+    '''
+    def add(self, board: SimulatedBoard, seed: int = 0, maxSteps: int = 0) -> int: ...
+    '''
+    Add a board to run. It gets seeded and reset when the run starts. Every run needs its own board.
+
+    Parameters:
+        board: The board. The ensemble keeps it alive.
+        seed: The seed given to the board.
+        maxSteps: The step limit. 0 runs until the board stops by itself.
+
+    Returns the index of the run.
+    '''
+    def setStop(self, stop: Callable[[SimulatedBoard], bool]) -> None: ...
+    '''
+    Set a function called after every step of every board. The board stops if it returns True.
+    '''
+    def size(self) -> int: ...
+    def clear(self) -> None: ...
+    def getThreadCount(self) -> int: ...
+    def run(self) -> EnsembleResult: ...
+    '''
+    Reset and step every board until it stops. Blocks until every board finished.
+    '''
+
+class LifeRule:
+    '''
+    A Life-like rule engine running on a field layer. Created by SimulatedBoard.life_add.
+    '''
+    @property
+    def rule(self) -> str: ...
+    '''readonly rulestring'''
+    @property
+    def wrap(self) -> bool: ...
+    '''readonly, if the edges wrap around'''
+    def population(self) -> int: ...
+    '''The amount of alive cells after the last step.'''
+
+class ScalarField:
+    '''
+    One float per cell, stepped natively. numpy.asarray(field) gives a (height, width) float32 view of the values (no copy, stays valid).
+    Cells outside of the board count as the cell itself when the field does not wrap, so nothing leaks out.
+    '''
+    @property
+    def wrap(self) -> bool: ...
+    '''readonly, if the edges wrap around'''
+    @property
+    def diffusion(self) -> float: ...
+    '''readonly, the diffusion rate used every step'''
+    @property
+    def evaporation(self) -> float: ...
+    '''readonly, the evaporation rate used every step'''
+    def setRates(self, diffusion: float, evaporation: float) -> None: ...
+    '''
+    Set the rates (0 to 1) used every step. 0 skips the operator.
+    '''
+    def setStencil(self, stencil: Stencil) -> None: ...
+    '''
+    Set the neighbors used to diffuse every step (moore(1) by default).
+    '''
+    def sample(self, pos: Pos) -> float: ...
+    '''
+    Returns the value at pos (0 outside of the board).
+    '''
+    def deposit(self, pos: Pos, amount: float) -> None: ...
+    '''
+    Adds amount to the value at pos.
+    '''
+    def deposit_layer(self, layer: int, amount: float, state: Optional[str] = None) -> None: ...
+    '''
+    Adds amount to every cell of the layer that holds something (only cells in state, if given).
+    '''
+    def fill(self, value: float) -> None: ...
+    '''
+    Sets every cell to value.
+    '''
+    def total(self) -> float: ...
+    '''
+    Returns the sum of every cell.
+    '''
+    def diffuse(self, rate: float, stencil: Stencil) -> None: ...
+    '''
+    Each cell keeps (1 - rate) of its value, and gets rate times the mean of its neighbors.
+    '''
+    def evaporate(self, rate: float) -> None: ...
+    '''
+    Multiplies every cell by (1 - rate).
+    '''
+    def gradient(self, pos: Pos) -> List[float]: ...
+    '''
+    Returns the change of the value along x and y at pos.
+    '''
+    def uphill(self, pos: Pos) -> Pos: ...
+    '''
+    Returns the cell around pos with the highest value (pos itself if none is higher).
+    '''
+
+class FlowField:
+    '''
+    The distance (in moves) from every cell to the closest target, and the move to make from each cell. Get it with SimulatedBoard.flow_field.
+    Walls are the cells of layers with a SOLID collision, and static agents of the own layer. It only gets recomputed when the walls change.
+    Agents moving in the own layer are free. Changes in a SOLID layer, or to static agents of the own layer, make the next query read the walls again (one pass over the board).
+    '''
+    UNREACHABLE: ClassVar[int] = ...
+    '''The distance of cells that can not reach any target (-1)'''
+    @property
+    def layer(self) -> int: ...
+    '''readonly, the layer that walks'''
+    @property
+    def computations(self) -> int: ...
+    '''readonly, the amount of times the distances got computed'''
+    def getDistance(self, pos: Pos) -> int: ...
+    '''
+    Returns the distance from pos to the closest target, UNREACHABLE if there is no path.
+    '''
+    def next_step(self, pos: Pos) -> Pos: ...
+    '''
+    Returns the cell to move to from pos to get closer to a target (pos itself on a target, or if there is no path).
+    '''
+    def update(self) -> None: ...
+    '''
+    Checks the field against the board (every query already does it).
+    '''
+    def distances(self) -> numpy.ndarray: ...
+    '''
+    Returns a copy of every distance, as an int32 array of shape (height, width).
+    '''
+
+class Replay:
+    '''
+    Reads a recording written by SimulatedBoard.record_start, and rebuilds the board at any of its steps without stepping the agents.
+
+    The file gets indexed when opened: frames written after that are not seen (open it again). Seeking starts from the last keyframe before the step.
+    Every reset or load of the board while recording starts a new run in the file. Steps are counted inside a run, and run -1 means the current one.
+    '''
+    def __init__(self, path: str) -> None: ...
+    def seek(self, step: int, run: int = -1) -> None: ...
+    '''Rebuild the board at a step of a run (between getFirstStep(run) and getLastStep(run)).'''
+    def next(self) -> bool: ...
+    '''Go to the next step (or the start of the next run). Returns False if there are no more steps.'''
+    def getStep(self) -> int: ...
+    def getRun(self) -> int: ...
+    def getRunCount(self) -> int: ...
+    def getFirstStep(self, run: int = -1) -> int: ...
+    def getLastStep(self, run: int = -1) -> int: ...
+    def getWidth(self) -> int: ...
+    def getHeight(self) -> int: ...
+    def getLayerCount(self) -> int: ...
+    def getFieldLayers(self) -> List[int]: ...
+    def getStates(self) -> List[str]: ...
+    '''The names of the states, by id.'''
+    def items(self) -> numpy.ndarray: ...
+    '''
+    Every agent and entity at the current step, sorted by entity and id. A structured array with the fields id, x, y, layer (int32), state (uint16) and entity (a ChangeEntity).
+    '''
+    def field(self, layer: int) -> numpy.ndarray: ...
+    '''The states of a field layer at the current step, as a (height, width) array (a copy).'''
+
+class RuleSet:
+    '''
+    A transition table that steps every agent, entity or field cell of a layer natively, before step() gets called. Get it with SimulatedBoard.rules_add.
+    For each cell, the rules get checked in the order they were added, and the first that matches (and fires) is used.
+    '''
+    @property
+    def layer(self) -> int: ...
+    '''readonly, the layer that gets stepped'''
+    @property
+    def countLayer(self) -> int: ...
+    '''readonly, the layer the neighbors get counted in'''
+    @property
+    def wrap(self) -> bool: ...
+    '''readonly, if the stencil and the moves wrap around the edges'''
+    def add(self, state: Optional[str] = None, next: Optional[str] = None, counts: dict[str, tuple[int, int]] = {}, move: Pos = ..., probability: float = 1.0, layer: int = -1, occupied: bool = True) -> None: ...
+    '''
+    Add a rule at the end of the table.
+
+    Parameters:
+        state: The state of the cell (None matches any state).
+        next: The next state (None keeps it).
+        counts: The amount of neighbors (in the stencil) of each state, as (min, max). Every one must hold.
+        move: The move to make. The rule only matches if the target cell is free.
+        probability: The chance of the rule firing once it matches (drawn from the board seed).
+        layer: A layer to look at in the same cell (-1 to not look).
+        occupied: If the cell must be occupied in that layer, or empty.
+    '''
+    def clear(self) -> None: ...
+    '''
+    Remove every rule.
+    '''
+    def __len__(self) -> int: ...
+
+class Neighborhood:
+    '''
+    A stencil bound to a board. Queries do not allocate, and cells far from the edges get read without bounds checks.
+    A cell holds the state of its agent (or entity), or of the field on field layers.
+    '''
+    def __init__(self, board: SimulatedBoard, stencil: Stencil) -> None: ...
+    @property
+    def stencil(self) -> Stencil: ...
+    def count(self, pos: Pos, layer: int, state: str, wrap: bool = ...) -> int: ...
+    '''
+    Counts the cells around pos in a state.
+    '''
+    def count_id(self, pos: Pos, layer: int, state: int, wrap: bool = ...) -> int: ...
+    '''
+    Same as count, with a state id.
+    '''
+    def count_occupied(self, pos: Pos, layer: int, wrap: bool = ...) -> int: ...
+    '''
+    Counts the cells around pos that hold an agent, an entity or a non empty field cell.
+    '''
+    def first_empty(self, pos: Pos, layer: int, wrap: bool = ...) -> Optional[Pos]: ...
+    '''
+    Returns the first cell around pos (in stencil order) that is not occupied, None if there is none.
+    '''
+    def agents(self, pos: Pos, layer: int, wrap: bool = ...) -> List[BaseAgent]: ...
+    '''
+    Returns the agents around pos (empty cells are skipped).
+    '''
+
 class Pos:
     x: int
     '''The x position of the position'''
@@ -190,8 +620,9 @@ class SimulatedBoard:
     color_map: Dict[str,List[int[3]]]
     '''
     A map of all the colors. The key is the cell type, and the value is rgb colors in list format.
-    
-    WARNING: Do not use .append() to add colors. Use .addColor() instead.
+
+    Reading it builds a new dict, so changing that dict (color_map[key] = color) does not change the board. Use .addColor() instead.
+    Assigning a dict replaces the colors: states in it get added (or recolored), states left out keep existing (their ids never change) with their default color.
     '''
     layer_collisions: CollisionMap
     '''A map of all the collisions between layers.'''
@@ -207,6 +638,12 @@ class SimulatedBoard:
 
     WARNING: Using .append() will not work. Use .append_on_delete() instead.
     '''
+    on_spawn: list[Callable[[List[int]],None]]
+    '''
+    A list of functions that will get called once per agents_spawn, with the ids of every agent it added.
+
+    WARNING: Using .append() will not work. Use .append_on_spawn() instead.
+    '''
     python_on_delete: Callable[[BaseAgent],None]
     '''
     A function to call the python delete. Since you know, python really likes to take out the trash...
@@ -233,6 +670,10 @@ class SimulatedBoard:
 
     READONLY!!!
     '''
+    simulated: bool
+    '''
+    False once the simulation finished. Set it to False (for example in a step instruction) to stop the board. It gets set to True on reset.
+    '''
     def step_instructions_add(func: Callable[[SimulatedBoard],None]) -> None: ...
     def step_instructions_flush(): ...
     '''
@@ -248,6 +689,18 @@ class SimulatedBoard:
     '''
     Add a new color to the color_map.
     '''
+    def getColor(self, key: str) -> List[int[3]]: ...
+    '''
+    Get the color of a state. Faster than color_map[key], since it does not build the whole dictionary.
+    '''
+    def getStateId(self, key: str) -> int: ...
+    '''
+    Get the id of a state. States are stored as ids internally. If the state does not exist, it gets added with a random color.
+    '''
+    def getStateName(self, id: int) -> str: ...
+    '''
+    Get the name of a state id.
+    '''
     def agent_add(self, agent: BaseAgent, allowOverrides: bool = False) -> None: ...
     '''
     Add a new agent to the board. 
@@ -259,6 +712,23 @@ class SimulatedBoard:
         allowOverrides: If true, the agent will replace the other agent in the same pos.
     '''
 
+    def agents_spawn(self, positions: numpy.ndarray, states: str | numpy.ndarray, layers: int | numpy.ndarray = 0, simulated: bool = False, kernel: int = 0, userData: int = 0) -> numpy.ndarray: ...
+    '''
+    Create many static agents at once, natively. The board owns them (they are not in the python agent lists).
+
+    Every cell gets checked first: if one is taken (or repeated), nothing gets added. on_add is not called, on_spawn gets called once instead.
+
+    Parameters:
+        positions: An (n, 2) array of x, y.
+        states: A state name for every agent, or an array of state ids (see getStateId).
+        layers: A layer for every agent, or an array with the layer of each one.
+        simulated: Create native agents that get stepped (by a RuleSet, see rules_add) instead of static ones.
+        kernel: The address of a fa_agent_kernel. Creates KernelAgents stepped by it (see KernelAgent).
+        userData: A pointer the kernel gets called with.
+
+    Returns the ids of the new agents (see agent_by_id).
+    '''
+
     def agent_get(self, pos: Pos, layer:int = 1, wrap: bool = False) -> BaseAgent | None: ...
     '''
     Get an agent from the board. 
@@ -290,6 +760,24 @@ class SimulatedBoard:
     Remove an agent from the board.
 
     You should't call this directly, the agent's kill() method calls it already, but that's just a wrapper.
+
+    The agent gets deleted at the end of the step. Removing it twice does nothing.
+    '''
+    def agent_by_id(self, id: int) -> BaseAgent | None: ...
+    '''
+    Returns the agent with that id, or None if it was removed (or never existed).
+    '''
+    def getAgentCount(self) -> int: ...
+    '''
+    Returns the amount of agents on the board (static agents included).
+    '''
+    def entities(self) -> AgentStore: ...
+    '''
+    Returns the store of native entities of the board (created on the first call).
+    '''
+    def entity_at(self, pos: Pos, layer: int = ...) -> int: ...
+    '''
+    Returns the id of the entity at a position, -1 if there is none.
     '''
 
     def append_on_add(self, func: Callable[[BaseAgent], None]) -> None: ...
@@ -302,6 +790,11 @@ class SimulatedBoard:
     Append a new function to the on_delete list.
     '''
 
+    def append_on_spawn(self, func: Callable[[List[int]], None]) -> None: ...
+    '''
+    Append a new function to the on_spawn list.
+    '''
+
     def append_on_reset(self, func: Callable[[SimulatedBoard],None]) -> None: ...
     '''
     Append a new function to the on_reset list.
@@ -319,6 +812,238 @@ class SimulatedBoard:
         includeSelf: If true, it will count collision with self.
     '''
 
+    def move_blocked(self, pos: Pos, layer: int, includeSelf: bool = True) -> bool: ...
+    '''
+    Check if something in layer can not move to pos (the cell is taken in its own layer, or in a layer with a SOLID collision).
+    Same as looking for SOLID in getCollisions, without building the dictionary.
+    Raises IndexError if pos is outside the board or layer does not exist.
+    '''
+
+    def flow_field(self, targets: List[Pos], layer: int = 0, diagonal: bool = True, wrap: bool = False) -> FlowField: ...
+    '''
+    Returns the flow field to a set of targets. Fields are cached: asking again for the same targets returns the same field.
+    A field keeps the board alive, and keeps working after flow_fields_clear (it is just not cached anymore).
+
+    Parameters:
+        targets: The cells to walk to.
+        layer: The layer that walks.
+        diagonal: If true, agents move to the 8 cells around them. If false, only to the 4 orthogonal ones.
+        wrap: If the edges of the board wrap around.
+    '''
+
+    def flow_fields_clear(self) -> None: ...
+    '''
+    Remove every cached flow field. Fields you still hold keep working.
+    '''
+
+    def rules_add(self, layer: int, stencil: Stencil, countLayer: int = -1, wrap: bool = False) -> RuleSet: ...
+    '''
+    Step a layer with a transition table instead of step(). The rules run natively (in parallel) before the step instructions.
+    Agents and entities get their changes queued, field cells get written to the next step. Add the rules to the returned RuleSet.
+    A layer that runs a Life rule (see life_add) can not have a rule set.
+
+    Parameters:
+        layer: The layer that gets stepped (one rule set per layer).
+        stencil: The neighbors that get counted.
+        countLayer: The layer the neighbors get counted in (-1 for the same layer).
+        wrap: If the stencil and the moves wrap around the edges.
+    '''
+
+    def kernel_add(self, kernel: int, userData: int = 0) -> None: ...
+    '''
+    Add a C function (a fa_board_kernel, see fastautomata_capi.h) that gets called once per step, before the agents get stepped (after the rule sets). The board stays native.
+
+    Parameters:
+        kernel: The address of the function (numba cfunc .address, kernel_load, ...).
+        userData: A pointer the kernel gets called with.
+    '''
+
+    def kernels_clear(self) -> None: ...
+    '''
+    Remove every kernel added with kernel_add.
+    '''
+
+    def save(self, path: str) -> None: ...
+    '''
+    Write a binary checkpoint of the board: the states and colors, the collisions, the field layers, the scalar fields, the agents, the entities, the step count, the random generator, the move policy and active scheduling.
+
+    Code is not saved (step instructions, rules, kernels, callbacks), and neither is the thread count. The file gets replaced only once it is fully written.
+    '''
+
+    def load(self, path: str, restore: Callable[[AgentRecord], None] = None) -> None: ...
+    '''
+    Replace what is on the board with a checkpoint written by save. The board must have the same size and amount of layers. The file gets mapped into memory and copied in bulk.
+
+    Add the code again before or after loading, the thread count stays the one of the board. Agents come back as plain Agents (or BaseAgents if they were static), unless restore adds one for the record: it gets called once per agent, and the agent it adds gets the saved id.
+    Agents implemented in python (record.type 2) have to be added by restore. Agents that called wake() stay awake.
+    Raises ValueError if the file is not a checkpoint of this board (or a python agent did not get restored), and leaves the board empty if it breaks while loading.
+    '''
+
+    def record_start(self, path: str, keyframeInterval: int = 100) -> None: ...
+    '''
+    Record every step of the board to a file until record_stop. Replay it with Replay. A reset or a load does not stop it: the board after it starts a new run in the file.
+
+    The file holds a keyframe (every agent, entity and field layer) every keyframeInterval steps, and the changes of each step in between (moves, state and layer changes, agents added and removed, field cells changed).
+    The frames get encoded and written by another thread. Scalar fields are not recorded.
+    '''
+
+    def record_stop(self) -> None: ...
+    '''
+    Finish writing the recording and close it. Raises RuntimeError if the file could not be written.
+    '''
+
+    def getRecording(self) -> bool: ...
+
+    def stream_enable(self, enabled: bool = True) -> None: ...
+    '''
+    Start (or stop) keeping the changes of the board for stream_take. Every call starts from the board as it is now.
+
+    A stream sends the frames of a recording to viewers: each gets stream_keyframe once, then every stream_take. The messages of a viewer, one after the other, are a recording Replay can read.
+    '''
+
+    def getStreamEnabled(self) -> bool: ...
+
+    def stream_take(self) -> bytes: ...
+    '''
+    Take the changes since the last call (or since stream_enable): a STEP frame (agents added, removed, moved or changed, the field cells that changed) and a COUNTS frame (the cells of each state).
+    '''
+
+    def stream_keyframe(self, header: bool = False) -> bytes: ...
+    '''
+    Get the whole board for a viewer that joins: a KEYFRAME frame and a COUNTS frame, after the header of a recording if header is True. Does not change what stream_take sends.
+
+    Call stream_take first, so the changes before it do not reach the viewer twice.
+    '''
+
+    def field_enable(self, layer: int, emptyState: str = "None") -> None: ...
+    '''
+    Turn a layer into a field layer. A field layer stores one state per cell instead of agents (1 or 2 bytes per cell).
+
+    Field layers are double buffered: field_get reads the current step, field_set writes the next one. The buffers get swapped at the end of step().
+
+    Cells in emptyState are not counted in color_map_count and do not collide. The layer must not contain agents.
+    '''
+
+    def is_field(self, layer: int) -> bool: ...
+    '''
+    Returns true if the layer is a field layer.
+    '''
+
+    def field_get(self, pos: Pos, layer: int, wrap: bool = False) -> str: ...
+    '''
+    Get the state of a cell in a field layer (current step). Returns "" if the position is out of bounds.
+    '''
+
+    def field_get_id(self, pos: Pos, layer: int, wrap: bool = False) -> int: ...
+    '''
+    Same as field_get, but returns the state id. Returns 65535 if the position is out of bounds.
+    '''
+
+    def field_set(self, pos: Pos, state: str, layer: int) -> None: ...
+    '''
+    Queue the state of a cell in a field layer. It will get applied at the end of the step.
+    '''
+
+    def field_set_id(self, pos: Pos, state: int, layer: int) -> None: ...
+    '''
+    Same as field_set, but with a state id.
+    '''
+
+    def field_put(self, pos: Pos, state: str, layer: int) -> None: ...
+    '''
+    Set the state of a cell in a field layer right now. Use this in on_reset generators.
+    '''
+
+    def field_put_id(self, pos: Pos, state: int, layer: int) -> None: ...
+    '''
+    Same as field_put, but with a state id.
+    '''
+
+    def neighbor_count(self, layer: int, state: str, stencil: Stencil, wrap: bool = False, out: Optional[numpy.ndarray] = None) -> numpy.ndarray: ...
+    '''
+    Count, for every cell of a layer, the neighbors (cells of the stencil) in a state. One native pass over the board.
+
+    Parameters:
+        layer: The layer to look at.
+        state: The state to count.
+        stencil: The neighbors of each cell.
+        wrap: If the stencil wraps around the edges.
+        out: A writeable, c contiguous int32 array of shape (height, width) to write into (used as is, never converted: anything else raises ValueError). A new one gets created if None.
+
+    Returns:
+        The counts, indexed [y, x].
+    '''
+    def neighbor_counts(self, layer: int, stencil: Stencil, wrap: bool = False, out: Optional[numpy.ndarray] = None) -> numpy.ndarray: ...
+    '''
+    Same as neighbor_count, for every state at once. The result has shape (states, height, width), indexed by state id (see getStateId).
+    If out is given, only the states that fit in its first dimension get counted.
+    '''
+    def layer_view(self, layer: int) -> numpy.ndarray: ...
+    '''
+    Returns a read only uint16 view (height, width) of the state id of every cell of a layer (no copy). Empty cells of agent layers hold 65535.
+    The view shows the current step: it gets refreshed at the end of every step and after a reset (changes made in between show up after views_sync).
+    '''
+    def occupancy_view(self) -> Optional[numpy.ndarray]: ...
+    '''
+    Returns a read only uint64 view (height, width) of the agent layers that hold something in each cell (bit n is layer n). Always up to date.
+    Field layers do not get bits. None if the board has more than 64 layers.
+    '''
+    def views_sync(self) -> None: ...
+    '''
+    Refresh every view returned by layer_view.
+    '''
+    def journal_enable(self, enabled: bool = True) -> None: ...
+    '''
+    Keep a journal of the changes of the agents and entities (added, removed, moved, changed state or layer). Disabled by default.
+
+    Read it once per step with journal_take, instead of getting a callback (on_add, on_update, ...) per change.
+    Field layers and scalar fields are not journaled (read them whole, see layer_view).
+    Nothing gets dropped: the journal keeps growing until it gets taken. Disabling it also empties it.
+    '''
+    def getJournalEnabled(self) -> bool: ...
+    def getJournalSize(self) -> int: ...
+    '''
+    Returns the amount of changes waiting in the journal.
+    '''
+    def journal_take(self) -> numpy.ndarray: ...
+    '''
+    Take the journal: returns every change since the last call (in order) and starts an empty one.
+
+    The result is a structured array with one record per change, with the fields:
+        step, id, x_old, y_old, x_new, y_new (int32), state_old, state_new (uint16), layer_old, layer_new (int16), kind (a ChangeKind), entity (a ChangeEntity).
+
+    A reset empties the journal and writes a RESET change, followed by the agents added by on_reset.
+    '''
+    def life_add(self, layer: int, rule: str, wrap: bool = False, aliveState: str = "Alive", deadState: str = "Dead") -> LifeRule: ...
+    '''
+    Run a Life-like automata (for example "B3/S23", "S23/B3" or "23/3") on a layer, natively. No agents needed.
+
+    The layer gets turned into a field layer (deadState as the empty state) if it is not one already. Use field_put to set the starting cells.
+    Cells get stored as packed bits, so a step is way faster than stepping agents. Results can be read with field_get and color_map_count.
+    field_set and kernels can still write the layer (the change shows up after the next step), but it can not have a rule set too.
+
+    Parameters:
+        layer: The layer to run on.
+        rule: The B/S rulestring.
+        wrap: If true, the edges of the board wrap around (same as agent_get).
+        aliveState: The state of alive cells.
+        deadState: The state of dead cells.
+    '''
+
+    def scalar_add(self, name: str, wrap: bool = False) -> ScalarField: ...
+    '''
+    Add a float field (heat, pheromones, ...). It does not take a layer. Every step it diffuses and evaporates with its rates (see ScalarField.setRates).
+
+    Parameters:
+        name: The name of the field.
+        wrap: If true, the edges of the board wrap around.
+    '''
+
+    def scalar(self, name: str) -> ScalarField: ...
+    '''
+    Returns the float field added with that name.
+    '''
+
     def getHeight(self) -> int: ...
     '''
     Return the defined height of the board.
@@ -329,11 +1054,82 @@ class SimulatedBoard:
     Return the defined layer count of the board.
     '''
 
+    def setThreadCount(self, threads: int) -> None: ...
+    '''
+    Set the amount of threads used to step agents. 1 (default) steps in serial, 0 uses every core.
+
+    Threads are kept alive between steps. Only native agents (implemented in c++) get stepped in parallel, agents implemented in python are always stepped in serial.
+
+    Agents stepped in parallel can only use states that already exist: register new ones with `setColorMap` before stepping.
+    '''
+
+    def getThreadCount(self) -> int: ...
+    '''
+    Return the amount of threads used to step agents.
+    '''
+    def setSeed(self, seed: int) -> None: ...
+    '''
+    Set the seed used by the board for anything random (for example, the RANDOM move policy).
+    '''
+    def getSeed(self) -> int: ...
+    '''
+    Return the seed of the board.
+    '''
+    def setMovePolicy(self, policy: MovePolicy, allowSwaps: bool = False) -> None: ...
+    '''
+    Set how agent moves get resolved.
+
+    Parameters:
+        policy: SEQUENTIAL moves every agent in order (default). LOWEST_ID and RANDOM resolve every move of the step together, so the result does not depend on the amount of threads.
+        allowSwaps: If true, agents that move into each other's cells (a swap or a cycle) all move. Otherwise none of them does.
+    '''
+    def getMovePolicy(self) -> MovePolicy: ...
+    '''
+    Return the current move policy.
+    '''
+    def setActiveScheduling(self, enabled: bool, radius: int = 1, wrap: bool = False) -> None: ...
+    '''
+    Only step the agents that are close to a change.
+
+    An agent gets stepped if a cell (in any layer) within radius changed during the previous step, or if it called wake().
+    Cells change when agents get added, removed, moved or change state, and when field cells change.
+
+    Parameters:
+        enabled: If False, every agent gets stepped (default).
+        radius: The neighborhood (square) that the agents look at.
+        wrap: If the neighborhood wraps around the edges.
+    '''
+    def getActiveScheduling(self) -> bool: ...
+    '''
+    Return True if active scheduling is enabled.
+    '''
+    def getActiveCount(self) -> int: ...
+    '''
+    Return the amount of agents that got stepped in the last step.
+    '''
+
     @staticmethod
     def getRandomColor() -> List[int[3]]: ...
     '''
     Gets a random color. Literally nothing more to it.
     '''
+    @staticmethod
+    def getStateColor(name: str) -> List[int[3]]: ...
+    '''
+    Gets the color given to states that were not added with addColor. Always the same for the same name.
+    '''
+    def random(self) -> float: ...
+    '''
+    Returns a random float in [0, 1) from the board stream, keyed by (seed, step). The stream starts again every step, so the same calls give the same numbers.
+    '''
+    def random_int(self, low: int, high: int) -> int: ...
+    '''
+    Returns a random integer in [low, high] (both included) from the board stream.
+    '''
+    def random_uniform(self, count: int) -> numpy.ndarray: ...
+    '''
+    Returns a numpy array of count random floats in [0, 1) from the board stream. Faster than calling random count times (same numbers).
+    '''
 
     def getWidth(self) -> int: ...
     '''
@@ -351,6 +1147,16 @@ class SimulatedBoard:
     Make a board step. Calls all the functions in the step_instructions list.
 
     By default update_agents and update_agents_end are added to step_instructions.
+
+    If the board is native (see is_native), the GIL gets released while stepping, so other python threads can step other boards at the same time.
+    '''
+    def step_n(self, n: int) -> None: ...
+    '''
+    Make n board steps. Works like calling step n times, without going back to python in between.
+    '''
+    def is_native(self) -> bool: ...
+    '''
+    Return True if a step runs fully in c++: there are no agents implemented in python, and every step instruction is a c++ function.
     '''
 
     def updateColor(self, arg0: str, arg1: str) -> None: ...
@@ -375,3 +1181,48 @@ class SimulatedBoard:
     '''
     Update all the agents. Calls the step_end() method of all the agents.
     '''
+
+class Stencil:
+    '''
+    A list of offsets around a cell. Hex stencils have different offsets for even and odd rows.
+    '''
+    @staticmethod
+    def moore(radius: int = ..., includeCenter: bool = ...) -> Stencil: ...
+    '''The square around the cell.'''
+    @staticmethod
+    def von_neumann(radius: int = ..., includeCenter: bool = ...) -> Stencil: ...
+    '''The cells within a manhattan distance.'''
+    @staticmethod
+    def hex(radius: int = ..., includeCenter: bool = ...) -> Stencil: ...
+    '''The cells within a hex distance (odd rows are shifted half a cell to the right).'''
+    @staticmethod
+    def custom(offsets: List[Pos]) -> Stencil: ...
+    @staticmethod
+    def from_mask(mask: List[List[int]]) -> Stencil: ...
+    '''
+    A stencil from a mask with odd sides, centered on the cell. The first row is the top one.
+    '''
+    @property
+    def type(self) -> StencilType: ...
+    @property
+    def radius(self) -> int: ...
+    def getOffsets(self, y: int = ...) -> List[Pos]: ...
+    '''The offsets used for a cell in row y.'''
+    def __len__(self) -> int: ...
+
+class StencilType:
+    __members__: ClassVar[dict] = ...  # read-only
+    MOORE: ClassVar[StencilType] = ...
+    VON_NEUMANN: ClassVar[StencilType] = ...
+    HEX: ClassVar[StencilType] = ...
+    CUSTOM: ClassVar[StencilType] = ...
+    __entries: ClassVar[dict] = ...
+    def __init__(self, value: int) -> None: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __hash__(self) -> int: ...
+    def __index__(self) -> int: ...
+    def __int__(self) -> int: ...
+    @property
+    def name(self) -> str: ...
+    @property
+    def value(self) -> int: ...
@@ -0,0 +1,389 @@
+#include "AgentStore.hpp"
+#include "Board.hpp"
+#include <stdexcept>
+
+namespace fastautomata::Agents {
+    AgentStore::AgentStore(Board::SimulatedBoard *board)
+    {
+        this->board = board;
+    }
+
+    uint32_t AgentStore::spawn(Pos pos, uint16_t state, int layer)
+    {
+        if (layer < 0 || layer >= this->board->getLayerCount())
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+        if (this->board->is_field(layer))
+        {
+            throw std::invalid_argument("Cannot add an entity to a field layer (layer: " + std::to_string(layer) + ")");
+        }
+        if (!this->board->pos_resolve(pos, false))
+        {
+            throw std::out_of_range("Position out of range when adding an entity. (Pos given: " + pos.toString() + ")");
+        }
+        if (state >= this->board->states.size())
+        {
+            throw std::out_of_range("State id out of range (id given: " + std::to_string(state) + ")");
+        }
+        if (this->board->cell_occupied(pos, layer))
+        {
+            throw std::invalid_argument("Cannot add an entity at " + pos.toString() + ", the cell is occupied");
+        }
+
+        uint32_t entityId = this->next_id++;
+        uint32_t index = static_cast<uint32_t>(this->id.size());
+
+        this->x.push_back(pos.x);
+        this->y.push_back(pos.y);
+        this->layer.push_back(layer);
+        this->state.push_back(state);
+        this->id.push_back(entityId);
+        this->state_next.push_back(StateRegistry::NONE);
+        this->x_next.push_back(0);
+        this->y_next.push_back(0);
+        this->has_pos_next.push_back(0);
+        this->killed.push_back(0);
+        for (size_t i = 0; i < this->attributes.size(); i++)
+        {
+            this->attributes[i].push_back(this->attribute_defaults[i]);
+        }
+
+        this->indices.push_back(index);
+
+        this->board->entity_cell(layer, pos.toIndex(this->board->getWidth())) = entityId;
+        this->board->occupancy_update(layer, pos.toIndex(this->board->getWidth()));
+        this->board->state_counts[state] += 1;
+        this->board->cell_touch(pos);
+        this->board->journal_add(Journal::ADD, Journal::ENTITY, static_cast<int>(entityId), pos, pos, state, state, layer, layer);
+
+        return entityId;
+    }
+
+    void AgentStore::kill(uint32_t id)
+    {
+        int index = this->index(id);
+        if (index < 0)
+        {
+            throw std::out_of_range("No entity with id " + std::to_string(id));
+        }
+        this->killed[index] = 1;
+    }
+
+    size_t AgentStore::size()
+    {
+        return this->id.size();
+    }
+
+    int AgentStore::index(uint32_t id)
+    {
+        if (id >= this->indices.size() || this->indices[id] == NONE)
+        {
+            return -1;
+        }
+        return static_cast<int>(this->indices[id]);
+    }
+
+    int AgentStore::attribute_add(std::string name, double value)
+    {
+        int existing = this->attribute_index(name);
+        if (existing >= 0)
+        {
+            return existing;
+        }
+
+        this->attribute_names.push_back(name);
+        this->attribute_defaults.push_back(value);
+        this->attributes.emplace_back(this->id.size(), value);
+        return static_cast<int>(this->attributes.size() - 1);
+    }
+
+    int AgentStore::attribute_index(const std::string &name)
+    {
+        for (size_t i = 0; i < this->attribute_names.size(); i++)
+        {
+            if (this->attribute_names[i] == name)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    double AgentStore::attribute_get(uint32_t id, const std::string &name)
+    {
+        int index = this->index(id);
+        int column = this->attribute_index(name);
+        if (index < 0)
+        {
+            throw std::out_of_range("No entity with id " + std::to_string(id));
+        }
+        if (column < 0)
+        {
+            throw std::invalid_argument("Unknown attribute: " + name);
+        }
+        return this->attributes[column][index];
+    }
+
+    void AgentStore::attribute_set(uint32_t id, const std::string &name, double value)
+    {
+        int index = this->index(id);
+        int column = this->attribute_index(name);
+        if (index < 0)
+        {
+            throw std::out_of_range("No entity with id " + std::to_string(id));
+        }
+        if (column < 0)
+        {
+            throw std::invalid_argument("Unknown attribute: " + name);
+        }
+        this->attributes[column][index] = value;
+    }
+
+    Pos AgentStore::getPos(uint32_t id)
+    {
+        int index = this->index(id);
+        if (index < 0)
+        {
+            throw std::out_of_range("No entity with id " + std::to_string(id));
+        }
+        return Pos(this->x[index], this->y[index]);
+    }
+
+    uint16_t AgentStore::getStateId(uint32_t id)
+    {
+        int index = this->index(id);
+        if (index < 0)
+        {
+            throw std::out_of_range("No entity with id " + std::to_string(id));
+        }
+        return this->state[index];
+    }
+
+    Board::SimulatedBoard *AgentStore::getBoard()
+    {
+        return this->board;
+    }
+
+    void AgentStore::kernel_add(Kernel kernel)
+    {
+        this->kernels.push_back(kernel);
+    }
+
+    void AgentStore::kernel_flush()
+    {
+        this->kernels.clear();
+    }
+
+    void AgentStore::run_kernels()
+    {
+        for (auto &kernel : this->kernels)
+        {
+            this->board->parallel_for(this->size(), 0, [&](size_t begin, size_t end) {
+                kernel(*this, begin, end);
+            });
+        }
+    }
+
+    void AgentStore::commit()
+    {
+        auto board = this->board;
+        int width = board->getWidth();
+        int height = board->getHeight();
+        size_t count = this->size();
+
+        // states (kernels write state_next directly, a state the board does not know gets dropped)
+        size_t states = board->states.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (this->state_next[i] != StateRegistry::NONE && this->state_next[i] >= states)
+            {
+                this->state_next[i] = StateRegistry::NONE;
+            }
+            else if (this->state_next[i] != StateRegistry::NONE)
+            {
+                board->updateColor(this->state[i], this->state_next[i]);
+                board->cell_touch(Pos(this->x[i], this->y[i]));
+                board->journal_add(Journal::STATE, Journal::ENTITY, static_cast<int>(this->id[i]), Pos(this->x[i], this->y[i]), Pos(this->x[i], this->y[i]), this->state[i], this->state_next[i], this->layer[i], this->layer[i]);
+                this->state[i] = this->state_next[i];
+                this->state_next[i] = StateRegistry::NONE;
+            }
+        }
+
+        // moves, in entity order (an entity can take the cell another one left before it)
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!this->has_pos_next[i])
+            {
+                continue;
+            }
+            this->has_pos_next[i] = 0;
+
+            Pos from(this->x[i], this->y[i]);
+            Pos to(this->x_next[i], this->y_next[i]);
+            if (to == from || to.x < 0 || to.y < 0 || to.x >= width || to.y >= height)
+            {
+                continue;
+            }
+
+            int entityLayer = this->layer[i];
+            if (board->move_blocked(to, entityLayer))
+            {
+                continue;
+            }
+
+            board->entity_cell(entityLayer, from.toIndex(width)) = NONE;
+            board->entity_cell(entityLayer, to.toIndex(width)) = this->id[i];
+            board->occupancy_update(entityLayer, from.toIndex(width));
+            board->occupancy_update(entityLayer, to.toIndex(width));
+            board->cell_touch(from);
+            board->cell_touch(to);
+            board->journal_add(Journal::MOVE, Journal::ENTITY, static_cast<int>(this->id[i]), from, to, this->state[i], this->state[i], entityLayer, entityLayer);
+            this->x[i] = to.x;
+            this->y[i] = to.y;
+        }
+
+        // removals. The last entity takes the place of the removed one, so the index gets checked again
+        size_t i = 0;
+        while (i < this->size())
+        {
+            if (this->killed[i])
+            {
+                this->remove_index(i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+    void AgentStore::remove_index(size_t index)
+    {
+        Pos pos(this->x[index], this->y[index]);
+        this->board->entity_cell(this->layer[index], pos.toIndex(this->board->getWidth())) = NONE;
+        this->board->occupancy_update(this->layer[index], pos.toIndex(this->board->getWidth()));
+        this->board->state_counts[this->state[index]] -= 1;
+        this->board->cell_touch(pos);
+        this->board->journal_add(Journal::REMOVE, Journal::ENTITY, static_cast<int>(this->id[index]), pos, pos, this->state[index], this->state[index], this->layer[index], this->layer[index]);
+        this->indices[this->id[index]] = NONE;
+
+        size_t last = this->size() - 1;
+        if (index != last)
+        {
+            this->x[index] = this->x[last];
+            this->y[index] = this->y[last];
+            this->layer[index] = this->layer[last];
+            this->state[index] = this->state[last];
+            this->id[index] = this->id[last];
+            this->state_next[index] = this->state_next[last];
+            this->x_next[index] = this->x_next[last];
+            this->y_next[index] = this->y_next[last];
+            this->has_pos_next[index] = this->has_pos_next[last];
+            this->killed[index] = this->killed[last];
+            for (auto &column : this->attributes)
+            {
+                column[index] = column[last];
+            }
+            this->indices[this->id[index]] = static_cast<uint32_t>(index);
+        }
+
+        this->x.pop_back();
+        this->y.pop_back();
+        this->layer.pop_back();
+        this->state.pop_back();
+        this->id.pop_back();
+        this->state_next.pop_back();
+        this->x_next.pop_back();
+        this->y_next.pop_back();
+        this->has_pos_next.pop_back();
+        this->killed.pop_back();
+        for (auto &column : this->attributes)
+        {
+            column.pop_back();
+        }
+    }
+
+    void AgentStore::restore(size_t count, const int32_t *x, const int32_t *y, const int32_t *layer, const uint16_t *state, const uint32_t *id, uint32_t nextId)
+    {
+        if (!this->id.empty())
+        {
+            throw std::invalid_argument("Entities can only be restored into an empty store");
+        }
+
+        int width = this->board->getWidth();
+        for (size_t i = 0; i < count; i++)
+        {
+            Pos pos(x[i], y[i]);
+            if (layer[i] < 0 || layer[i] >= this->board->getLayerCount() || this->board->is_field(layer[i]) || !this->board->pos_resolve(pos, false)
+                || state[i] >= this->board->states.size() || id[i] >= nextId || this->board->cell_occupied(pos, layer[i]))
+            {
+                throw std::invalid_argument("Cannot restore the entity " + std::to_string(id[i]) + " at " + pos.toString());
+            }
+
+            if (id[i] >= this->indices.size())
+            {
+                this->indices.resize(id[i] + 1, NONE);
+            }
+            this->indices[id[i]] = static_cast<uint32_t>(i);
+
+            this->board->entity_cell(layer[i], pos.toIndex(width)) = id[i];
+            this->board->occupancy_update(layer[i], pos.toIndex(width));
+            this->board->state_counts[state[i]] += 1;
+            this->board->cell_touch(pos);
+            this->board->journal_add(Journal::ADD, Journal::ENTITY, static_cast<int>(id[i]), pos, pos, state[i], state[i], layer[i], layer[i]);
+        }
+
+        this->x.assign(x, x + count);
+        this->y.assign(y, y + count);
+        this->layer.assign(layer, layer + count);
+        this->state.assign(state, state + count);
+        this->id.assign(id, id + count);
+        this->state_next.assign(count, StateRegistry::NONE);
+        this->x_next.assign(count, 0);
+        this->y_next.assign(count, 0);
+        this->has_pos_next.assign(count, 0);
+        this->killed.assign(count, 0);
+        for (size_t i = 0; i < this->attributes.size(); i++)
+        {
+            this->attributes[i].assign(count, this->attribute_defaults[i]);
+        }
+        this->indices.resize(nextId, NONE);
+        this->next_id = nextId;
+    }
+
+    const std::vector<std::string> &AgentStore::getAttributeNames()
+    {
+        return this->attribute_names;
+    }
+
+    const std::vector<double> &AgentStore::getAttributeDefaults()
+    {
+        return this->attribute_defaults;
+    }
+
+    uint32_t AgentStore::getNextId()
+    {
+        return this->next_id;
+    }
+
+    void AgentStore::clear()
+    {
+        this->x.clear();
+        this->y.clear();
+        this->layer.clear();
+        this->state.clear();
+        this->id.clear();
+        this->state_next.clear();
+        this->x_next.clear();
+        this->y_next.clear();
+        this->has_pos_next.clear();
+        this->killed.clear();
+        for (auto &column : this->attributes)
+        {
+            column.clear();
+        }
+        this->indices.clear();
+        this->next_id = 0;
+    }
+}
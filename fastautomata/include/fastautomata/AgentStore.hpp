@@ -0,0 +1,256 @@
+/**
+ * @file AgentStore.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief Native agents (entities) stored by column, stepped by kernels
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include "ClassTypes.hpp"
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdint>
+
+using namespace fastautomata::ClassTypes;
+
+namespace fastautomata::Board {
+    class SimulatedBoard;
+}
+
+namespace fastautomata::Agents {
+    /**
+     * @brief A store of lightweight native agents (entities). Every property is a column (one element per entity), so kernels go through them in order.
+     *
+     * Entities live in agent layers next to the Agent objects, and collide with them. They do not have a step function:
+     * kernels get called on ranges of entities (in parallel), and write intents (set_state, set_pos, kill) that get applied at the end of the step, in entity order.
+     *
+     * The index of an entity changes when another one gets removed (the last entity takes its place). Use the id to keep track of an entity.
+     */
+    class AgentStore
+    {
+        public:
+        static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+        /**
+         * @brief A function that steps the entities [begin, end). It can run in parallel with other ranges, so it should only write the entities of its range.
+         *
+         */
+        typedef std::function<void(AgentStore &store, size_t begin, size_t end)> Kernel;
+
+        /*
+         ██████  ██████  ██      ██    ██ ███    ███ ███    ██ ███████
+        ██      ██    ██ ██      ██    ██ ████  ████ ████   ██ ██
+        ██      ██    ██ ██      ██    ██ ██ ████ ██ ██ ██  ██ ███████
+        ██      ██    ██ ██      ██    ██ ██  ██  ██ ██  ██ ██      ██
+         ██████  ██████  ███████  ██████  ██      ██ ██   ████ ███████
+        */
+
+        std::vector<int> x;
+        std::vector<int> y;
+        std::vector<int> layer;
+        std::vector<uint16_t> state;
+        std::vector<uint32_t> id;
+
+        /**
+         * @brief The queued state of each entity. StateRegistry::NONE if there is no change, ids the board does not know get dropped.
+         *
+         */
+        std::vector<uint16_t> state_next;
+
+        /**
+         * @brief The queued position of each entity. Only valid if has_pos_next is set.
+         *
+         */
+        std::vector<int> x_next;
+        std::vector<int> y_next;
+        std::vector<uint8_t> has_pos_next;
+
+        /**
+         * @brief Set for the entities that get removed at the end of the step
+         *
+         */
+        std::vector<uint8_t> killed;
+
+        /**
+         * @brief The user declared attributes ([attribute][entity])
+         *
+         */
+        std::vector<std::vector<double>> attributes;
+
+        private:
+        Board::SimulatedBoard *board;
+
+        std::vector<std::string> attribute_names;
+        std::vector<double> attribute_defaults;
+
+        /**
+         * @brief The index of each entity id ([id]). NONE once removed.
+         *
+         */
+        std::vector<uint32_t> indices;
+
+        uint32_t next_id = 0;
+
+        std::vector<Kernel> kernels;
+
+        /**
+         * @brief Remove an entity right away (swap with the last one)
+         *
+         */
+        void remove_index(size_t index);
+
+        public:
+        /**
+         * @brief Construct a new Agent Store. Use SimulatedBoard::entities() instead.
+         *
+         * @param board The board of the entities
+         */
+        AgentStore(Board::SimulatedBoard *board);
+
+        /**
+         * @brief Add an entity. Not allowed from a kernel.
+         *
+         * @param pos The position (must be free in the layer)
+         * @param state The state id
+         * @param layer [optional] An agent layer [default: 0]
+         * @return uint32_t The id of the entity
+         */
+        uint32_t spawn(Pos pos, uint16_t state, int layer = 0);
+
+        /**
+         * @brief Remove an entity at the end of the step
+         *
+         * @param id The id of the entity
+         */
+        void kill(uint32_t id);
+
+        /**
+         * @brief Get the amount of entities
+         *
+         * @return size_t
+         */
+        size_t size();
+
+        /**
+         * @brief Get the index of an entity
+         *
+         * @param id The id of the entity
+         * @return int The index, -1 if the entity does not exist
+         */
+        int index(uint32_t id);
+
+        /**
+         * @brief Declare a numeric attribute. Every entity gets a value (existing ones get the default).
+         *
+         * @param name The name of the attribute
+         * @param value [optional] The value of new entities [default: 0]
+         * @return int The column of the attribute (see attributes)
+         */
+        int attribute_add(std::string name, double value = 0);
+
+        /**
+         * @brief Get the column of an attribute
+         *
+         * @return int -1 if it was not declared
+         */
+        int attribute_index(const std::string &name);
+
+        /**
+         * @brief Get the value of an attribute of an entity
+         *
+         * @param id The id of the entity
+         * @param name The attribute
+         */
+        double attribute_get(uint32_t id, const std::string &name);
+
+        void attribute_set(uint32_t id, const std::string &name, double value);
+
+        Pos getPos(uint32_t id);
+
+        uint16_t getStateId(uint32_t id);
+
+        /**
+         * @brief Queue a state change of the entity at index (from a kernel)
+         *
+         */
+        inline void set_state(size_t index, uint16_t state)
+        {
+            this->state_next[index] = state;
+        }
+
+        /**
+         * @brief Queue a move of the entity at index (from a kernel). It fails if the cell is taken, or has a SOLID collision.
+         *
+         */
+        inline void set_pos(size_t index, Pos pos)
+        {
+            this->x_next[index] = pos.x;
+            this->y_next[index] = pos.y;
+            this->has_pos_next[index] = 1;
+        }
+
+        /**
+         * @brief Queue the removal of the entity at index (from a kernel)
+         *
+         */
+        inline void kill_index(size_t index)
+        {
+            this->killed[index] = 1;
+        }
+
+        Board::SimulatedBoard *getBoard();
+
+        /**
+         * @brief Add a kernel. Kernels run in the order they got added, one after the other, every step.
+         *
+         */
+        void kernel_add(Kernel kernel);
+
+        void kernel_flush();
+
+        /**
+         * @brief Run the kernels over every entity (in parallel if the board has threads)
+         *
+         */
+        void run_kernels();
+
+        /**
+         * @brief Apply the queued changes (states, then moves, then removals) in entity order
+         *
+         */
+        void commit();
+
+        /**
+         * @brief Add entities with their ids, at once (used to load checkpoints). The store must be empty, and the cells free.
+         *
+         * The arrays hold one value per entity. The attributes get their default values.
+         *
+         * @param count The amount of entities
+         * @param nextId The id of the next entity spawned
+         */
+        void restore(size_t count, const int32_t *x, const int32_t *y, const int32_t *layer, const uint16_t *state, const uint32_t *id, uint32_t nextId);
+
+        const std::vector<std::string> &getAttributeNames();
+
+        const std::vector<double> &getAttributeDefaults();
+
+        /**
+         * @brief Get the id the next entity will get
+         *
+         * @return uint32_t
+         */
+        uint32_t getNextId();
+
+        /**
+         * @brief Remove every entity (the attributes stay declared)
+         *
+         */
+        void clear();
+    };
+}
@@ -0,0 +1,115 @@
+#include "AgentTable.hpp"
+#include "Agents.hpp"
+
+namespace fastautomata::Agents {
+    AgentHandle AgentTable::insert(BaseAgent *agent, AgentType type, uint32_t dense)
+    {
+        uint32_t index;
+        if (!this->free_slots.empty())
+        {
+            index = this->free_slots.back();
+            this->free_slots.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(this->slots.size());
+            this->slots.emplace_back();
+        }
+
+        auto &slot = this->slots[index];
+        slot.agent = agent;
+        slot.type = type;
+        slot.dense = dense;
+        slot.pending_delete = false;
+        slot.owned = false;
+
+        if (agent->id >= static_cast<int>(this->ids.size()))
+        {
+            this->ids.resize(agent->id + 1, NONE);
+        }
+        this->ids[agent->id] = index;
+
+        agent->slot = index;
+        this->alive++;
+
+        return AgentHandle{index, slot.generation};
+    }
+
+    void AgentTable::erase(BaseAgent *agent)
+    {
+        auto &slot = this->slots[agent->slot];
+        slot.agent = nullptr;
+        slot.dense = NONE;
+        slot.pending_delete = false;
+        slot.owned = false;
+        slot.generation++;
+
+        this->ids[agent->id] = NONE;
+        this->free_slots.push_back(agent->slot);
+        agent->slot = NONE;
+        this->alive--;
+    }
+
+    bool AgentTable::contains(BaseAgent *agent)
+    {
+        return agent->slot < this->slots.size() && this->slots[agent->slot].agent == agent;
+    }
+
+    AgentTable::Slot &AgentTable::slot(BaseAgent *agent)
+    {
+        return this->slots[agent->slot];
+    }
+
+    AgentHandle AgentTable::handle(BaseAgent *agent)
+    {
+        return AgentHandle{agent->slot, this->slots[agent->slot].generation};
+    }
+
+    BaseAgent *AgentTable::get(AgentHandle handle)
+    {
+        if (handle.slot >= this->slots.size() || this->slots[handle.slot].generation != handle.generation)
+        {
+            return nullptr;
+        }
+        return this->slots[handle.slot].agent;
+    }
+
+    BaseAgent *AgentTable::get_by_id(int id)
+    {
+        if (id < 0 || id >= static_cast<int>(this->ids.size()) || this->ids[id] == NONE)
+        {
+            return nullptr;
+        }
+        return this->slots[this->ids[id]].agent;
+    }
+
+    int AgentTable::size()
+    {
+        return static_cast<int>(this->alive);
+    }
+
+    void AgentTable::clear()
+    {
+        // the generations survive, so old handles stay invalid
+        this->free_slots.clear();
+        for (uint32_t i = 0; i < this->slots.size(); i++)
+        {
+            auto &slot = this->slots[i];
+            // the agents might be gone already (python frees them on reset), so they do not get touched
+            if (slot.agent != nullptr)
+            {
+                slot.agent = nullptr;
+                slot.generation++;
+            }
+            slot.dense = NONE;
+            slot.pending_delete = false;
+            slot.owned = false;
+        }
+        for (uint32_t i = static_cast<uint32_t>(this->slots.size()); i > 0; i--)
+        {
+            this->free_slots.push_back(i - 1);
+        }
+        this->ids.clear();
+        this->alive = 0;
+    }
+}
@@ -0,0 +1,170 @@
+/**
+ * @file AgentTable.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief A table of every agent of a board, with stable slots, generational handles and lookup by id
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace fastautomata::Agents {
+    class BaseAgent;
+
+    /**
+     * @brief What kind of agent a slot holds
+     *
+     */
+    enum AgentType : uint8_t
+    {
+        STATIC, // a BaseAgent, never stepped
+        NATIVE, // an Agent implemented in c++
+        PYTHON, // an Agent implemented in python (known once the board checked, see SimulatedBoard::is_native)
+    };
+
+    /**
+     * @brief A reference to an agent that can be checked for validity. Once the agent gets removed, its handle stops resolving (even if the slot gets reused).
+     *
+     */
+    struct AgentHandle
+    {
+        uint32_t slot = 0xFFFFFFFF;
+        uint32_t generation = 0;
+
+        bool operator==(const AgentHandle &other) const
+        {
+            return this->slot == other.slot && this->generation == other.generation;
+        }
+    };
+
+    /**
+     * @brief Every agent of a board. Slots get reused after removal (with a new generation), and every operation is O(1).
+     *
+     */
+    class AgentTable
+    {
+        public:
+        static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+        struct Slot
+        {
+            BaseAgent *agent = nullptr;
+            uint32_t generation = 0;
+            /**
+             * @brief The index in the board's list of simulated agents. NONE for static agents.
+             *
+             */
+            uint32_t dense = NONE;
+            AgentType type = AgentType::STATIC;
+            /**
+             * @brief True once the agent is scheduled for deletion (so it only gets scheduled once)
+             *
+             */
+            bool pending_delete = false;
+            /**
+             * @brief True if the board created the agent (see SimulatedBoard::agents_spawn), so the board deletes it
+             *
+             */
+            bool owned = false;
+        };
+
+        private:
+        std::vector<Slot> slots;
+        std::vector<uint32_t> free_slots;
+
+        /**
+         * @brief The slot of each agent id ([id]). NONE if the agent was removed.
+         *
+         */
+        std::vector<uint32_t> ids;
+
+        uint32_t alive = 0;
+
+        public:
+        /**
+         * @brief Add an agent (its id must already be set). Stores the slot in the agent.
+         *
+         * @param agent The agent
+         * @param type The kind of agent
+         * @param dense The index in the board's list of simulated agents (NONE for static agents)
+         * @return AgentHandle
+         */
+        AgentHandle insert(BaseAgent *agent, AgentType type, uint32_t dense);
+
+        /**
+         * @brief Remove an agent. Its slot gets a new generation and can be reused.
+         *
+         * @param agent The agent (must be in the table)
+         */
+        void erase(BaseAgent *agent);
+
+        /**
+         * @brief Check if the agent is in this table
+         *
+         */
+        bool contains(BaseAgent *agent);
+
+        /**
+         * @brief Get the slot of an agent of the table
+         *
+         * @param agent The agent (must be in the table)
+         * @return Slot&
+         */
+        Slot &slot(BaseAgent *agent);
+
+        /**
+         * @brief Get the handle of an agent of the table
+         *
+         */
+        AgentHandle handle(BaseAgent *agent);
+
+        /**
+         * @brief Get the agent of a handle
+         *
+         * @return BaseAgent* nullptr if the agent got removed
+         */
+        BaseAgent *get(AgentHandle handle);
+
+        /**
+         * @brief Get an agent by id
+         *
+         * @return BaseAgent* nullptr if there is no agent with that id
+         */
+        BaseAgent *get_by_id(int id);
+
+        /**
+         * @brief Get the amount of agents in the table
+         *
+         * @return int
+         */
+        int size();
+
+        /**
+         * @brief Call func(Slot &) for every slot that holds an agent
+         *
+         */
+        template <typename Func>
+        inline void for_each(Func &&func)
+        {
+            for (auto &slot : this->slots)
+            {
+                if (slot.agent != nullptr)
+                {
+                    func(slot);
+                }
+            }
+        }
+
+        /**
+         * @brief Remove every agent. Handles of removed agents stop resolving.
+         *
+         */
+        void clear();
+    };
+}
@@ -11,11 +11,9 @@ namespace fastautomata::Agents {
     ██████  ██   ██ ███████ ███████     ██   ██  ██████  ███████ ██   ████    ██                                                                                                                            
     */
 
-    int BaseAgent::current_id = 0;
-
     BaseAgent::BaseAgent()
     {
-        this->id = current_id++;
+
     }
 
     BaseAgent::BaseAgent(Board::SimulatedBoard* board, Pos pos, std::string state, int layer, bool allowOverriding)
@@ -23,8 +21,7 @@ namespace fastautomata::Agents {
         this->board = board;
         this->pos = pos;
         this->layer = layer;
-        this->state = state;
-        this->id = current_id++;
+        this->state = board->state_id(state);
 
         this->board->agent_add(this, allowOverriding);
     }
@@ -39,7 +36,17 @@ namespace fastautomata::Agents {
         return this->id;
     }
 
-    std::string BaseAgent::getState()
+    const std::string &BaseAgent::getState()
+    {
+        static const std::string noState = "";
+        if (this->board == nullptr || this->state == StateRegistry::NONE)
+        {
+            return noState;
+        }
+        return this->board->state_name(this->state);
+    }
+
+    uint16_t BaseAgent::getStateId()
     {
         return this->state;
     }
@@ -58,14 +65,33 @@ namespace fastautomata::Agents {
     {
         // std::cout << "Checking collisions for agent (id: " << std::to_string(this->getId()) << ") in pos: " << seachIn.toString() << std::endl;
         bool searchSelf = !(seachIn == this->pos);
-        // std::cout << "Search self: " << std::to_string(searchSelf) << std::endl;
-        auto collisions = this->board->getCollisions(seachIn, this->layer, searchSelf);
+        if (seachIn.x < 0 || seachIn.y < 0 || seachIn.x >= this->board->getWidth() || seachIn.y >= this->board->getHeight())
+        {
+            throw std::out_of_range("Position out of range when trying to check for collisions. (Pos given: " + seachIn.toString() + ")");
+        }
+
+        // the common case, a few bitwise operations
+        if (type == CollisionType::SOLID)
+        {
+            return this->board->move_blocked(seachIn, this->layer, searchSelf);
+        }
 
-        // std::cout << "Collisions found: " << std::to_string(collisions.size()) << std::endl;
-        for (auto coll: collisions)
+        // same result as looking through getCollisions, without building the map
+        int index = seachIn.toIndex(this->board->getWidth());
+        for (int searchLayer = 0; searchLayer < this->board->getLayerCount(); searchLayer++)
         {
-            auto coltype = std::get<0>(coll.second);
-            // std::cout << "Collision: " << std::to_string(coltype) << std::endl;
+            CollisionType coltype = CollisionType::NONE;
+            if (this->board->cell_occupied_at(searchLayer, index))
+            {
+                if (searchLayer == this->layer)
+                {
+                    coltype = searchSelf ? CollisionType::SOLID : CollisionType::NONE;
+                }
+                else
+                {
+                    coltype = this->board->layer_collisions.getCollision(this->layer, searchLayer);
+                }
+            }
             if (coltype == type)
             {
                 return true;
@@ -93,13 +119,12 @@ namespace fastautomata::Agents {
         this->board = board;
         this->pos = pos;
         this->layer = layer;
-        this->state = state;
 
-        if (this->board->color_map.find(state) == this->board->color_map.end())
+        if (this->board->states.find(state) == -1)
         {
             std::cout << "WARNING: State '" << state << "' does not exist in the color map. It will be added with a random color." << std::endl;
-            this->board->addColor(state, this->board->getRandomColor());
         }
+        this->state = this->board->state_id(state);
 
         this->board->agent_add(this, allowOverriding);
     }
@@ -113,54 +138,110 @@ namespace fastautomata::Agents {
     {
         bool gotUpdated = false;
 
+        // the board already moved the agent (moves resolved together)
+        if (this->moved)
+        {
+            this->moved = false;
+            gotUpdated = true;
+        }
+
         // if position has been updated, move the agent
-        if (pos_next)
+        if (this->has_pos_next)
         {
-            // std::cout << "Moving agent (id: " << std::to_string(this->getId()) << ") to pos: " << (*this->pos_next).toString() << std::endl;
+            // std::cout << "Moving agent (id: " << std::to_string(this->getId()) << ") to pos: " << this->pos_next.toString() << std::endl;
+            bool inside = this->pos_next.x >= 0 && this->pos_next.y >= 0 && this->pos_next.x < this->board->getWidth() && this->pos_next.y < this->board->getHeight();
+
             // check if there are any collisions in current pos (of type SOLID)
-            bool collision = checkCollisions(CollisionType::SOLID, *this->pos_next);
+            bool collision = inside && this->board->move_blocked(this->pos_next, this->layer, !(this->pos_next == this->pos));
             
             // std::cout << "Collision: " << std::to_string(collision) << std::endl;
             // only move if there are no collisions
-            if (!collision && (pos_next->x >= 0 && pos_next->y >= 0) && (pos_next->x < this->board->getWidth() && pos_next->y < this->board->getHeight()))
+            if (inside && !collision)
             {
-                // std::cout << "No problems found for agent id: " << std::to_string(this->getId()) << " to pos: " << (*this->pos_next).toString() << std::endl;
-                board->agent_move(this, this->pos,*this->pos_next);
-                this->pos = *this->pos_next;
+                // std::cout << "No problems found for agent id: " << std::to_string(this->getId()) << " to pos: " << this->pos_next.toString() << std::endl;
+                board->agent_move(this, this->pos, this->pos_next);
+                this->pos = this->pos_next;
                 gotUpdated = true;
                 // std::cout << "Agent was moved" << std::endl;
             }
             else
             {
-                std::cout << "WARNING: Cannot move agent (id: " << std::to_string(this->getId()) << ") to pos: " << (*this->pos_next).toString() << " because it's occupied (a SOLID collision detected)." << std::endl;
+                std::cout << "WARNING: Cannot move agent (id: " << std::to_string(this->getId()) << ") to pos: " << this->pos_next.toString() << " because it's occupied (a SOLID collision detected)." << std::endl;
             }
 
             // reset the next pos
-            this->pos_next = nullptr;
+            this->has_pos_next = false;
         }
 
         // if state has been updated, update the state
-        if (state_next)
+        if (this->state_next != StateRegistry::NONE)
         {
             // update the colors in board
-            this->board->updateColor(this->state, *this->state_next);
+            this->board->updateColor(this->state, this->state_next);
+            this->board->cell_touch(this->pos);
+            this->board->journal_add(Journal::STATE, Journal::AGENT, this->getId(), this->pos, this->pos, this->state, this->state_next, this->layer, this->layer);
 
             // update the state
-            this->state = *this->state_next;
-            this->state_next = nullptr;
+            this->state = this->state_next;
+            this->state_next = StateRegistry::NONE;
             gotUpdated = true;
         }
 
         // call on_update functions if there were any updates
         if (gotUpdated)
         {
-            for (auto func : this->on_update)
+            for (auto &func : this->on_update)
             {
                 func(this);
             }
         }
     }
 
+    bool Agent::isNative()
+    {
+        return true;
+    }
+
+    void Agent::wake()
+    {
+        this->awake = true;
+    }
+
+    Random::RandomStream Agent::random_stream()
+    {
+        int step = this->board->getStepCount();
+        if (this->random_step != step)
+        {
+            this->random_step = step;
+            this->random_draws = 0;
+        }
+        return Random::RandomStream(this->board->getSeed(), step, static_cast<uint32_t>(this->getId()), Random::RandomDomain::AGENT, this->random_draws);
+    }
+
+    double Agent::random()
+    {
+        auto stream = this->random_stream();
+        double value = stream.uniform();
+        this->random_draws = static_cast<uint32_t>(stream.position());
+        return value;
+    }
+
+    int Agent::random_int(int low, int high)
+    {
+        auto stream = this->random_stream();
+        int value = stream.integer(low, high);
+        this->random_draws = static_cast<uint32_t>(stream.position());
+        return value;
+    }
+
+    double Agent::random_normal(double mean, double deviation)
+    {
+        auto stream = this->random_stream();
+        double value = stream.normal(mean, deviation);
+        this->random_draws = static_cast<uint32_t>(stream.position());
+        return value;
+    }
+
     void Agent::append_on_update(std::function<void(Agent*)> func)
     {
         this->on_update.push_back(func);
@@ -168,17 +249,23 @@ namespace fastautomata::Agents {
 
     void Agent::setPos(Pos pos)
     {
-        this->pos_next = std::make_unique<Pos>(pos);
+        this->pos_next = pos;
+        this->has_pos_next = true;
     }
 
     void Agent::setState(std::string state)
     {
-        if (this->board->color_map.find(state) == this->board->color_map.end())
+        // unknown states get added with a random color
+        this->state_next = this->board->state_id(state);
+    }
+
+    void Agent::setStateId(uint16_t state)
+    {
+        if (state >= this->board->states.size())
         {
-            // std::cout << "WARNING: State '" << state << "' does not exist in the color map. It will be added with a random color." << std::endl;
-            this->board->addColor(state, this->board->getRandomColor());
+            throw std::out_of_range("State id out of range (id given: " + std::to_string(state) + ")");
         }
-        this->state_next = std::make_unique<std::string>(state);
+        this->state_next = state;
     }
 
     void Agent::changeLayer(int layer)
@@ -196,14 +283,26 @@ namespace fastautomata::Agents {
         
         // std::cout << "Getting neighbors for agent (id: " << std::to_string(this->getId()) << ") in pos: " << this->pos.toString() << " with radius: " << std::to_string(radius) << std::endl;
         std::vector<BaseAgent*> neighbors;
-        neighbors.reserve(pow(radius * 2 + 1, 2));
+        neighbors.reserve((radius * 2 + 1) * (radius * 2 + 1));
+
+        bool inside = layer >= 0 && layer < this->board->getLayerCount() &&
+            this->pos.x - radius >= 0 && this->pos.y - radius >= 0 &&
+            this->pos.x + radius < this->board->getWidth() && this->pos.y + radius < this->board->getHeight();
 
         // always return top left to bottom right
         for (int j = this->pos.y + radius; j >= this->pos.y - radius ; j--)
         {
             for (int i = this->pos.x - radius; i <= this->pos.x + radius; i++)
             {
-                neighbors.push_back(this->board->agent_get(Pos(i,j), layer, wrap));
+                // the whole neighborhood is inside the board, skip the bounds checks
+                if (inside)
+                {
+                    neighbors.push_back(this->board->agent_get_unchecked(Pos(i, j), layer));
+                }
+                else
+                {
+                    neighbors.push_back(this->board->agent_get(Pos(i,j), layer, wrap));
+                }
             }
         }
 
@@ -212,7 +311,7 @@ namespace fastautomata::Agents {
 
     std::string Agent::toString()
     {
-        return "Agent (id: " + std::to_string(this->getId()) + ", pos: " + this->pos.toString() + ", state: " + this->state + ")";
+        return "Agent (id: " + std::to_string(this->getId()) + ", pos: " + this->pos.toString() + ", state: " + this->getState() + ")";
     }
 
     std::string Agent::objInfo()
@@ -238,6 +337,11 @@ namespace fastautomata::Agents {
         );
     }
 
+    bool PyAgent::isNative()
+    {
+        return false;
+    }
+
     void PyAgent::kill()
     {
         PYBIND11_OVERLOAD(
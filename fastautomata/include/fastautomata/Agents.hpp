@@ -12,6 +12,8 @@
 #pragma once
 
 #include "ClassTypes.hpp"
+#include "Random.hpp"
+#include "AgentTable.hpp"
 #include <memory>
 #include <functional>
 #include <math.h>
@@ -30,9 +32,21 @@ namespace fastautomata::Agents{
      */
     class BaseAgent
     {
+        // the board gives out the ids, and the table the slots
+        friend class Board::SimulatedBoard;
+        friend class AgentTable;
         private:
-        static int current_id;
-        int id;
+        /**
+         * @brief The id of the agent, unique inside its board. -1 until the agent gets added to a board.
+         * 
+         */
+        int id = -1;
+
+        /**
+         * @brief The slot of the agent in the board's AgentTable
+         * 
+         */
+        uint32_t slot = 0xFFFFFFFF;
 
         protected:
         /**
@@ -48,10 +62,10 @@ namespace fastautomata::Agents{
         int layer;
 
         /**
-         * @brief The current state of the cell. Do not edit directly!!!
+         * @brief The current state id of the cell (see SimulatedBoard::states). Do not edit directly!!!
          * 
          */
-        std::string state;
+        uint16_t state = StateRegistry::NONE;
 
         public:
 
@@ -60,7 +74,7 @@ namespace fastautomata::Agents{
          * @brief A reference to the board. Once defined, should not be edited.
          * 
          */
-        Board::SimulatedBoard* board;
+        Board::SimulatedBoard* board = nullptr;
 
 
         BaseAgent();
@@ -96,7 +110,19 @@ namespace fastautomata::Agents{
          */
         int getLayer();
 
-        std::string getState();
+        /**
+         * @brief Get the name of the current state. A lookup of the state id in the board.
+         * 
+         * @return const std::string& 
+         */
+        const std::string &getState();
+
+        /**
+         * @brief Get the current state id
+         * 
+         * @return uint16_t 
+         */
+        uint16_t getStateId();
 
         /**
          * @brief Delete the agent from the board. 
@@ -130,17 +156,56 @@ namespace fastautomata::Agents{
      */
     class Agent: public BaseAgent
     {
+        // the board resolves the moves of every agent at once (see MovePolicy)
+        friend class Board::SimulatedBoard;
+
         private:
         /**
-         * @brief Defines a state that will get changed at the end of the step.
+         * @brief Defines a state id that will get changed at the end of the step. StateRegistry::NONE if there is no change.
+         * 
+         */
+        uint16_t state_next = StateRegistry::NONE;
+        /**
+         * @brief Defines a position where it will move towards. Only valid if has_pos_next is true.
+         * 
+         */
+        Pos pos_next;
+
+        /**
+         * @brief True if the agent wants to move to pos_next
+         * 
+         */
+        bool has_pos_next = false;
+
+        /**
+         * @brief True if the board already moved the agent this step (when moves are resolved together)
+         * 
+         */
+        bool moved = false;
+
+        /**
+         * @brief True if the agent has to be stepped in the next step, even if nothing changed around it (active scheduling)
          * 
          */
-        std::unique_ptr<std::string> state_next = nullptr;
+        bool awake = false;
+
         /**
-         * @brief Defines a position where it will move towards. 
+         * @brief The amount of words drawn from the agent's random stream during random_step
          * 
          */
-        std::unique_ptr<Pos> pos_next = nullptr;
+        uint32_t random_draws = 0;
+
+        /**
+         * @brief The step of the random stream. The draws start again from 0 every step.
+         * 
+         */
+        int random_step = -1;
+
+        /**
+         * @brief Get the random stream of the agent, where the last draw stopped
+         * 
+         */
+        Random::RandomStream random_stream();
 
         public:
         Agent();
@@ -167,6 +232,43 @@ namespace fastautomata::Agents{
          */
         virtual void step_end();
 
+        /**
+         * @brief Check if the agent is implemented in c++. Native agents can be stepped in parallel.
+         * 
+         * @return true if step() does not call into python
+         */
+        virtual bool isNative();
+        /**
+         * @brief Ask to be stepped in the next step, even if nothing changes around the agent. Only does something with active scheduling.
+         * 
+         * Call it from the agent's own step (or between steps), for example on agents that count time.
+         */
+        void wake();
+
+        /**
+         * @brief Get a random double in [0, 1). 
+         * 
+         * Keyed by (board seed, step, agent id), so the results are the same for any amount of threads or order of the agents.
+         * 
+         * @return double 
+         */
+        double random();
+
+        /**
+         * @brief Get a random integer in [low, high] (both included). See random().
+         * 
+         */
+        int random_int(int low, int high);
+
+        /**
+         * @brief Get a normally distributed random double. See random().
+         * 
+         * @param mean [optional] [default: 0]
+         * @param deviation [optional] The standard deviation [default: 1]
+         * @return double 
+         */
+        double random_normal(double mean = 0, double deviation = 1);
+
         /**
          * @brief Queue a state change. Will be changed at the end of the step.
          * 
@@ -183,6 +285,13 @@ namespace fastautomata::Agents{
          */
         void setState(std::string state);
 
+        /**
+         * @brief Queue a state change by id. Will be changed at the end of the step.
+         * 
+         * @param state A registered state id
+         */
+        void setStateId(uint16_t state);
+
         /**
          * @brief Get the neighbors list. The full list of neighbors is defined by the radius. It will always return a list of size (radius * 2 + 1)^2. If there is no agent, or out of bounds, returns nullptr
          * 
@@ -207,5 +316,6 @@ namespace fastautomata::Agents{
         void step() override;
         void step_end() override;
         void kill() override;
+        bool isNative() override;
     };
 }
\ No newline at end of file
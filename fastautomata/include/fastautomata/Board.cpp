@@ -1,15 +1,24 @@
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <random>
 #include <array>
-//#include <thread>
+#include <thread>
 #include <chrono>
 #include <tuple>
 #include <functional>
 #include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
 #include "Agents.hpp"
 #include "ClassTypes.hpp"
 #include "Board.hpp"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 using namespace fastautomata::ClassTypes;
 
 namespace fastautomata::Board {
@@ -19,19 +28,17 @@ namespace fastautomata::Board {
         this->height = height;
         this->layerCount = layerCount;
         this->agentSize = width * height;
+        this->layerStride = this->agentSize;
         // this->layer_collisions = layer_collisions;
-        this->board = new Agents::BaseAgent **[layerCount];
-        for (int i = 0; i < layerCount; i++)
-        {
-            this->board[i] = new Agents::BaseAgent *[this->agentSize];
-            for (int j = 0; j < this->agentSize; j++)
-            {
-                this->board[i][j] = nullptr;
-            }
-        }
+        // one allocation for every layer, it only gets cleared (never reallocated) afterwards
+        this->board = std::vector<Agents::BaseAgent *>(static_cast<size_t>(layerCount) * this->layerStride, nullptr);
+        this->fields = std::vector<std::unique_ptr<Fields::StateField>>(layerCount);
+        this->life_rules = std::vector<std::unique_ptr<Life::LifeRule>>(layerCount);
+        this->rule_sets = std::vector<std::unique_ptr<Rules::RuleSet>>(layerCount);
+        this->layer_revisions = std::vector<uint64_t>(layerCount, 0);
+        this->static_revisions = std::vector<uint64_t>(layerCount, 0);
         this->step_count = 0;
 
-        this->color_map = std::map<std::string, std::array<int, 3>>();
 
         // add dead, alive and none
         this->addColor("Dead", std::array<int, 3>{100, 100, 100});
@@ -47,6 +54,12 @@ namespace fastautomata::Board {
         // std::cout << "INFO: Created board with width: " << width << ", height: " << height << ", layers: " << layerCount << std::endl;
 
         this->layer_collisions = CollisionMap(layerCount);
+
+        // the occupancy bitmask only fits 64 layers, bigger boards check every layer
+        if (layerCount <= 64)
+        {
+            this->occupancy = std::vector<uint64_t>(this->agentSize, 0);
+        }
     }
 
     SimulatedBoard::~SimulatedBoard()
@@ -57,30 +70,43 @@ namespace fastautomata::Board {
     void SimulatedBoard::delete_this()
     {
         // clear board
-        for (int i = 0; i < this->layerCount; i++)
-        {
-            // for (int j = 0; j < this->agentSize; j++)
-            // {
-            //     if (this->board[i][j] != nullptr)
-            //     {
-            //         delete this->board[i][j];
-            //     }
-            // }
-
-            // only delete the pointer list, and let python take care of everything else
-            delete[] this->board[i];
-        }
-        delete[] this->board;
-
-        // clear all lists (do not delete tho)
+        // only delete the pointer list, and let python take care of everything else
+        this->board.clear();
+        this->board.shrink_to_fit();
+        this->life_rules.clear();
+        this->rule_sets.clear();
+        this->fields.clear();
+        this->scalar_fields.clear();
+        this->state_views.clear();
+        this->board_kernels.clear();
+        this->kernel_cells.clear();
+        this->kernel_view_ready = false;
+        this->pool = nullptr;
+        this->dirty_cells.clear();
+        this->active_cells.clear();
+        this->agents_stepping.clear();
+
+        // clear all lists (do not delete tho, except the agents the board created)
+        this->owned_agents_delete();
         this->agents.clear();
+        this->agent_table.clear();
+        this->store = nullptr;
+        this->entity_cells.clear();
+        this->occupancy.clear();
+        this->flow_fields.clear();
+        this->journal.clear();
+        this->recorder = nullptr;
+        this->record_changes.clear();
+        this->stream_enabled = false;
+        this->stream_encoder = nullptr;
+        this->stream_changes.clear();
         this->step_instructions.clear();
         this->on_add.clear();
         this->on_delete.clear();
         this->on_reset.clear();
         this->scheduled_delete_agents.clear();
-        this->color_map.clear();
-        this->color_map_count.clear();
+        this->state_colors.clear();
+        this->state_counts.clear();
     }
 
     int SimulatedBoard::getStepCount()
@@ -103,6 +129,40 @@ namespace fastautomata::Board {
         this->on_delete.push_back(func);
     }
 
+    void SimulatedBoard::append_on_spawn(std::function<void(const std::vector<int> &)> func)
+    {
+        this->on_spawn.push_back(func);
+    }
+
+    void SimulatedBoard::journal_enable(bool enabled)
+    {
+        this->journal_enabled = enabled;
+        if (!enabled)
+        {
+            this->journal.clear();
+            this->journal.shrink_to_fit();
+        }
+    }
+
+    bool SimulatedBoard::getJournalEnabled()
+    {
+        return this->journal_enabled;
+    }
+
+    std::vector<Journal::Change> SimulatedBoard::journal_take()
+    {
+        // the next journal starts with about the same size, so it does not grow again every step
+        std::vector<Journal::Change> taken;
+        taken.reserve(this->journal.size());
+        std::swap(taken, this->journal);
+        return taken;
+    }
+
+    size_t SimulatedBoard::getJournalSize()
+    {
+        return this->journal.size();
+    }
+
     int SimulatedBoard::getWidth()
     {
         return this->width;
@@ -118,10 +178,246 @@ namespace fastautomata::Board {
         return this->layerCount;
     }
 
+    void SimulatedBoard::setThreadCount(int threads)
+    {
+        if (threads < 0)
+        {
+            throw std::invalid_argument("The amount of threads cannot be negative");
+        }
+        if (threads == 0)
+        {
+            threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+
+        if (threads == 1)
+        {
+            this->pool = nullptr;
+        }
+        else if (!this->pool || this->pool->getThreadCount() != threads)
+        {
+            this->pool = std::make_unique<Threading::ThreadPool>(threads);
+        }
+    }
+
+    int SimulatedBoard::getThreadCount()
+    {
+        return this->pool ? this->pool->getThreadCount() : 1;
+    }
+
+    void SimulatedBoard::parallel_for(size_t count, size_t chunk, const std::function<void(size_t, size_t)> &func)
+    {
+        if (this->pool)
+        {
+            // a counter and not a flag: a nested call (from a worker) ending must not end the call around it
+            this->parallel_depth++;
+            try
+            {
+                this->pool->parallel_for(count, chunk, func);
+            }
+            catch (...)
+            {
+                this->parallel_depth--;
+                throw;
+            }
+            this->parallel_depth--;
+        }
+        else if (count > 0)
+        {
+            func(0, count);
+        }
+    }
+
+    void SimulatedBoard::setSeed(uint64_t seed)
+    {
+        this->seed = seed;
+    }
+
+    uint64_t SimulatedBoard::getSeed()
+    {
+        return this->seed;
+    }
+
+    Random::RandomStream SimulatedBoard::random_stream(uint64_t stream, Random::RandomDomain domain)
+    {
+        return Random::RandomStream(this->seed, this->step_count, stream, domain);
+    }
+
+    double SimulatedBoard::random()
+    {
+        double value;
+        this->random_fill(&value, 1);
+        return value;
+    }
+
+    int SimulatedBoard::random_int(int low, int high)
+    {
+        if (this->board_random_step != this->step_count)
+        {
+            this->board_random_step = this->step_count;
+            this->board_random_draws = 0;
+        }
+
+        Random::RandomStream stream(this->seed, this->step_count, 0, Random::RandomDomain::BOARD, this->board_random_draws);
+        int value = stream.integer(low, high);
+        this->board_random_draws = stream.position();
+        return value;
+    }
+
+    void SimulatedBoard::random_fill(double *out, size_t count)
+    {
+        if (this->board_random_step != this->step_count)
+        {
+            this->board_random_step = this->step_count;
+            this->board_random_draws = 0;
+        }
+
+        Random::RandomStream stream(this->seed, this->step_count, 0, Random::RandomDomain::BOARD, this->board_random_draws);
+        stream.fill_uniform(out, count);
+        this->board_random_draws = stream.position();
+    }
+
+    void SimulatedBoard::setMovePolicy(MovePolicy policy, bool allowSwaps)
+    {
+        this->move_policy = policy;
+        this->move_allow_swaps = allowSwaps;
+    }
+
+    MovePolicy SimulatedBoard::getMovePolicy()
+    {
+        return this->move_policy;
+    }
+
+    void SimulatedBoard::setActiveScheduling(bool enabled, int radius, bool wrap)
+    {
+        if (radius < 0)
+        {
+            throw std::invalid_argument("The active radius can not be negative (radius given: " + std::to_string(radius) + ")");
+        }
+
+        this->active_scheduling = enabled;
+        this->active_radius = radius;
+        this->active_wrap = wrap;
+
+        if (enabled)
+        {
+            // nothing is known about the previous steps, so every agent gets stepped once
+            this->dirty_cells.assign(this->agentSize, 1);
+            this->active_cells.assign(this->agentSize, 0);
+        }
+        else
+        {
+            this->dirty_cells.clear();
+            this->active_cells.clear();
+        }
+    }
+
+    bool SimulatedBoard::getActiveScheduling()
+    {
+        return this->active_scheduling;
+    }
+
+    int SimulatedBoard::getActiveCount()
+    {
+        if (this->agents_stepping.empty())
+        {
+            return static_cast<int>(this->agents.size());
+        }
+        int count = 0;
+        for (auto stepping : this->agents_stepping)
+        {
+            count += stepping;
+        }
+        return count;
+    }
+
     void SimulatedBoard::addColor(std::string name, std::array<int, 3> color)
     {
-        this->color_map[name] = color;
-        this->color_map_count[name] = 0;
+        uint16_t id = this->states.intern(name);
+
+        if (id >= this->state_colors.size())
+        {
+            this->state_colors.resize(id + 1);
+            this->state_counts.resize(id + 1, 0);
+        }
+
+        this->state_colors[id] = color;
+    }
+
+    std::array<int, 3> SimulatedBoard::getColor(std::string name)
+    {
+        int id = this->states.find(name);
+        if (id == -1)
+        {
+            throw std::out_of_range("State '" + name + "' does not exist in the color map");
+        }
+        return this->state_colors[id];
+    }
+
+    std::map<std::string, std::array<int, 3>> SimulatedBoard::getColorMap()
+    {
+        std::map<std::string, std::array<int, 3>> colorMap;
+        for (size_t id = 0; id < this->states.size(); id++)
+        {
+            colorMap[this->states.getName(id)] = this->state_colors[id];
+        }
+        return colorMap;
+    }
+
+    void SimulatedBoard::setColorMap(std::map<std::string, std::array<int, 3>> colorMap)
+    {
+        // states can not be removed (their ids stay), the ones left out go back to their default color
+        for (size_t id = 0; id < this->states.size(); id++)
+        {
+            const std::string &name = this->states.getName(id);
+            if (colorMap.find(name) == colorMap.end())
+            {
+                this->state_colors[id] = SimulatedBoard::getStateColor(name);
+            }
+        }
+
+        for (auto &kv : colorMap)
+        {
+            this->addColor(kv.first, kv.second);
+        }
+    }
+
+    std::map<std::string, int> SimulatedBoard::getColorMapCount()
+    {
+        std::map<std::string, int> colorMapCount;
+        for (size_t id = 0; id < this->states.size(); id++)
+        {
+            colorMapCount[this->states.getName(id)] = this->state_counts[id];
+        }
+        return colorMapCount;
+    }
+
+    uint16_t SimulatedBoard::state_id(const std::string &name)
+    {
+        int id = this->states.find(name);
+        if (id != -1)
+        {
+            return id;
+        }
+
+        // the state tables can not grow while other threads read them
+        if (this->parallel_depth > 0)
+        {
+            throw std::invalid_argument("State '" + name + "' does not exist. States can not be added while agents step in parallel, add it with setColorMap before stepping");
+        }
+
+        std::lock_guard<std::mutex> lock(this->states_mutex);
+        id = this->states.find(name);
+        if (id == -1)
+        {
+            this->addColor(name, SimulatedBoard::getStateColor(name));
+            id = this->states.find(name);
+        }
+        return id;
+    }
+
+    const std::string &SimulatedBoard::state_name(uint16_t id)
+    {
+        return this->states.getName(id);
     }
 
     void SimulatedBoard::step_instructions_add(std::function<void(SimulatedBoard *)> func)
@@ -152,9 +448,8 @@ namespace fastautomata::Board {
                 if (includeSelf)
                 {
                     auto agent = this->agent_get(pos, searchLayer);
-                    bool agentExists = agent != nullptr;
                     // std::cout << "INFO: Agent exists: " << std::to_string(agentExists) << std::endl;
-                    if (agent != nullptr)
+                    if (agent != nullptr || this->cell_occupied(pos, searchLayer))
                     {
                         collisions[searchLayer] = std::make_tuple(ClassTypes::CollisionType::SOLID, agent);
                     }
@@ -172,7 +467,7 @@ namespace fastautomata::Board {
             }
 
             auto agent = this->agent_get(pos, searchLayer);
-            if (agent != nullptr)
+            if (agent != nullptr || this->cell_occupied(pos, searchLayer))
             {
                 auto collision = layer_collisions.getCollision(layer, searchLayer);
 
@@ -199,52 +494,84 @@ namespace fastautomata::Board {
     {
         // std::cout << "INFO: Updating color map. Old state: " << oldState << ", new state: " << newState << std::endl;
 
-        this->color_map_count[oldState] -= 1;
-        this->color_map_count[newState] += 1;
+        this->updateColor(this->state_id(oldState), this->state_id(newState));
     }
 
     void SimulatedBoard::reset()
     {
-        // Delete and recreate board
-        for (int i = 0; i < this->layerCount; i++)
+        this->contents_clear();
+
+        // Call on_reset functions
+        for (auto &func : this->on_reset)
         {
-            // for (int j = 0; j < this->agentSize; j++)
-            // {
-            //     if (this->board[i][j] != nullptr)
-            //     {
-            //         delete this->board[i][j];
-            //     }
-            // }
-            delete[] this->board[i];
+            func(this);
+        }
+
+        this->views_sync();
+
+        // a recording keeps going, with a new run that starts from the board as on_reset left it
+        if (this->recorder)
+        {
+            this->record_frame(Recording::RESET);
         }
-        delete[] this->board;
-        this->board = new Agents::BaseAgent **[this->layerCount];
-        for (int i = 0; i < this->layerCount; i++)
+    }
+
+    void SimulatedBoard::contents_clear()
+    {
+        // Clear the board in place (the arena keeps its allocation)
+        std::fill(this->board.begin(), this->board.end(), nullptr);
+        std::fill(this->occupancy.begin(), this->occupancy.end(), 0);
+
+        // Empty the fields
+        for (auto &field : this->fields)
         {
-            this->board[i] = new Agents::BaseAgent *[this->agentSize];
-            for (int j = 0; j < this->agentSize; j++)
+            if (field)
             {
-                this->board[i][j] = nullptr;
+                field->clear();
             }
         }
+        for (auto &scalarField : this->scalar_fields)
+        {
+            scalarField.second->fill(0.0f);
+        }
 
         // Reset step count
         this->step_count = 0;
+        this->simulated = true;
+
+        // Ids start again, so the same setup gets the same ids
+        this->next_agent_id = 0;
 
-        // Flush the agents
+        // Flush the agents (pending deletes are gone with them)
+        this->owned_agents_delete();
         this->agents.clear();
+        this->agent_table.clear();
+        this->scheduled_delete_agents.clear();
+        this->python_agents_changed = true;
 
-        // reset the count
-        for (auto &kv : this->color_map_count)
+        // Flush the entities (kernels and attributes stay)
+        if (this->store)
         {
-            kv.second = 0;
+            this->store->clear();
+            std::fill(this->entity_cells.begin(), this->entity_cells.end(), Agents::AgentStore::NONE);
         }
 
-        // Call on_reset functions
-        for (auto func : this->on_reset)
+        // reset the count
+        std::fill(this->state_counts.begin(), this->state_counts.end(), 0);
+
+        // every layer changed (flow fields get checked again)
+        for (int layer = 0; layer < this->layerCount; layer++)
         {
-            func(this);
+            this->layer_touch(layer);
+            this->static_revisions[layer]++;
         }
+
+        // everything gets stepped in the first step
+        std::fill(this->dirty_cells.begin(), this->dirty_cells.end(), 1);
+
+        // readers only need to know that everything before is gone (the agents added by on_reset come after)
+        this->journal.clear();
+        this->journal_add(Journal::RESET, Journal::AGENT, -1, Pos(0, 0), Pos(0, 0), StateRegistry::NONE, StateRegistry::NONE, -1, -1);
     }
 
     void SimulatedBoard::step()
@@ -254,142 +581,1583 @@ namespace fastautomata::Board {
 
         auto step = 0;
 
-        for (auto func : this->step_instructions)
+        for (auto &func : this->step_instructions)
         {
             // std::cout << "INFO: Calling step instruction: " << step++ << std::endl;
             func(this);
         }
 
+        // Apply the next buffer of the fields
+        this->fields_swap();
+
+        // Python views of the layers show the new step
+        this->views_sync();
+
         // Increment step count
         this->step_count++;
 
+        // Hand the step to the recorder (the keyframes let replays seek)
+        if (this->recorder)
+        {
+            this->record_steps++;
+            this->record_frame(this->record_steps >= this->recorder->getKeyframeInterval() ? Recording::KEYFRAME : Recording::STEP);
+        }
+
         auto end = std::chrono::high_resolution_clock::now();
 
         // std::cout << "INFO: Step took: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms" << std::endl;
     }
 
-    /*
-     █████   ██████  ███████ ███    ██ ████████ ███████ 
-    ██   ██ ██       ██      ████   ██    ██    ██      
-    ███████ ██   ███ █████   ██ ██  ██    ██    ███████ 
-    ██   ██ ██    ██ ██      ██  ██ ██    ██         ██ 
-    ██   ██  ██████  ███████ ██   ████    ██    ███████ 
-    */
-
-    Agents::BaseAgent *SimulatedBoard::agent_get(Pos pos, int layer, bool wrap)
+    void SimulatedBoard::step_n(int n)
     {
-        // std::cout << "INFO: Getting agent at pos: " << pos.toString() << ", layer: " << std::to_string(layer) << ", wrap: " << std::to_string(wrap) << std::endl;
-        if (layer >= this->layerCount)
+        for (int i = 0; i < n; i++)
         {
-            throw std::out_of_range("Layer out of range");
+            this->step();
         }
-        if (pos.x >= this->width || pos.y >= this->height || pos.x < 0 || pos.y < 0)
+    }
+
+    bool SimulatedBoard::is_native()
+    {
+        if (this->python_agents_changed)
         {
-            // std::cout << "WARNING: Position out of range. Pos: " << pos.toString() << ", width: " << std::to_string(this->width) << ", height: " << std::to_string(this->height) << std::endl;
-            if (wrap)
+            this->python_agents = false;
+            for (auto agent : this->agents)
             {
-                // TODO use modulo instead of this
-                int x = pos.x;
-                int y = pos.y;
-
-                if (pos.x < 0)
-                {
-                    x = this->width + pos.x;
-                }
-                if (pos.y < 0)
-                {
-                    y = this->height + pos.y;
-                }
-
-                if (pos.x >= this->width)
-                {
-                    x = pos.x % this->width;
-                }
-                if (pos.y >= this->height)
-                {
-                    y = pos.y % this->height;
-                }
-
-                pos = Pos(x, y);
-                // std::cout << "INFO: Wrapped position. New pos: " << pos.toString() << std::endl;
+                bool native = agent->isNative();
+                this->agent_table.slot(agent).type = native ? Agents::AgentType::NATIVE : Agents::AgentType::PYTHON;
+                this->python_agents = this->python_agents || !native;
             }
-            else
+            this->python_agents_changed = false;
+        }
+        if (this->python_agents)
+        {
+            return false;
+        }
+
+        // lambdas and python functions might call into python
+        for (auto &func : this->step_instructions)
+        {
+            if (func.target<void (*)(SimulatedBoard *)>() == nullptr)
             {
-                return nullptr;
+                return false;
             }
         }
-
-        // auto toReturn = this->board[layer][pos.toIndex(this->width)];
-        // std::cout << "INFO: Returning agent at pos: " << pos.toString() << ", layer: " << std::to_string(layer) << ", wrap: " << std::to_string(wrap) << ". Agent: " << static_cast<void*>(toReturn) << std::endl;
-        return this->board[layer][pos.toIndex(this->width)];
+        return true;
     }
 
-    void SimulatedBoard::agent_add(Agents::BaseAgent *agent, bool allowOverrides)
+    /*
+    ███████  █████  ██    ██ ███████ 
+    ██      ██   ██ ██    ██ ██      
+    ███████ ███████ ██    ██ █████   
+         ██ ██   ██  ██  ██  ██      
+    ███████ ██   ██   ████   ███████ 
+    */
+
+    void SimulatedBoard::save(const std::string &path)
     {
-        auto existing = this->agent_get(agent->getPos(), agent->getLayer());
+        std::vector<Checkpoint::SectionWriter> sections;
 
-        // check if agent already exists
-        if (existing != nullptr)
+        // states (with their colors) go first, everything else stores state ids
+        Checkpoint::SectionWriter &states = sections.emplace_back(Checkpoint::STATES);
+        states.write(static_cast<uint32_t>(this->states.size()));
+        for (size_t id = 0; id < this->states.size(); id++)
         {
-            if (allowOverrides)
+            std::array<int, 3> color = id < this->state_colors.size() ? this->state_colors[id] : std::array<int, 3>{0, 0, 0};
+            for (int channel : color)
             {
-                this->agent_remove(existing);
+                states.write(static_cast<int32_t>(channel));
             }
-            else
+            states.write_string(this->states.getName(static_cast<uint16_t>(id)));
+        }
+
+        Checkpoint::SectionWriter &collisions = sections.emplace_back(Checkpoint::COLLISIONS);
+        int length = this->layer_collisions.getLength();
+        collisions.write(static_cast<int32_t>(length));
+        for (int start = 0; start < length; start++)
+        {
+            for (int end = 0; end < length; end++)
             {
-                throw std::invalid_argument("Agent already exists at that position");
+                collisions.write(static_cast<uint8_t>(this->layer_collisions.getCollision(start, end)));
             }
         }
 
-        // check if agent inherits from Agent
-        Agents::Agent *simulatedAgent = dynamic_cast<Agents::Agent *>(agent);
-        bool isSimulatedAgent = simulatedAgent != nullptr;
-
-        // std::cout << "INFO: Adding agent. Si agent simulated? = " << isSimulatedAgent << ". Agent ID: " << agent->getId() << ". Simulated agent ID: " << simulatedAgent->getId() << ". Agent address: " << static_cast<void*>(agent) << std::endl;
-
-        if (isSimulatedAgent)
+        for (int layer = 0; layer < this->layerCount; layer++)
         {
-            this->agents.push_back(simulatedAgent);
+            if (!this->fields[layer])
+            {
+                continue;
+            }
+            Checkpoint::SectionWriter &field = sections.emplace_back(Checkpoint::FIELD);
+            field.write(static_cast<int32_t>(layer));
+            field.write(this->fields[layer]->getEmptyState());
+            field.write_bytes(this->fields[layer]->current_data(), sizeof(uint16_t) * this->agentSize);
         }
 
-        // add agent to board
-        this->board[agent->getLayer()][agent->getPos().toIndex(this->width)] = agent;
-
-        // update color map
-        color_map_count[agent->getState()] += 1;
-
-        // call on_add functions
-        for (auto func : this->on_add)
+        for (auto &scalarField : this->scalar_fields)
         {
-            func(agent);
+            Checkpoint::SectionWriter &scalar = sections.emplace_back(Checkpoint::SCALAR);
+            scalar.write_string(scalarField.first);
+            scalar.write(static_cast<uint8_t>(scalarField.second->getWrap()));
+            scalar.write(scalarField.second->getDiffusion());
+            scalar.write(scalarField.second->getEvaporation());
+            scalar.write_bytes(scalarField.second->data(), sizeof(float) * this->agentSize);
         }
-    }
-
-    void SimulatedBoard::agent_move(Agents::BaseAgent *agent, Pos posPrev, Pos posNew)
-    {
-        board[agent->getLayer()][posPrev.toIndex(this->width)] = nullptr;
-        board[agent->getLayer()][posNew.toIndex(this->width)] = agent;
-    }
-
-    void SimulatedBoard::agent_move_layer(Agents::Agent *agent, int layerNew)
-    {
-        board[agent->getLayer()][agent->getPos().toIndex(this->width)] = nullptr;
-        board[layerNew][agent->getPos().toIndex(this->width)] = agent;
-
-        agent->changeLayer(layerNew);
-    }
 
-    void SimulatedBoard::agent_remove(Agents::BaseAgent *agent)
-    {
-        // check if agent is not already schedlued for deletion
-        for (auto scheduledAgent : this->scheduled_delete_agents)
+        // simulated agents in step order (so they step in the same order after loading), then the static ones
+        std::vector<Checkpoint::AgentRecord> records;
+        auto record = [&](Agents::BaseAgent *agent, Agents::AgentType type, bool awake) {
+            Checkpoint::AgentRecord agentRecord;
+            agentRecord.id = agent->id;
+            agentRecord.x = agent->pos.x;
+            agentRecord.y = agent->pos.y;
+            agentRecord.layer = agent->layer;
+            agentRecord.state = agent->state;
+            agentRecord.type = type;
+            agentRecord.flags = awake ? Checkpoint::AgentRecord::AWAKE : 0;
+            records.push_back(agentRecord);
+        };
+        for (auto agent : this->agents)
         {
-            if (scheduledAgent == agent)
+            if (!this->agent_table.slot(agent).pending_delete)
             {
-                return;
+                record(agent, agent->isNative() ? Agents::AgentType::NATIVE : Agents::AgentType::PYTHON, agent->awake);
             }
         }
-        this->scheduled_delete_agents.push_back(agent);
+        this->agent_table.for_each([&](Agents::AgentTable::Slot &slot) {
+            if (slot.dense == Agents::AgentTable::NONE && !slot.pending_delete)
+            {
+                record(slot.agent, Agents::AgentType::STATIC, false);
+            }
+        });
+        Checkpoint::SectionWriter &agentSection = sections.emplace_back(Checkpoint::AGENTS);
+        agentSection.write(static_cast<uint32_t>(records.size()));
+        agentSection.write_bytes(records.data(), sizeof(Checkpoint::AgentRecord) * records.size());
+
+        if (this->store)
+        {
+            auto store = this->store.get();
+            size_t count = store->size();
+            Checkpoint::SectionWriter &entities = sections.emplace_back(Checkpoint::ENTITIES);
+            entities.write(static_cast<uint32_t>(count));
+            entities.write(store->getNextId());
+            entities.write(static_cast<uint32_t>(store->attributes.size()));
+            for (size_t i = 0; i < store->attributes.size(); i++)
+            {
+                entities.write_string(store->getAttributeNames()[i]);
+                entities.write(store->getAttributeDefaults()[i]);
+            }
+            entities.write_bytes(store->x.data(), sizeof(int32_t) * count);
+            entities.write_bytes(store->y.data(), sizeof(int32_t) * count);
+            entities.write_bytes(store->layer.data(), sizeof(int32_t) * count);
+            entities.write_bytes(store->state.data(), sizeof(uint16_t) * count);
+            entities.write_bytes(store->id.data(), sizeof(uint32_t) * count);
+            for (auto &column : store->attributes)
+            {
+                entities.write_bytes(column.data(), sizeof(double) * count);
+            }
+        }
+
+        // the dirty cells too, so the first step after loading steps the same agents it would have
+        Checkpoint::SectionWriter &settings = sections.emplace_back(Checkpoint::SETTINGS);
+        settings.write(static_cast<uint8_t>(this->move_policy));
+        settings.write(static_cast<uint8_t>(this->move_allow_swaps));
+        settings.write(static_cast<uint8_t>(this->active_scheduling));
+        settings.write(static_cast<uint8_t>(this->active_wrap));
+        settings.write(static_cast<int32_t>(this->active_radius));
+        if (this->active_scheduling)
+        {
+            settings.write_bytes(this->dirty_cells.data(), this->agentSize);
+        }
+
+        Checkpoint::Header header;
+        std::memcpy(header.magic, Checkpoint::MAGIC, sizeof(header.magic));
+        header.version = Checkpoint::VERSION;
+        header.byteOrder = Checkpoint::ENDIAN_MARK;
+        header.width = this->width;
+        header.height = this->height;
+        header.layers = this->layerCount;
+        header.step = this->step_count;
+        header.nextAgentId = this->next_agent_id;
+        header.sectionCount = static_cast<uint32_t>(sections.size());
+        header.seed = this->seed;
+        header.randomStep = this->board_random_step;
+        header.reserved = 0;
+        header.randomDraws = this->board_random_draws;
+
+        // write next to the file and rename it, so the last checkpoint survives if this one gets interrupted
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file)
+            {
+                throw std::runtime_error("Could not open file: " + temporary);
+            }
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            for (auto &section : sections)
+            {
+                section.flush(file);
+            }
+            file.flush();
+            if (!file)
+            {
+                throw std::runtime_error("Could not write file: " + temporary);
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (error)
+        {
+            std::filesystem::remove(temporary, error);
+            throw std::runtime_error("Could not write file: " + path);
+        }
+    }
+
+    void SimulatedBoard::load(const std::string &path, const std::function<void(const Checkpoint::AgentRecord &)> &restore)
+    {
+        Checkpoint::MappedFile file(path);
+        const uint8_t *data = file.getData();
+        size_t size = file.getSize();
+
+        Checkpoint::Header header;
+        if (size < sizeof(header))
+        {
+            throw std::invalid_argument(path + " is not a checkpoint");
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, Checkpoint::MAGIC, sizeof(header.magic)) != 0)
+        {
+            throw std::invalid_argument(path + " is not a checkpoint");
+        }
+        if (header.byteOrder != Checkpoint::ENDIAN_MARK)
+        {
+            throw std::invalid_argument("The checkpoint was written on a machine with another byte order");
+        }
+        if (header.version != Checkpoint::VERSION)
+        {
+            throw std::invalid_argument("The checkpoint has version " + std::to_string(header.version) + ", only version " + std::to_string(Checkpoint::VERSION) + " can be loaded");
+        }
+        if (header.width != this->width || header.height != this->height || header.layers != this->layerCount)
+        {
+            throw std::invalid_argument("The checkpoint is of a " + std::to_string(header.width) + "x" + std::to_string(header.height) + " board with " + std::to_string(header.layers) + " layers");
+        }
+
+        // find every section first, so a truncated file throws before the board changes
+        std::vector<std::pair<uint32_t, Checkpoint::SectionReader>> sections;
+        size_t position = sizeof(header);
+        for (uint32_t i = 0; i < header.sectionCount; i++)
+        {
+            Checkpoint::SectionHeader section;
+            if (size - position < sizeof(section))
+            {
+                throw std::invalid_argument("The checkpoint is broken (it ends before its last section)");
+            }
+            std::memcpy(&section, data + position, sizeof(section));
+            position += sizeof(section);
+            if (section.size > size - position)
+            {
+                throw std::invalid_argument("The checkpoint is broken (it ends before its last section)");
+            }
+            sections.emplace_back(section.kind, Checkpoint::SectionReader(data + position, static_cast<size_t>(section.size)));
+            position += static_cast<size_t>(section.size);
+        }
+
+        this->contents_clear();
+        const uint8_t *dirtyCells = nullptr;
+        try
+        {
+            // the states of the file get their id in this board (the same one, unless the board registered states in another order)
+            std::vector<uint16_t> stateMap;
+            bool sameIds = true;
+            auto mapState = [&](uint16_t state) -> uint16_t {
+                if (state == StateRegistry::NONE || sameIds)
+                {
+                    return state;
+                }
+                if (state >= stateMap.size())
+                {
+                    throw std::invalid_argument("The checkpoint is broken (state id " + std::to_string(state) + " is not in the file)");
+                }
+                return stateMap[state];
+            };
+            auto mapStates = [&](uint16_t *states, size_t count) {
+                for (size_t i = 0; i < count && !sameIds; i++)
+                {
+                    states[i] = mapState(states[i]);
+                }
+            };
+
+            for (auto &[kind, reader] : sections)
+            {
+                switch (kind)
+                {
+                case Checkpoint::STATES:
+                {
+                    uint32_t count = reader.read<uint32_t>();
+                    stateMap.resize(count);
+                    for (uint32_t id = 0; id < count; id++)
+                    {
+                        std::array<int, 3> color;
+                        for (int &channel : color)
+                        {
+                            channel = reader.read<int32_t>();
+                        }
+                        std::string name = reader.read_string();
+                        stateMap[id] = this->state_id(name);
+                        this->addColor(name, color);
+                        sameIds = sameIds && stateMap[id] == id;
+                    }
+                    break;
+                }
+                case Checkpoint::COLLISIONS:
+                {
+                    int length = reader.read<int32_t>();
+                    if (length < 0)
+                    {
+                        throw std::invalid_argument("The checkpoint is broken (negative collision map size)");
+                    }
+                    const uint8_t *types = reader.read_bytes(static_cast<size_t>(length) * length);
+                    CollisionMap collisionMap(length);
+                    for (int start = 0; start < length; start++)
+                    {
+                        for (int end = 0; end < length; end++)
+                        {
+                            uint8_t type = types[static_cast<size_t>(start) * length + end];
+                            if (type > static_cast<uint8_t>(CollisionType::TRIGGER))
+                            {
+                                throw std::invalid_argument("The checkpoint is broken (unknown collision type " + std::to_string(type) + ")");
+                            }
+                            CollisionType collision = static_cast<CollisionType>(type);
+                            if (collision != CollisionType::NONE)
+                            {
+                                collisionMap.addCollision(&collision, start, end);
+                            }
+                        }
+                    }
+                    this->layer_collisions = collisionMap;
+                    break;
+                }
+                case Checkpoint::FIELD:
+                {
+                    int layer = reader.read<int32_t>();
+                    uint16_t emptyState = mapState(reader.read<uint16_t>());
+                    if (layer < 0 || layer >= this->layerCount || emptyState >= this->states.size())
+                    {
+                        throw std::invalid_argument("The checkpoint is broken (field layer " + std::to_string(layer) + ")");
+                    }
+                    if (!this->is_field(layer))
+                    {
+                        this->field_enable(layer, this->state_name(emptyState));
+                    }
+                    else if (this->fields[layer]->getEmptyState() != emptyState)
+                    {
+                        throw std::invalid_argument("Layer " + std::to_string(layer) + " is a field layer with another empty state than in the checkpoint");
+                    }
+
+                    std::vector<uint16_t> cells(this->agentSize);
+                    std::memcpy(cells.data(), reader.read_bytes(sizeof(uint16_t) * cells.size()), sizeof(uint16_t) * cells.size());
+                    mapStates(cells.data(), cells.size());
+                    for (uint16_t state : cells)
+                    {
+                        if (state >= this->states.size())
+                        {
+                            throw std::invalid_argument("The checkpoint is broken (state id " + std::to_string(state) + " in field layer " + std::to_string(layer) + ")");
+                        }
+                    }
+                    this->fields[layer]->assign(cells.data(), this->state_counts);
+                    this->layer_touch(layer);
+                    break;
+                }
+                case Checkpoint::SCALAR:
+                {
+                    std::string name = reader.read_string();
+                    bool wrap = reader.read<uint8_t>() != 0;
+                    float diffusion = reader.read<float>();
+                    float evaporation = reader.read<float>();
+                    Fields::ScalarField *scalarField = this->scalar_fields.count(name) > 0 ? this->scalar(name) : this->scalar_add(name, wrap);
+                    scalarField->setRates(diffusion, evaporation);
+                    std::memcpy(scalarField->data(), reader.read_bytes(sizeof(float) * this->agentSize), sizeof(float) * this->agentSize);
+                    break;
+                }
+                case Checkpoint::AGENTS:
+                {
+                    uint32_t count = reader.read<uint32_t>();
+                    const uint8_t *records = reader.read_bytes(sizeof(Checkpoint::AgentRecord) * count);
+                    for (uint32_t i = 0; i < count; i++)
+                    {
+                        Checkpoint::AgentRecord record;
+                        std::memcpy(&record, records + sizeof(Checkpoint::AgentRecord) * i, sizeof(record));
+                        record.state = mapState(record.state);
+
+                        Pos pos(record.x, record.y);
+                        if (record.id < 0 || record.layer < 0 || record.layer >= this->layerCount || this->is_field(record.layer) || !this->pos_resolve(pos, false)
+                            || record.state >= this->states.size() || this->cell_occupied_at(record.layer, pos.toIndex(this->width)))
+                        {
+                            throw std::invalid_argument("Cannot restore the agent " + std::to_string(record.id) + " at " + pos.toString() + " (layer " + std::to_string(record.layer) + ")");
+                        }
+
+                        // whatever restore adds gets the id of the record
+                        Agents::BaseAgent *agent = nullptr;
+                        if (restore)
+                        {
+                            this->next_agent_id = record.id;
+                            restore(record);
+                            agent = this->agent_by_id(record.id);
+                        }
+
+                        if (agent == nullptr)
+                        {
+                            // a plain Agent does not step like the python one did
+                            if (record.type == Agents::AgentType::PYTHON)
+                            {
+                                throw std::invalid_argument("The agent " + std::to_string(record.id) + " was implemented in python, load needs a restore function that adds it");
+                            }
+
+                            agent = record.type == Agents::AgentType::STATIC ? new Agents::BaseAgent() : new Agents::Agent();
+                            agent->board = this;
+                            agent->pos = pos;
+                            agent->layer = record.layer;
+                            agent->state = record.state;
+                            agent->id = record.id;
+                            this->agent_place_owned(agent);
+                        }
+                        Agents::Agent *simulatedAgent = dynamic_cast<Agents::Agent *>(agent);
+                        if (simulatedAgent != nullptr)
+                        {
+                            simulatedAgent->awake = (record.flags & Checkpoint::AgentRecord::AWAKE) != 0;
+                        }
+                    }
+                    break;
+                }
+                case Checkpoint::ENTITIES:
+                {
+                    uint32_t count = reader.read<uint32_t>();
+                    uint32_t nextId = reader.read<uint32_t>();
+                    uint32_t attributeCount = reader.read<uint32_t>();
+                    std::vector<std::pair<std::string, double>> attributes;
+                    for (uint32_t i = 0; i < attributeCount; i++)
+                    {
+                        std::string name = reader.read_string();
+                        attributes.emplace_back(name, reader.read<double>());
+                    }
+
+                    std::vector<int32_t> x(count), y(count), layer(count);
+                    std::vector<uint16_t> state(count);
+                    std::vector<uint32_t> id(count);
+                    std::memcpy(x.data(), reader.read_bytes(sizeof(int32_t) * count), sizeof(int32_t) * count);
+                    std::memcpy(y.data(), reader.read_bytes(sizeof(int32_t) * count), sizeof(int32_t) * count);
+                    std::memcpy(layer.data(), reader.read_bytes(sizeof(int32_t) * count), sizeof(int32_t) * count);
+                    std::memcpy(state.data(), reader.read_bytes(sizeof(uint16_t) * count), sizeof(uint16_t) * count);
+                    std::memcpy(id.data(), reader.read_bytes(sizeof(uint32_t) * count), sizeof(uint32_t) * count);
+                    mapStates(state.data(), count);
+
+                    auto store = this->entities();
+                    store->restore(count, x.data(), y.data(), layer.data(), state.data(), id.data(), nextId);
+                    for (auto &attribute : attributes)
+                    {
+                        int column = store->attribute_add(attribute.first, attribute.second);
+                        std::memcpy(store->attributes[column].data(), reader.read_bytes(sizeof(double) * count), sizeof(double) * count);
+                    }
+                    break;
+                }
+                case Checkpoint::SETTINGS:
+                {
+                    uint8_t policy = reader.read<uint8_t>();
+                    bool allowSwaps = reader.read<uint8_t>() != 0;
+                    bool activeScheduling = reader.read<uint8_t>() != 0;
+                    bool activeWrap = reader.read<uint8_t>() != 0;
+                    int activeRadius = reader.read<int32_t>();
+                    if (policy > MovePolicy::RANDOM || activeRadius < 0)
+                    {
+                        throw std::invalid_argument("The checkpoint is broken (unknown settings)");
+                    }
+                    this->setMovePolicy(static_cast<MovePolicy>(policy), allowSwaps);
+                    this->setActiveScheduling(activeScheduling, activeRadius, activeWrap);
+                    dirtyCells = activeScheduling ? reader.read_bytes(this->agentSize) : nullptr;
+                    break;
+                }
+                default:
+                    // written by a newer version, and not needed to load
+                    break;
+                }
+            }
+
+            // placing the agents marked their cells, the file knows which cells really changed in the last step
+            if (dirtyCells != nullptr)
+            {
+                std::memcpy(this->dirty_cells.data(), dirtyCells, this->agentSize);
+            }
+        }
+        catch (...)
+        {
+            // half a checkpoint is worse than an empty board
+            this->contents_clear();
+            this->views_sync();
+            if (this->recorder)
+            {
+                this->record_frame(Recording::RESET);
+            }
+            throw;
+        }
+
+        this->step_count = header.step;
+        this->next_agent_id = header.nextAgentId;
+        this->seed = header.seed;
+        this->board_random_step = header.randomStep;
+        this->board_random_draws = header.randomDraws;
+
+        this->views_sync();
+
+        // a recording keeps going, with a new run that starts at the step of the checkpoint
+        if (this->recorder)
+        {
+            this->record_frame(Recording::RESET);
+        }
+    }
+
+    /*
+    ██████  ███████  ██████  ██████  ██████  ██████
+    ██   ██ ██      ██      ██    ██ ██   ██ ██   ██
+    ██████  █████   ██      ██    ██ ██████  ██   ██
+    ██   ██ ██      ██      ██    ██ ██   ██ ██   ██
+    ██   ██ ███████  ██████  ██████  ██   ██ ██████
+    */
+
+    void SimulatedBoard::record_start(const std::string &path, int keyframeInterval)
+    {
+        if (this->recorder)
+        {
+            throw std::invalid_argument("The board is already recording (call record_stop first)");
+        }
+        if (keyframeInterval < 1)
+        {
+            throw std::invalid_argument("The keyframe interval must be at least 1");
+        }
+        this->recorder = std::make_unique<Recording::Recorder>(path, this->width, this->height, this->layerCount, keyframeInterval);
+        this->record_changes.clear();
+        this->record_frame(Recording::KEYFRAME);
+    }
+
+    void SimulatedBoard::record_stop()
+    {
+        if (!this->recorder)
+        {
+            return;
+        }
+        std::string error = this->recorder->close();
+        this->recorder = nullptr;
+        this->record_changes.clear();
+        this->record_changes.shrink_to_fit();
+        if (!error.empty())
+        {
+            throw std::runtime_error(error);
+        }
+    }
+
+    bool SimulatedBoard::getRecording()
+    {
+        return this->recorder != nullptr;
+    }
+
+    void SimulatedBoard::record_frame(Recording::FrameKind kind)
+    {
+        if (Recording::is_keyframe(kind))
+        {
+            this->record_steps = 0;
+        }
+        this->recorder->push(this->frame_build(kind, this->record_changes, this->record_states));
+    }
+
+    Recording::Frame SimulatedBoard::frame_build(Recording::FrameKind kind, std::vector<Journal::Change> &changes, size_t &knownStates)
+    {
+        Recording::Frame frame;
+        frame.kind = kind;
+        frame.step = this->step_count;
+
+        // keyframes hold every state, so a replay can start from any of them
+        bool keyframe = Recording::is_keyframe(kind);
+        size_t firstState = keyframe ? 0 : knownStates;
+        for (size_t id = firstState; id < this->states.size(); id++)
+        {
+            frame.states.push_back(this->states.getName(static_cast<uint16_t>(id)));
+        }
+        knownStates = this->states.size();
+
+        // the encoder compares the layers with the last frame
+        for (int layer = 0; layer < this->layerCount; layer++)
+        {
+            if (this->fields[layer])
+            {
+                const uint16_t *cells = this->fields[layer]->current_data();
+                frame.fields.emplace_back(layer, std::vector<uint16_t>(cells, cells + this->agentSize));
+            }
+        }
+
+        if (keyframe)
+        {
+            this->agent_table.for_each([&](Agents::AgentTable::Slot &slot) {
+                if (!slot.pending_delete)
+                {
+                    Agents::BaseAgent *agent = slot.agent;
+                    frame.items.push_back(Recording::Item{agent->id, agent->pos.x, agent->pos.y, agent->layer, agent->state, Journal::AGENT, 0});
+                }
+            });
+            if (this->store)
+            {
+                auto store = this->store.get();
+                for (size_t i = 0; i < store->size(); i++)
+                {
+                    frame.items.push_back(Recording::Item{static_cast<int32_t>(store->id[i]), store->x[i], store->y[i], store->layer[i], store->state[i], Journal::ENTITY, 0});
+                }
+            }
+            // the keyframe replaces the changes before it
+            changes.clear();
+        }
+        else
+        {
+            // the next step starts with about the same size, so it does not grow again every step
+            frame.changes.reserve(changes.size());
+            std::swap(frame.changes, changes);
+        }
+        return frame;
+    }
+
+    Recording::Frame SimulatedBoard::frame_counts()
+    {
+        Recording::Frame frame;
+        frame.kind = Recording::COUNTS;
+        frame.step = this->step_count;
+        frame.counts = this->state_counts;
+        return frame;
+    }
+
+    /*
+    ███████ ████████ ██████  ███████  █████  ███    ███
+    ██         ██    ██   ██ ██      ██   ██ ████  ████
+    ███████    ██    ██████  █████   ███████ ██ ████ ██
+         ██    ██    ██   ██ ██      ██   ██ ██  ██  ██
+    ███████    ██    ██   ██ ███████ ██   ██ ██      ██
+    */
+
+    void SimulatedBoard::stream_enable(bool enabled)
+    {
+        this->stream_changes.clear();
+        if (!enabled)
+        {
+            this->stream_enabled = false;
+            this->stream_encoder = nullptr;
+            this->stream_changes.shrink_to_fit();
+            return;
+        }
+
+        // the encoder starts from the board as it is now (the keyframe the clients get), the bytes are not needed
+        this->stream_encoder = std::make_unique<Recording::Encoder>();
+        std::vector<Journal::Change> none;
+        Recording::Frame frame = this->frame_build(Recording::KEYFRAME, none, this->stream_states);
+        std::vector<uint8_t> bytes;
+        this->stream_encoder->write(frame, bytes);
+        this->stream_enabled = true;
+    }
+
+    bool SimulatedBoard::getStreamEnabled()
+    {
+        return this->stream_enabled;
+    }
+
+    std::vector<uint8_t> SimulatedBoard::stream_take()
+    {
+        if (!this->stream_enabled)
+        {
+            throw std::invalid_argument("The board is not streaming (call stream_enable first)");
+        }
+        std::vector<uint8_t> bytes;
+        Recording::Frame frame = this->frame_build(Recording::STEP, this->stream_changes, this->stream_states);
+        this->stream_encoder->write(frame, bytes);
+        Recording::Frame counts = this->frame_counts();
+        this->stream_encoder->write(counts, bytes);
+        return bytes;
+    }
+
+    std::vector<uint8_t> SimulatedBoard::stream_keyframe(bool header)
+    {
+        if (!this->stream_enabled)
+        {
+            throw std::invalid_argument("The board is not streaming (call stream_enable first)");
+        }
+        std::vector<uint8_t> bytes;
+        if (header)
+        {
+            Recording::Header start = Recording::header_make(this->width, this->height, this->layerCount, 0);
+            const uint8_t *data = reinterpret_cast<const uint8_t *>(&start);
+            bytes.insert(bytes.end(), data, data + sizeof(start));
+        }
+
+        // its own encoder and change list, so the frames of stream_take do not change
+        Recording::Encoder encoder;
+        std::vector<Journal::Change> none;
+        size_t knownStates = 0;
+        Recording::Frame frame = this->frame_build(Recording::KEYFRAME, none, knownStates);
+        encoder.write(frame, bytes);
+        Recording::Frame counts = this->frame_counts();
+        encoder.write(counts, bytes);
+        return bytes;
+    }
+
+    /*
+    ███████ ██ ███████ ██      ██████  ███████ 
+    ██      ██ ██      ██      ██   ██ ██      
+    █████   ██ █████   ██      ██   ██ ███████ 
+    ██      ██ ██      ██      ██   ██      ██ 
+    ██      ██ ███████ ███████ ██████  ███████ 
+    */
+
+    void SimulatedBoard::field_enable(int layer, std::string emptyState)
+    {
+        if (layer < 0 || layer >= this->layerCount)
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+        if (this->is_field(layer))
+        {
+            return;
+        }
+
+        for (int i = 0; i < this->agentSize; i++)
+        {
+            if (this->agent_at(layer, i) != nullptr || (this->store && this->entity_cell(layer, i) != Agents::AgentStore::NONE))
+            {
+                throw std::invalid_argument("Cannot turn layer " + std::to_string(layer) + " into a field layer, it contains agents");
+            }
+        }
+
+        this->fields[layer] = std::make_unique<Fields::StateField>(this->width, this->height, this->state_id(emptyState));
+        if (layer < 64)
+        {
+            this->field_layers |= uint64_t(1) << layer;
+        }
+        this->layer_touch(layer);
+    }
+
+    bool SimulatedBoard::is_field(int layer)
+    {
+        return layer >= 0 && layer < this->layerCount && this->fields[layer] != nullptr;
+    }
+
+    Fields::StateField *SimulatedBoard::field(int layer)
+    {
+        if (!this->is_field(layer))
+        {
+            throw std::invalid_argument("Layer " + std::to_string(layer) + " is not a field layer");
+        }
+        return this->fields[layer].get();
+    }
+
+    uint16_t SimulatedBoard::field_get_id(Pos pos, int layer, bool wrap)
+    {
+        auto field = this->field(layer);
+        if (!this->pos_resolve(pos, wrap))
+        {
+            return StateRegistry::NONE;
+        }
+        return field->get(pos.toIndex(this->width));
+    }
+
+    std::string SimulatedBoard::field_get(Pos pos, int layer, bool wrap)
+    {
+        uint16_t state = this->field_get_id(pos, layer, wrap);
+        if (state == StateRegistry::NONE)
+        {
+            return "";
+        }
+        return this->state_name(state);
+    }
+
+    void SimulatedBoard::field_set_id(Pos pos, uint16_t state, int layer)
+    {
+        auto field = this->field(layer);
+        if (!this->pos_resolve(pos, false))
+        {
+            throw std::out_of_range("Position out of range when setting a field cell. (Pos given: " + pos.toString() + ")");
+        }
+        if (state >= this->states.size())
+        {
+            throw std::out_of_range("State id out of range (id given: " + std::to_string(state) + ")");
+        }
+        field->set(pos.toIndex(this->width), state);
+        field->touch_next();
+    }
+
+    void SimulatedBoard::field_set(Pos pos, std::string state, int layer)
+    {
+        this->field_set_id(pos, this->state_id(state), layer);
+    }
+
+    void SimulatedBoard::field_put_id(Pos pos, uint16_t state, int layer)
+    {
+        auto field = this->field(layer);
+        if (!this->pos_resolve(pos, false))
+        {
+            throw std::out_of_range("Position out of range when putting a field cell. (Pos given: " + pos.toString() + ")");
+        }
+        if (state >= this->states.size())
+        {
+            throw std::out_of_range("State id out of range (id given: " + std::to_string(state) + ")");
+        }
+        field->put(pos.toIndex(this->width), state, this->state_counts);
+        this->cell_touch(pos);
+        this->layer_touch(layer);
+    }
+
+    void SimulatedBoard::field_put(Pos pos, std::string state, int layer)
+    {
+        this->field_put_id(pos, this->state_id(state), layer);
+    }
+
+    Life::LifeRule *SimulatedBoard::life_add(int layer, std::string rule, bool wrap, std::string aliveState, std::string deadState)
+    {
+        if (!this->is_field(layer))
+        {
+            this->field_enable(layer, deadState);
+        }
+        if (this->life_rules[layer])
+        {
+            throw std::invalid_argument("Layer " + std::to_string(layer) + " already runs a Life rule");
+        }
+        // the Life rule keeps its own copy of the layer, writes of a rule set would not get into it
+        if (this->rule_sets[layer])
+        {
+            throw std::invalid_argument("Layer " + std::to_string(layer) + " already has a rule set, it can not run a Life rule too");
+        }
+
+        this->life_rules[layer] = std::make_unique<Life::LifeRule>(this->field(layer), rule, wrap, this->state_id(aliveState), this->state_id(deadState));
+
+        Life::LifeRule *lifeRule = this->life_rules[layer].get();
+
+        // one step instruction steps every rule (a plain function, so the step can stay native)
+        bool hasInstruction = false;
+        for (auto &func : this->step_instructions)
+        {
+            auto target = func.target<void (*)(SimulatedBoard *)>();
+            hasInstruction = hasInstruction || (target != nullptr && *target == SimulatedBoard::update_life);
+        }
+        if (!hasInstruction)
+        {
+            this->step_instructions.push_back(SimulatedBoard::update_life);
+        }
+
+        return lifeRule;
+    }
+
+    Rules::RuleSet *SimulatedBoard::rules_add(int layer, const Neighborhood::Stencil &stencil, int countLayer, bool wrap)
+    {
+        if (layer < 0 || layer >= this->layerCount || countLayer < -1 || countLayer >= this->layerCount)
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+        if (this->rule_sets[layer])
+        {
+            throw std::invalid_argument("Layer " + std::to_string(layer) + " already has a rule set");
+        }
+        if (this->life_rules[layer])
+        {
+            throw std::invalid_argument("Layer " + std::to_string(layer) + " already runs a Life rule, it can not have a rule set too");
+        }
+
+        this->rule_sets[layer] = std::make_unique<Rules::RuleSet>(this, layer, stencil, countLayer == -1 ? layer : countLayer, wrap);
+
+        // the rules queue changes that the agents apply in step_end, so they go first (before the kernels too)
+        bool hasInstruction = false;
+        for (auto &func : this->step_instructions)
+        {
+            auto target = func.target<void (*)(SimulatedBoard *)>();
+            hasInstruction = hasInstruction || (target != nullptr && *target == SimulatedBoard::update_rules);
+        }
+        if (!hasInstruction)
+        {
+            this->step_instructions.insert(this->step_instructions.begin(), SimulatedBoard::update_rules);
+        }
+
+        return this->rule_sets[layer].get();
+    }
+
+    void SimulatedBoard::kernel_add(fa_board_kernel kernel, void *userData)
+    {
+        if (kernel == nullptr)
+        {
+            throw std::invalid_argument("The kernel can not be null");
+        }
+
+        this->board_kernels.push_back({kernel, userData});
+
+        // like the rules, kernels queue changes that the agents apply in step_end. They always run right after the rules (whichever got added first).
+        bool hasInstruction = false;
+        size_t position = 0;
+        for (size_t i = 0; i < this->step_instructions.size(); i++)
+        {
+            auto target = this->step_instructions[i].target<void (*)(SimulatedBoard *)>();
+            hasInstruction = hasInstruction || (target != nullptr && *target == SimulatedBoard::update_kernels);
+            if (target != nullptr && *target == SimulatedBoard::update_rules)
+            {
+                position = i + 1;
+            }
+        }
+        if (!hasInstruction)
+        {
+            this->step_instructions.insert(this->step_instructions.begin() + position, SimulatedBoard::update_kernels);
+        }
+    }
+
+    void SimulatedBoard::kernels_clear()
+    {
+        this->board_kernels.clear();
+    }
+
+    const fa_board *SimulatedBoard::kernel_board(bool agentKernel)
+    {
+        if (!this->kernel_view_ready)
+        {
+            std::lock_guard<std::mutex> lock(this->kernel_view_mutex);
+            if (!this->kernel_view_ready)
+            {
+                // the buffers of the views never move, so the pointers stay valid
+                this->kernel_cells.resize(this->layerCount);
+                for (int layer = 0; layer < this->layerCount; layer++)
+                {
+                    this->kernel_cells[layer] = this->layer_view(layer);
+                }
+                this->kernel_view = Kernels::board_view(this);
+                this->kernel_view.cells = this->kernel_cells.data();
+                this->kernel_agent_view = Kernels::agent_view(this);
+                this->kernel_agent_view.cells = this->kernel_cells.data();
+                this->kernel_view_ready = true;
+            }
+        }
+        return agentKernel ? &this->kernel_agent_view : &this->kernel_view;
+    }
+
+    Fields::ScalarField *SimulatedBoard::scalar_add(std::string name, bool wrap)
+    {
+        if (this->scalar_fields.count(name) > 0)
+        {
+            throw std::invalid_argument("There is already a scalar field named " + name);
+        }
+
+        this->scalar_fields[name] = std::make_unique<Fields::ScalarField>(this, wrap);
+
+        // one step instruction steps every field
+        bool hasInstruction = false;
+        for (auto &func : this->step_instructions)
+        {
+            auto target = func.target<void (*)(SimulatedBoard *)>();
+            hasInstruction = hasInstruction || (target != nullptr && *target == SimulatedBoard::update_scalars);
+        }
+        if (!hasInstruction)
+        {
+            this->step_instructions.push_back(SimulatedBoard::update_scalars);
+        }
+
+        return this->scalar_fields[name].get();
+    }
+
+    Fields::ScalarField *SimulatedBoard::scalar(const std::string &name)
+    {
+        auto found = this->scalar_fields.find(name);
+        if (found == this->scalar_fields.end())
+        {
+            throw std::invalid_argument("There is no scalar field named " + name);
+        }
+        return found->second.get();
+    }
+
+    void SimulatedBoard::fields_swap()
+    {
+        for (int layer = 0; layer < this->layerCount; layer++)
+        {
+            auto &field = this->fields[layer];
+            if (field && field->swap(this->state_counts, this->active_scheduling ? this->dirty_cells.data() : nullptr) > 0)
+            {
+                this->layer_touch(layer);
+            }
+        }
+    }
+
+    void SimulatedBoard::layer_states(int layer, uint16_t *out)
+    {
+        if (layer < 0 || layer >= this->layerCount)
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+
+        if (this->fields[layer])
+        {
+            std::copy(this->fields[layer]->current_data(), this->fields[layer]->current_data() + this->agentSize, out);
+            return;
+        }
+
+        this->parallel_for(this->agentSize, 0, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                out[i] = this->cell_state(layer, static_cast<int>(i));
+            }
+        });
+    }
+
+    const uint16_t *SimulatedBoard::layer_view(int layer)
+    {
+        if (layer < 0 || layer >= this->layerCount)
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+
+        if (this->state_views.empty())
+        {
+            this->state_views.resize(this->layerCount);
+        }
+        auto &view = this->state_views[layer];
+        if (view.empty())
+        {
+            view.resize(this->agentSize);
+        }
+        this->layer_states(layer, view.data());
+        return view.data();
+    }
+
+    void SimulatedBoard::views_sync()
+    {
+        for (int layer = 0; layer < static_cast<int>(this->state_views.size()); layer++)
+        {
+            if (!this->state_views[layer].empty())
+            {
+                this->layer_states(layer, this->state_views[layer].data());
+            }
+        }
+    }
+
+    const uint64_t *SimulatedBoard::occupancy_data()
+    {
+        return this->occupancy.empty() ? nullptr : this->occupancy.data();
+    }
+
+    /**
+     * @brief Add source (a row shifted by dx) to row. Cells that fall outside of the row are skipped, or wrapped.
+     * 
+     */
+    template <typename T>
+    static inline void add_shifted_row(int32_t *row, const T *source, int dx, int width, bool wrap)
+    {
+        int begin = std::max(0, -dx);
+        int end = std::min(width, width - dx);
+        for (int x = begin; x < end; x++)
+        {
+            row[x] += source[x + dx];
+        }
+        if (!wrap)
+        {
+            return;
+        }
+        for (int x = 0; x < width; x++)
+        {
+            if (x < begin || x >= end)
+            {
+                row[x] += source[(((x + dx) % width) + width) % width];
+            }
+        }
+    }
+
+    void SimulatedBoard::neighbor_count(int layer, uint16_t state, const Neighborhood::Stencil &stencil, int32_t *out, bool wrap)
+    {
+        std::vector<uint16_t> states(this->agentSize);
+        this->layer_states(layer, states.data());
+
+        std::vector<uint8_t> hits(this->agentSize);
+        for (int i = 0; i < this->agentSize; i++)
+        {
+            hits[i] = states[i] == state;
+        }
+
+        // every row only writes itself, and adds whole shifted rows (so the inner loop vectorizes)
+        int width = this->width;
+        int height = this->height;
+        this->parallel_for(height, 0, [&](size_t begin, size_t end) {
+            for (int y = static_cast<int>(begin); y < static_cast<int>(end); y++)
+            {
+                int32_t *row = out + static_cast<size_t>(y) * width;
+                std::fill(row, row + width, 0);
+                for (auto &offset : stencil.getOffsets(y))
+                {
+                    int sourceY = y + offset.y;
+                    if (sourceY < 0 || sourceY >= height)
+                    {
+                        if (!wrap)
+                        {
+                            continue;
+                        }
+                        sourceY = ((sourceY % height) + height) % height;
+                    }
+                    add_shifted_row(row, hits.data() + static_cast<size_t>(sourceY) * width, offset.x, width, wrap);
+                }
+            }
+        });
+    }
+
+    void SimulatedBoard::neighbor_counts(int layer, const Neighborhood::Stencil &stencil, int32_t *out, size_t stateCount, bool wrap)
+    {
+        std::vector<uint16_t> states(this->agentSize);
+        this->layer_states(layer, states.data());
+
+        int width = this->width;
+        int height = this->height;
+        size_t cells = static_cast<size_t>(this->agentSize);
+        this->parallel_for(height, 0, [&](size_t begin, size_t end) {
+            for (size_t s = 0; s < stateCount; s++)
+            {
+                std::fill(out + s * cells + begin * width, out + s * cells + end * width, 0);
+            }
+            for (int y = static_cast<int>(begin); y < static_cast<int>(end); y++)
+            {
+                for (auto &offset : stencil.getOffsets(y))
+                {
+                    int sourceY = y + offset.y;
+                    if (sourceY < 0 || sourceY >= height)
+                    {
+                        if (!wrap)
+                        {
+                            continue;
+                        }
+                        sourceY = ((sourceY % height) + height) % height;
+                    }
+                    const uint16_t *source = states.data() + static_cast<size_t>(sourceY) * width;
+                    for (int x = 0; x < width; x++)
+                    {
+                        int sourceX = x + offset.x;
+                        if (sourceX < 0 || sourceX >= width)
+                        {
+                            if (!wrap)
+                            {
+                                continue;
+                            }
+                            sourceX = ((sourceX % width) + width) % width;
+                        }
+                        uint16_t cellState = source[sourceX];
+                        if (cellState < stateCount)
+                        {
+                            out[cellState * cells + static_cast<size_t>(y) * width + x]++;
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    /*
+     █████   ██████  ███████ ███    ██ ████████ ███████ 
+    ██   ██ ██       ██      ████   ██    ██    ██      
+    ███████ ██   ███ █████   ██ ██  ██    ██    ███████ 
+    ██   ██ ██    ██ ██      ██  ██ ██    ██         ██ 
+    ██   ██  ██████  ███████ ██   ████    ██    ███████ 
+    */
+
+    Agents::BaseAgent *SimulatedBoard::agent_get(Pos pos, int layer, bool wrap)
+    {
+        // std::cout << "INFO: Getting agent at pos: " << pos.toString() << ", layer: " << std::to_string(layer) << ", wrap: " << std::to_string(wrap) << std::endl;
+        if (layer >= this->layerCount)
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+        if (!this->pos_resolve(pos, wrap))
+        {
+            return nullptr;
+        }
+
+        return this->agent_get_unchecked(pos, layer);
+    }
+
+    bool SimulatedBoard::pos_resolve(Pos &pos, bool wrap)
+    {
+        if (pos.x >= 0 && pos.y >= 0 && pos.x < this->width && pos.y < this->height)
+        {
+            return true;
+        }
+        if (!wrap)
+        {
+            return false;
+        }
+
+        pos.x = ((pos.x % this->width) + this->width) % this->width;
+        pos.y = ((pos.y % this->height) + this->height) % this->height;
+        return true;
+    }
+
+    bool SimulatedBoard::cell_occupied(Pos pos, int layer)
+    {
+        return this->cell_occupied_at(layer, pos.toIndex(this->width));
+    }
+
+    /**
+     * @brief Index of the lowest set bit (word must not be 0)
+     * 
+     */
+    static inline int lowestBit(uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    bool SimulatedBoard::move_blocked(Pos pos, int layer, bool includeSelf)
+    {
+        int index = pos.toIndex(this->width);
+
+        // too many layers for a bitmask, or a map of another size (it throws like getCollisions would)
+        if (this->occupancy.empty() || this->layer_collisions.getLength() != this->layerCount)
+        {
+            for (int searchLayer = 0; searchLayer < this->layerCount; searchLayer++)
+            {
+                bool solid = searchLayer == layer ? includeSelf : this->layer_collisions.getCollision(layer, searchLayer) == CollisionType::SOLID;
+                if (solid && this->cell_occupied_at(searchLayer, index))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        uint64_t self = uint64_t(1) << layer;
+        uint64_t mask = this->layer_collisions.getSolidMask(layer) & ~self;
+        if (includeSelf)
+        {
+            mask |= self;
+        }
+
+        if (this->occupancy[index] & mask & ~this->field_layers)
+        {
+            return true;
+        }
+
+        // field layers keep their own cells
+        uint64_t fieldMask = mask & this->field_layers;
+        while (fieldMask != 0)
+        {
+            if (this->fields[lowestBit(fieldMask)]->occupied(index))
+            {
+                return true;
+            }
+            fieldMask &= fieldMask - 1;
+        }
+        return false;
+    }
+
+    void SimulatedBoard::agent_add(Agents::BaseAgent *agent, bool allowOverrides)
+    {
+        if (agent->getLayer() < 0 || agent->getLayer() >= this->layerCount)
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+        if (this->is_field(agent->getLayer()))
+        {
+            throw std::invalid_argument("Cannot add an agent to a field layer (layer: " + std::to_string(agent->getLayer()) + ")");
+        }
+
+        auto existing = this->agent_get(agent->getPos(), agent->getLayer());
+
+        if (this->entity_at(agent->getPos(), agent->getLayer()) >= 0)
+        {
+            throw std::invalid_argument("An entity already exists at that position");
+        }
+
+        // check if agent already exists
+        if (existing != nullptr)
+        {
+            if (allowOverrides)
+            {
+                this->agent_remove(existing);
+            }
+            else
+            {
+                throw std::invalid_argument("Agent already exists at that position");
+            }
+        }
+
+        // check if agent inherits from Agent
+        Agents::Agent *simulatedAgent = dynamic_cast<Agents::Agent *>(agent);
+        bool isSimulatedAgent = simulatedAgent != nullptr;
+
+        // std::cout << "INFO: Adding agent. Si agent simulated? = " << isSimulatedAgent << ". Agent ID: " << agent->getId() << ". Simulated agent ID: " << simulatedAgent->getId() << ". Agent address: " << static_cast<void*>(agent) << std::endl;
+
+        agent->id = this->next_agent_id++;
+
+        if (isSimulatedAgent)
+        {
+            this->agents.push_back(simulatedAgent);
+            this->python_agents_changed = true;
+            this->agent_table.insert(agent, Agents::AgentType::NATIVE, static_cast<uint32_t>(this->agents.size() - 1));
+        }
+        else
+        {
+            this->agent_table.insert(agent, Agents::AgentType::STATIC, Agents::AgentTable::NONE);
+        }
+
+        // add agent to board
+        this->agent_at(agent->getLayer(), agent->getPos().toIndex(this->width)) = agent;
+        this->occupancy_update(agent->getLayer(), agent->getPos().toIndex(this->width));
+        this->static_touch(agent, agent->getLayer());
+
+        // update color map
+        this->state_counts[agent->getStateId()] += 1;
+        this->cell_touch(agent->getPos());
+        this->journal_add(Journal::ADD, Journal::AGENT, agent->id, agent->getPos(), agent->getPos(), agent->getStateId(), agent->getStateId(), agent->getLayer(), agent->getLayer());
+
+        // call on_add functions
+        for (auto &func : this->on_add)
+        {
+            func(agent);
+        }
+    }
+
+    std::vector<int> SimulatedBoard::agents_spawn(const std::vector<Pos> &positions, const std::vector<uint16_t> &states, const std::vector<int> &layers, const std::function<Agents::BaseAgent *()> &factory)
+    {
+        size_t count = positions.size();
+        if (count == 0)
+        {
+            return {};
+        }
+        if ((states.size() != 1 && states.size() != count) || (layers.size() != 1 && layers.size() != count))
+        {
+            throw std::invalid_argument("agents_spawn needs one state and one layer per position (or a single one for all of them)");
+        }
+
+        // check everything first, so a bad cell does not leave half of the agents on the board
+        std::vector<uint8_t> claimed(this->board.size(), 0);
+        for (size_t i = 0; i < count; i++)
+        {
+            Pos pos = positions[i];
+            int layer = layers.size() == 1 ? layers[0] : layers[i];
+            uint16_t state = states.size() == 1 ? states[0] : states[i];
+            if (layer < 0 || layer >= this->layerCount)
+            {
+                throw std::out_of_range("Layer out of range");
+            }
+            if (this->is_field(layer))
+            {
+                throw std::invalid_argument("Cannot add an agent to a field layer (layer: " + std::to_string(layer) + ")");
+            }
+            if (!this->pos_resolve(pos, false))
+            {
+                throw std::out_of_range("Position out of range when spawning agents. (Pos given: " + pos.toString() + ")");
+            }
+            if (state >= this->states.size())
+            {
+                throw std::out_of_range("State id out of range (id given: " + std::to_string(state) + ")");
+            }
+            size_t cell = this->cell_index(layer, pos.toIndex(this->width));
+            if (claimed[cell] || this->cell_occupied_at(layer, pos.toIndex(this->width)))
+            {
+                throw std::invalid_argument("Cannot spawn an agent at " + pos.toString() + " (layer " + std::to_string(layer) + "), the cell is occupied");
+            }
+            claimed[cell] = 1;
+        }
+
+        std::vector<int> ids(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            Agents::BaseAgent *agent = factory ? factory() : new Agents::BaseAgent();
+            agent->board = this;
+            agent->pos = positions[i];
+            agent->layer = layers.size() == 1 ? layers[0] : layers[i];
+            agent->state = states.size() == 1 ? states[0] : states[i];
+            agent->id = this->next_agent_id++;
+
+            this->agent_place_owned(agent);
+            ids[i] = agent->id;
+        }
+
+        for (auto &func : this->on_spawn)
+        {
+            func(ids);
+        }
+
+        return ids;
+    }
+
+    void SimulatedBoard::agent_place_owned(Agents::BaseAgent *agent)
+    {
+        Agents::Agent *simulatedAgent = dynamic_cast<Agents::Agent *>(agent);
+        if (simulatedAgent != nullptr)
+        {
+            this->agents.push_back(simulatedAgent);
+            this->python_agents_changed = true;
+            this->agent_table.insert(agent, Agents::AgentType::NATIVE, static_cast<uint32_t>(this->agents.size() - 1));
+        }
+        else
+        {
+            this->agent_table.insert(agent, Agents::AgentType::STATIC, Agents::AgentTable::NONE);
+        }
+        this->agent_table.slot(agent).owned = true;
+
+        int index = agent->pos.toIndex(this->width);
+        this->agent_at(agent->layer, index) = agent;
+        this->occupancy_update(agent->layer, index);
+        this->static_touch(agent, agent->layer);
+        this->state_counts[agent->state] += 1;
+        this->cell_touch(agent->pos);
+        this->journal_add(Journal::ADD, Journal::AGENT, agent->id, agent->pos, agent->pos, agent->state, agent->state, agent->layer, agent->layer);
+    }
+
+    void SimulatedBoard::owned_agents_delete()
+    {
+        this->agent_table.for_each([](Agents::AgentTable::Slot &slot) {
+            if (slot.owned)
+            {
+                delete slot.agent;
+            }
+        });
+    }
+
+    Agents::AgentStore *SimulatedBoard::entities()
+    {
+        if (!this->store)
+        {
+            this->store = std::make_unique<Agents::AgentStore>(this);
+            this->entity_cells = std::vector<uint32_t>(this->board.size(), Agents::AgentStore::NONE);
+            // a plain function, so the step can stay native
+            this->step_instructions.push_back(SimulatedBoard::update_entities);
+        }
+        return this->store.get();
+    }
+
+    long long SimulatedBoard::entity_at(Pos pos, int layer)
+    {
+        if (layer < 0 || layer >= this->layerCount)
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+        if (!this->store || !this->pos_resolve(pos, false))
+        {
+            return -1;
+        }
+
+        uint32_t id = this->entity_cell(layer, pos.toIndex(this->width));
+        return id == Agents::AgentStore::NONE ? -1 : static_cast<long long>(id);
+    }
+
+    std::shared_ptr<Paths::FlowField> SimulatedBoard::flow_field(const std::vector<Pos> &targets, int layer, bool diagonal, bool wrap)
+    {
+        if (layer < 0 || layer >= this->layerCount)
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+        if (targets.empty())
+        {
+            throw std::invalid_argument("A flow field needs at least one target");
+        }
+
+        std::vector<int> cells;
+        cells.reserve(targets.size());
+        for (Pos target : targets)
+        {
+            if (!this->pos_resolve(target, wrap))
+            {
+                throw std::out_of_range("Position out of range when adding a flow field target. (Pos given: " + target.toString() + ")");
+            }
+            cells.push_back(target.toIndex(this->width));
+        }
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+        std::lock_guard<std::mutex> lock(this->flow_fields_mutex);
+        auto key = std::make_tuple(layer, diagonal, wrap, cells);
+        auto found = this->flow_fields.find(key);
+        if (found != this->flow_fields.end())
+        {
+            return found->second;
+        }
+
+        auto flowField = std::make_shared<Paths::FlowField>(this, cells, layer, diagonal, wrap);
+        this->flow_fields.emplace(key, flowField);
+        return flowField;
+    }
+
+    void SimulatedBoard::flow_fields_clear()
+    {
+        std::lock_guard<std::mutex> lock(this->flow_fields_mutex);
+        this->flow_fields.clear();
+    }
+
+    Agents::BaseAgent *SimulatedBoard::agent_by_id(int id)
+    {
+        return this->agent_table.get_by_id(id);
+    }
+
+    Agents::AgentHandle SimulatedBoard::agent_handle(Agents::BaseAgent *agent)
+    {
+        if (!this->agent_table.contains(agent))
+        {
+            throw std::invalid_argument("The agent is not on this board");
+        }
+        return this->agent_table.handle(agent);
+    }
+
+    Agents::BaseAgent *SimulatedBoard::agent_from_handle(Agents::AgentHandle handle)
+    {
+        return this->agent_table.get(handle);
+    }
+
+    int SimulatedBoard::getAgentCount()
+    {
+        return this->agent_table.size();
+    }
+
+    void SimulatedBoard::agent_move(Agents::BaseAgent *agent, Pos posPrev, Pos posNew)
+    {
+        this->agent_at(agent->getLayer(), posPrev.toIndex(this->width)) = nullptr;
+        this->agent_at(agent->getLayer(), posNew.toIndex(this->width)) = agent;
+        this->occupancy_update(agent->getLayer(), posPrev.toIndex(this->width));
+        this->occupancy_update(agent->getLayer(), posNew.toIndex(this->width));
+        this->static_touch(agent, agent->getLayer());
+        this->cell_touch(posPrev);
+        this->cell_touch(posNew);
+        this->journal_add(Journal::MOVE, Journal::AGENT, agent->getId(), posPrev, posNew, agent->getStateId(), agent->getStateId(), agent->getLayer(), agent->getLayer());
+    }
+
+    void SimulatedBoard::agent_move_layer(Agents::Agent *agent, int layerNew)
+    {
+        if (this->is_field(layerNew))
+        {
+            throw std::invalid_argument("Cannot move an agent to a field layer (layer: " + std::to_string(layerNew) + ")");
+        }
+
+        this->agent_at(agent->getLayer(), agent->getPos().toIndex(this->width)) = nullptr;
+        this->agent_at(layerNew, agent->getPos().toIndex(this->width)) = agent;
+        this->occupancy_update(agent->getLayer(), agent->getPos().toIndex(this->width));
+        this->occupancy_update(layerNew, agent->getPos().toIndex(this->width));
+        this->static_touch(agent, agent->getLayer());
+        this->static_touch(agent, layerNew);
+        this->cell_touch(agent->getPos());
+        this->journal_add(Journal::LAYER, Journal::AGENT, agent->getId(), agent->getPos(), agent->getPos(), agent->getStateId(), agent->getStateId(), agent->getLayer(), layerNew);
+
+        agent->changeLayer(layerNew);
+    }
+
+    void SimulatedBoard::agent_remove(Agents::BaseAgent *agent)
+    {
+        // agents of other boards (or already deleted) are ignored
+        if (!this->agent_table.contains(agent))
+        {
+            return;
+        }
+
+        // check if agent is not already schedlued for deletion
+        auto &slot = this->agent_table.slot(agent);
+        if (slot.pending_delete)
+        {
+            return;
+        }
+        slot.pending_delete = true;
+        this->scheduled_delete_agents.push_back(agent);
     }
 
     /*
@@ -407,37 +2175,49 @@ namespace fastautomata::Board {
      */
     void SimulatedBoard::scheduled_delete(SimulatedBoard *board)
     {
-        for (auto agent : board->scheduled_delete_agents)
+        // callbacks can schedule more agents, they get deleted in this pass as well
+        for (size_t i = 0; i < board->scheduled_delete_agents.size(); i++)
         {
-            board->color_map_count[agent->getState()] -= 1;
+            auto agent = board->scheduled_delete_agents[i];
+            board->state_counts[agent->getStateId()] -= 1;
             // std::cout << "INFO: Removing agent (id: " << std::to_string(agent->getId()) << "). Address; " << static_cast<void*>(agent) << std::endl;
-            // remove agent from board
-            board->board[agent->getLayer()][agent->getPos().toIndex(board->width)] = nullptr;
+            // remove agent from board (another agent might have overridden the cell)
+            auto &cell = board->agent_at(agent->getLayer(), agent->getPos().toIndex(board->width));
+            if (cell == agent)
+            {
+                cell = nullptr;
+                board->occupancy_update(agent->getLayer(), agent->getPos().toIndex(board->width));
+                board->static_touch(agent, agent->getLayer());
+            }
+            board->cell_touch(agent->getPos());
+            board->journal_add(Journal::REMOVE, Journal::AGENT, agent->getId(), agent->getPos(), agent->getPos(), agent->getStateId(), agent->getStateId(), agent->getLayer(), agent->getLayer());
 
             // std::cout << "INFO: Removed agent from board" << std::endl;
-            // check if agent is simulated Agent
-            Agents::Agent *simulatedAgent = dynamic_cast<Agents::Agent *>(agent);
-            if (simulatedAgent != nullptr)
+            // simulated agents leave the simulation loop: the last agent takes their place
+            uint32_t dense = board->agent_table.slot(agent).dense;
+            if (dense != Agents::AgentTable::NONE)
             {
-                // remove agent from agents
-                for (int i = 0; i < board->agents.size(); i++)
-                {
-                    if (board->agents[i] == simulatedAgent)
-                    {
-                        board->agents.erase(board->agents.begin() + i);
-                        // std::cout << "INFO: Removed agent from simulation loop." << std::endl;
-                        break;
-                    }
-                }
+                auto last = board->agents.back();
+                board->agents[dense] = last;
+                board->agent_table.slot(last).dense = dense;
+                board->agents.pop_back();
+                board->python_agents_changed = true;
+                // std::cout << "INFO: Removed agent from simulation loop." << std::endl;
             }
+            bool owned = board->agent_table.slot(agent).owned;
+            board->agent_table.erase(agent);
 
             // call on_delete functions
-            for (auto func : board->on_delete)
+            for (auto &func : board->on_delete)
             {
                 func(agent);
             }
 
-            if (board->python_on_delete != nullptr)
+            if (owned)
+            {
+                delete agent;
+            }
+            else if (board->python_on_delete != nullptr)
             {
                 board->python_on_delete(agent);
             }
@@ -460,10 +2240,49 @@ namespace fastautomata::Board {
     void SimulatedBoard::update_agents(Board::SimulatedBoard *board)
     {
         // std::cout << "INFO: Updating agents" << std::endl;
-        for (int i = 0; i < board->agents.size(); i++)
+        SimulatedBoard::update_active_set(board);
+        bool scheduled = !board->agents_stepping.empty();
+
+        if (board->pool)
+        {
+            // step() only writes pos_next and state_next, so native agents can be stepped in any order
+            board->parallel_for(board->agents.size(), 0, [board, scheduled](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                {
+                    auto agent = board->agents[i];
+                    if (!agent->isNative() || (scheduled && !board->agents_stepping[i]))
+                    {
+                        continue;
+                    }
+
+                    try
+                    {
+                        agent->step();
+                    }
+                    catch (const std::exception &e)
+                    {
+                        std::cout << "ERROR: When stepping through agents: " << e.what() << std::endl;
+                    }
+                }
+            });
+        }
+
+        for (size_t i = 0; i < board->agents.size(); i++)
         {
             auto agent = board->agents[i];
 
+            // already stepped by the pool
+            if (board->pool && agent->isNative())
+            {
+                continue;
+            }
+
+            // nothing changed around it (agents added during the step are always stepped)
+            if (scheduled && i < board->agents_stepping.size() && !board->agents_stepping[i])
+            {
+                continue;
+            }
+
             try
             {
                 // std::cout << "INFO: Updating agent (id: " << std::to_string(agent->getId()) << "). Address: " << static_cast<void*>(agent) << std::endl;
@@ -476,36 +2295,6 @@ namespace fastautomata::Board {
             }
         }
         // std::cout << "INFO: Updating agents finished" << std::endl;
-
-        // const int num_threads = std::thread::hardware_concurrency();
-
-        // // Calculate the number of agents per thread
-        // int agents_per_thread = board->agents.size() / num_threads;
-
-        // std::vector<std::thread> threads(num_threads);
-
-        // for (int t = 0; t < num_threads; t++) {
-        //     threads[t] = std::thread([&, t]() {
-        //         // Calculate the start and end indices for this thread
-        //         int start = t * agents_per_thread;
-        //         int end = (t == num_threads - 1) ? board->agents.size() : start + agents_per_thread;
-
-        //         for (int i = start; i < end; i++) {
-        //             auto agent = board->agents[i];
-
-        //             try {
-        //                 agent->step();
-        //             } catch(const std::exception& e) {
-        //                 std::cout << "ERROR: When stepping through agents: " << e.what() << std::endl;
-        //             }
-        //         }
-        //     });
-        // }
-
-        // // Wait for all threads to finish
-        // for (auto& thread : threads) {
-        //     thread.join();
-        // }
     }
 
     /**
@@ -516,17 +2305,523 @@ namespace fastautomata::Board {
     void SimulatedBoard::update_agents_end(Board::SimulatedBoard *board)
     {
         // std::cout << "INFO: Updating agents, step: end" << std::endl;
-        for (auto agent : board->agents)
+        if (board->move_policy != MovePolicy::SEQUENTIAL)
+        {
+            SimulatedBoard::resolve_moves(board);
+        }
+
+        bool scheduled = !board->agents_stepping.empty();
+        for (size_t i = 0; i < board->agents.size(); i++)
         {
+            auto agent = board->agents[i];
+
+            // skipped agents only need step_end if something got queued outside of their step
+            if (scheduled && i < board->agents_stepping.size() && !board->agents_stepping[i] 
+                && !agent->has_pos_next && !agent->moved && agent->state_next == StateRegistry::NONE)
+            {
+                continue;
+            }
+
             agent->step_end();
         }
         // std::cout << "INFO: Finished updating agents, step: end. Updated: " << board->agents.size() << std::endl;
     }
 
+    /**
+     * @brief Dilate one line of cells: out[i] is 1 if any in[j] with |i - j| <= radius is set
+     * 
+     * @param in The line to read (contiguous)
+     * @param out The first cell of the line to write
+     * @param count The amount of cells in the line
+     * @param stride The distance between two cells of out
+     * @param radius The dilation radius
+     * @param wrap If the line wraps around
+     * @param prefix A buffer for the prefix sums (count + 1 elements)
+     */
+    static void dilate_line(const uint8_t *in, uint8_t *out, int count, size_t stride, int radius, bool wrap, std::vector<int> &prefix)
+    {
+        prefix[0] = 0;
+        for (int i = 0; i < count; i++)
+        {
+            prefix[i + 1] = prefix[i] + (in[i] != 0);
+        }
+
+        if (prefix[count] == 0)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                out[i * stride] = 0;
+            }
+            return;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            int first = i - radius;
+            int last = i + radius;
+            int total;
+            if (!wrap)
+            {
+                total = prefix[std::min(last, count - 1) + 1] - prefix[std::max(first, 0)];
+            }
+            else if (radius * 2 + 1 >= count)
+            {
+                total = prefix[count];
+            }
+            else if (first < 0)
+            {
+                total = prefix[last + 1] + prefix[count] - prefix[count + first];
+            }
+            else if (last >= count)
+            {
+                total = prefix[count] - prefix[first] + prefix[last - count + 1];
+            }
+            else
+            {
+                total = prefix[last + 1] - prefix[first];
+            }
+            out[i * stride] = total != 0;
+        }
+    }
+
+    void SimulatedBoard::update_entities(Board::SimulatedBoard *board)
+    {
+        if (board->store)
+        {
+            board->store->run_kernels();
+            board->store->commit();
+        }
+    }
+
+    void SimulatedBoard::update_scalars(Board::SimulatedBoard *board)
+    {
+        for (auto &scalarField : board->scalar_fields)
+        {
+            scalarField.second->step();
+        }
+    }
+
+    void SimulatedBoard::update_life(Board::SimulatedBoard *board)
+    {
+        for (auto &rule : board->life_rules)
+        {
+            if (rule)
+            {
+                rule->step();
+            }
+        }
+    }
+
+    void SimulatedBoard::update_rules(Board::SimulatedBoard *board)
+    {
+        bool agentRules = false;
+        for (int layer = 0; layer < board->layerCount; layer++)
+        {
+            auto rules = board->rule_sets[layer].get();
+            if (!rules || rules->size() == 0)
+            {
+                continue;
+            }
+            rules->compile();
+
+            if (!board->is_field(layer))
+            {
+                agentRules = true;
+                continue;
+            }
+
+            // field cells: the whole layer, a row at a time
+            auto field = board->field(layer);
+            int width = board->width;
+            uint64_t streams = uint64_t(2) << 32;
+            board->parallel_for(board->height, 0, [&](size_t begin, size_t end) {
+                Rules::RuleResult result;
+                for (int y = static_cast<int>(begin); y < static_cast<int>(end); y++)
+                {
+                    for (int x = 0; x < width; x++)
+                    {
+                        int index = x + y * width;
+                        if (rules->evaluate(Pos(x, y), field->get(index), streams + index, result) && result.state != StateRegistry::NONE)
+                        {
+                            field->set(index, result.state);
+                        }
+                    }
+                }
+            });
+        }
+
+        if (!agentRules)
+        {
+            return;
+        }
+
+        // agents: every agent only writes its own queued changes
+        auto &agents = board->agents;
+        board->parallel_for(agents.size(), 0, [&](size_t begin, size_t end) {
+            Rules::RuleResult result;
+            for (size_t i = begin; i < end; i++)
+            {
+                auto agent = agents[i];
+                auto rules = board->rule_sets[agent->layer].get();
+                if (!rules || !rules->evaluate(agent->pos, agent->state, static_cast<uint32_t>(agent->getId()), result))
+                {
+                    continue;
+                }
+                if (result.state != StateRegistry::NONE)
+                {
+                    agent->state_next = result.state;
+                }
+                if (result.moves)
+                {
+                    agent->pos_next = result.target;
+                    agent->has_pos_next = true;
+                }
+            }
+        });
+
+        // entities: same, through the intents of the store
+        if (board->store)
+        {
+            auto store = board->store.get();
+            uint64_t streams = uint64_t(1) << 32;
+            board->parallel_for(store->size(), 0, [&](size_t begin, size_t end) {
+                Rules::RuleResult result;
+                for (size_t i = begin; i < end; i++)
+                {
+                    auto rules = board->rule_sets[store->layer[i]].get();
+                    if (!rules || !rules->evaluate(Pos(store->x[i], store->y[i]), store->state[i], streams + store->id[i], result))
+                    {
+                        continue;
+                    }
+                    if (result.state != StateRegistry::NONE)
+                    {
+                        store->set_state(i, result.state);
+                    }
+                    if (result.moves)
+                    {
+                        store->set_pos(i, result.target);
+                    }
+                }
+            });
+        }
+    }
+
+    void SimulatedBoard::update_kernels(Board::SimulatedBoard *board)
+    {
+        if (board->board_kernels.empty())
+        {
+            return;
+        }
+
+        fa_board view = *board->kernel_board();
+        view.step = board->step_count;
+        for (auto &kernel : board->board_kernels)
+        {
+            kernel.function(&view, kernel.userData);
+        }
+    }
+
+    void SimulatedBoard::update_active_set(Board::SimulatedBoard *board)
+    {
+        if (!board->active_scheduling)
+        {
+            board->agents_stepping.clear();
+            return;
+        }
+
+        int width = board->width;
+        int height = board->height;
+        int radius = board->active_radius;
+        bool wrap = board->active_wrap;
+        uint8_t *dirty = board->dirty_cells.data();
+        uint8_t *active = board->active_cells.data();
+
+        // the radius is a square, so it can be done one direction at a time: rows into active, then the columns of active in place
+        board->parallel_for(height, 0, [=](size_t begin, size_t end) {
+            std::vector<int> prefix(width + 1);
+            for (size_t y = begin; y < end; y++)
+            {
+                dilate_line(dirty + y * width, active + y * width, width, 1, radius, wrap, prefix);
+            }
+        });
+        board->parallel_for(width, 0, [=](size_t begin, size_t end) {
+            std::vector<int> prefix(height + 1);
+            std::vector<uint8_t> column(height);
+            for (size_t x = begin; x < end; x++)
+            {
+                for (int y = 0; y < height; y++)
+                {
+                    column[y] = active[x + y * width];
+                }
+                dilate_line(column.data(), active + x, height, width, radius, wrap, prefix);
+            }
+        });
+
+        // the changes of this step get collected for the next one
+        std::fill(board->dirty_cells.begin(), board->dirty_cells.end(), 0);
+
+        auto &agents = board->agents;
+        board->agents_stepping.assign(agents.size(), 0);
+        uint8_t *stepping = board->agents_stepping.data();
+        board->parallel_for(agents.size(), 0, [=, &agents](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto agent = agents[i];
+                stepping[i] = active[agent->pos.x + agent->pos.y * width] || agent->awake;
+                agent->awake = false;
+            }
+        });
+    }
+
+    void SimulatedBoard::resolve_moves(Board::SimulatedBoard *board)
+    {
+        // a move request of one agent
+        struct MoveIntent
+        {
+            size_t target;      // index of the target cell in the arena
+            uint64_t priority;  // lower wins
+            size_t agent;       // index in board->agents
+        };
+
+        enum MoveStatus : uint8_t { NO_MOVE, PENDING, VISITING, DONE, BLOCKED };
+
+        auto &agents = board->agents;
+        size_t count = agents.size();
+
+        // gather the intents (in parallel, every agent writes its own slot)
+        std::vector<MoveIntent> intents(count);
+        std::vector<uint8_t> status(count, NO_MOVE);
+        std::vector<uint8_t> outside(count, 0);
+
+        board->parallel_for(count, 0, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto agent = agents[i];
+                if (!agent->has_pos_next)
+                {
+                    continue;
+                }
+
+                Pos target = agent->pos_next;
+                if (target.x < 0 || target.y < 0 || target.x >= board->width || target.y >= board->height)
+                {
+                    outside[i] = 1;
+                    continue;
+                }
+
+                uint64_t priority = static_cast<uint64_t>(static_cast<uint32_t>(agent->getId()));
+                if (board->move_policy == MovePolicy::RANDOM)
+                {
+                    // ties (very unlikely) get broken by the id in the sort below
+                    priority = board->random_stream(priority, Random::RandomDomain::MOVES).next_u64();
+                }
+
+                intents[i] = MoveIntent{board->cell_index(agent->getLayer(), target.toIndex(board->width)), priority, i};
+                status[i] = PENDING;
+            }
+        });
+
+        // group the intents by target cell. The first of each group (lowest priority) is the only one that can get there
+        std::vector<MoveIntent> requests;
+        requests.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (status[i] == PENDING)
+            {
+                requests.push_back(intents[i]);
+            }
+        }
+        std::sort(requests.begin(), requests.end(), [&](const MoveIntent &a, const MoveIntent &b) {
+            if (a.target != b.target) return a.target < b.target;
+            if (a.priority != b.priority) return a.priority < b.priority;
+            return agents[a.agent]->getId() < agents[b.agent]->getId();
+        });
+        for (size_t i = 1; i < requests.size(); i++)
+        {
+            if (requests[i].target == requests[i - 1].target)
+            {
+                status[requests[i].agent] = BLOCKED;
+            }
+        }
+
+        // which agent (if any) each winner has to wait for: the agent that is in its target cell
+        std::vector<long long> follows(count, -1);
+
+        for (auto &request : requests)
+        {
+            size_t i = request.agent;
+            if (status[i] != PENDING)
+            {
+                continue;
+            }
+            auto agent = agents[i];
+            Pos target = agent->pos_next;
+
+            // not moving at all
+            if (target == agent->pos)
+            {
+                status[i] = DONE;
+                continue;
+            }
+
+            // SOLID collisions with the other layers (as they were before the step)
+            if (board->move_blocked(target, agent->layer, false))
+            {
+                status[i] = BLOCKED;
+                continue;
+            }
+
+            // entities never move out of the way during the moves of the agents
+            if (board->store && board->entity_cell(agent->layer, target.toIndex(board->width)) != Agents::AgentStore::NONE)
+            {
+                status[i] = BLOCKED;
+                continue;
+            }
+
+            auto occupant = board->agent_at(agent->layer, target.toIndex(board->width));
+            if (occupant != nullptr)
+            {
+                // the index of the occupant in agents (NONE for static agents)
+                uint32_t occupantIndex = board->agent_table.slot(occupant).dense;
+                if (occupantIndex == Agents::AgentTable::NONE || status[occupantIndex] == NO_MOVE || status[occupantIndex] == BLOCKED 
+                    || agents[occupantIndex]->pos_next == agents[occupantIndex]->pos)
+                {
+                    // the occupant is not leaving
+                    status[i] = BLOCKED;
+                }
+                else
+                {
+                    follows[i] = static_cast<long long>(occupantIndex);
+                }
+            }
+        }
+
+        // every winner follows at most one other winner, so the chains get resolved by walking them
+        std::vector<size_t> path;
+        for (auto &request : requests)
+        {
+            size_t start = request.agent;
+            if (status[start] != PENDING)
+            {
+                continue;
+            }
+
+            path.clear();
+            size_t current = start;
+            uint8_t result = DONE;
+            while (true)
+            {
+                if (status[current] == DONE || status[current] == BLOCKED)
+                {
+                    result = status[current];
+                    break;
+                }
+                if (status[current] == VISITING)
+                {
+                    // a cycle. Everyone in it trades cells at once, or nobody moves
+                    uint8_t cycleResult = board->move_allow_swaps ? DONE : BLOCKED;
+                    size_t cycleAgent = current;
+                    do
+                    {
+                        status[cycleAgent] = cycleResult;
+                        cycleAgent = static_cast<size_t>(follows[cycleAgent]);
+                    } while (cycleAgent != current);
+                    result = cycleResult;
+                    break;
+                }
+
+                status[current] = VISITING;
+                path.push_back(current);
+                if (follows[current] == -1)
+                {
+                    // the target cell is free
+                    result = DONE;
+                    break;
+                }
+                current = static_cast<size_t>(follows[current]);
+            }
+
+            for (auto agentIndex : path)
+            {
+                if (status[agentIndex] == VISITING)
+                {
+                    status[agentIndex] = result;
+                }
+            }
+        }
+
+        // commit every successful move. Sources and targets are unique, so both passes can run in parallel
+        std::vector<size_t> movers;
+        for (auto &request : requests)
+        {
+            if (status[request.agent] == DONE && !(agents[request.agent]->pos_next == agents[request.agent]->pos))
+            {
+                movers.push_back(request.agent);
+                board->cell_touch(agents[request.agent]->pos);
+                board->cell_touch(agents[request.agent]->pos_next);
+            }
+        }
+
+        board->parallel_for(movers.size(), 0, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto agent = agents[movers[i]];
+                board->agent_at(agent->layer, agent->pos.toIndex(board->width)) = nullptr;
+            }
+        });
+        board->parallel_for(movers.size(), 0, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto agent = agents[movers[i]];
+                board->agent_at(agent->layer, agent->pos_next.toIndex(board->width)) = agent;
+            }
+        });
+        // cells of different layers share an occupancy word, so the bits get updated serially
+        for (auto mover : movers)
+        {
+            auto agent = agents[mover];
+            board->occupancy_update(agent->layer, agent->pos.toIndex(board->width));
+            board->occupancy_update(agent->layer, agent->pos_next.toIndex(board->width));
+            board->journal_add(Journal::MOVE, Journal::AGENT, agent->getId(), agent->pos, agent->pos_next, agent->state, agent->state, agent->layer, agent->layer);
+            agent->pos = agent->pos_next;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            auto agent = agents[i];
+            if (status[i] == DONE)
+            {
+                agent->moved = true;
+            }
+            else if (status[i] == BLOCKED || outside[i])
+            {
+                std::cout << "WARNING: Cannot move agent (id: " << std::to_string(agent->getId()) << ") to pos: " << agent->pos_next.toString() << " because it's occupied (a SOLID collision detected)." << std::endl;
+            }
+            agent->has_pos_next = false;
+        }
+    }
+
     /// @brief Create a random color
     /// @return A random color in rgb format
     std::array<int, 3> SimulatedBoard::getRandomColor()
     {
-        return std::array<int, 3>{rand() % 255, rand() % 255, rand() % 255};
+        // every thread gets its own stream, seeded once
+        thread_local Random::RandomStream stream(
+            (static_cast<uint64_t>(std::random_device()()) << 32) | std::random_device()(), 
+            0, 0, Random::RandomDomain::COLORS);
+        return std::array<int, 3>{stream.integer(0, 254), stream.integer(0, 254), stream.integer(0, 254)};
+    }
+
+    std::array<int, 3> SimulatedBoard::getStateColor(const std::string &name)
+    {
+        // FNV-1a of the name picks the stream
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (unsigned char character : name)
+        {
+            hash = (hash ^ character) * 0x100000001B3ULL;
+        }
+
+        Random::RandomStream stream(hash, hash >> 32, 0, Random::RandomDomain::COLORS);
+        return std::array<int, 3>{stream.integer(0, 254), stream.integer(0, 254), stream.integer(0, 254)};
     }
 }
\ No newline at end of file
@@ -8,8 +8,23 @@
 #include <tuple>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include "Agents.hpp"
 #include "ClassTypes.hpp"
+#include "Fields.hpp"
+#include "Life.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "AgentStore.hpp"
+#include "Neighborhood.hpp"
+#include "FlowField.hpp"
+#include "Journal.hpp"
+#include "Rules.hpp"
+#include "Kernels.hpp"
+#include "Checkpoint.hpp"
+#include "Recorder.hpp"
 
 using namespace fastautomata::ClassTypes;
 
@@ -36,196 +51,1086 @@ namespace fastautomata::Board {
         int agentSize;
 
         /**
-         * @brief A representation of the board ([layer][x*y][agent])
+         * @brief The distance (in cells) between the start of two consecutive layers in the board arena
          * 
          */
-        Agents::BaseAgent*** board;
+        int layerStride;
 
         /**
-         * @brief The agents that will get updated each step
+         * @brief A representation of the board. One contiguous arena, layer-major ([layer * layerStride + y * width + x])
+         * 
+         */
+        std::vector<Agents::BaseAgent*> board;
+
+        /**
+         * @brief The field of each layer ([layer]). nullptr if the layer holds agents.
+         * 
+         */
+        std::vector<std::unique_ptr<Fields::StateField>> fields;
+
+        /**
+         * @brief The Life-like rule engine of each layer ([layer]). nullptr if the layer does not have one.
+         * 
+         */
+        std::vector<std::unique_ptr<Life::LifeRule>> life_rules;
+
+        /**
+         * @brief The transition table of each layer ([layer]). nullptr if the layer does not have one.
+         * 
+         */
+        std::vector<std::unique_ptr<Rules::RuleSet>> rule_sets;
+
+        /**
+         * @brief The float fields of the board, by name
+         * 
+         */
+        std::map<std::string, std::unique_ptr<Fields::ScalarField>> scalar_fields;
+
+        /**
+         * @brief The state of every cell of a layer, as layer_states writes it ([layer][y * width + x]). Empty until layer_view gets called for the layer.
+         * 
+         * Allocated once, so views of it stay valid. Refreshed at the end of every step and after a reset.
+         */
+        std::vector<std::vector<uint16_t>> state_views;
+
+        /**
+         * @brief The C functions that step the board, in the order they were added (see kernel_add)
+         * 
+         */
+        std::vector<Kernels::BoardKernel> board_kernels;
+
+        /**
+         * @brief The views of the board given to board and agent kernels, built by kernel_board (the step gets set by each caller)
+         * 
+         */
+        fa_board kernel_view;
+        fa_board kernel_agent_view;
+        std::vector<const uint16_t *> kernel_cells;
+        std::atomic<bool> kernel_view_ready{false};
+
+        /**
+         * @brief Makes building kernel_view atomic (kernel agents stepped in parallel ask for it)
+         * 
+         */
+        std::mutex kernel_view_mutex;
+
+        /**
+         * @brief The agents that will get updated each step. Unordered: removing an agent moves the last one into its place.
          * 
          */
         std::vector<Agents::Agent*> agents;
 
+        /**
+         * @brief Every agent of the board (static ones included), by slot and by id
+         * 
+         */
+        Agents::AgentTable agent_table;
+
+        /**
+         * @brief The native entities of the board. nullptr until entities() gets called.
+         * 
+         */
+        std::unique_ptr<Agents::AgentStore> store;
+
+        /**
+         * @brief The id of the entity in each cell, same layout as the board arena. AgentStore::NONE if empty. Empty until entities() gets called.
+         * 
+         */
+        std::vector<uint32_t> entity_cells;
+
+        /**
+         * @brief The agent layers that hold something in each cell, as a bitmask (bit n is layer n, [y * width + x]). Field layers do not get bits. Empty if the board has more than 64 layers.
+         * 
+         */
+        std::vector<uint64_t> occupancy;
+
+        /**
+         * @brief The field layers, as a bitmask (bit n is layer n)
+         * 
+         */
+        uint64_t field_layers = 0;
+
+        /**
+         * @brief Changes every time a cell of a layer changes ([layer])
+         * 
+         */
+        std::vector<uint64_t> layer_revisions;
+
+        /**
+         * @brief Changes every time a static agent of a layer gets added, removed or moved ([layer])
+         * 
+         */
+        std::vector<uint64_t> static_revisions;
+
+        /**
+         * @brief Changes every time any cell changes
+         * 
+         */
+        uint64_t cells_revision = 0;
+
+        /**
+         * @brief The flow fields built by flow_field, by (layer, diagonal, wrap, targets). Shared with python, which can keep them after they get removed from here.
+         * 
+         */
+        std::map<std::tuple<int, bool, bool, std::vector<int>>, std::shared_ptr<Paths::FlowField>> flow_fields;
+
+        /**
+         * @brief Makes creating flow fields atomic (agents stepped in parallel can ask for them)
+         * 
+         */
+        std::mutex flow_fields_mutex;
+
         /**
          * @brief The current step (counter) in the simulation
          * 
          */
-        int step_count;
+        int step_count;
+
+        /**
+         * @brief The id the next added agent will get
+         * 
+         */
+        int next_agent_id = 0;
+
+        /**
+         * @brief True if there is an agent implemented in python (only valid if python_agents_changed is false)
+         * 
+         */
+        bool python_agents = false;
+
+        /**
+         * @brief True if agents got added or removed since python_agents was computed
+         * 
+         */
+        bool python_agents_changed = true;
+
+        /**
+         * @brief The pool that steps agents in parallel. nullptr when stepping in serial.
+         * 
+         */
+        std::unique_ptr<Threading::ThreadPool> pool;
+
+        /**
+         * @brief Makes adding new states atomic
+         * 
+         */
+        std::mutex states_mutex;
+
+        /**
+         * @brief The amount of parallel_for calls running on the pool (nested calls from the workers count too).
+         * New states can not be added while it is not 0, the state tables would grow under the other threads.
+         * 
+         */
+        std::atomic<int> parallel_depth{0};
+
+        /**
+         * @brief The seed of the board. Used for everything random that has to be reproducible.
+         * 
+         */
+        uint64_t seed = 0;
+
+        /**
+         * @brief The amount of words drawn from the board stream (random) during board_random_step
+         * 
+         */
+        uint64_t board_random_draws = 0;
+
+        /**
+         * @brief The step of the board stream. The draws start again from 0 every step.
+         * 
+         */
+        int board_random_step = -1;
+
+        /**
+         * @brief How moves get applied at the end of a step
+         * 
+         */
+        MovePolicy move_policy = MovePolicy::SEQUENTIAL;
+
+        /**
+         * @brief If true, agents can trade cells (or move in a cycle) when moves are resolved together
+         * 
+         */
+        bool move_allow_swaps = false;
+
+        /**
+         * @brief If true, only agents close to a change (or awake) get stepped
+         * 
+         */
+        bool active_scheduling = false;
+
+        /**
+         * @brief The distance from a changed cell in which agents get stepped (active scheduling)
+         * 
+         */
+        int active_radius = 1;
+
+        /**
+         * @brief If true, the active radius wraps around the board edges (active scheduling)
+         * 
+         */
+        bool active_wrap = false;
+
+        /**
+         * @brief The cells (x + y * width, every layer at once) that changed since the agents were last stepped
+         * 
+         */
+        std::vector<uint8_t> dirty_cells;
+
+        /**
+         * @brief The cells that are within active_radius of a dirty cell. Built at the start of update_agents.
+         * 
+         */
+        std::vector<uint8_t> active_cells;
+
+        /**
+         * @brief Which agents ([index in agents]) got stepped in the current step
+         * 
+         */
+        std::vector<uint8_t> agents_stepping;
+
+        /**
+         * @brief If true, the changes of the agents and entities get written to the journal
+         * 
+         */
+        bool journal_enabled = false;
+
+        /**
+         * @brief The changes since the journal was last taken, in the order they happened
+         * 
+         */
+        std::vector<Journal::Change> journal;
+
+        /**
+         * @brief The recording being written, nullptr if there is none (see record_start)
+         * 
+         */
+        std::unique_ptr<Recording::Recorder> recorder;
+
+        /**
+         * @brief The changes of the current step, for the recorder (kept apart from the journal, so taking the journal does not take them)
+         * 
+         */
+        std::vector<Journal::Change> record_changes;
+
+        /**
+         * @brief The amount of states the recorder knows, and the steps since its last keyframe
+         * 
+         */
+        size_t record_states = 0;
+        int record_steps = 0;
+
+        /**
+         * @brief Hand the current step to the recorder
+         * 
+         * @param kind KEYFRAME for the whole board, STEP for the changes since the last frame
+         */
+        void record_frame(Recording::FrameKind kind);
+
+        /**
+         * @brief If true, the changes of the agents and entities get kept for stream_take
+         * 
+         */
+        bool stream_enabled = false;
+
+        /**
+         * @brief The changes since the last stream_take (kept apart from the journal and the recording)
+         * 
+         */
+        std::vector<Journal::Change> stream_changes;
+
+        /**
+         * @brief The amount of states sent by stream_take
+         * 
+         */
+        size_t stream_states = 0;
+
+        /**
+         * @brief Remembers the field layers of the last stream_take
+         * 
+         */
+        std::unique_ptr<Recording::Encoder> stream_encoder;
+
+        /**
+         * @brief Build a frame of the board as it is now
+         * 
+         * @param kind KEYFRAME for the whole board, STEP for the changes since the last frame
+         * @param changes The changes since the last frame (taken by the frame)
+         * @param knownStates The amount of states the reader knows (updated)
+         * @return Recording::Frame 
+         */
+        Recording::Frame frame_build(Recording::FrameKind kind, std::vector<Journal::Change> &changes, size_t &knownStates);
+
+        /**
+         * @brief Build a frame with the amount of cells of each state (see getColorMapCount)
+         * 
+         * @return Recording::Frame 
+         */
+        Recording::Frame frame_counts();
+
+        /**
+         * @brief Delete the agents created by agents_spawn that are still on the board
+         * 
+         */
+        void owned_agents_delete();
+
+        /**
+         * @brief Put an agent created by the board on it (its id, position, layer and state must be set). The board owns it.
+         * 
+         * Agent subclasses get stepped, other agents are static. Does not check the cell.
+         * 
+         * @param agent The agent
+         */
+        void agent_place_owned(Agents::BaseAgent *agent);
+
+        /**
+         * @brief Empty the board (agents, entities, fields, step count), like reset does before calling on_reset
+         * 
+         */
+        void contents_clear();
+
+
+        public:
+        /**
+         * @brief False once the simulation finished. Steppers (the python wrapper, ensembles) stop stepping the board when it is false. Set to true on reset.
+         * 
+         */
+        bool simulated = true;
+
+        /**
+         * @brief The collisions that will be checked when repositioning agents
+         * 
+         */
+        CollisionMap layer_collisions;
+
+        /**
+         * @brief A list of functions to call on each step
+         * 
+         */
+        std::vector<std::function<void(SimulatedBoard*)>> step_instructions;
+
+        /**
+         * @brief Interns the state names used in the board into dense ids
+         * 
+         */
+        StateRegistry states;
+
+        /**
+         * @brief The colors to use for automatas, indexed by state id
+         * 
+         */
+        std::vector<std::array<int, 3>> state_colors;
+
+        /**
+         * @brief The amount of agents in each state, indexed by state id
+         * 
+         */
+        std::vector<int> state_counts;
+
+        /**
+         * @brief List of functions to call on reset
+         * 
+         */
+        std::vector<std::function<void(SimulatedBoard*)>> on_reset;
+
+        /**
+         * @brief List of functions to call when a new agent is added
+         * 
+         */
+        std::vector<std::function<void(Agents::BaseAgent*)>> on_add;
+
+        /**
+         * @brief List of functions to call when an agent is deleted
+         * 
+         */
+        std::vector<std::function<void(Agents::BaseAgent*)>> on_delete;
+
+        /**
+         * @brief List of functions to call once per agents_spawn, with the ids of every agent it added (on_add does not get called for them)
+         * 
+         */
+        std::vector<std::function<void(const std::vector<int> &)>> on_spawn;
+
+        /**
+         * @brief Python is... special...
+         * 
+         */
+        std::function<void(Agents::BaseAgent*)> python_on_delete;
+
+        /**
+         * @brief A list of agents that will be deleted at the end of the step
+         * 
+         */
+        std::vector<Agents::BaseAgent*> scheduled_delete_agents;
+
+        /*
+         ██████  ██████  ███    ██ ███████ ████████ ██████  ██    ██  ██████ ████████  ██████  ██████  ███████ 
+        ██      ██    ██ ████   ██ ██         ██    ██   ██ ██    ██ ██         ██    ██    ██ ██   ██ ██      
+        ██      ██    ██ ██ ██  ██ ███████    ██    ██████  ██    ██ ██         ██    ██    ██ ██████  ███████ 
+        ██      ██    ██ ██  ██ ██      ██    ██    ██   ██ ██    ██ ██         ██    ██    ██ ██   ██      ██ 
+         ██████  ██████  ██   ████ ███████    ██    ██   ██  ██████   ██████    ██     ██████  ██   ██ ███████ 
+        */
+
+        /**
+         * @brief Construct a new Simulated Board object
+         * 
+         * @param width 
+         * @param height 
+         * @param layerCount 
+         */
+        SimulatedBoard(int width, int height, int layerCount);
+
+        /**
+         * @brief Destroy the Simulated Board object
+         * 
+         */
+        ~SimulatedBoard();
+
+        void delete_this();
+
+        /*
+         ██████  ███████ ████████         ██     ███████ ███████ ████████ 
+        ██       ██         ██           ██      ██      ██         ██    
+        ██   ███ █████      ██          ██       ███████ █████      ██    
+        ██    ██ ██         ██         ██             ██ ██         ██    
+         ██████  ███████    ██        ██         ███████ ███████    ██                              
+        */
+
+        int getStepCount();
+
+        void append_on_reset(std::function<void(SimulatedBoard *)> func);
+
+        void append_on_add(std::function<void(Agents::BaseAgent *)> func);
+
+        void append_on_delete(std::function<void(Agents::BaseAgent *)> func);
+
+        void append_on_spawn(std::function<void(const std::vector<int> &)> func);
+
+        /**
+         * @brief Get the Width object
+         * 
+         * @return int 
+         */
+        int getWidth();
+
+        /**
+         * @brief Get the Height object
+         * 
+         * @return int 
+         */
+        int getHeight();
+
+        /**
+         * @brief Get the Layer Count object
+         * 
+         * @return int 
+         */
+        int getLayerCount();
+
+        /**
+         * @brief Set the amount of threads used to step agents. 1 steps in serial (default).
+         * 
+         * Only native agents get stepped in parallel. Agents implemented in python are always stepped in serial.
+         * Agents stepped in parallel can only use states that already exist (register new ones with setColorMap before stepping).
+         * 
+         * @param threads The amount of threads (the calling thread included). 0 uses every core.
+         */
+        void setThreadCount(int threads);
+
+        /**
+         * @brief Get the amount of threads used to step agents
+         * 
+         * @return int 
+         */
+        int getThreadCount();
+
+        /**
+         * @brief Run func over [0, count) in chunks, in parallel if the board has more than one thread
+         * 
+         * @param count The amount of elements
+         * @param chunk The amount of elements per chunk. 0 picks one automatically
+         * @param func The function to call with the range of each chunk (begin, end)
+         */
+        void parallel_for(size_t count, size_t chunk, const std::function<void(size_t, size_t)> &func);
+
+        /**
+         * @brief Check if a step runs fully in c++: no agents implemented in python, and every step instruction is a c++ function.
+         * 
+         * The python bindings release the GIL while stepping native boards. Python callbacks (on_update, on_add, ...) take it back when called.
+         * 
+         * @return true if the step does not need python
+         */
+        bool is_native();
+
+        /**
+         * @brief Set the seed of the board
+         * 
+         * @param seed 
+         */
+        void setSeed(uint64_t seed);
+
+        uint64_t getSeed();
+
+        /**
+         * @brief Set how moves get applied at the end of a step
+         * 
+         * @param policy SEQUENTIAL (default, each agent moves in its step_end), LOWEST_ID or RANDOM (every move gets resolved at once, before step_end)
+         * @param allowSwaps [optional] If true, agents can trade cells or move in a cycle when moves are resolved at once [default: false]
+         */
+        void setMovePolicy(MovePolicy policy, bool allowSwaps = false);
+
+        MovePolicy getMovePolicy();
+
+        /**
+         * @brief Get a random stream of the current step, keyed by (seed, step, stream)
+         * 
+         * @param stream The stream number (for example, an agent id)
+         * @param domain [optional] What the stream is for. Different domains never give the same numbers [default: AGENT]
+         * @return Random::RandomStream 
+         */
+        Random::RandomStream random_stream(uint64_t stream, Random::RandomDomain domain = Random::RandomDomain::AGENT);
+
+        /**
+         * @brief Get a random double in [0, 1) from the board stream. 
+         * 
+         * The board stream starts again every step, so the same calls give the same numbers. Not thread safe, call it from serial code (python agents, step instructions).
+         * 
+         * @return double 
+         */
+        double random();
+
+        /**
+         * @brief Get a random integer in [low, high] (both included) from the board stream
+         * 
+         */
+        int random_int(int low, int high);
+
+        /**
+         * @brief Fill out with count random doubles in [0, 1) from the board stream
+         * 
+         * @param out The buffer to fill
+         * @param count The amount of doubles
+         */
+        void random_fill(double *out, size_t count);
+
+        /**
+         * @brief Only step the agents that are close to a change. 
+         * 
+         * An agent gets stepped if a cell (in any layer) within radius changed during the previous step, or if it called wake().
+         * Cells change when agents get added, removed, moved or change state, and when field cells change.
+         * Agents that are skipped do not get their step nor step_end called (unless they have a queued change).
+         * 
+         * @param enabled If false, every agent gets stepped (default)
+         * @param radius [optional] The neighborhood (square) that the agents look at [default: 1]
+         * @param wrap [optional] If the neighborhood wraps around the edges [default: false]
+         */
+        void setActiveScheduling(bool enabled, int radius = 1, bool wrap = false);
+
+        bool getActiveScheduling();
+
+        /**
+         * @brief Get the amount of agents that got stepped in the last step (all of them if active scheduling is disabled)
+         * 
+         * @return int 
+         */
+        int getActiveCount();
+
+        /**
+         * @brief Mark a cell as changed, so the agents around it get stepped in the next step (active scheduling)
+         * 
+         * @param pos The position (must be inside the board)
+         */
+        inline void cell_touch(Pos pos)
+        {
+            if (this->active_scheduling)
+            {
+                this->dirty_cells[pos.x + pos.y * this->width] = 1;
+            }
+        }
+
+        /**
+         * @brief Keep a journal of the changes of the agents and entities (added, removed, moved, changed state or layer). Disabled by default.
+         * 
+         * Readers (renderers, recorders, ...) take the whole journal once per step instead of getting a callback per change.
+         * Field layers and scalar fields are not journaled (read them whole, see layer_view).
+         * Nothing gets dropped: the journal keeps growing until it gets taken.
+         * 
+         * @param enabled If false, the journal also gets emptied
+         */
+        void journal_enable(bool enabled);
+
+        bool getJournalEnabled();
+
+        /**
+         * @brief Take the journal: get every change since the last call (in order), and start an empty one
+         * 
+         * @return std::vector<Journal::Change> 
+         */
+        std::vector<Journal::Change> journal_take();
+
+        /**
+         * @brief Get the amount of changes waiting in the journal
+         * 
+         * @return size_t 
+         */
+        size_t getJournalSize();
+
+        /**
+         * @brief Write a change to the journal (if it is enabled), the recording (if there is one) and the stream (if it is enabled). Call it from serial code only.
+         * 
+         * @param kind What happened
+         * @param entity If the id is of an agent or of an entity
+         * @param id The id of the agent or entity
+         * @param posOld The position before the change
+         * @param posNew The position after the change
+         * @param stateOld The state before the change
+         * @param stateNew The state after the change
+         * @param layerOld The layer before the change
+         * @param layerNew The layer after the change
+         */
+        inline void journal_add(Journal::ChangeKind kind, Journal::ChangeEntity entity, int id, Pos posOld, Pos posNew, uint16_t stateOld, uint16_t stateNew, int layerOld, int layerNew)
+        {
+            if (!this->journal_enabled && !this->recorder && !this->stream_enabled)
+            {
+                return;
+            }
+            Journal::Change change{
+                static_cast<int32_t>(this->step_count), static_cast<int32_t>(id),
+                posOld.x, posOld.y, posNew.x, posNew.y,
+                stateOld, stateNew,
+                static_cast<int16_t>(layerOld), static_cast<int16_t>(layerNew),
+                static_cast<uint8_t>(kind), static_cast<uint8_t>(entity)};
+            if (this->journal_enabled)
+            {
+                this->journal.push_back(change);
+            }
+            if (this->recorder)
+            {
+                this->record_changes.push_back(change);
+            }
+            if (this->stream_enabled)
+            {
+                this->stream_changes.push_back(change);
+            }
+        }
+
+        /**
+         * @brief Add a color to the simulation (state)
+         * 
+         * @param name The state
+         * @param color The color that will be used
+         */
+        void addColor(std::string name, std::array<int, 3> color);
+
+        /**
+         * @brief Get the color of a state
+         * 
+         * @param name The state
+         * @return std::array<int, 3> 
+         */
+        std::array<int, 3> getColor(std::string name);
+
+        /**
+         * @brief Get a dictionary of state names to colors. Built from state_colors, so changing it does not change the board (use addColor or setColorMap).
+         * 
+         * @return std::map<std::string, std::array<int, 3>> 
+         */
+        std::map<std::string, std::array<int, 3>> getColorMap();
+
+        /**
+         * @brief Replace the colors with the ones in the dictionary. New states get added. States can not be removed: the ones left out keep their id and get their default color (see getStateColor).
+         * 
+         * @param colorMap 
+         */
+        void setColorMap(std::map<std::string, std::array<int, 3>> colorMap);
+
+        /**
+         * @brief Get a dictionary of state names to the amount of agents in that state. Built from state_counts.
+         * 
+         * @return std::map<std::string, int> 
+         */
+        std::map<std::string, int> getColorMapCount();
+
+        /**
+         * @brief Get the id of a state. If the state does not exist, it gets added with a random color.
+         * 
+         * @param name The state
+         * @return uint16_t 
+         */
+        uint16_t state_id(const std::string &name);
+
+        /**
+         * @brief Get the name of a state id
+         * 
+         * @param id 
+         * @return const std::string& 
+         */
+        const std::string &state_name(uint16_t id);
+
+        /**
+         * @brief Add an instruction to the steps that will be executed each step
+         * 
+         * @param func 
+         */
+        void step_instructions_add(std::function<void(SimulatedBoard *)> func);
+
+        /**
+         * @brief remove all the step instructions
+         */
+        void step_instructions_flush();
+
+        /**
+         * @brief Get the Collisions of an agent from given layer. Returns a map of layers to collision types.
+         * 
+         * @param pos The position to check collisions for
+         * @param layer The layer from where to check collisions 
+         * @param includeSelf If true, returns it's own layer as well
+         * @return std::map<int, std::tuple<ClassTypes::CollisionType, Agents::BaseAgent*>> 
+         */
+        std::map<int, std::tuple<ClassTypes::CollisionType, Agents::BaseAgent *>> getCollisions(ClassTypes::Pos pos, int layer = 0, bool includeSelf = true);
+
+        /*
+        ██    ██ ██████  ██████   █████  ████████ ██ ███    ██  ██████  
+        ██    ██ ██   ██ ██   ██ ██   ██    ██    ██ ████   ██ ██       
+        ██    ██ ██████  ██   ██ ███████    ██    ██ ██ ██  ██ ██   ███ 
+        ██    ██ ██      ██   ██ ██   ██    ██    ██ ██  ██ ██ ██    ██ 
+         ██████  ██      ██████  ██   ██    ██    ██ ██   ████  ██████  
+        */
+
+        /**
+         * @brief Update the index of a new and old state in the color map. This assumes you did a color check first
+         * 
+         * @param oldState the state that got replaced
+         * @param newState the state that replaced the old state
+         */
+        void updateColor(std::string oldState, std::string newState);
+
+        /**
+         * @brief Update the count of a new and old state id. Ids must be registered.
+         * 
+         * @param oldState the state that got replaced
+         * @param newState the state that replaced the old state
+         */
+        inline void updateColor(uint16_t oldState, uint16_t newState)
+        {
+            this->state_counts[oldState] -= 1;
+            this->state_counts[newState] += 1;
+        }
+
+        void reset();
+
+        /**
+         * @brief Write the board to a checkpoint file (see Checkpoint.hpp): the states and their colors, the collisions, the field layers, the float fields,
+         * every agent and entity, the step count, the seed, the move policy and active scheduling (with the cells that changed in the last step).
+         * 
+         * Code is not saved (step instructions, rules, kernels, callbacks). Neither is the thread count, set it again after loading (with MovePolicy::SEQUENTIAL it changes the results). The file gets written next to path, and then renamed, so an interrupted save does not break the last checkpoint.
+         * 
+         * @param path The file to write
+         */
+        void save(const std::string &path);
+
+        /**
+         * @brief Replace what is on the board with a checkpoint written by save. The file gets mapped into memory, and the cells get copied in bulk.
+         * 
+         * The board must have the same size and layers. Its code (step instructions, rules, kernels, callbacks) and thread count stay, and on_reset does not get called.
+         * The move policy and active scheduling get replaced by the ones of the file (agents that called wake() stay awake). Agents come back with their ids: by default as plain Agents (static ones as BaseAgents), owned by the board.
+         * To get other classes back, restore gets called for every agent first, and can add one (its id will be the one of the record). Agents implemented in python have to be added by restore, the load fails otherwise.
+         * If the file is broken, the board is left empty.
+         * 
+         * @param path The file to read
+         * @param restore [optional] Called with every agent, in order. If it does not add an agent, the board adds a default one [default: nullptr]
+         */
+        void load(const std::string &path, const std::function<void(const Checkpoint::AgentRecord &)> &restore = nullptr);
+
+        /**
+         * @brief Record every step of the board to a file, until record_stop. Replay it with Recording::Replay.
+         * 
+         * The file starts with a keyframe (every agent, entity and field layer), and then holds the changes of each step (the journal, and the field cells that changed),
+         * with another keyframe every keyframeInterval steps so replays can seek. The frames get encoded and written by another thread.
+         * A reset or a load does not stop the recording: it writes a RESET frame (the whole board after it), which starts a new run in the file.
+         * Scalar fields are not recorded. Changes that are not journaled (static agents changing state) show up at the next keyframe.
+         * 
+         * @param path The file, replaced if it exists
+         * @param keyframeInterval [optional] The amount of steps between keyframes [default: 100]
+         */
+        void record_start(const std::string &path, int keyframeInterval = 100);
+
+        /**
+         * @brief Finish writing the recording, and close it. Does nothing if the board is not recording.
+         * 
+         * Throws std::runtime_error if the file could not be written (the frames after the error are missing).
+         * 
+         */
+        void record_stop();
+
+        bool getRecording();
+
+        /**
+         * @brief Start (or stop) keeping the changes of the board for stream_take. Every call starts from the board as it is now.
+         * 
+         * A stream sends the frames of a recording (see Recording::FrameKind) to viewers: each gets stream_keyframe once, then every stream_take.
+         * The messages of a viewer, one after the other, are a recording Replay can read (if the first one has the header).
+         * Resets and loads get streamed too (a RESET change, then the new agents).
+         * 
+         * @param enabled [optional] If false, the kept changes get dropped [default: true]
+         */
+        void stream_enable(bool enabled = true);
+
+        bool getStreamEnabled();
+
+        /**
+         * @brief Take the changes since the last call (or since stream_enable): a STEP frame and a COUNTS frame
+         * 
+         * @return std::vector<uint8_t> The frames
+         */
+        std::vector<uint8_t> stream_take();
+
+        /**
+         * @brief Get the whole board, for a viewer that joins: a KEYFRAME frame and a COUNTS frame. Does not change what stream_take sends.
+         * 
+         * Call stream_take first, so the changes before it do not reach the viewer twice.
+         * 
+         * @param header [optional] Start with the header of a recording [default: false]
+         * @return std::vector<uint8_t> The frames
+         */
+        std::vector<uint8_t> stream_keyframe(bool header = false);
+
+        /**
+         * @brief Step through an iteration of the simulation
+         * 
+         * The steps to run are defined by step_instructions
+         * 
+         */
+        void step();
+
+        /**
+         * @brief Step the simulation n times
+         * 
+         * @param n The amount of steps
+         */
+        void step_n(int n);
 
+        /*
+        ███████ ██ ███████ ██      ██████  ███████ 
+        ██      ██ ██      ██      ██   ██ ██      
+        █████   ██ █████   ██      ██   ██ ███████ 
+        ██      ██ ██      ██      ██   ██      ██ 
+        ██      ██ ███████ ███████ ██████  ███████ 
+        */
 
-        public:
         /**
-         * @brief The collisions that will be checked when repositioning agents
+         * @brief Turn a layer into a field layer. A field layer stores one state per cell (double buffered) instead of agents.
+         * 
+         * States get read from the current buffer and written to the next one. The buffers get swapped at the end of step().
          * 
+         * @param layer The layer to convert. It must not contain agents.
+         * @param emptyState [optional] The state that represents an empty cell. Empty cells are not counted and do not collide. [default: "None"]
          */
-        CollisionMap layer_collisions;
+        void field_enable(int layer, std::string emptyState = "None");
 
         /**
-         * @brief A list of functions to call on each step
+         * @brief Check if a layer is a field layer
          * 
+         * @param layer 
+         * @return true if the layer is a field layer
          */
-        std::vector<std::function<void(SimulatedBoard*)>> step_instructions;
+        bool is_field(int layer);
 
         /**
-         * @brief A dictionary of colors to use for automatas
+         * @brief Get the field of a layer
          * 
+         * @param layer 
+         * @return Fields::StateField* 
          */
-        std::map<std::string, std::array<int, 3>> color_map;
+        Fields::StateField *field(int layer);
 
         /**
-         * @brief A dictionary that holds info about the time that it takes to get objects. 
+         * @brief Get the state id of a cell in a field layer (current buffer)
          * 
+         * @param pos The position of the cell
+         * @param layer The field layer
+         * @param wrap [optional] Whether to wrap the position if it is out of bounds [default: false]
+         * @return uint16_t The state id. StateRegistry::NONE if out of bounds.
          */
-        std::map<std::string, int> color_map_count; 
+        uint16_t field_get_id(Pos pos, int layer, bool wrap = false);
 
         /**
-         * @brief List of functions to call on reset
+         * @brief Get the state of a cell in a field layer (current buffer)
          * 
+         * @param pos The position of the cell
+         * @param layer The field layer
+         * @param wrap [optional] Whether to wrap the position if it is out of bounds [default: false]
+         * @return std::string The state. Empty string if out of bounds.
          */
-        std::vector<std::function<void(SimulatedBoard*)>> on_reset;
+        std::string field_get(Pos pos, int layer, bool wrap = false);
 
         /**
-         * @brief List of functions to call when a new agent is added
+         * @brief Queue a state for a cell in a field layer. Will be changed at the end of the step.
          * 
+         * @param pos The position of the cell
+         * @param state A registered state id
+         * @param layer The field layer
          */
-        std::vector<std::function<void(Agents::BaseAgent*)>> on_add;
+        void field_set_id(Pos pos, uint16_t state, int layer);
 
         /**
-         * @brief List of functions to call when an agent is deleted
+         * @brief Queue a state for a cell in a field layer. Will be changed at the end of the step.
          * 
+         * @param pos The position of the cell
+         * @param state The state
+         * @param layer The field layer
          */
-        std::vector<std::function<void(Agents::BaseAgent*)>> on_delete;
+        void field_set(Pos pos, std::string state, int layer);
 
         /**
-         * @brief Python is... special...
+         * @brief Set the state of a cell in a field layer right now (used when generating the board, for example in on_reset)
          * 
+         * @param pos The position of the cell
+         * @param state A registered state id
+         * @param layer The field layer
          */
-        std::function<void(Agents::BaseAgent*)> python_on_delete;
+        void field_put_id(Pos pos, uint16_t state, int layer);
 
         /**
-         * @brief A list of agents that will be deleted at the end of the step
+         * @brief Set the state of a cell in a field layer right now (used when generating the board, for example in on_reset)
          * 
+         * @param pos The position of the cell
+         * @param state The state
+         * @param layer The field layer
          */
-        std::vector<Agents::BaseAgent*> scheduled_delete_agents;
-
-        /*
-         ██████  ██████  ███    ██ ███████ ████████ ██████  ██    ██  ██████ ████████  ██████  ██████  ███████ 
-        ██      ██    ██ ████   ██ ██         ██    ██   ██ ██    ██ ██         ██    ██    ██ ██   ██ ██      
-        ██      ██    ██ ██ ██  ██ ███████    ██    ██████  ██    ██ ██         ██    ██    ██ ██████  ███████ 
-        ██      ██    ██ ██  ██ ██      ██    ██    ██   ██ ██    ██ ██         ██    ██    ██ ██   ██      ██ 
-         ██████  ██████  ██   ████ ███████    ██    ██   ██  ██████   ██████    ██     ██████  ██   ██ ███████ 
-        */
+        void field_put(Pos pos, std::string state, int layer);
 
         /**
-         * @brief Construct a new Simulated Board object
+         * @brief Run a Life-like automata on a layer. The layer gets turned into a field layer (if it is not one already).
          * 
-         * @param width 
-         * @param height 
-         * @param layerCount 
+         * Cells get stored as packed bits and stepped a word (64 cells) at a time. The results get written to the field, so they can be read with field_get and color_map_count.
+         * field_set and kernels can still write the layer, but a layer can not have a Life rule and a rule set (see rules_add).
+         * 
+         * @param layer The layer to run on
+         * @param rule The rulestring ("B3/S23", "S23/B3" or "23/3")
+         * @param wrap [optional] Whether the edges of the board wrap around (same as agent_get) [default: false]
+         * @param aliveState [optional] The state of alive cells [default: "Alive"]
+         * @param deadState [optional] The state of dead cells [default: "Dead"]
+         * @return Life::LifeRule* The rule engine (owned by the board)
          */
-        SimulatedBoard(int width, int height, int layerCount);
+        Life::LifeRule *life_add(int layer, std::string rule, bool wrap = false, std::string aliveState = "Alive", std::string deadState = "Dead");
 
         /**
-         * @brief Destroy the Simulated Board object
+         * @brief Step a layer with a transition table instead of step(): every agent, entity or field cell of the layer gets its next state (and move) from the rules.
          * 
+         * The rules run natively (in parallel with the threads of the board) at the start of the step, before the agents get stepped.
+         * Agents and entities get their changes queued, so step() and kernels can still override them. Field cells get written to the next buffer.
+         * A layer that runs a Life rule (see life_add) can not have a rule set.
+         * 
+         * @param layer The layer to step
+         * @param stencil The neighbors the rules count
+         * @param countLayer [optional] The layer the neighbors get counted in. -1 counts in the same layer [default: -1]
+         * @param wrap [optional] If the stencil and the moves wrap around the edges [default: false]
+         * @return Rules::RuleSet* The rules, empty (owned by the board). Add rules to it with RuleSet::add.
          */
-        ~SimulatedBoard();
-
-        void delete_this();
-
-        /*
-         ██████  ███████ ████████         ██     ███████ ███████ ████████ 
-        ██       ██         ██           ██      ██      ██         ██    
-        ██   ███ █████      ██          ██       ███████ █████      ██    
-        ██    ██ ██         ██         ██             ██ ██         ██    
-         ██████  ███████    ██        ██         ███████ ███████    ██                              
-        */
-
-        int getStepCount();
-
-        void append_on_reset(std::function<void(SimulatedBoard *)> func);
-
-        void append_on_add(std::function<void(Agents::BaseAgent *)> func);
-
-        void append_on_delete(std::function<void(Agents::BaseAgent *)> func);
+        Rules::RuleSet *rules_add(int layer, const Neighborhood::Stencil &stencil, int countLayer = -1, bool wrap = false);
 
         /**
-         * @brief Get the Width object
+         * @brief Add a C function (see fa_board_kernel in fastautomata_capi.h) that gets called once per step, before the agents get stepped.
          * 
-         * @return int 
+         * Kernels do not call into python, so the board stays native (see is_native). They run in the order they were added, after the rule sets (see rules_add).
+         * 
+         * @param kernel The function (from a shared library, a numba cfunc, cffi, ...)
+         * @param userData [optional] The pointer the kernel gets called with [default: nullptr]
          */
-        int getWidth();
+        void kernel_add(fa_board_kernel kernel, void *userData = nullptr);
 
         /**
-         * @brief Get the Height object
+         * @brief Remove every kernel added with kernel_add
          * 
-         * @return int 
          */
-        int getHeight();
+        void kernels_clear();
 
         /**
-         * @brief Get the Layer Count object
+         * @brief Get the view of the board given to kernels. Allocates the buffers of every layer_view the first time. Thread safe.
          * 
-         * @return int 
+         * The step of the view is not kept up to date (copy the view and set it, see Kernels::KernelAgent::step).
+         * 
+         * @param agentKernel [optional] Get the view for agent kernels, which can not write the board (see Kernels::agent_view) [default: false]
+         * @return const fa_board* The view (owned by the board)
          */
-        int getLayerCount();
+        const fa_board *kernel_board(bool agentKernel = false);
 
         /**
-         * @brief Add a color to the simulation (state)
+         * @brief Add a float field (heat, pheromones, ...). It does not take a layer. Every step it diffuses and evaporates with its rates (see ScalarField::setRates).
          * 
-         * @param name The state
-         * @param color The color that will be used
+         * @param name The name of the field
+         * @param wrap [optional] Whether the edges of the board wrap around [default: false]
+         * @return Fields::ScalarField* The field (owned by the board)
          */
-        void addColor(std::string name, std::array<int, 3> color);
+        Fields::ScalarField *scalar_add(std::string name, bool wrap = false);
 
         /**
-         * @brief Add an instruction to the steps that will be executed each step
+         * @brief Get a float field by name
          * 
-         * @param func 
+         * @param name The name given to scalar_add
+         * @return Fields::ScalarField* 
          */
-        void step_instructions_add(std::function<void(SimulatedBoard *)> func);
+        Fields::ScalarField *scalar(const std::string &name);
 
         /**
-         * @brief remove all the step instructions
+         * @brief Swap the buffers of every field layer. Called at the end of step().
+         * 
          */
-        void step_instructions_flush();
+        void fields_swap();
 
         /**
-         * @brief Get the Collisions of an agent from given layer. Returns a map of layers to collision types.
+         * @brief Write the state of every cell of a layer (see cell_state) into out
          * 
-         * @param pos The position to check collisions for
-         * @param layer The layer from where to check collisions 
-         * @param includeSelf If true, returns it's own layer as well
-         * @return std::map<int, std::tuple<ClassTypes::CollisionType, Agents::BaseAgent*>> 
+         * @param layer The layer
+         * @param out A buffer of width * height states ([y * width + x])
          */
-        std::map<int, std::tuple<ClassTypes::CollisionType, Agents::BaseAgent *>> getCollisions(ClassTypes::Pos pos, int layer = 0, bool includeSelf = true);
+        void layer_states(int layer, uint16_t *out);
 
-        /*
-        ██    ██ ██████  ██████   █████  ████████ ██ ███    ██  ██████  
-        ██    ██ ██   ██ ██   ██ ██   ██    ██    ██ ████   ██ ██       
-        ██    ██ ██████  ██   ██ ███████    ██    ██ ██ ██  ██ ██   ███ 
-        ██    ██ ██      ██   ██ ██   ██    ██    ██ ██  ██ ██ ██    ██ 
-         ██████  ██      ██████  ██   ██    ██    ██ ██   ████  ██████  
-        */
+        /**
+         * @brief Get the state of every cell of a layer (see cell_state), in a buffer owned by the board. The buffer never moves, and gets refreshed at the end of every step and after a reset.
+         * 
+         * Changes made between steps show up after the next views_sync (this call also syncs the layer).
+         * 
+         * @param layer The layer
+         * @return const uint16_t* width * height states ([y * width + x])
+         */
+        const uint16_t *layer_view(int layer);
 
         /**
-         * @brief Update the index of a new and old state in the color map. This assumes you did a color check first
+         * @brief Refresh every buffer given by layer_view
          * 
-         * @param oldState the state that got replaced
-         * @param newState the state that replaced the old state
          */
-        void updateColor(std::string oldState, std::string newState);
+        void views_sync();
 
-        void reset();
+        /**
+         * @brief Get the agent layers that hold something in each cell, as a bitmask (bit n is layer n). Always up to date, field layers do not get bits.
+         * 
+         * @return const uint64_t* width * height masks ([y * width + x]), nullptr if the board has more than 64 layers
+         */
+        const uint64_t *occupancy_data();
 
         /**
-         * @brief Step through an iteration of the simulation
+         * @brief Count, for every cell of a layer, the neighbors that are in a state. One pass over the board (in parallel if the board has threads).
          * 
-         * The steps to run are defined by step_instructions
+         * @param layer The layer to look at
+         * @param state A registered state id
+         * @param stencil The neighbors of each cell
+         * @param out A buffer of width * height counts ([y * width + x]), gets overwritten
+         * @param wrap [optional] If the stencil wraps around the edges [default: false]
+         */
+        void neighbor_count(int layer, uint16_t state, const Neighborhood::Stencil &stencil, int32_t *out, bool wrap = false);
+
+        /**
+         * @brief Count, for every cell of a layer, the neighbors in each state
          * 
+         * @param layer The layer to look at
+         * @param stencil The neighbors of each cell
+         * @param out A buffer of stateCount * width * height counts ([state][y * width + x]), gets overwritten
+         * @param stateCount The amount of states to count (states with a higher id are ignored)
+         * @param wrap [optional] If the stencil wraps around the edges [default: false]
          */
-        void step();
+        void neighbor_counts(int layer, const Neighborhood::Stencil &stencil, int32_t *out, size_t stateCount, bool wrap = false);
 
         /*
          █████   ██████  ███████ ███    ██ ████████ ███████ 
@@ -245,6 +1150,212 @@ namespace fastautomata::Board {
          */
         Agents::BaseAgent *agent_get(Pos pos, int layer = 0, bool wrap = false);
 
+        /**
+         * @brief Make sure a position is inside the board
+         * 
+         * @param pos The position to check. Gets wrapped in place if wrap is true.
+         * @param wrap Whether to wrap the position if it is out of bounds
+         * @return true if the position is (now) inside the board
+         */
+        bool pos_resolve(Pos &pos, bool wrap);
+
+        /**
+         * @brief Check if a cell holds something (an agent, an entity, or a non empty field cell)
+         * 
+         * @param pos The position to check (must be inside the board)
+         * @param layer The layer to check
+         * @return true if the cell is occupied
+         */
+        bool cell_occupied(Pos pos, int layer);
+
+        /**
+         * @brief Check if a cell holds something (see cell_occupied). Internal use, does not check bounds.
+         * 
+         * @param layer The layer of the cell
+         * @param index The index of the cell inside the layer (x + y * width)
+         * @return true if the cell is occupied
+         */
+        inline bool cell_occupied_at(int layer, int index)
+        {
+            if (this->fields[layer])
+            {
+                return this->fields[layer]->occupied(index);
+            }
+            if (this->agent_at(layer, index) != nullptr)
+            {
+                return true;
+            }
+            return this->store && this->entity_cell(layer, index) != Agents::AgentStore::NONE;
+        }
+
+        /**
+         * @brief Mark a layer as changed (flow fields that depend on it get checked again)
+         * 
+         * @param layer The layer (must be inside the board)
+         */
+        inline void layer_touch(int layer)
+        {
+            this->layer_revisions[layer]++;
+            this->cells_revision++;
+        }
+
+        /**
+         * @brief Get the revision of a layer. It changes every time a cell of the layer changes.
+         * 
+         * @param layer The layer (must be inside the board)
+         * @return uint64_t 
+         */
+        inline uint64_t getLayerRevision(int layer)
+        {
+            return this->layer_revisions[layer];
+        }
+
+        /**
+         * @brief Mark the layer of an agent as changed for the walls of flow fields, if the agent is static. Call it while the agent is still in the agent table.
+         * 
+         * @param agent The agent that got added, removed or moved
+         * @param layer The layer it was added to, removed from or moved in (must be inside the board)
+         */
+        inline void static_touch(Agents::BaseAgent *agent, int layer)
+        {
+            if (this->agent_table.slot(agent).type == Agents::AgentType::STATIC)
+            {
+                this->static_revisions[layer]++;
+                this->cells_revision++;
+            }
+        }
+
+        /**
+         * @brief Get the static revision of a layer. It only changes when a static agent of the layer gets added, removed or moved (moving agents do not change it).
+         * 
+         * @param layer The layer (must be inside the board)
+         * @return uint64_t 
+         */
+        inline uint64_t getStaticRevision(int layer)
+        {
+            return this->static_revisions[layer];
+        }
+
+        /**
+         * @brief Get the revision of the cells. It changes every time any cell changes.
+         * 
+         * @return uint64_t 
+         */
+        inline uint64_t getCellsRevision()
+        {
+            return this->cells_revision;
+        }
+
+        /**
+         * @brief Check if a cell holds a static agent. Internal use, does not check bounds.
+         * 
+         * @param layer The layer of the cell
+         * @param index The index of the cell inside the layer (x + y * width)
+         * @return true if the agent of the cell is static
+         */
+        inline bool cell_static(int layer, int index)
+        {
+            auto agent = this->agent_at(layer, index);
+            return agent != nullptr && this->agent_table.slot(agent).type == Agents::AgentType::STATIC;
+        }
+
+        /**
+         * @brief Update the occupancy bit of a cell after its agent or entity changed. Internal use, does not check bounds.
+         * 
+         * @param layer The layer of the cell
+         * @param index The index of the cell inside the layer (x + y * width)
+         */
+        inline void occupancy_update(int layer, int index)
+        {
+            this->layer_touch(layer);
+            if (this->occupancy.empty())
+            {
+                return;
+            }
+            uint64_t bit = uint64_t(1) << layer;
+            bool occupied = this->agent_at(layer, index) != nullptr || (this->store && this->entity_cell(layer, index) != Agents::AgentStore::NONE);
+            this->occupancy[index] = occupied ? (this->occupancy[index] | bit) : (this->occupancy[index] & ~bit);
+        }
+
+        /**
+         * @brief Check if something in layer can not move to a cell: the cell is occupied in its own layer, or in a layer it has a SOLID collision with.
+         * 
+         * Same result as checking getCollisions for SOLID, without building the map. Uses the occupancy bitmask when the board has 64 layers or less.
+         * 
+         * Nothing gets checked: the python binding checks the arguments, c++ callers have to.
+         * 
+         * @param pos The target cell (must be inside the board)
+         * @param layer The layer that moves (must exist)
+         * @param includeSelf [optional] If false, the own layer is not checked (for example, when not moving) [default: true]
+         * @return true if the move is blocked
+         */
+        bool move_blocked(Pos pos, int layer, bool includeSelf = true);
+
+        /**
+         * @brief Get the state of a cell: the state of its agent or entity, or of the field for field layers. Internal use, does not check bounds.
+         * 
+         * @param layer The layer of the cell
+         * @param index The index of the cell inside the layer (x + y * width)
+         * @return uint16_t StateRegistry::NONE if the cell is empty (agent layers)
+         */
+        inline uint16_t cell_state(int layer, int index)
+        {
+            if (this->fields[layer])
+            {
+                return this->fields[layer]->get(index);
+            }
+            auto agent = this->agent_at(layer, index);
+            if (agent != nullptr)
+            {
+                return agent->getStateId();
+            }
+            if (this->store)
+            {
+                uint32_t id = this->entity_cell(layer, index);
+                if (id != Agents::AgentStore::NONE)
+                {
+                    return this->store->state[this->store->index(id)];
+                }
+            }
+            return StateRegistry::NONE;
+        }
+
+        /**
+         * @brief Get the index of a cell inside the board arena. Internal use, does not check bounds.
+         * 
+         * @param layer The layer of the cell
+         * @param index The index of the cell inside the layer (x + y * width)
+         * @return size_t 
+         */
+        inline size_t cell_index(int layer, int index)
+        {
+            return static_cast<size_t>(layer) * this->layerStride + index;
+        }
+
+        /**
+         * @brief Get a reference to the slot of a cell. Internal use, does not check bounds.
+         * 
+         * @param layer The layer of the cell
+         * @param index The index of the cell inside the layer (x + y * width)
+         * @return Agents::BaseAgent*& 
+         */
+        inline Agents::BaseAgent *&agent_at(int layer, int index)
+        {
+            return this->board[this->cell_index(layer, index)];
+        }
+
+        /**
+         * @brief Get an agent at a position. Internal use, does not check bounds nor wrap.
+         * 
+         * @param pos The position to get the agent from (must be inside the board)
+         * @param layer The layer to get the agent from (must exist)
+         * @return Agents::BaseAgent* The agent at the position, nullptr if empty.
+         */
+        inline Agents::BaseAgent *agent_get_unchecked(Pos pos, int layer)
+        {
+            return this->board[this->cell_index(layer, pos.x + pos.y * this->width)];
+        }
+
         /**
          * @brief Add an agent to the board
          * 
@@ -253,6 +1364,99 @@ namespace fastautomata::Board {
          */
         void agent_add(Agents::BaseAgent *agent, bool allowOverrides = false);
 
+        /**
+         * @brief Create and add many agents at once. The board owns them (it deletes them when they get removed, or on reset).
+         * 
+         * Everything gets checked before adding anything: if a cell is taken (or repeated), nothing gets added.
+         * on_add is not called, on_spawn gets called once with every id instead.
+         * 
+         * @param positions The position of each agent
+         * @param states The state id of each agent (or a single one for all of them)
+         * @param layers The layer of each agent (or a single one for all of them)
+         * @param factory [optional] Creates each agent (for example a c++ Agent subclass, which gets stepped). nullptr creates static agents [default: nullptr]
+         * @return std::vector<int> The ids of the new agents, in the same order
+         */
+        std::vector<int> agents_spawn(const std::vector<Pos> &positions, const std::vector<uint16_t> &states, const std::vector<int> &layers, const std::function<Agents::BaseAgent *()> &factory = nullptr);
+
+        /**
+         * @brief Get an agent by id
+         * 
+         * @param id The id of the agent
+         * @return Agents::BaseAgent* nullptr if there is no agent with that id (removed, or never added)
+         */
+        Agents::BaseAgent *agent_by_id(int id);
+
+        /**
+         * @brief Get a handle of an agent. Unlike a pointer, a handle can be checked after the agent got removed.
+         * 
+         * @param agent An agent of the board
+         * @return Agents::AgentHandle 
+         */
+        Agents::AgentHandle agent_handle(Agents::BaseAgent *agent);
+
+        /**
+         * @brief Get the agent of a handle
+         * 
+         * @return Agents::BaseAgent* nullptr if the agent got removed
+         */
+        Agents::BaseAgent *agent_from_handle(Agents::AgentHandle handle);
+
+        /**
+         * @brief Get the amount of agents on the board (static agents included)
+         * 
+         * @return int 
+         */
+        int getAgentCount();
+
+        /**
+         * @brief Get the store of native entities (agents stored by column and stepped by kernels). Gets created on the first call.
+         * 
+         * Creating the store adds a step instruction (update_entities) that runs its kernels and applies their changes.
+         * 
+         * @return Agents::AgentStore* The store (owned by the board)
+         */
+        Agents::AgentStore *entities();
+
+        /**
+         * @brief Get the entity at a position
+         * 
+         * @param pos The position
+         * @param layer [optional] The layer [default: 0]
+         * @return long long The id of the entity, -1 if there is none (or out of bounds)
+         */
+        long long entity_at(Pos pos, int layer = 0);
+
+        /**
+         * @brief Get a reference to the entity id of a cell. Internal use, does not check bounds. entities() must have been called.
+         * 
+         * @param layer The layer of the cell
+         * @param index The index of the cell inside the layer (x + y * width)
+         * @return uint32_t& 
+         */
+        inline uint32_t &entity_cell(int layer, int index)
+        {
+            return this->entity_cells[this->cell_index(layer, index)];
+        }
+
+        /**
+         * @brief Get the flow field (distance to the closest target) of a set of targets. Fields get cached: the same targets give the same field.
+         * 
+         * The field gets checked again when the board changes, and only gets recomputed if its walls changed. Safe to call from agents stepped in parallel.
+         * 
+         * @param targets The target cells (duplicates and order do not matter)
+         * @param layer [optional] The layer that walks [default: 0]
+         * @param diagonal [optional] If true, moves go to the 8 cells around, if false only to the 4 orthogonal ones [default: true]
+         * @param wrap [optional] If the edges of the board wrap around [default: false]
+         * @return std::shared_ptr<Paths::FlowField> The field (shared with the cache). It keeps working after it leaves the cache, but must not outlive the board.
+         */
+        std::shared_ptr<Paths::FlowField> flow_field(const std::vector<Pos> &targets, int layer = 0, bool diagonal = true, bool wrap = false);
+
+        /**
+         * @brief Remove every cached flow field. Fields still held elsewhere keep working, asking for the same targets again builds a new one.
+         * 
+         */
+        void flow_fields_clear();
+
         /**
          * @brief Move an agent to a new position. 
          * 
@@ -267,7 +1471,9 @@ namespace fastautomata::Board {
         void agent_move_layer(Agents::Agent *agent, int layerNew);
 
         /**
-         * @brief remove an agent from board. Deletes it afterwards.
+         * @brief remove an agent from board. Deletes it afterwards (at the end of the step). 
+         * 
+         * Scheduling the same agent twice, or an agent that is not on the board, does nothing.
          * 
          * @param agent The agent to delete
          */
@@ -288,6 +1494,48 @@ namespace fastautomata::Board {
          */
         static void scheduled_delete(SimulatedBoard *board);
 
+        /**
+         * @brief Run the kernels of the entity store, and apply their changes
+         * 
+         * @param board The board to update
+         */
+        static void update_entities(Board::SimulatedBoard *board);
+
+        /**
+         * @brief Step the Life-like rules of every field layer
+         * 
+         * @param board The board to update
+         */
+        static void update_life(Board::SimulatedBoard *board);
+
+        /**
+         * @brief Check the rule sets of every layer, and queue (or write) their changes
+         * 
+         * @param board The board to update
+         */
+        static void update_rules(Board::SimulatedBoard *board);
+
+        /**
+         * @brief Call the C kernels of the board
+         * 
+         * @param board The board to update
+         */
+        static void update_kernels(Board::SimulatedBoard *board);
+
+        /**
+         * @brief Diffuse and evaporate every float field
+         * 
+         * @param board The board to update
+         */
+        static void update_scalars(Board::SimulatedBoard *board);
+
+        /**
+         * @brief Pick the agents that will get stepped (agents_stepping), from the dirty cells and the awake agents
+         * 
+         * @param board The board to update
+         */
+        static void update_active_set(Board::SimulatedBoard *board);
+
         /**
          * @brief A wrapper function that calls the step function of each agent
          * 
@@ -295,6 +1543,17 @@ namespace fastautomata::Board {
          */
         static void update_agents(Board::SimulatedBoard *board);
 
+        /**
+         * @brief Resolve and apply the moves (pos_next) of every agent at once, following move_policy.
+         * 
+         * Every move gets grouped by target cell. Each cell goes to a single agent (lowest id, or random with the seed), 
+         * an agent can follow another one that leaves its cell, and cycles only move if move_allow_swaps is true.
+         * Collisions with other layers are checked against the board before the step. The result does not depend on the order of the agents nor the amount of threads.
+         * 
+         * @param board The board to update
+         */
+        static void resolve_moves(Board::SimulatedBoard *board);
+
         /**
          * @brief A wrapper function that calls the step_end function of each agent
          * 
@@ -305,5 +1564,13 @@ namespace fastautomata::Board {
         /// @brief Create a random color
         /// @return A random color in rgb format
         static std::array<int, 3> getRandomColor();
+
+        /**
+         * @brief Get the color given to a state that was not added with addColor. Always the same for the same name.
+         * 
+         * @param name The state
+         * @return std::array<int, 3> 
+         */
+        static std::array<int, 3> getStateColor(const std::string &name);
     };
 }
\ No newline at end of file
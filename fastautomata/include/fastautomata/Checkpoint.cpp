@@ -0,0 +1,171 @@
+#include "Checkpoint.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fastautomata::Checkpoint {
+    SectionWriter::SectionWriter(SectionKind kind)
+    {
+        this->kind = kind;
+    }
+
+    void SectionWriter::write_bytes(const void *bytes, size_t size)
+    {
+        const char *begin = static_cast<const char *>(bytes);
+        this->data.insert(this->data.end(), begin, begin + size);
+    }
+
+    void SectionWriter::write_string(const std::string &value)
+    {
+        this->write(static_cast<uint32_t>(value.size()));
+        this->write_bytes(value.data(), value.size());
+    }
+
+    void SectionWriter::flush(std::ofstream &file)
+    {
+        SectionHeader header;
+        header.kind = this->kind;
+        header.reserved = 0;
+        header.size = this->data.size();
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(this->data.data(), static_cast<std::streamsize>(this->data.size()));
+        this->data.clear();
+    }
+
+    SectionReader::SectionReader(const uint8_t *data, size_t size)
+    {
+        this->data = data;
+        this->size = size;
+    }
+
+    const uint8_t *SectionReader::read_bytes(size_t size)
+    {
+        if (size > this->size - this->position)
+        {
+            throw std::invalid_argument("The checkpoint is broken (a section is shorter than its contents)");
+        }
+        const uint8_t *bytes = this->data + this->position;
+        this->position += size;
+        return bytes;
+    }
+
+    std::string SectionReader::read_string()
+    {
+        uint32_t length = this->read<uint32_t>();
+        const uint8_t *bytes = this->read_bytes(length);
+        return std::string(reinterpret_cast<const char *>(bytes), length);
+    }
+
+    /*
+    ███    ███  █████  ██████  ██████  ███████ ██████
+    ████  ████ ██   ██ ██   ██ ██   ██ ██      ██   ██
+    ██ ████ ██ ███████ ██████  ██████  █████   ██   ██
+    ██  ██  ██ ██   ██ ██      ██      ██      ██   ██
+    ██      ██ ██   ██ ██      ██      ███████ ██████
+    */
+
+    MappedFile::MappedFile(const std::string &path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Could not open file: " + path);
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize))
+        {
+            CloseHandle(file);
+            throw std::runtime_error("Could not read the size of file: " + path);
+        }
+        this->file = file;
+        this->size = static_cast<size_t>(fileSize.QuadPart);
+        if (this->size == 0)
+        {
+            return;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            CloseHandle(file);
+            throw std::runtime_error("Could not map file: " + path);
+        }
+        this->mapping = mapping;
+        this->data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (this->data == nullptr)
+        {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("Could not map file: " + path);
+        }
+#else
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            throw std::runtime_error("Could not open file: " + path);
+        }
+        struct stat info;
+        if (fstat(file, &info) != 0)
+        {
+            close(file);
+            throw std::runtime_error("Could not read the size of file: " + path);
+        }
+        this->size = static_cast<size_t>(info.st_size);
+        if (this->size == 0)
+        {
+            close(file);
+            return;
+        }
+
+        void *data = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, file, 0);
+        // the mapping keeps the file open by itself
+        close(file);
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("Could not map file: " + path);
+        }
+        this->data = static_cast<const uint8_t *>(data);
+#endif
+    }
+
+    MappedFile::~MappedFile()
+    {
+#ifdef _WIN32
+        if (this->data != nullptr)
+        {
+            UnmapViewOfFile(this->data);
+        }
+        if (this->mapping != nullptr)
+        {
+            CloseHandle(this->mapping);
+        }
+        if (this->file != nullptr)
+        {
+            CloseHandle(this->file);
+        }
+#else
+        if (this->data != nullptr)
+        {
+            munmap(const_cast<uint8_t *>(this->data), this->size);
+        }
+#endif
+    }
+
+    const uint8_t *MappedFile::getData()
+    {
+        return this->data;
+    }
+
+    size_t MappedFile::getSize()
+    {
+        return this->size;
+    }
+}
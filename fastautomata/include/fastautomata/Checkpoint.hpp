@@ -0,0 +1,249 @@
+/**
+ * @file Checkpoint.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief The binary file format of board checkpoints (see SimulatedBoard::save and SimulatedBoard::load)
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace fastautomata::Checkpoint {
+    /**
+     * @brief The version of the format. Files of other versions do not load.
+     *
+     */
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     * @brief Written as is, so files from a machine with another byte order get rejected
+     *
+     */
+    static constexpr uint32_t ENDIAN_MARK = 0x01020304;
+
+    /**
+     * @brief The start of every checkpoint. Followed by sectionCount sections.
+     *
+     */
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        int32_t width;
+        int32_t height;
+        int32_t layers;
+        int32_t step;
+        int32_t nextAgentId;
+        uint32_t sectionCount;
+        uint64_t seed;
+
+        /**
+         * @brief Where the random generator of the board was (see SimulatedBoard::random)
+         *
+         */
+        int32_t randomStep;
+        uint32_t reserved;
+        uint64_t randomDraws;
+    };
+    static_assert(sizeof(Header) == 64, "The checkpoint header must not have padding");
+
+    static constexpr char MAGIC[8] = {'F', 'A', 'U', 'T', 'O', 'C', 'K', 'P'};
+
+    /**
+     * @brief What a section holds. Sections of unknown kinds get skipped.
+     *
+     */
+    enum SectionKind : uint32_t
+    {
+        /**
+         * @brief Every registered state, in id order: [int32 r, g, b][uint32 length][name]
+         *
+         */
+        STATES = 1,
+
+        /**
+         * @brief The collision map: [int32 length][uint8 type, length * length]
+         *
+         */
+        COLLISIONS = 2,
+
+        /**
+         * @brief A field layer: [int32 layer][uint16 empty state][uint16 cells, width * height]
+         *
+         */
+        FIELD = 3,
+
+        /**
+         * @brief A float field: [uint32 length][name][uint8 wrap][float diffusion, evaporation][float values, width * height]
+         *
+         */
+        SCALAR = 4,
+
+        /**
+         * @brief Every agent: [uint32 count][AgentRecord, count]. Simulated agents first, in step order.
+         *
+         */
+        AGENTS = 5,
+
+        /**
+         * @brief Every entity, by column: [uint32 count, next id, attribute count][attributes: uint32 length, name, double default]
+         * [int32 x, count][int32 y, count][int32 layer, count][uint16 state, count][uint32 id, count][double value, count, per attribute]
+         *
+         */
+        ENTITIES = 6,
+
+        /**
+         * @brief How the board steps: [uint8 move policy, allow swaps][uint8 active scheduling, active wrap][int32 active radius]
+         * [uint8 dirty cell, width * height, only with active scheduling]
+         *
+         */
+        SETTINGS = 7,
+    };
+
+    struct SectionHeader
+    {
+        uint32_t kind;
+        uint32_t reserved;
+        uint64_t size;
+    };
+    static_assert(sizeof(SectionHeader) == 16, "The section header must not have padding");
+
+    /**
+     * @brief An agent, as stored in a checkpoint
+     *
+     */
+    struct AgentRecord
+    {
+        /**
+         * @brief Set in flags if the agent called wake() in the last step (active scheduling)
+         *
+         */
+        static constexpr uint8_t AWAKE = 1;
+
+        int32_t id;
+        int32_t x;
+        int32_t y;
+        int32_t layer;
+        uint16_t state;
+
+        /**
+         * @brief The Agents::AgentType of the agent (STATIC, NATIVE or PYTHON)
+         *
+         */
+        uint8_t type;
+
+        /**
+         * @brief AWAKE, or 0
+         *
+         */
+        uint8_t flags;
+    };
+    static_assert(sizeof(AgentRecord) == 20, "The agent record must not have padding");
+
+    /**
+     * @brief Builds a section in memory, then writes it with its header
+     *
+     */
+    class SectionWriter
+    {
+        private:
+        uint32_t kind;
+        std::vector<char> data;
+
+        public:
+        SectionWriter(SectionKind kind);
+
+        template <typename T>
+        void write(const T &value)
+        {
+            this->write_bytes(&value, sizeof(T));
+        }
+
+        void write_bytes(const void *bytes, size_t size);
+
+        /**
+         * @brief Write a string as [uint32 length][characters]
+         *
+         */
+        void write_string(const std::string &value);
+
+        /**
+         * @brief Write the header and the data of the section to a file
+         *
+         */
+        void flush(std::ofstream &file);
+    };
+
+    /**
+     * @brief Reads the data of a section in order. Every read checks the size, so a broken file throws instead of reading past the end.
+     *
+     */
+    class SectionReader
+    {
+        private:
+        const uint8_t *data;
+        size_t size;
+        size_t position = 0;
+
+        public:
+        SectionReader(const uint8_t *data, size_t size);
+
+        template <typename T>
+        T read()
+        {
+            T value;
+            std::memcpy(&value, this->read_bytes(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        /**
+         * @brief Skip size bytes
+         *
+         * @return const uint8_t* Where the bytes start (not aligned, copy them with memcpy)
+         */
+        const uint8_t *read_bytes(size_t size);
+
+        std::string read_string();
+    };
+
+    /**
+     * @brief A file mapped into memory, read only (mmap on linux and mac, MapViewOfFile on windows). Unmapped when destroyed.
+     *
+     */
+    class MappedFile
+    {
+        private:
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+
+#ifdef _WIN32
+        void *file = nullptr;
+        void *mapping = nullptr;
+#endif
+
+        public:
+        /**
+         * @brief Map a whole file
+         *
+         * @param path The path of the file
+         */
+        MappedFile(const std::string &path);
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile();
+
+        const uint8_t *getData();
+
+        size_t getSize();
+    };
+}
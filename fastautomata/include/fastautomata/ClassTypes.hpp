@@ -15,7 +15,13 @@
 #include <stdexcept>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <deque>
+#include <shared_mutex>
+#include <atomic>
+#include <mutex>
 #include <string> 
+#include <cstdint>
 
 namespace fastautomata::ClassTypes{
     /**
@@ -172,6 +178,29 @@ namespace fastautomata::ClassTypes{
         TRIGGER
     };
 
+    /**
+     * @brief Describes how the moves of the agents get applied at the end of a step
+     * 
+     */
+    enum MovePolicy
+    {
+        /**
+         * @brief Every agent moves in step_end, one at a time, in the order of the agent list. Results depend on that order.
+         * 
+         */
+        SEQUENTIAL,
+        /**
+         * @brief Moves get resolved together. If many agents want the same cell, the one with the lowest id wins.
+         * 
+         */
+        LOWEST_ID,
+        /**
+         * @brief Moves get resolved together. If many agents want the same cell, a random one wins (reproducible with the board seed).
+         * 
+         */
+        RANDOM
+    };
+
     class CollisionList
     {
         std::map<int, CollisionType> collisions;
@@ -202,29 +231,61 @@ namespace fastautomata::ClassTypes{
         }
     };
 
+    /**
+     * @brief The collisions between every pair of layers, stored as a flat matrix ([layer_start * length + layer_end]).
+     * 
+     * The SOLID collisions of each layer are also kept as a bitmask of layers (first 64 layers), so a move can be checked with a few bitwise operations.
+     * 
+     */
     class CollisionMap
     {
         private:
-        CollisionList* collisions;
         int length;
+        std::vector<CollisionType> matrix;
+
+        /**
+         * @brief Bit layer_end is set if layer_start has a SOLID collision with it ([layer_start]). Only layers below 64 get a bit.
+         * 
+         */
+        std::vector<uint64_t> solid;
+
+        /**
+         * @brief Changes every time a collision gets added. Different maps never share a revision.
+         * 
+         */
+        uint64_t revision;
+
+        static uint64_t nextRevision()
+        {
+            static std::atomic<uint64_t> revisions{0};
+            return revisions.fetch_add(1, std::memory_order_relaxed);
+        }
 
         public:
         CollisionMap()
         {
-            this->collisions = new CollisionList[0];
             this->length = 0;
+            this->revision = nextRevision();
         }
 
         CollisionMap(int length)
         {
-            this->collisions = new CollisionList[length];
             this->length = length;
+            this->revision = nextRevision();
+            this->matrix = std::vector<CollisionType>(static_cast<size_t>(length) * length, CollisionType::NONE);
+            this->solid = std::vector<uint64_t>(length, 0);
         }
 
-        CollisionMap(CollisionList* collisions, int length)
+        CollisionMap(CollisionList* collisions, int length) : CollisionMap(length)
         {
-            this->collisions = collisions;
-            this->length = length;
+            for (int layer_start = 0; layer_start < length; layer_start++)
+            {
+                for (int layer_end = 0; layer_end < length; layer_end++)
+                {
+                    CollisionType collision = collisions[layer_start].getCollision(layer_end);
+                    this->addCollision(&collision, layer_start, layer_end);
+                }
+            }
         }
 
         /**
@@ -234,23 +295,49 @@ namespace fastautomata::ClassTypes{
          * @param layer_end the layer that the layer_start is colliding with
          * @return CollisionType 
          */
-        CollisionType getCollision(int layer_start, int layer_end)
+        inline CollisionType getCollision(int layer_start, int layer_end)
         {
             if (this->length == 0)
             {
                 return CollisionType::NONE;
             }
 
-            if (layer_start >= this->length || layer_end >= this->length)
+            if (layer_start >= this->length || layer_end >= this->length || layer_start < 0 || layer_end < 0)
             {
                 throw std::out_of_range("Layer out of range");
             }
-            return this->collisions[layer_start].getCollision(layer_end);
+            return this->matrix[static_cast<size_t>(layer_start) * this->length + layer_end];
+        }
+
+        /**
+         * @brief Get the layers that layer_start has a SOLID collision with, as a bitmask (bit n is layer n). Does not check bounds.
+         * 
+         * @param layer_start the layer to look for collisions (below 64)
+         * @return uint64_t 
+         */
+        inline uint64_t getSolidMask(int layer_start)
+        {
+            return this->length == 0 ? 0 : this->solid[layer_start];
         }
 
-        ~CollisionMap()
+        /**
+         * @brief Get the amount of layers of the map
+         * 
+         * @return int 
+         */
+        int getLength()
         {
-            // delete[] this->collisions;
+            return this->length;
+        }
+
+        /**
+         * @brief Get the revision of the map (changes every time a collision gets added)
+         * 
+         * @return uint64_t 
+         */
+        uint64_t getRevision()
+        {
+            return this->revision;
         }
 
         /**
@@ -267,11 +354,127 @@ namespace fastautomata::ClassTypes{
                 throw std::out_of_range("No layers defined at startup");
             }
 
-            if (layer_start >= this->length || layer_start < 0)
+            if (layer_start >= this->length || layer_start < 0 || layer_end >= this->length || layer_end < 0)
             {
                 throw std::out_of_range("Layer out of range");
             }
-            this->collisions[layer_start].addCollision(collision, layer_end);
+            this->matrix[static_cast<size_t>(layer_start) * this->length + layer_end] = *collision;
+            this->revision = nextRevision();
+
+            if (layer_end < 64)
+            {
+                uint64_t bit = uint64_t(1) << layer_end;
+                if (*collision == CollisionType::SOLID)
+                {
+                    this->solid[layer_start] |= bit;
+                }
+                else
+                {
+                    this->solid[layer_start] &= ~bit;
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief Interns state names into dense ids. Ids are given in registration order and never change.
+     * 
+     * Safe to read from many threads. Registering takes a lock, but the board refuses new states while agents step in parallel
+     * (see SimulatedBoard::state_id): the tables that grow with the states are not locked.
+     * 
+     */
+    class StateRegistry
+    {
+        private:
+        /**
+         * @brief The names of the states ([id]). A deque, so references to names stay valid when states get added.
+         * 
+         */
+        std::deque<std::string> names;
+        std::unordered_map<std::string, uint16_t> ids;
+        mutable std::shared_mutex mutex;
+
+        public:
+        /**
+         * @brief An id that is never given to a state (used as "no state")
+         * 
+         */
+        static constexpr uint16_t NONE = 0xFFFF;
+
+        StateRegistry()
+        {
+            this->names = std::deque<std::string>();
+            this->ids = std::unordered_map<std::string, uint16_t>();
+        }
+
+        /**
+         * @brief Find the id of a state
+         * 
+         * @param name The name of the state
+         * @return int The id of the state, -1 if it was never registered
+         */
+        int find(const std::string &name) const
+        {
+            std::shared_lock<std::shared_mutex> lock(this->mutex);
+            auto found = this->ids.find(name);
+            if (found == this->ids.end())
+            {
+                return -1;
+            }
+            return found->second;
+        }
+
+        /**
+         * @brief Get the id of a state, registering it if needed
+         * 
+         * @param name The name of the state
+         * @return uint16_t 
+         */
+        uint16_t intern(const std::string &name)
+        {
+            std::unique_lock<std::shared_mutex> lock(this->mutex);
+            auto found = this->ids.find(name);
+            if (found != this->ids.end())
+            {
+                return found->second;
+            }
+
+            if (this->names.size() >= NONE)
+            {
+                throw std::length_error("Too many states registered (max: " + std::to_string(NONE) + ")");
+            }
+
+            uint16_t id = static_cast<uint16_t>(this->names.size());
+            this->names.push_back(name);
+            this->ids[name] = id;
+            return id;
+        }
+
+        /**
+         * @brief Get the name of a state
+         * 
+         * @param id The id of the state
+         * @return const std::string& 
+         */
+        const std::string &getName(uint16_t id) const
+        {
+            std::shared_lock<std::shared_mutex> lock(this->mutex);
+            if (id >= this->names.size())
+            {
+                throw std::out_of_range("State id out of range (id given: " + std::to_string(id) + ")");
+            }
+            return this->names[id];
+        }
+
+        /**
+         * @brief The amount of registered states
+         * 
+         * @return size_t 
+         */
+        size_t size() const
+        {
+            std::shared_lock<std::shared_mutex> lock(this->mutex);
+            return this->names.size();
         }
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,200 @@
+#include "Ensemble.hpp"
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <stdexcept>
+
+namespace fastautomata::Ensemble {
+    /*
+    ██████  ███████ ███████ ██    ██ ██      ████████
+    ██   ██ ██      ██      ██    ██ ██         ██
+    ██████  █████   ███████ ██    ██ ██         ██
+    ██   ██ ██           ██ ██    ██ ██         ██
+    ██   ██ ███████ ███████  ██████  ███████    ██
+    */
+
+    int EnsembleResult::size()
+    {
+        return static_cast<int>(this->run.size());
+    }
+
+    std::map<std::string, std::vector<double>> EnsembleResult::columns()
+    {
+        std::map<std::string, std::vector<double>> columns;
+
+        columns["run"] = std::vector<double>(this->run.begin(), this->run.end());
+        columns["seed"] = std::vector<double>(this->seed.begin(), this->seed.end());
+        columns["steps"] = std::vector<double>(this->steps.begin(), this->steps.end());
+        columns["time"] = this->time;
+        columns["step_time_mean"] = this->step_time_mean;
+        columns["step_time_max"] = this->step_time_max;
+
+        for (auto &[state, counts] : this->state_counts)
+        {
+            columns["state." + state] = std::vector<double>(counts.begin(), counts.end());
+        }
+
+        return columns;
+    }
+
+    void EnsembleResult::to_csv(std::string filename, bool append)
+    {
+        std::ofstream file(filename, append ? std::ios::app : std::ios::trunc);
+        if (!file)
+        {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+
+        if (!append)
+        {
+            file << "run,seed,steps,time,step_time_mean,step_time_max";
+            for (auto &[state, counts] : this->state_counts)
+            {
+                file << ",state." << state;
+            }
+            file << "\n";
+        }
+
+        for (size_t i = 0; i < this->run.size(); i++)
+        {
+            file << this->run[i] << "," << this->seed[i] << "," << this->steps[i] << "," << this->time[i] << "," << this->step_time_mean[i] << "," << this->step_time_max[i];
+            for (auto &[state, counts] : this->state_counts)
+            {
+                file << "," << counts[i];
+            }
+            file << "\n";
+        }
+    }
+
+    /*
+    ██████  ██    ██ ███    ██ ███    ██ ███████ ██████
+    ██   ██ ██    ██ ████   ██ ████   ██ ██      ██   ██
+    ██████  ██    ██ ██ ██  ██ ██ ██  ██ █████   ██████
+    ██   ██ ██    ██ ██  ██ ██ ██  ██ ██ ██      ██   ██
+    ██   ██  ██████  ██   ████ ██   ████ ███████ ██   ██
+    */
+
+    EnsembleRunner::EnsembleRunner(int threads)
+    {
+        if (threads < 0)
+        {
+            throw std::invalid_argument("The amount of threads cannot be negative");
+        }
+        if (threads == 0)
+        {
+            threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+        this->pool = std::make_unique<Threading::ThreadPool>(threads);
+    }
+
+    int EnsembleRunner::add(Board::SimulatedBoard *board, uint64_t seed, int maxSteps)
+    {
+        if (board == nullptr)
+        {
+            throw std::invalid_argument("Cannot add an empty board to the ensemble");
+        }
+        if (maxSteps < 0)
+        {
+            throw std::invalid_argument("The step limit cannot be negative (given: " + std::to_string(maxSteps) + ")");
+        }
+        for (auto &run : this->runs)
+        {
+            if (run.board == board)
+            {
+                throw std::invalid_argument("The board was already added to the ensemble (boards run at the same time, so each run needs its own board)");
+            }
+        }
+
+        this->runs.push_back(Run{board, seed, maxSteps});
+        return static_cast<int>(this->runs.size()) - 1;
+    }
+
+    void EnsembleRunner::setStop(std::function<bool(Board::SimulatedBoard *)> stop)
+    {
+        this->stop = stop;
+    }
+
+    int EnsembleRunner::size()
+    {
+        return static_cast<int>(this->runs.size());
+    }
+
+    void EnsembleRunner::clear()
+    {
+        this->runs.clear();
+    }
+
+    int EnsembleRunner::getThreadCount()
+    {
+        return this->pool->getThreadCount();
+    }
+
+    EnsembleResult EnsembleRunner::run()
+    {
+        size_t count = this->runs.size();
+
+        EnsembleResult result;
+        result.run.resize(count);
+        result.seed.resize(count);
+        result.steps.resize(count);
+        result.time.resize(count);
+        result.step_time_mean.resize(count);
+        result.step_time_max.resize(count);
+
+        // each run writes its own slot, the state columns get built afterwards (boards can know different states)
+        std::vector<std::map<std::string, int>> counts(count);
+
+        // one board per chunk, so slow boards do not hold back the others
+        this->pool->parallel_for(count, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                auto &run = this->runs[i];
+                auto board = run.board;
+
+                auto start = std::chrono::steady_clock::now();
+                board->setSeed(run.seed);
+                board->reset();
+
+                int steps = 0;
+                double stepTotal = 0;
+                double stepMax = 0;
+                while ((run.maxSteps == 0 || steps < run.maxSteps) && board->simulated)
+                {
+                    auto stepStart = std::chrono::steady_clock::now();
+                    board->step();
+                    double stepTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count();
+
+                    stepTotal += stepTime;
+                    stepMax = std::max(stepMax, stepTime);
+                    steps++;
+
+                    if (this->stop && this->stop(board))
+                    {
+                        break;
+                    }
+                }
+
+                result.run[i] = static_cast<int>(i);
+                result.seed[i] = run.seed;
+                result.steps[i] = steps;
+                result.time[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                result.step_time_mean[i] = steps > 0 ? stepTotal / steps : 0;
+                result.step_time_max[i] = stepMax;
+                counts[i] = board->getColorMapCount();
+            }
+        });
+
+        for (size_t i = 0; i < count; i++)
+        {
+            for (auto &[state, value] : counts[i])
+            {
+                auto &column = result.state_counts[state];
+                column.resize(count, 0);
+                column[i] = value;
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,170 @@
+/**
+ * @file Ensemble.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief Runs many boards at once (parameter sweeps, repetitions) and collects their results
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include "Board.hpp"
+#include "ThreadPool.hpp"
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+namespace fastautomata::Ensemble {
+    /**
+     * @brief The results of an ensemble run, stored by column (one element per run)
+     *
+     */
+    class EnsembleResult
+    {
+        public:
+        /**
+         * @brief The index of the run (order in which the boards got added)
+         *
+         */
+        std::vector<int> run;
+
+        /**
+         * @brief The seed given to each board
+         *
+         */
+        std::vector<uint64_t> seed;
+
+        /**
+         * @brief The amount of steps each board ran
+         *
+         */
+        std::vector<int> steps;
+
+        /**
+         * @brief The total time of each run (reset included), in seconds
+         *
+         */
+        std::vector<double> time;
+
+        /**
+         * @brief The mean time of a step of each run, in seconds
+         *
+         */
+        std::vector<double> step_time_mean;
+
+        /**
+         * @brief The slowest step of each run, in seconds
+         *
+         */
+        std::vector<double> step_time_max;
+
+        /**
+         * @brief The count of each state at the end of each run ([state][run]). States a board does not know count as 0.
+         *
+         */
+        std::map<std::string, std::vector<int>> state_counts;
+
+        /**
+         * @brief Get the amount of runs
+         *
+         * @return int
+         */
+        int size();
+
+        /**
+         * @brief Get every column as doubles. The states get a "state." prefix.
+         *
+         * @return std::map<std::string, std::vector<double>>
+         */
+        std::map<std::string, std::vector<double>> columns();
+
+        /**
+         * @brief Write every run to a csv file, in one go
+         *
+         * @param filename The file to write
+         * @param append [optional] If true, add the rows at the end of the file (without the header) [default: false]
+         */
+        void to_csv(std::string filename, bool append = false);
+    };
+
+    /**
+     * @brief Steps many boards in parallel (one board per thread) until they stop, and collects their results
+     *
+     * A board stops when its step count reaches the step limit, when its simulated flag gets cleared, or when the stop predicate returns true.
+     */
+    class EnsembleRunner
+    {
+        private:
+        struct Run
+        {
+            Board::SimulatedBoard *board;
+            uint64_t seed;
+            int maxSteps;
+        };
+
+        std::vector<Run> runs;
+
+        /**
+         * @brief Called after every step of every board. The board stops if it returns true.
+         *
+         */
+        std::function<bool(Board::SimulatedBoard *)> stop;
+
+        std::unique_ptr<Threading::ThreadPool> pool;
+
+        public:
+        /**
+         * @brief Construct a new Ensemble Runner
+         *
+         * @param threads [optional] The amount of boards stepped at once. 0 uses every core [default: 0]
+         */
+        EnsembleRunner(int threads = 0);
+
+        /**
+         * @brief Add a board to the next run. The board must live until the run finishes.
+         *
+         * @param board The board (already configured, it will get reset)
+         * @param seed The seed given to the board before the reset
+         * @param maxSteps The step limit. 0 runs until the board stops by itself.
+         * @return int The index of the run
+         */
+        int add(Board::SimulatedBoard *board, uint64_t seed = 0, int maxSteps = 0);
+
+        /**
+         * @brief Set the stop predicate. Called after every step from the thread stepping the board.
+         *
+         * @param stop A function returning true when the board has to stop. nullptr to remove it.
+         */
+        void setStop(std::function<bool(Board::SimulatedBoard *)> stop);
+
+        /**
+         * @brief Get the amount of boards added
+         *
+         * @return int
+         */
+        int size();
+
+        /**
+         * @brief Remove every board
+         *
+         */
+        void clear();
+
+        int getThreadCount();
+
+        /**
+         * @brief Reset and step every board until it stops. Blocks until every board is done.
+         *
+         * The boards do not get removed, so calling run again runs them again.
+         *
+         * @return EnsembleResult
+         */
+        EnsembleResult run();
+    };
+}
@@ -0,0 +1,399 @@
+#include "Fields.hpp"
+#include "Board.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace fastautomata::Fields {
+    /*
+    ███████ ████████  █████  ████████ ███████     ███████ ██ ███████ ██      ██████  
+    ██         ██    ██   ██    ██    ██          ██      ██ ██      ██      ██   ██ 
+    ███████    ██    ███████    ██    █████       █████   ██ █████   ██      ██   ██ 
+         ██    ██    ██   ██    ██    ██          ██      ██ ██      ██      ██   ██ 
+    ███████    ██    ██   ██    ██    ███████     ██      ██ ███████ ███████ ██████  
+    */
+
+    StateField::StateField(int width, int height, uint16_t emptyState)
+    {
+        this->width = width;
+        this->height = height;
+        this->emptyState = emptyState;
+        this->current = std::vector<uint16_t>(static_cast<size_t>(width) * height, emptyState);
+        this->next = std::vector<uint16_t>(static_cast<size_t>(width) * height, emptyState);
+    }
+
+    uint16_t StateField::getEmptyState()
+    {
+        return this->emptyState;
+    }
+
+    int StateField::getWidth()
+    {
+        return this->width;
+    }
+
+    int StateField::getHeight()
+    {
+        return this->height;
+    }
+
+    uint64_t StateField::getRevision()
+    {
+        return this->revision;
+    }
+
+    void StateField::put(int index, uint16_t state, std::vector<int> &counts)
+    {
+        this->touch();
+
+        uint16_t old = this->current[index];
+
+        if (old != this->emptyState)
+        {
+            counts[old] -= 1;
+        }
+        if (state != this->emptyState)
+        {
+            counts[state] += 1;
+        }
+
+        this->current[index] = state;
+        this->next[index] = state;
+    }
+
+    void StateField::assign(const uint16_t *cells, std::vector<int> &counts)
+    {
+        this->touch();
+
+        size_t size = this->current.size();
+        for (size_t i = 0; i < size; i++)
+        {
+            if (this->current[i] != this->emptyState)
+            {
+                counts[this->current[i]] -= 1;
+            }
+            if (cells[i] != this->emptyState)
+            {
+                counts[cells[i]] += 1;
+            }
+        }
+
+        std::copy(cells, cells + size, this->current.begin());
+        std::copy(cells, cells + size, this->next.begin());
+    }
+
+    void StateField::clear()
+    {
+        this->touch();
+
+        std::fill(this->current.begin(), this->current.end(), this->emptyState);
+        std::fill(this->next.begin(), this->next.end(), this->emptyState);
+    }
+
+    size_t StateField::swap(std::vector<int> &counts, uint8_t *changed)
+    {
+        // update the counts of the cells that changed
+        size_t size = this->current.size();
+        size_t changes = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            uint16_t old = this->current[i];
+            uint16_t now = this->next[i];
+            if (old != now)
+            {
+                changes++;
+                if (old != this->emptyState)
+                {
+                    counts[old] -= 1;
+                }
+                if (now != this->emptyState)
+                {
+                    counts[now] += 1;
+                }
+                if (changed != nullptr)
+                {
+                    changed[i] = 1;
+                }
+            }
+        }
+
+        std::swap(this->current, this->next);
+
+        if (this->nextTouched.exchange(false, std::memory_order_relaxed))
+        {
+            this->touch();
+        }
+
+        // cells that do not get written during the step keep their state
+        std::copy(this->current.begin(), this->current.end(), this->next.begin());
+
+        return changes;
+    }
+
+    /*
+    ███████  ██████  █████  ██       █████  ██████      ███████ ██ ███████ ██      ██████  
+    ██      ██      ██   ██ ██      ██   ██ ██   ██     ██      ██ ██      ██      ██   ██ 
+    ███████ ██      ███████ ██      ███████ ██████      █████   ██ █████   ██      ██   ██ 
+         ██ ██      ██   ██ ██      ██   ██ ██   ██     ██      ██ ██      ██      ██   ██ 
+    ███████  ██████ ██   ██ ███████ ██   ██ ██   ██     ██      ██ ███████ ███████ ██████  
+    */
+
+    ScalarField::ScalarField(Board::SimulatedBoard *board, bool wrap) : stencil(Neighborhood::Stencil::moore(1))
+    {
+        this->board = board;
+        this->width = board->getWidth();
+        this->height = board->getHeight();
+        this->wrap = wrap;
+        this->values = std::vector<float>(static_cast<size_t>(this->width) * this->height, 0.0f);
+        this->scratch = std::vector<float>(this->values.size(), 0.0f);
+    }
+
+    Board::SimulatedBoard *ScalarField::getBoard()
+    {
+        return this->board;
+    }
+
+    int ScalarField::getWidth()
+    {
+        return this->width;
+    }
+
+    int ScalarField::getHeight()
+    {
+        return this->height;
+    }
+
+    bool ScalarField::getWrap()
+    {
+        return this->wrap;
+    }
+
+    float ScalarField::sample(Pos pos)
+    {
+        if (!this->board->pos_resolve(pos, this->wrap))
+        {
+            return 0.0f;
+        }
+        return this->values[pos.toIndex(this->width)];
+    }
+
+    void ScalarField::deposit(Pos pos, float amount)
+    {
+        if (!this->board->pos_resolve(pos, this->wrap))
+        {
+            throw std::out_of_range("Position out of range when depositing on a scalar field. (Pos given: " + pos.toString() + ")");
+        }
+        this->values[pos.toIndex(this->width)] += amount;
+    }
+
+    void ScalarField::deposit_layer(int layer, float amount, uint16_t state)
+    {
+        if (layer < 0 || layer >= this->board->getLayerCount())
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+
+        auto board = this->board;
+        float *values = this->values.data();
+        int width = this->width;
+        board->parallel_for(this->height, 0, [&](size_t begin, size_t end) {
+            for (int index = static_cast<int>(begin) * width; index < static_cast<int>(end) * width; index++)
+            {
+                if (board->cell_occupied_at(layer, index) && (state == StateRegistry::NONE || board->cell_state(layer, index) == state))
+                {
+                    values[index] += amount;
+                }
+            }
+        });
+    }
+
+    void ScalarField::fill(float value)
+    {
+        std::fill(this->values.begin(), this->values.end(), value);
+    }
+
+    double ScalarField::total()
+    {
+        double sum = 0;
+        for (float value : this->values)
+        {
+            sum += value;
+        }
+        return sum;
+    }
+
+    void ScalarField::diffuse(float rate, const Neighborhood::Stencil &stencil)
+    {
+        if (rate < 0 || rate > 1)
+        {
+            throw std::invalid_argument("The diffusion rate must be between 0 and 1");
+        }
+        if (rate == 0 || stencil.size() == 0)
+        {
+            return;
+        }
+        this->diffuse_scaled(rate, stencil, 1.0f);
+    }
+
+    void ScalarField::diffuse_scaled(float rate, const Neighborhood::Stencil &stencil, float scale)
+    {
+        int width = this->width;
+        int height = this->height;
+        bool wrap = this->wrap;
+        const float *values = this->values.data();
+        float *out = this->scratch.data();
+        float keep = (1.0f - rate) * scale;
+
+        // every row only writes itself, and adds whole shifted rows (so the inner loops vectorize)
+        this->board->parallel_for(height, 0, [&](size_t begin, size_t end) {
+            for (int y = static_cast<int>(begin); y < static_cast<int>(end); y++)
+            {
+                const auto &offsets = stencil.getOffsets(y);
+                float share = rate * scale / static_cast<float>(offsets.size());
+                const float *center = values + static_cast<size_t>(y) * width;
+                float *row = out + static_cast<size_t>(y) * width;
+                for (int x = 0; x < width; x++)
+                {
+                    row[x] = keep * center[x];
+                }
+
+                for (auto &offset : offsets)
+                {
+                    int sourceY = y + offset.y;
+                    if (sourceY < 0 || sourceY >= height)
+                    {
+                        if (!wrap)
+                        {
+                            // outside of the board: the cell gets its own share back
+                            for (int x = 0; x < width; x++)
+                            {
+                                row[x] += share * center[x];
+                            }
+                            continue;
+                        }
+                        sourceY = ((sourceY % height) + height) % height;
+                    }
+                    const float *source = values + static_cast<size_t>(sourceY) * width;
+
+                    int dx = offset.x;
+                    int first = std::max(0, -dx);
+                    int last = std::min(width, width - dx);
+                    for (int x = first; x < last; x++)
+                    {
+                        row[x] += share * source[x + dx];
+                    }
+                    // the columns that fall outside of the board
+                    for (int x = 0; x < first; x++)
+                    {
+                        row[x] += share * (wrap ? source[(((x + dx) % width) + width) % width] : center[x]);
+                    }
+                    for (int x = std::max(first, last); x < width; x++)
+                    {
+                        row[x] += share * (wrap ? source[(((x + dx) % width) + width) % width] : center[x]);
+                    }
+                }
+            }
+        });
+
+        // copy back instead of swapping, so views of the values stay valid
+        std::copy(this->scratch.begin(), this->scratch.end(), this->values.begin());
+    }
+
+    void ScalarField::evaporate(float rate)
+    {
+        if (rate < 0 || rate > 1)
+        {
+            throw std::invalid_argument("The evaporation rate must be between 0 and 1");
+        }
+        if (rate == 0)
+        {
+            return;
+        }
+
+        float keep = 1.0f - rate;
+        float *values = this->values.data();
+        int width = this->width;
+        this->board->parallel_for(this->height, 0, [&](size_t begin, size_t end) {
+            for (size_t i = begin * width; i < end * width; i++)
+            {
+                values[i] *= keep;
+            }
+        });
+    }
+
+    std::array<float, 2> ScalarField::gradient(Pos pos)
+    {
+        if (!this->board->pos_resolve(pos, this->wrap))
+        {
+            throw std::out_of_range("Position out of range when sampling a scalar field. (Pos given: " + pos.toString() + ")");
+        }
+
+        // cells outside of the board count as the cell itself (one sided difference)
+        float center = this->values[pos.toIndex(this->width)];
+        auto at = [&](int x, int y) {
+            Pos cell(x, y);
+            return this->board->pos_resolve(cell, this->wrap) ? this->values[cell.toIndex(this->width)] : center;
+        };
+        return {
+            (at(pos.x + 1, pos.y) - at(pos.x - 1, pos.y)) * 0.5f,
+            (at(pos.x, pos.y + 1) - at(pos.x, pos.y - 1)) * 0.5f,
+        };
+    }
+
+    Pos ScalarField::uphill(Pos pos)
+    {
+        if (!this->board->pos_resolve(pos, this->wrap))
+        {
+            throw std::out_of_range("Position out of range when sampling a scalar field. (Pos given: " + pos.toString() + ")");
+        }
+
+        Pos best = pos;
+        float bestValue = this->values[pos.toIndex(this->width)];
+        static const int AROUND[8][2] = {{-1, 1}, {0, 1}, {1, 1}, {-1, 0}, {1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+        for (auto &offset : AROUND)
+        {
+            Pos cell(pos.x + offset[0], pos.y + offset[1]);
+            if (this->board->pos_resolve(cell, this->wrap) && this->values[cell.toIndex(this->width)] > bestValue)
+            {
+                best = cell;
+                bestValue = this->values[cell.toIndex(this->width)];
+            }
+        }
+        return best;
+    }
+
+    void ScalarField::setRates(float diffusion, float evaporation)
+    {
+        if (diffusion < 0 || diffusion > 1 || evaporation < 0 || evaporation > 1)
+        {
+            throw std::invalid_argument("The rates must be between 0 and 1");
+        }
+        this->diffusion = diffusion;
+        this->evaporation = evaporation;
+    }
+
+    void ScalarField::setStencil(const Neighborhood::Stencil &stencil)
+    {
+        this->stencil = stencil;
+    }
+
+    float ScalarField::getDiffusion()
+    {
+        return this->diffusion;
+    }
+
+    float ScalarField::getEvaporation()
+    {
+        return this->evaporation;
+    }
+
+    void ScalarField::step()
+    {
+        // one pass when both run (evaporating after diffusing is the same as scaling the weights)
+        if (this->diffusion > 0 && this->stencil.size() > 0)
+        {
+            this->diffuse_scaled(this->diffusion, this->stencil, 1.0f - this->evaporation);
+            return;
+        }
+        this->evaporate(this->evaporation);
+    }
+}
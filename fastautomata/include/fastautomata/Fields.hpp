@@ -0,0 +1,395 @@
+/**
+ * @file Fields.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief Dense layers that store a value per cell instead of agents
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#pragma once
+
+#include "ClassTypes.hpp"
+#include "Neighborhood.hpp"
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <atomic>
+
+using namespace fastautomata::ClassTypes;
+
+namespace fastautomata::Board {
+    class SimulatedBoard;
+}
+
+namespace fastautomata::Fields {
+    /**
+     * @brief A layer that stores one state id per cell, double buffered.
+     * 
+     * Rules read the current buffer and write the next one. At the end of the step the buffers get swapped.
+     * Cells in the empty state are treated as if there was no agent (not counted, no collisions).
+     * 
+     */
+    class StateField
+    {
+        private:
+        int width;
+        int height;
+
+        /**
+         * @brief The state that represents an empty cell
+         * 
+         */
+        uint16_t emptyState;
+
+        /**
+         * @brief The states of the current step ([y * width + x])
+         * 
+         */
+        std::vector<uint16_t> current;
+
+        /**
+         * @brief The states that will be used on the next step ([y * width + x])
+         * 
+         */
+        std::vector<uint16_t> next;
+
+        /**
+         * @brief Incremented every time the field gets written from outside a rule engine (see touch())
+         * 
+         */
+        uint64_t revision = 0;
+
+        /**
+         * @brief True if the next buffer got written from outside a rule engine since the last swap (see touch_next())
+         * 
+         */
+        std::atomic<bool> nextTouched{false};
+
+        public:
+        /**
+         * @brief Construct a new State Field object. All the cells start empty.
+         * 
+         * @param width 
+         * @param height 
+         * @param emptyState The state id that represents an empty cell
+         */
+        StateField(int width, int height, uint16_t emptyState);
+
+        /**
+         * @brief Get the state id that represents an empty cell
+         * 
+         * @return uint16_t 
+         */
+        uint16_t getEmptyState();
+
+        int getWidth();
+
+        int getHeight();
+
+        /**
+         * @brief Get the revision of the field. Rule engines that keep their own copy of the field use it to know when to reload it.
+         * 
+         * @return uint64_t 
+         */
+        uint64_t getRevision();
+
+        /**
+         * @brief Mark the field as written from outside a rule engine
+         * 
+         */
+        inline void touch()
+        {
+            this->revision++;
+        }
+
+        /**
+         * @brief Mark the next buffer as written from outside a rule engine. The revision changes on the next swap, once the write is in the current buffer.
+         * 
+         */
+        inline void touch_next()
+        {
+            this->nextTouched.store(true, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the state of a cell in the current buffer. Does not check bounds.
+         * 
+         * @param index The index of the cell (x + y * width)
+         * @return uint16_t 
+         */
+        inline uint16_t get(int index)
+        {
+            return this->current[index];
+        }
+
+        /**
+         * @brief Set the state of a cell in the next buffer. Does not check bounds.
+         * 
+         * @param index The index of the cell (x + y * width)
+         * @param state 
+         */
+        inline void set(int index, uint16_t state)
+        {
+            this->next[index] = state;
+        }
+
+        /**
+         * @brief Check if a cell of the current buffer is not empty. Does not check bounds.
+         * 
+         * @param index The index of the cell (x + y * width)
+         */
+        inline bool occupied(int index)
+        {
+            return this->current[index] != this->emptyState;
+        }
+
+        /**
+         * @brief Raw access to the current buffer (read only for rules)
+         * 
+         * @return const uint16_t* 
+         */
+        inline const uint16_t *current_data()
+        {
+            return this->current.data();
+        }
+
+        /**
+         * @brief Raw access to the next buffer (write only for rules)
+         * 
+         * @return uint16_t* 
+         */
+        inline uint16_t *next_data()
+        {
+            return this->next.data();
+        }
+
+        /**
+         * @brief Set the state of a cell in both buffers, right now. Updates the counts and the revision.
+         * 
+         * @param index The index of the cell (x + y * width)
+         * @param state 
+         * @param counts The state counts of the board
+         */
+        void put(int index, uint16_t state, std::vector<int> &counts);
+
+        /**
+         * @brief Set every cell in both buffers, right now (used to load checkpoints). Updates the counts and the revision.
+         * 
+         * @param cells The states of every cell ([y * width + x])
+         * @param counts The state counts of the board
+         */
+        void assign(const uint16_t *cells, std::vector<int> &counts);
+
+        /**
+         * @brief Empty every cell in both buffers. Does not update the counts, updates the revision.
+         * 
+         */
+        void clear();
+
+        /**
+         * @brief Swap the buffers. Updates the counts with the cells that changed, and leaves next as a copy of the new current.
+         * Updates the revision if the next buffer was written from outside a rule engine.
+         * 
+         * @param counts The state counts of the board
+         * @param changed [optional] If given, the cells that changed get set to 1 (one byte per cell) [default: nullptr]
+         * @return size_t The amount of cells that changed
+         */
+        size_t swap(std::vector<int> &counts, uint8_t *changed = nullptr);
+    };
+
+    /**
+     * @brief A field that stores one float per cell (heat, pheromones, ...). It does not take a layer: agents of any layer can read and write it.
+     * 
+     * The operators work on whole rows (so the inner loops vectorize) and run in parallel with the threads of the board.
+     * The values never move in memory, so python can keep a view of them (see data()). Changes do not wake agents (active scheduling).
+     * 
+     */
+    class ScalarField
+    {
+        private:
+        Board::SimulatedBoard *board;
+        int width;
+        int height;
+
+        /**
+         * @brief If the edges wrap around. If not, cells outside of the board count as the cell itself (nothing leaks out).
+         * 
+         */
+        bool wrap;
+
+        /**
+         * @brief The values ([y * width + x])
+         * 
+         */
+        std::vector<float> values;
+
+        /**
+         * @brief Where diffuse writes before copying back into values ([y * width + x])
+         * 
+         */
+        std::vector<float> scratch;
+
+        /**
+         * @brief The rates and the stencil used by step()
+         * 
+         */
+        float diffusion = 0;
+        float evaporation = 0;
+        Neighborhood::Stencil stencil;
+
+        /**
+         * @brief diffuse, with every result multiplied by scale (does not check the rate)
+         * 
+         */
+        void diffuse_scaled(float rate, const Neighborhood::Stencil &stencil, float scale);
+
+        public:
+        /**
+         * @brief Construct a new Scalar Field. Every cell starts at 0. Use SimulatedBoard::scalar_add instead.
+         * 
+         * @param board The board (its size and threads get used)
+         * @param wrap If the edges wrap around
+         */
+        ScalarField(Board::SimulatedBoard *board, bool wrap);
+
+        Board::SimulatedBoard *getBoard();
+
+        int getWidth();
+
+        int getHeight();
+
+        bool getWrap();
+
+        /**
+         * @brief Get the value of a cell. Does not check bounds.
+         * 
+         * @param index The index of the cell (x + y * width)
+         * @return float 
+         */
+        inline float get(int index)
+        {
+            return this->values[index];
+        }
+
+        /**
+         * @brief Set the value of a cell. Does not check bounds.
+         * 
+         * @param index The index of the cell (x + y * width)
+         * @param value 
+         */
+        inline void set(int index, float value)
+        {
+            this->values[index] = value;
+        }
+
+        /**
+         * @brief Raw access to the values ([y * width + x]). The pointer stays valid for the whole life of the field.
+         * 
+         * @return float* 
+         */
+        inline float *data()
+        {
+            return this->values.data();
+        }
+
+        /**
+         * @brief Get the value at a position
+         * 
+         * @param pos The position (wraps if the field wraps)
+         * @return float 0 if the position is outside the board
+         */
+        float sample(Pos pos);
+
+        /**
+         * @brief Add to the value at a position
+         * 
+         * @param pos The position (wraps if the field wraps)
+         * @param amount 
+         */
+        void deposit(Pos pos, float amount);
+
+        /**
+         * @brief Add to the value of every cell that holds something in a layer (an agent, an entity or a non empty field cell)
+         * 
+         * @param layer The layer to look at
+         * @param amount 
+         * @param state [optional] Only cells in this state [default: StateRegistry::NONE (any state)]
+         */
+        void deposit_layer(int layer, float amount, uint16_t state = StateRegistry::NONE);
+
+        /**
+         * @brief Set every cell to a value
+         * 
+         * @param value 
+         */
+        void fill(float value);
+
+        /**
+         * @brief Get the sum of every cell
+         * 
+         * @return double 
+         */
+        double total();
+
+        /**
+         * @brief Spread the values to the neighbors: each cell keeps (1 - rate) of its value, and gets rate times the mean of its neighbors.
+         * 
+         * With a symmetric stencil the total stays the same.
+         * 
+         * @param rate Between 0 and 1
+         * @param stencil The neighbors
+         */
+        void diffuse(float rate, const Neighborhood::Stencil &stencil);
+
+        /**
+         * @brief Multiply every cell by (1 - rate)
+         * 
+         * @param rate Between 0 and 1
+         */
+        void evaporate(float rate);
+
+        /**
+         * @brief Get the gradient at a position (central differences)
+         * 
+         * @param pos The position (must be inside the board, or wrap)
+         * @return std::array<float, 2> The change of the value along x and y
+         */
+        std::array<float, 2> gradient(Pos pos);
+
+        /**
+         * @brief Get the cell around pos (8 neighbors) with the highest value
+         * 
+         * @param pos The position (must be inside the board, or wrap)
+         * @return Pos pos itself if no neighbor is higher
+         */
+        Pos uphill(Pos pos);
+
+        /**
+         * @brief Set what step() does
+         * 
+         * @param diffusion The rate of diffuse (0 to skip it)
+         * @param evaporation The rate of evaporate (0 to skip it)
+         */
+        void setRates(float diffusion, float evaporation);
+
+        /**
+         * @brief Set the neighbors used by step() to diffuse. The default is moore(1).
+         * 
+         * @param stencil 
+         */
+        void setStencil(const Neighborhood::Stencil &stencil);
+
+        float getDiffusion();
+
+        float getEvaporation();
+
+        /**
+         * @brief Diffuse and then evaporate with the rates of the field. Called every step by the board.
+         * 
+         */
+        void step();
+    };
+}
@@ -0,0 +1,210 @@
+#include "FlowField.hpp"
+#include "Board.hpp"
+#include <stdexcept>
+
+namespace fastautomata::Paths {
+    FlowField::FlowField(Board::SimulatedBoard *board, std::vector<int> targets, int layer, bool diagonal, bool wrap)
+    {
+        this->board = board;
+        this->targets = targets;
+        this->layer = layer;
+        this->diagonal = diagonal;
+        this->wrap = wrap;
+        this->width = board->getWidth();
+        this->height = board->getHeight();
+
+        size_t cells = static_cast<size_t>(this->width) * this->height;
+        this->distances = std::vector<int32_t>(cells, UNREACHABLE);
+        this->next = std::vector<int32_t>(cells, 0);
+        this->walls = std::vector<uint8_t>(cells, 0);
+        this->layer_revisions = std::vector<uint64_t>(board->getLayerCount(), ~uint64_t(0));
+    }
+
+    bool FlowField::read_walls()
+    {
+        auto board = this->board;
+        bool changed = false;
+        for (int i = 0; i < static_cast<int>(this->walls.size()); i++)
+        {
+            Pos pos(i % this->width, i / this->width);
+            uint8_t wall = board->move_blocked(pos, this->layer, false) || board->cell_static(this->layer, i);
+            changed = changed || wall != this->walls[i];
+            this->walls[i] = wall;
+        }
+        return changed;
+    }
+
+    void FlowField::update()
+    {
+        // nothing changed since the last check (the usual case, no lock needed)
+        uint64_t cells = this->board->getCellsRevision();
+        if (this->checked_cells.load(std::memory_order_acquire) == cells && this->checked_collisions.load(std::memory_order_relaxed) == this->board->layer_collisions.getRevision())
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->checked_cells.load(std::memory_order_relaxed) == cells && this->checked_collisions.load(std::memory_order_relaxed) == this->board->layer_collisions.getRevision())
+        {
+            return;
+        }
+
+        // only the layers that can hold walls matter. In the walking layer only static agents are walls, so agents moving in it do not count.
+        bool first = this->computations == 0;
+        bool layersChanged = first || this->checked_collisions.load(std::memory_order_relaxed) != this->board->layer_collisions.getRevision();
+        for (int searchLayer = 0; searchLayer < this->board->getLayerCount(); searchLayer++)
+        {
+            bool self = searchLayer == this->layer;
+            bool solid = self || this->board->layer_collisions.getCollision(this->layer, searchLayer) == CollisionType::SOLID;
+            uint64_t revision = self ? this->board->getStaticRevision(searchLayer) : this->board->getLayerRevision(searchLayer);
+            if (solid && revision != this->layer_revisions[searchLayer])
+            {
+                layersChanged = true;
+            }
+            this->layer_revisions[searchLayer] = revision;
+        }
+
+        // the walls might still be the same (agents moving in a SOLID layer only change the cells they leave and enter)
+        if (layersChanged && (this->read_walls() || first))
+        {
+            this->compute();
+        }
+
+        this->checked_collisions.store(this->board->layer_collisions.getRevision(), std::memory_order_relaxed);
+        this->checked_cells.store(cells, std::memory_order_release);
+    }
+
+    void FlowField::compute()
+    {
+        int width = this->width;
+        int height = this->height;
+        std::fill(this->distances.begin(), this->distances.end(), UNREACHABLE);
+
+        static const int ORTHOGONAL[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        static const int ALL[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {-1, 1}, {1, -1}, {-1, -1}};
+        const int (*moves)[2] = this->diagonal ? ALL : ORTHOGONAL;
+        int moveCount = this->diagonal ? 8 : 4;
+
+        // every move costs the same, so a breadth first search from every target at once gives the shortest distances
+        std::vector<int32_t> queue;
+        queue.reserve(this->distances.size());
+        for (int target : this->targets)
+        {
+            if (!this->walls[target] && this->distances[target] == UNREACHABLE)
+            {
+                this->distances[target] = 0;
+                queue.push_back(target);
+            }
+        }
+
+        for (size_t head = 0; head < queue.size(); head++)
+        {
+            int cell = queue[head];
+            int x = cell % width;
+            int y = cell / width;
+            int32_t distance = this->distances[cell] + 1;
+            for (int m = 0; m < moveCount; m++)
+            {
+                int nx = x + moves[m][0];
+                int ny = y + moves[m][1];
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                {
+                    if (!this->wrap)
+                    {
+                        continue;
+                    }
+                    nx = (nx + width) % width;
+                    ny = (ny + height) % height;
+                }
+                int neighbor = nx + ny * width;
+                if (!this->walls[neighbor] && this->distances[neighbor] == UNREACHABLE)
+                {
+                    this->distances[neighbor] = distance;
+                    queue.push_back(neighbor);
+                }
+            }
+        }
+
+        // the move of each cell: the first neighbor (in move order) that is one step closer
+        for (int cell = 0; cell < static_cast<int>(this->distances.size()); cell++)
+        {
+            this->next[cell] = cell;
+            int32_t distance = this->distances[cell];
+            if (distance <= 0)
+            {
+                continue;
+            }
+            int x = cell % width;
+            int y = cell / width;
+            for (int m = 0; m < moveCount; m++)
+            {
+                int nx = x + moves[m][0];
+                int ny = y + moves[m][1];
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                {
+                    if (!this->wrap)
+                    {
+                        continue;
+                    }
+                    nx = (nx + width) % width;
+                    ny = (ny + height) % height;
+                }
+                int neighbor = nx + ny * width;
+                if (this->distances[neighbor] == distance - 1)
+                {
+                    this->next[cell] = neighbor;
+                    break;
+                }
+            }
+        }
+
+        this->computations++;
+    }
+
+    int32_t FlowField::getDistance(Pos pos)
+    {
+        if (!this->board->pos_resolve(pos, this->wrap))
+        {
+            return UNREACHABLE;
+        }
+        this->update();
+        return this->distances[pos.toIndex(this->width)];
+    }
+
+    Pos FlowField::next_step(Pos pos)
+    {
+        if (!this->board->pos_resolve(pos, this->wrap))
+        {
+            return pos;
+        }
+        this->update();
+        int cell = this->next[pos.toIndex(this->width)];
+        return Pos(cell % this->width, cell / this->width);
+    }
+
+    const int32_t *FlowField::data()
+    {
+        this->update();
+        return this->distances.data();
+    }
+
+    int FlowField::getLayer()
+    {
+        return this->layer;
+    }
+
+    int FlowField::getWidth()
+    {
+        return this->width;
+    }
+
+    int FlowField::getHeight()
+    {
+        return this->height;
+    }
+
+    uint64_t FlowField::getComputations()
+    {
+        return this->computations;
+    }
+}
@@ -0,0 +1,162 @@
+/**
+ * @file FlowField.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief Distance fields (flow fields) to a set of targets, shared by every agent that walks to them
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include "ClassTypes.hpp"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+using namespace fastautomata::ClassTypes;
+
+namespace fastautomata::Board {
+    class SimulatedBoard;
+}
+
+namespace fastautomata::Paths {
+    /**
+     * @brief The distance (in moves) from every cell of a layer to the closest target, and the move to make from each cell.
+     *
+     * Walls are the cells the layer can not move to: cells of layers it has a SOLID collision with, and static agents of its own layer.
+     * Other agents of the layer are not walls (they move). The walls get read again (one pass over the cells) when a SOLID layer changes, or a static agent
+     * of the walking layer gets added, removed or moved. Agents moving in the walking layer do not trigger it. The distances only get recomputed if the walls changed.
+     *
+     * Created (and cached) by SimulatedBoard::flow_field, shared with python. Reads can run from agents stepped in parallel.
+     */
+    class FlowField
+    {
+        public:
+        /**
+         * @brief The distance of cells that can not reach any target
+         *
+         */
+        static constexpr int32_t UNREACHABLE = -1;
+
+        private:
+        Board::SimulatedBoard *board;
+        int layer;
+        bool diagonal;
+        bool wrap;
+
+        int width;
+        int height;
+
+        /**
+         * @brief The target cells (x + y * width), sorted
+         *
+         */
+        std::vector<int> targets;
+
+        /**
+         * @brief The distance of each cell ([y * width + x])
+         *
+         */
+        std::vector<int32_t> distances;
+
+        /**
+         * @brief The cell to move to from each cell ([y * width + x]). The cell itself for targets and unreachable cells.
+         *
+         */
+        std::vector<int32_t> next;
+
+        /**
+         * @brief The walls the field was computed with ([y * width + x])
+         *
+         */
+        std::vector<uint8_t> walls;
+
+        /**
+         * @brief The revisions of the board (cells and collisions) the field was checked against
+         *
+         */
+        std::atomic<uint64_t> checked_cells{~uint64_t(0)};
+        std::atomic<uint64_t> checked_collisions{~uint64_t(0)};
+
+        /**
+         * @brief The revision of each layer the walls were read with ([layer]). The static revision for the walking layer.
+         *
+         */
+        std::vector<uint64_t> layer_revisions;
+
+        uint64_t computations = 0;
+
+        std::mutex mutex;
+
+        /**
+         * @brief Read the walls from the board
+         *
+         * @return true if they changed
+         */
+        bool read_walls();
+
+        /**
+         * @brief Compute the distances (breadth first search from every target at once) and the moves
+         *
+         */
+        void compute();
+
+        public:
+        /**
+         * @brief Construct a new Flow Field. Use SimulatedBoard::flow_field instead (it caches the fields).
+         *
+         * @param board The board
+         * @param targets The target cells (x + y * width)
+         * @param layer The layer that walks
+         * @param diagonal If true, agents can move to the 8 cells around them. If false, only to the 4 orthogonal ones.
+         * @param wrap If the edges of the board wrap around
+         */
+        FlowField(Board::SimulatedBoard *board, std::vector<int> targets, int layer, bool diagonal, bool wrap);
+
+        /**
+         * @brief Make sure the field matches the board. Called by every query, only does work if the board changed.
+         *
+         */
+        void update();
+
+        /**
+         * @brief Get the distance (in moves) from a cell to the closest target
+         *
+         * @param pos The cell
+         * @return int32_t UNREACHABLE if no target can be reached (or pos is outside the board)
+         */
+        int32_t getDistance(Pos pos);
+
+        /**
+         * @brief Get the cell to move to, to get closer to a target
+         *
+         * @param pos The current cell
+         * @return Pos pos itself if it is a target, or no target can be reached
+         */
+        Pos next_step(Pos pos);
+
+        /**
+         * @brief Get the distance of every cell ([y * width + x]). Valid until the next change of the board.
+         *
+         * @return const int32_t*
+         */
+        const int32_t *data();
+
+        int getLayer();
+
+        int getWidth();
+
+        int getHeight();
+
+        /**
+         * @brief Get the amount of times the distances got computed
+         *
+         * @return uint64_t
+         */
+        uint64_t getComputations();
+    };
+}
@@ -0,0 +1,106 @@
+/**
+ * @file Journal.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief The changes of a board (agents and entities added, removed, moved, ...) as one compact list per step
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace fastautomata::Journal {
+    /**
+     * @brief What happened to the agent (or entity) of a change
+     *
+     */
+    enum ChangeKind : uint8_t
+    {
+        /**
+         * @brief Added to the board (the old values are the same as the new ones)
+         *
+         */
+        ADD,
+        /**
+         * @brief Deleted from the board (the new values are the same as the old ones)
+         *
+         */
+        REMOVE,
+        /**
+         * @brief Moved to another cell
+         *
+         */
+        MOVE,
+        /**
+         * @brief Changed state
+         *
+         */
+        STATE,
+        /**
+         * @brief Moved to another layer
+         *
+         */
+        LAYER,
+        /**
+         * @brief The board got reset, every agent and entity before this change is gone (the id is -1)
+         *
+         */
+        RESET,
+    };
+
+    /**
+     * @brief The agents are the Agent and BaseAgent objects, the entities live in the AgentStore. Both have their own ids.
+     *
+     */
+    enum ChangeEntity : uint8_t
+    {
+        AGENT,
+        ENTITY,
+    };
+
+    /**
+     * @brief One change of the board. Plain data, so a list of them can be copied as is (to numpy, to a file, ...).
+     *
+     */
+    struct Change
+    {
+        /**
+         * @brief The step of the board when the change happened (changes made during step n have step n)
+         *
+         */
+        int32_t step;
+
+        /**
+         * @brief The id of the agent or entity
+         *
+         */
+        int32_t id;
+
+        int32_t x_old;
+        int32_t y_old;
+        int32_t x_new;
+        int32_t y_new;
+
+        uint16_t state_old;
+        uint16_t state_new;
+
+        int16_t layer_old;
+        int16_t layer_new;
+
+        /**
+         * @brief A ChangeKind
+         *
+         */
+        uint8_t kind;
+
+        /**
+         * @brief A ChangeEntity
+         *
+         */
+        uint8_t entity;
+    };
+}
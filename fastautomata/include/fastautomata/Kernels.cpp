@@ -0,0 +1,253 @@
+#include "Kernels.hpp"
+#include "Board.hpp"
+#include <cstddef>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+// the layout is part of the ABI (see fastautomata_capi.h), changing it needs a new FASTAUTOMATA_CAPI_VERSION
+static_assert(sizeof(void *) != 8 || sizeof(fa_board) == 88, "The layout of fa_board changed");
+static_assert(sizeof(void *) != 8 || offsetof(fa_board, cells) == 24, "The layout of fa_board changed");
+static_assert(sizeof(void *) != 8 || offsetof(fa_board, random) == 80, "The layout of fa_board changed");
+static_assert(sizeof(void *) != 8 || sizeof(fa_agent) == 48, "The layout of fa_agent changed");
+static_assert(offsetof(fa_agent, state) == 24 && offsetof(fa_agent, moves) == 28, "The layout of fa_agent changed");
+static_assert(FA_STATE_NONE == fastautomata::ClassTypes::StateRegistry::NONE, "FA_STATE_NONE must match StateRegistry::NONE");
+
+namespace fastautomata::Kernels {
+    /*
+     ██████      █████  ██████  ██
+    ██          ██   ██ ██   ██ ██
+    ██          ███████ ██████  ██
+    ██          ██   ██ ██      ██
+     ██████     ██   ██ ██      ██
+    */
+
+    // the functions of the views: nothing may throw through a kernel
+
+    static uint16_t capi_cell_state(void *handle, int32_t layer, int32_t x, int32_t y)
+    {
+        auto board = static_cast<Board::SimulatedBoard *>(handle);
+        if (layer < 0 || layer >= board->getLayerCount() || x < 0 || y < 0 || x >= board->getWidth() || y >= board->getHeight())
+        {
+            return StateRegistry::NONE;
+        }
+        return board->cell_state(layer, x + y * board->getWidth());
+    }
+
+    static uint16_t capi_state_id(void *handle, const char *name)
+    {
+        auto board = static_cast<Board::SimulatedBoard *>(handle);
+        int state = name != nullptr ? board->states.find(name) : -1;
+        return state == -1 ? StateRegistry::NONE : static_cast<uint16_t>(state);
+    }
+
+    static int32_t capi_field_set(void *handle, int32_t layer, int32_t x, int32_t y, uint16_t state)
+    {
+        auto board = static_cast<Board::SimulatedBoard *>(handle);
+        try
+        {
+            board->field_set_id(Pos(x, y), state, layer);
+        }
+        catch (const std::exception &)
+        {
+            return -1;
+        }
+        return 0;
+    }
+
+    static int32_t capi_agent_set_state(void *handle, int32_t id, uint16_t state)
+    {
+        auto board = static_cast<Board::SimulatedBoard *>(handle);
+        auto agent = dynamic_cast<Agents::Agent *>(board->agent_by_id(id));
+        if (agent == nullptr || state >= board->states.size())
+        {
+            return -1;
+        }
+        agent->setStateId(state);
+        return 0;
+    }
+
+    static int32_t capi_agent_set_pos(void *handle, int32_t id, int32_t x, int32_t y)
+    {
+        auto board = static_cast<Board::SimulatedBoard *>(handle);
+        auto agent = dynamic_cast<Agents::Agent *>(board->agent_by_id(id));
+        if (agent == nullptr)
+        {
+            return -1;
+        }
+        agent->setPos(Pos(x, y));
+        return 0;
+    }
+
+    static double capi_board_random(void *handle)
+    {
+        return static_cast<Board::SimulatedBoard *>(handle)->random();
+    }
+
+    static double capi_agent_random(void *handle)
+    {
+        return static_cast<KernelAgent *>(handle)->random();
+    }
+
+    // what agent kernels get instead of the functions that write the board
+
+    static int32_t capi_refuse_field_set(void *handle, int32_t layer, int32_t x, int32_t y, uint16_t state)
+    {
+        return -1;
+    }
+
+    static int32_t capi_refuse_agent_set_state(void *handle, int32_t id, uint16_t state)
+    {
+        return -1;
+    }
+
+    static int32_t capi_refuse_agent_set_pos(void *handle, int32_t id, int32_t x, int32_t y)
+    {
+        return -1;
+    }
+
+    static double capi_refuse_random(void *handle)
+    {
+        return -1;
+    }
+
+    fa_board board_view(Board::SimulatedBoard *board)
+    {
+        fa_board view;
+        view.version = FASTAUTOMATA_CAPI_VERSION;
+        view.width = board->getWidth();
+        view.height = board->getHeight();
+        view.layers = board->getLayerCount();
+        view.step = board->getStepCount();
+        view.cells = nullptr;
+        view.handle = board;
+        view.cell_state = capi_cell_state;
+        view.state_id = capi_state_id;
+        view.field_set = capi_field_set;
+        view.agent_set_state = capi_agent_set_state;
+        view.agent_set_pos = capi_agent_set_pos;
+        view.random = capi_board_random;
+        return view;
+    }
+
+    fa_board agent_view(Board::SimulatedBoard *board)
+    {
+        fa_board view = board_view(board);
+        view.field_set = capi_refuse_field_set;
+        view.agent_set_state = capi_refuse_agent_set_state;
+        view.agent_set_pos = capi_refuse_agent_set_pos;
+        view.random = capi_refuse_random;
+        return view;
+    }
+
+    void *symbol_load(const std::string &path, const std::string &symbol)
+    {
+#ifdef _WIN32
+        HMODULE library = LoadLibraryA(path.c_str());
+        if (library == nullptr)
+        {
+            throw std::invalid_argument("Could not load the library " + path);
+        }
+        void *address = reinterpret_cast<void *>(GetProcAddress(library, symbol.c_str()));
+#else
+        // RTLD_NODELETE keeps the kernels valid even if something else closes the library
+        void *library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL | RTLD_NODELETE);
+        if (library == nullptr)
+        {
+            throw std::invalid_argument("Could not load the library " + path + ": " + dlerror());
+        }
+        void *address = dlsym(library, symbol.c_str());
+#endif
+        if (address == nullptr)
+        {
+            throw std::invalid_argument("The library " + path + " does not have a function named " + symbol);
+        }
+        return address;
+    }
+
+    /*
+    ██   ██ ███████ ██████  ███    ██ ███████ ██          █████   ██████  ███████ ███    ██ ████████
+    ██  ██  ██      ██   ██ ████   ██ ██      ██         ██   ██ ██       ██      ████   ██    ██
+    █████   █████   ██████  ██ ██  ██ █████   ██         ███████ ██   ███ █████   ██ ██  ██    ██
+    ██  ██  ██      ██   ██ ██  ██ ██ ██      ██         ██   ██ ██    ██ ██      ██  ██ ██    ██
+    ██   ██ ███████ ██   ██ ██   ████ ███████ ███████    ██   ██  ██████  ███████ ██   ████    ██
+    */
+
+    KernelAgent::KernelAgent() : Agents::Agent()
+    {
+
+    }
+
+    KernelAgent::KernelAgent(Board::SimulatedBoard *board, Pos pos, std::string state, int layer, fa_agent_kernel kernel, void *userData, bool allowOverriding)
+    {
+        this->board = board;
+        this->pos = pos;
+        this->layer = layer;
+        this->state = board->state_id(state);
+        this->kernel = kernel;
+        this->userData = userData;
+
+        this->board->agent_add(this, allowOverriding);
+    }
+
+    void KernelAgent::setKernel(fa_agent_kernel kernel, void *userData)
+    {
+        this->kernel = kernel;
+        this->userData = userData;
+    }
+
+    fa_agent_kernel KernelAgent::getKernel()
+    {
+        return this->kernel;
+    }
+
+    void KernelAgent::step()
+    {
+        if (this->kernel == nullptr)
+        {
+            return;
+        }
+
+        // the shared view only changes with the step
+        fa_board board = *this->board->kernel_board(true);
+        board.step = this->board->getStepCount();
+
+        fa_agent agent;
+        agent.id = this->getId();
+        agent.x = this->pos.x;
+        agent.y = this->pos.y;
+        agent.layer = this->layer;
+        agent.x_next = this->pos.x;
+        agent.y_next = this->pos.y;
+        agent.state = this->state;
+        agent.state_next = StateRegistry::NONE;
+        agent.moves = 0;
+        agent.wake = 0;
+        agent.handle = this;
+        agent.random = capi_agent_random;
+
+        this->kernel(&board, &agent, this->userData);
+
+        if (agent.state_next != StateRegistry::NONE && agent.state_next < this->board->states.size())
+        {
+            this->setStateId(agent.state_next);
+        }
+        if (agent.moves)
+        {
+            this->setPos(Pos(agent.x_next, agent.y_next));
+        }
+        if (agent.wake)
+        {
+            this->wake();
+        }
+    }
+
+    bool KernelAgent::isNative()
+    {
+        return true;
+    }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file Kernels.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief Step kernels compiled outside of fastautomata (C function pointers, see fastautomata_capi.h)
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include "ClassTypes.hpp"
+#include "Agents.hpp"
+#include "fastautomata_capi.h"
+#include <string>
+
+using namespace fastautomata::ClassTypes;
+
+namespace fastautomata::Board {
+    class SimulatedBoard;
+}
+
+namespace fastautomata::Kernels {
+    /**
+     * @brief A board kernel and the pointer it gets called with
+     *
+     */
+    struct BoardKernel
+    {
+        fa_board_kernel function;
+        void *userData;
+    };
+
+    /**
+     * @brief Build the view of a board given to kernels (see fa_board)
+     *
+     * @param board The board
+     * @return fa_board
+     */
+    fa_board board_view(Board::SimulatedBoard *board);
+
+    /**
+     * @brief Build the view of a board given to agent kernels. Agent kernels run in parallel, so the functions that write the board
+     * (or draw from its generator) only return errors: field_set, agent_set_state and agent_set_pos return -1, random returns -1.
+     *
+     * @param board The board
+     * @return fa_board
+     */
+    fa_board agent_view(Board::SimulatedBoard *board);
+
+    /**
+     * @brief Get a function from a shared library (dlopen on linux and mac, LoadLibrary on windows). The library stays loaded.
+     *
+     * @param path The path of the library
+     * @param symbol The name of the function (declare it extern "C" in c++)
+     * @return void* The address of the function
+     */
+    void *symbol_load(const std::string &path, const std::string &symbol);
+
+    /**
+     * @brief A simulated agent stepped by a C function (see fa_agent_kernel) instead of step().
+     *
+     * The kernel gets a view of the agent and writes the state and move it wants, which get queued like setStateId and setPos.
+     * It does not call into python, so kernel agents are native (stepped in parallel, without the GIL).
+     */
+    class KernelAgent: public Agents::Agent
+    {
+        private:
+        fa_agent_kernel kernel = nullptr;
+        void *userData = nullptr;
+
+        public:
+        KernelAgent();
+        KernelAgent(Board::SimulatedBoard *board, Pos pos, std::string state, int layer, fa_agent_kernel kernel, void *userData = nullptr, bool allowOverriding = false);
+
+        /**
+         * @brief Change the kernel of the agent
+         *
+         * @param kernel The function that steps the agent (nullptr to do nothing)
+         * @param userData [optional] The pointer the kernel gets called with [default: nullptr]
+         */
+        void setKernel(fa_agent_kernel kernel, void *userData = nullptr);
+
+        fa_agent_kernel getKernel();
+
+        void step() override;
+        bool isNative() override;
+    };
+}
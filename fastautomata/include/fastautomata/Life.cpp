@@ -0,0 +1,297 @@
+#include "Life.hpp"
+#include <stdexcept>
+#include <cctype>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace fastautomata::Life {
+    /**
+     * @brief Index of the lowest set bit (word must not be 0)
+     * 
+     */
+    static inline int lowestBit(uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    static inline int popCount(uint64_t word)
+    {
+#ifdef _MSC_VER
+        return static_cast<int>(__popcnt64(word));
+#else
+        return __builtin_popcountll(word);
+#endif
+    }
+
+    /*
+    ██      ██ ███████ ███████ 
+    ██      ██ ██      ██      
+    ██      ██ █████   █████   
+    ██      ██ ██      ██      
+    ███████ ██ ██      ███████ 
+    */
+
+    LifeRule::LifeRule(Fields::StateField *field, std::string rule, bool wrap, uint16_t aliveState, uint16_t deadState)
+    {
+        this->field = field;
+        this->width = field->getWidth();
+        this->height = field->getHeight();
+        this->rowWords = (this->width + 63) / 64;
+        this->lastMask = (this->width % 64 == 0) ? ~0ULL : ((1ULL << (this->width % 64)) - 1);
+        this->wrap = wrap;
+        this->aliveState = aliveState;
+        this->deadState = deadState;
+
+        this->parse(rule);
+        this->rule = rule;
+
+        this->cells = std::vector<uint64_t>(static_cast<size_t>(this->rowWords) * this->height, 0);
+        this->cellsNext = std::vector<uint64_t>(static_cast<size_t>(this->rowWords) * this->height, 0);
+
+        // force a pack on the first step
+        this->revision = field->getRevision() - 1;
+    }
+
+    void LifeRule::parse(std::string rule)
+    {
+        for (int i = 0; i < 9; i++)
+        {
+            this->birth[i] = false;
+            this->survive[i] = false;
+        }
+
+        bool hasLetters = false;
+        for (char c : rule)
+        {
+            if (std::toupper(c) == 'B' || std::toupper(c) == 'S')
+            {
+                hasLetters = true;
+            }
+        }
+
+        // "23/3" is the classic survive/birth notation
+        bool *target = hasLetters ? nullptr : this->survive;
+        bool seenSlash = false;
+
+        for (char c : rule)
+        {
+            char upper = std::toupper(c);
+            if (upper == 'B')
+            {
+                target = this->birth;
+            }
+            else if (upper == 'S')
+            {
+                target = this->survive;
+            }
+            else if (c == '/')
+            {
+                if (!hasLetters)
+                {
+                    if (seenSlash)
+                    {
+                        throw std::invalid_argument("Invalid rulestring '" + rule + "'");
+                    }
+                    target = this->birth;
+                }
+                seenSlash = true;
+            }
+            else if (c >= '0' && c <= '8' && target != nullptr)
+            {
+                target[c - '0'] = true;
+            }
+            else if (c != ' ')
+            {
+                throw std::invalid_argument("Invalid rulestring '" + rule + "' (expected something like 'B3/S23')");
+            }
+        }
+
+        if (!hasLetters && !seenSlash)
+        {
+            throw std::invalid_argument("Invalid rulestring '" + rule + "' (expected something like 'B3/S23')");
+        }
+    }
+
+    void LifeRule::pack()
+    {
+        std::fill(this->cells.begin(), this->cells.end(), 0);
+
+        const uint16_t *states = this->field->current_data();
+        for (int y = 0; y < this->height; y++)
+        {
+            uint64_t *row = &this->cells[static_cast<size_t>(y) * this->rowWords];
+            const uint16_t *stateRow = states + static_cast<size_t>(y) * this->width;
+            for (int x = 0; x < this->width; x++)
+            {
+                if (stateRow[x] == this->aliveState)
+                {
+                    row[x >> 6] |= 1ULL << (x & 63);
+                }
+            }
+        }
+
+        this->revision = this->field->getRevision();
+    }
+
+    void LifeRule::shift(const uint64_t *row, uint64_t *west, uint64_t *east)
+    {
+        int last = this->rowWords - 1;
+        int lastBit = (this->width - 1) & 63;
+
+        // west[x] = row[x - 1]
+        for (int k = 0; k < this->rowWords; k++)
+        {
+            uint64_t carry = k > 0 ? row[k - 1] >> 63 : 0;
+            west[k] = (row[k] << 1) | carry;
+        }
+        // east[x] = row[x + 1]
+        for (int k = 0; k < this->rowWords; k++)
+        {
+            uint64_t carry = k < last ? row[k + 1] << 63 : 0;
+            east[k] = (row[k] >> 1) | carry;
+        }
+
+        if (this->wrap)
+        {
+            west[0] |= (row[last] >> lastBit) & 1ULL;
+            east[last] |= (row[0] & 1ULL) << lastBit;
+        }
+        west[last] &= this->lastMask;
+    }
+
+    void LifeRule::step()
+    {
+        // something else wrote the field, reload it
+        if (this->revision != this->field->getRevision())
+        {
+            this->pack();
+        }
+
+        int words = this->rowWords;
+        std::vector<uint64_t> zero(words, 0);
+        std::vector<uint64_t> shifted(static_cast<size_t>(words) * 6);
+        uint64_t *upW = &shifted[0];
+        uint64_t *upE = &shifted[words];
+        uint64_t *midW = &shifted[words * 2];
+        uint64_t *midE = &shifted[words * 3];
+        uint64_t *downW = &shifted[words * 4];
+        uint64_t *downE = &shifted[words * 5];
+
+        // the counts that matter, so each word only checks those
+        int birthCounts[9], surviveCounts[9];
+        int birthLen = 0, surviveLen = 0;
+        for (int n = 0; n < 9; n++)
+        {
+            if (this->birth[n]) birthCounts[birthLen++] = n;
+            if (this->survive[n]) surviveCounts[surviveLen++] = n;
+        }
+
+        for (int y = 0; y < this->height; y++)
+        {
+            const uint64_t *up;
+            const uint64_t *down;
+            const uint64_t *mid = &this->cells[static_cast<size_t>(y) * words];
+
+            // rows are indexed top to bottom in memory, neighbors are the same either way
+            if (y > 0)
+                up = &this->cells[static_cast<size_t>(y - 1) * words];
+            else
+                up = this->wrap ? &this->cells[static_cast<size_t>(this->height - 1) * words] : zero.data();
+
+            if (y < this->height - 1)
+                down = &this->cells[static_cast<size_t>(y + 1) * words];
+            else
+                down = this->wrap ? &this->cells[0] : zero.data();
+
+            this->shift(up, upW, upE);
+            this->shift(mid, midW, midE);
+            this->shift(down, downW, downE);
+
+            uint64_t *out = &this->cellsNext[static_cast<size_t>(y) * words];
+            for (int k = 0; k < words; k++)
+            {
+                const uint64_t neighbors[8] = {upW[k], up[k], upE[k], midW[k], midE[k], downW[k], down[k], downE[k]};
+
+                // bit sliced counter: every bit position holds its own 4 bit neighbor count
+                uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+                for (int i = 0; i < 8; i++)
+                {
+                    uint64_t a = neighbors[i];
+                    uint64_t c0 = s0 & a;
+                    s0 ^= a;
+                    uint64_t c1 = s1 & c0;
+                    s1 ^= c0;
+                    uint64_t c2 = s2 & c1;
+                    s2 ^= c1;
+                    s3 |= c2;
+                }
+
+                uint64_t born = 0;
+                for (int i = 0; i < birthLen; i++)
+                {
+                    int n = birthCounts[i];
+                    born |= ((n & 1) ? s0 : ~s0) & ((n & 2) ? s1 : ~s1) & ((n & 4) ? s2 : ~s2) & ((n & 8) ? s3 : ~s3);
+                }
+                uint64_t survives = 0;
+                for (int i = 0; i < surviveLen; i++)
+                {
+                    int n = surviveCounts[i];
+                    survives |= ((n & 1) ? s0 : ~s0) & ((n & 2) ? s1 : ~s1) & ((n & 4) ? s2 : ~s2) & ((n & 8) ? s3 : ~s3);
+                }
+
+                out[k] = (~mid[k] & born) | (mid[k] & survives);
+            }
+            out[words - 1] &= this->lastMask;
+        }
+
+        // only write the cells that changed
+        for (int y = 0; y < this->height; y++)
+        {
+            size_t rowStart = static_cast<size_t>(y) * words;
+            for (int k = 0; k < words; k++)
+            {
+                uint64_t changed = this->cells[rowStart + k] ^ this->cellsNext[rowStart + k];
+                while (changed)
+                {
+                    int bit = lowestBit(changed);
+                    changed &= changed - 1;
+
+                    int x = k * 64 + bit;
+                    bool alive = (this->cellsNext[rowStart + k] >> bit) & 1ULL;
+                    this->field->set(y * this->width + x, alive ? this->aliveState : this->deadState);
+                }
+            }
+        }
+
+        std::swap(this->cells, this->cellsNext);
+    }
+
+    std::string LifeRule::getRule()
+    {
+        return this->rule;
+    }
+
+    bool LifeRule::getWrap()
+    {
+        return this->wrap;
+    }
+
+    int LifeRule::population()
+    {
+        int count = 0;
+        for (auto word : this->cells)
+        {
+            count += popCount(word);
+        }
+        return count;
+    }
+}
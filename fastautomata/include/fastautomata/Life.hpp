@@ -0,0 +1,135 @@
+/**
+ * @file Life.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief A bit packed rule engine for Life-like (B/S rulestring) automatas
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#pragma once
+
+#include "ClassTypes.hpp"
+#include "Fields.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using namespace fastautomata::ClassTypes;
+
+namespace fastautomata::Life {
+    /**
+     * @brief Runs a Life-like automata (for example "B3/S23") over a field layer.
+     * 
+     * Cells are stored as packed bits (64 cells per word), and neighbor counts are computed for a whole word at a time with bitwise adders.
+     * The result gets written to the next buffer of the field (only the cells that changed), so it can be read with the normal board accessors and counts.
+     * 
+     */
+    class LifeRule
+    {
+        private:
+        Fields::StateField *field;
+        int width;
+        int height;
+
+        /**
+         * @brief Words per row
+         * 
+         */
+        int rowWords;
+
+        /**
+         * @brief The mask of the valid bits of the last word of a row
+         * 
+         */
+        uint64_t lastMask;
+
+        std::string rule;
+        bool wrap;
+        uint16_t aliveState;
+        uint16_t deadState;
+
+        /**
+         * @brief birth[n] is true if a dead cell with n alive neighbors gets born
+         * 
+         */
+        bool birth[9];
+
+        /**
+         * @brief survive[n] is true if an alive cell with n alive neighbors survives
+         * 
+         */
+        bool survive[9];
+
+        /**
+         * @brief The packed cells of the current step ([y * rowWords + word])
+         * 
+         */
+        std::vector<uint64_t> cells;
+
+        /**
+         * @brief The packed cells being computed ([y * rowWords + word])
+         * 
+         */
+        std::vector<uint64_t> cellsNext;
+
+        /**
+         * @brief The revision of the field when the cells were last packed
+         * 
+         */
+        uint64_t revision;
+
+        /**
+         * @brief Parse a rulestring into birth and survive
+         * 
+         * @param rule The rulestring ("B3/S23", "S23/B3" or "23/3")
+         */
+        void parse(std::string rule);
+
+        /**
+         * @brief Pack the current buffer of the field into cells
+         * 
+         */
+        void pack();
+
+        /**
+         * @brief Compute a row shifted one cell to the west and one cell to the east
+         * 
+         * @param row The packed row
+         * @param west Where to write the row shifted so each bit holds its west neighbor
+         * @param east Where to write the row shifted so each bit holds its east neighbor
+         */
+        void shift(const uint64_t *row, uint64_t *west, uint64_t *east);
+
+        public:
+        /**
+         * @brief Construct a new Life Rule object
+         * 
+         * @param field The field layer to run on
+         * @param rule The rulestring ("B3/S23", "S23/B3" or "23/3")
+         * @param wrap Whether the edges of the board wrap around
+         * @param aliveState The state id of alive cells
+         * @param deadState The state id of dead cells
+         */
+        LifeRule(Fields::StateField *field, std::string rule, bool wrap, uint16_t aliveState, uint16_t deadState);
+
+        /**
+         * @brief Compute one generation and write the cells that changed to the next buffer of the field
+         * 
+         */
+        void step();
+
+        std::string getRule();
+
+        bool getWrap();
+
+        /**
+         * @brief The amount of alive cells after the last step
+         * 
+         * @return int 
+         */
+        int population();
+    };
+}
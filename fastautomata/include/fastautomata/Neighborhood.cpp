@@ -0,0 +1,247 @@
+#include "Neighborhood.hpp"
+#include "Board.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace fastautomata::Neighborhood {
+    Stencil::Stencil(StencilType type, std::vector<Pos> even, std::vector<Pos> odd)
+    {
+        this->type = type;
+        this->offsets = {even, odd};
+        for (auto &offsets : this->offsets)
+        {
+            for (auto &offset : offsets)
+            {
+                this->radius = std::max(this->radius, std::max(std::abs(offset.x), std::abs(offset.y)));
+            }
+        }
+    }
+
+    Stencil Stencil::moore(int radius, bool includeCenter)
+    {
+        if (radius < 0)
+        {
+            throw std::invalid_argument("The radius of a stencil can not be negative");
+        }
+
+        // top left to bottom right, same as get_neighbors
+        std::vector<Pos> offsets;
+        for (int y = radius; y >= -radius; y--)
+        {
+            for (int x = -radius; x <= radius; x++)
+            {
+                if (x != 0 || y != 0 || includeCenter)
+                {
+                    offsets.push_back(Pos(x, y));
+                }
+            }
+        }
+        return Stencil(StencilType::MOORE, offsets, offsets);
+    }
+
+    Stencil Stencil::von_neumann(int radius, bool includeCenter)
+    {
+        if (radius < 0)
+        {
+            throw std::invalid_argument("The radius of a stencil can not be negative");
+        }
+
+        std::vector<Pos> offsets;
+        for (int y = radius; y >= -radius; y--)
+        {
+            for (int x = -radius; x <= radius; x++)
+            {
+                if (std::abs(x) + std::abs(y) <= radius && (x != 0 || y != 0 || includeCenter))
+                {
+                    offsets.push_back(Pos(x, y));
+                }
+            }
+        }
+        return Stencil(StencilType::VON_NEUMANN, offsets, offsets);
+    }
+
+    Stencil Stencil::hex(int radius, bool includeCenter)
+    {
+        if (radius < 0)
+        {
+            throw std::invalid_argument("The radius of a stencil can not be negative");
+        }
+
+        // walk the hexes in axial coordinates (q, r), and turn them into offsets for each row parity
+        std::array<std::vector<Pos>, 2> offsets;
+        for (int parity = 0; parity < 2; parity++)
+        {
+            for (int r = radius; r >= -radius; r--)
+            {
+                for (int q = -radius; q <= radius; q++)
+                {
+                    int s = -q - r;
+                    if (std::abs(s) > radius || (q == 0 && r == 0 && !includeCenter))
+                    {
+                        continue;
+                    }
+                    // odd rows are shifted to the right: x = q + floor(row / 2)
+                    int shift = parity + r;
+                    int floorHalf = shift >= 0 ? shift / 2 : -((-shift + 1) / 2);
+                    offsets[parity].push_back(Pos(q + floorHalf, r));
+                }
+            }
+        }
+        return Stencil(StencilType::HEX, offsets[0], offsets[1]);
+    }
+
+    Stencil Stencil::custom(std::vector<Pos> offsets)
+    {
+        return Stencil(StencilType::CUSTOM, offsets, offsets);
+    }
+
+    Stencil Stencil::from_mask(const std::vector<std::vector<int>> &mask)
+    {
+        int rows = static_cast<int>(mask.size());
+        if (rows % 2 == 0)
+        {
+            throw std::invalid_argument("A stencil mask must have an odd amount of rows (rows given: " + std::to_string(rows) + ")");
+        }
+
+        std::vector<Pos> offsets;
+        for (int row = 0; row < rows; row++)
+        {
+            int columns = static_cast<int>(mask[row].size());
+            if (columns % 2 == 0 || columns != static_cast<int>(mask[0].size()))
+            {
+                throw std::invalid_argument("Every row of a stencil mask must have the same odd length");
+            }
+            for (int column = 0; column < columns; column++)
+            {
+                if (mask[row][column] != 0)
+                {
+                    // the first row is the top one (highest y)
+                    offsets.push_back(Pos(column - columns / 2, rows / 2 - row));
+                }
+            }
+        }
+        return Stencil(StencilType::CUSTOM, offsets, offsets);
+    }
+
+    StencilType Stencil::getType() const
+    {
+        return this->type;
+    }
+
+    int Stencil::getRadius() const
+    {
+        return this->radius;
+    }
+
+    size_t Stencil::size() const
+    {
+        return this->offsets[0].size();
+    }
+
+    Neighborhood::Neighborhood(Board::SimulatedBoard *board, Stencil stencil) : stencil(stencil)
+    {
+        this->board = board;
+        this->width = board->getWidth();
+        this->height = board->getHeight();
+
+        for (int parity = 0; parity < 2; parity++)
+        {
+            for (auto &offset : this->stencil.getOffsets(parity))
+            {
+                this->deltas[parity].push_back(offset.x + offset.y * this->width);
+            }
+        }
+    }
+
+    const Stencil &Neighborhood::getStencil() const
+    {
+        return this->stencil;
+    }
+
+    Board::SimulatedBoard *Neighborhood::getBoard() const
+    {
+        return this->board;
+    }
+
+    int Neighborhood::count(Pos pos, int layer, uint16_t state, bool wrap) const
+    {
+        if (layer < 0 || layer >= this->board->getLayerCount())
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+
+        auto board = this->board;
+        int total = 0;
+        this->for_each(pos, wrap, [&](Pos, int index) {
+            total += board->cell_state(layer, index) == state;
+            return true;
+        });
+        return total;
+    }
+
+    int Neighborhood::count_occupied(Pos pos, int layer, bool wrap) const
+    {
+        if (layer < 0 || layer >= this->board->getLayerCount())
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+
+        auto board = this->board;
+        int total = 0;
+        this->for_each(pos, wrap, [&](Pos, int index) {
+            total += board->cell_occupied_at(layer, index);
+            return true;
+        });
+        return total;
+    }
+
+    bool Neighborhood::first_empty(Pos pos, int layer, Pos &out, bool wrap) const
+    {
+        if (layer < 0 || layer >= this->board->getLayerCount())
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+
+        auto board = this->board;
+        bool found = false;
+        this->for_each(pos, wrap, [&](Pos cell, int index) {
+            if (!board->cell_occupied_at(layer, index))
+            {
+                out = cell;
+                found = true;
+                return false;
+            }
+            return true;
+        });
+        return found;
+    }
+
+    size_t Neighborhood::agents(Pos pos, int layer, Agents::BaseAgent **out, bool wrap) const
+    {
+        if (layer < 0 || layer >= this->board->getLayerCount())
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+
+        auto board = this->board;
+        size_t total = 0;
+        this->for_each(pos, wrap, [&](Pos, int index) {
+            auto agent = board->agent_at(layer, index);
+            if (agent != nullptr)
+            {
+                out[total++] = agent;
+            }
+            return true;
+        });
+        return total;
+    }
+
+    std::vector<Agents::BaseAgent *> Neighborhood::agents(Pos pos, int layer, bool wrap) const
+    {
+        std::vector<Agents::BaseAgent *> found(this->stencil.size());
+        found.resize(this->agents(pos, layer, found.data(), wrap));
+        return found;
+    }
+}
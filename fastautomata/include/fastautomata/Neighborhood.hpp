@@ -0,0 +1,276 @@
+/**
+ * @file Neighborhood.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief Precomputed neighborhoods (stencils) and allocation free neighbor queries
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include "ClassTypes.hpp"
+#include <vector>
+#include <array>
+#include <cstdint>
+
+using namespace fastautomata::ClassTypes;
+
+namespace fastautomata::Board {
+    class SimulatedBoard;
+}
+
+namespace fastautomata::Agents {
+    class BaseAgent;
+}
+
+namespace fastautomata::Neighborhood {
+    /**
+     * @brief The shapes a stencil can have
+     *
+     */
+    enum StencilType
+    {
+        MOORE,       // the square around the cell
+        VON_NEUMANN, // the cells within a manhattan distance
+        HEX,         // the cells within a hex distance. Odd rows are shifted half a cell to the right
+        CUSTOM,      // a list of offsets, or a mask
+    };
+
+    /**
+     * @brief A list of offsets around a cell. Hex stencils have a list for even rows and one for odd rows, the rest use the same list for both.
+     *
+     */
+    class Stencil
+    {
+        private:
+        StencilType type;
+
+        /**
+         * @brief The offsets ([row parity][i])
+         *
+         */
+        std::array<std::vector<Pos>, 2> offsets;
+
+        /**
+         * @brief The largest offset (in x or y)
+         *
+         */
+        int radius = 0;
+
+        Stencil(StencilType type, std::vector<Pos> even, std::vector<Pos> odd);
+
+        public:
+        /**
+         * @brief The square of cells around the center
+         *
+         * @param radius [optional] [default: 1]
+         * @param includeCenter [optional] If the center is part of the stencil [default: false]
+         * @return Stencil
+         */
+        static Stencil moore(int radius = 1, bool includeCenter = false);
+
+        /**
+         * @brief The cells within a manhattan distance of the center
+         *
+         * @param radius [optional] [default: 1]
+         * @param includeCenter [optional] If the center is part of the stencil [default: false]
+         * @return Stencil
+         */
+        static Stencil von_neumann(int radius = 1, bool includeCenter = false);
+
+        /**
+         * @brief The cells within a hex distance of the center (odd rows are shifted half a cell to the right)
+         *
+         * @param radius [optional] [default: 1]
+         * @param includeCenter [optional] If the center is part of the stencil [default: false]
+         * @return Stencil
+         */
+        static Stencil hex(int radius = 1, bool includeCenter = false);
+
+        /**
+         * @brief A stencil from a list of offsets. Queries go through them in order.
+         *
+         * @param offsets
+         * @return Stencil
+         */
+        static Stencil custom(std::vector<Pos> offsets);
+
+        /**
+         * @brief A stencil from a mask (rows from top to bottom, as in get_neighbors). The center of the mask is the center of the stencil, so its sides must be odd.
+         *
+         * @param mask Non zero values are part of the stencil
+         * @return Stencil
+         */
+        static Stencil from_mask(const std::vector<std::vector<int>> &mask);
+
+        StencilType getType() const;
+
+        int getRadius() const;
+
+        /**
+         * @brief Get the amount of offsets (for even rows)
+         *
+         * @return size_t
+         */
+        size_t size() const;
+
+        /**
+         * @brief Get the offsets used for cells in a row
+         *
+         * @param y The row of the center
+         * @return const std::vector<Pos>&
+         */
+        inline const std::vector<Pos> &getOffsets(int y) const
+        {
+            return this->offsets[y & 1];
+        }
+    };
+
+    /**
+     * @brief A stencil bound to a board. The offsets get turned into cell index deltas once, so cells far from the edges get read without any bounds check.
+     *
+     * Queries do not allocate and only read the board, so they can run from agents stepped in parallel.
+     * Cells hold the state of their agent (or entity), or the state of the field if the layer is a field layer.
+     */
+    class Neighborhood
+    {
+        private:
+        Board::SimulatedBoard *board;
+        Stencil stencil;
+
+        int width;
+        int height;
+
+        /**
+         * @brief The offsets as deltas of the index inside a layer ([row parity][i])
+         *
+         */
+        std::array<std::vector<int>, 2> deltas;
+
+        /**
+         * @brief Check if every cell of the stencil around pos is inside the board
+         *
+         */
+        inline bool interior(Pos pos) const
+        {
+            int radius = this->stencil.getRadius();
+            return pos.x >= radius && pos.y >= radius && pos.x + radius < this->width && pos.y + radius < this->height;
+        }
+
+        public:
+        /**
+         * @brief Construct a new Neighborhood
+         *
+         * @param board The board to query (its size must not change)
+         * @param stencil The cells to look at
+         */
+        Neighborhood(Board::SimulatedBoard *board, Stencil stencil);
+
+        const Stencil &getStencil() const;
+
+        Board::SimulatedBoard *getBoard() const;
+
+        /**
+         * @brief Call func(Pos cell, int index) for every cell of the stencil around pos that is inside the board (index = x + y * width).
+         *
+         * Stops early if func returns false.
+         *
+         * @param pos The center (must be inside the board)
+         * @param wrap If cells outside of the board wrap around
+         * @param func bool(Pos, int)
+         */
+        template <typename Func>
+        inline void for_each(Pos pos, bool wrap, Func &&func) const
+        {
+            const auto &offsets = this->stencil.getOffsets(pos.y);
+            size_t count = offsets.size();
+
+            if (this->interior(pos))
+            {
+                const auto &deltas = this->deltas[pos.y & 1];
+                int center = pos.x + pos.y * this->width;
+                for (size_t i = 0; i < count; i++)
+                {
+                    if (!func(Pos(pos.x + offsets[i].x, pos.y + offsets[i].y), center + deltas[i]))
+                    {
+                        return;
+                    }
+                }
+                return;
+            }
+
+            // close to an edge
+            for (size_t i = 0; i < count; i++)
+            {
+                int x = pos.x + offsets[i].x;
+                int y = pos.y + offsets[i].y;
+                if (x < 0 || y < 0 || x >= this->width || y >= this->height)
+                {
+                    if (!wrap)
+                    {
+                        continue;
+                    }
+                    x = ((x % this->width) + this->width) % this->width;
+                    y = ((y % this->height) + this->height) % this->height;
+                }
+                if (!func(Pos(x, y), x + y * this->width))
+                {
+                    return;
+                }
+            }
+        }
+
+        /**
+         * @brief Count the cells around pos that are in a state
+         *
+         * @param pos The center
+         * @param layer The layer to look at
+         * @param state A registered state id
+         * @param wrap [optional] If cells outside of the board wrap around [default: false]
+         * @return int
+         */
+        int count(Pos pos, int layer, uint16_t state, bool wrap = false) const;
+
+        /**
+         * @brief Count the cells around pos that are occupied (an agent, an entity or a non empty field cell)
+         *
+         * @param pos The center
+         * @param layer The layer to look at
+         * @param wrap [optional] If cells outside of the board wrap around [default: false]
+         * @return int
+         */
+        int count_occupied(Pos pos, int layer, bool wrap = false) const;
+
+        /**
+         * @brief Find the first cell around pos (in stencil order) that is not occupied
+         *
+         * @param pos The center
+         * @param layer The layer to look at
+         * @param out Gets the position of the cell, if one was found
+         * @param wrap [optional] If cells outside of the board wrap around [default: false]
+         * @return true if there is an empty cell
+         */
+        bool first_empty(Pos pos, int layer, Pos &out, bool wrap = false) const;
+
+        /**
+         * @brief Write the agents around pos into out (skipping empty cells)
+         *
+         * @param pos The center
+         * @param layer The layer to look at (an agent layer)
+         * @param out A buffer of at least getStencil().size() agents
+         * @param wrap [optional] If cells outside of the board wrap around [default: false]
+         * @return size_t The amount of agents written
+         */
+        size_t agents(Pos pos, int layer, Agents::BaseAgent **out, bool wrap = false) const;
+
+        /**
+         * @brief Get the agents around pos (skipping empty cells). Allocates, meant for python.
+         *
+         * @return std::vector<Agents::BaseAgent *>
+         */
+        std::vector<Agents::BaseAgent *> agents(Pos pos, int layer, bool wrap = false) const;
+    };
+}
@@ -0,0 +1,100 @@
+#include "Random.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace fastautomata::Random {
+    RandomStream::RandomStream(uint64_t seed, uint64_t step, uint64_t stream, RandomDomain domain, uint64_t draw)
+    {
+        this->key = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+        this->step = static_cast<uint32_t>(step);
+        this->stream = static_cast<uint32_t>(stream);
+        // the high word of the stream shares the last counter word with the domain (domains fit in 8 bits), so streams below 2^32 draw what they always did
+        this->domain = static_cast<uint32_t>(domain) | static_cast<uint32_t>(stream >> 32) << 8;
+
+        // skip to the requested draw
+        this->block = static_cast<uint32_t>(draw / 4);
+        this->used = 4;
+        if (draw % 4 != 0)
+        {
+            this->next_u32();
+            this->used = static_cast<int>(draw % 4);
+        }
+    }
+
+    uint64_t RandomStream::position()
+    {
+        return static_cast<uint64_t>(this->block) * 4 - (4 - this->used);
+    }
+
+    double RandomStream::uniform(double low, double high)
+    {
+        return low + (high - low) * this->uniform();
+    }
+
+    int RandomStream::integer(int low, int high)
+    {
+        if (high < low)
+        {
+            throw std::invalid_argument("Empty range for a random integer (" + std::to_string(low) + ", " + std::to_string(high) + ")");
+        }
+
+        // Lemire's multiply and reject, no modulo bias
+        uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(high) - low) + 1;
+        if (range > 0xFFFFFFFFULL)
+        {
+            return static_cast<int>(static_cast<int64_t>(low) + this->next_u32());
+        }
+
+        uint64_t product = static_cast<uint64_t>(this->next_u32()) * range;
+        uint32_t leftover = static_cast<uint32_t>(product);
+        if (leftover < range)
+        {
+            uint32_t threshold = static_cast<uint32_t>((0x100000000ULL - range) % range);
+            while (leftover < threshold)
+            {
+                product = static_cast<uint64_t>(this->next_u32()) * range;
+                leftover = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<int>(static_cast<int64_t>(low) + static_cast<int64_t>(product >> 32));
+    }
+
+    double RandomStream::normal(double mean, double deviation)
+    {
+        // Box-Muller, 1 - u keeps the log away from 0
+        double u1 = 1.0 - this->uniform();
+        double u2 = this->uniform();
+        return mean + deviation * std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+
+    bool RandomStream::bernoulli(double p)
+    {
+        return this->uniform() < p;
+    }
+
+    void RandomStream::fill_uniform(double *out, size_t count)
+    {
+        size_t i = 0;
+
+        // finish the current block first, so the numbers match uniform()
+        while (i < count && this->used != 4)
+        {
+            out[i++] = this->uniform();
+        }
+
+        // whole blocks (2 doubles each), without the word buffer
+        while (i + 2 <= count)
+        {
+            auto words = philox({this->block, this->stream, this->step, this->domain}, this->key);
+            this->block++;
+            out[i++] = to_uniform((static_cast<uint64_t>(words[0]) << 32) | words[1]);
+            out[i++] = to_uniform((static_cast<uint64_t>(words[2]) << 32) | words[3]);
+        }
+
+        while (i < count)
+        {
+            out[i++] = this->uniform();
+        }
+    }
+}
@@ -0,0 +1,194 @@
+/**
+ * @file Random.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief A counter based random generator (Philox4x32-10). Draws only depend on (seed, step, stream, draw), never on the order they get made in.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+namespace fastautomata::Random {
+    /**
+     * @brief What a stream gets used for. Streams of different domains never overlap, even with the same stream number.
+     *
+     */
+    enum RandomDomain : uint32_t
+    {
+        AGENT = 0,  // stream = agent id
+        BOARD = 1,  // stream = 0, draws made through the board
+        MOVES = 2,  // stream = agent id, priority of the RANDOM move policy
+        COLORS = 3, // stream = hash of the state name
+        RULES = 4,  // stream = agent id (entities and field cells in their own ranges), probabilities of rule sets
+    };
+
+    /**
+     * @brief One Philox4x32-10 block: 4 random words for a counter and a key
+     *
+     * @param counter The counter (4 words)
+     * @param key The key (2 words)
+     * @return std::array<uint32_t, 4>
+     */
+    inline std::array<uint32_t, 4> philox(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key)
+    {
+        const uint64_t M0 = 0xD2511F53;
+        const uint64_t M1 = 0xCD9E8D57;
+        const uint32_t W0 = 0x9E3779B9;
+        const uint32_t W1 = 0xBB67AE85;
+
+        for (int round = 0; round < 10; round++)
+        {
+            uint64_t product0 = M0 * counter[0];
+            uint64_t product1 = M1 * counter[2];
+            counter = {
+                static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                static_cast<uint32_t>(product1),
+                static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                static_cast<uint32_t>(product0),
+            };
+            key[0] += W0;
+            key[1] += W1;
+        }
+        return counter;
+    }
+
+    /**
+     * @brief Turn 64 random bits into a double in [0, 1)
+     *
+     */
+    inline double to_uniform(uint64_t bits)
+    {
+        return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * @brief A stream of random numbers, keyed by (seed, step, stream, domain).
+     *
+     * Draw n of a stream is always the same number, so streams can be recreated anywhere (any thread, any order) and give the same results.
+     */
+    class RandomStream
+    {
+        private:
+        std::array<uint32_t, 2> key;
+
+        uint32_t step;
+        uint32_t stream;
+
+        /**
+         * @brief The domain in the low 8 bits, the high word of the stream above it (streams tag ranges with it, see SimulatedBoard::update_rules)
+         *
+         */
+        uint32_t domain;
+
+        /**
+         * @brief The index of the next block
+         *
+         */
+        uint32_t block = 0;
+
+        /**
+         * @brief The words of the current block, and how many have been used
+         *
+         */
+        std::array<uint32_t, 4> words;
+        int used = 4;
+
+        public:
+        /**
+         * @brief Construct a new Random Stream
+         *
+         * @param seed The seed (usually the board seed)
+         * @param step The step (usually the board step count)
+         * @param stream The stream number (usually an agent id). Streams up to 2^56 never overlap
+         * @param domain [optional] What the stream gets used for [default: AGENT]
+         * @param draw [optional] The first draw (32 bit words) to make. Lets a stream continue where another one with the same key stopped [default: 0]
+         */
+        RandomStream(uint64_t seed, uint64_t step, uint64_t stream, RandomDomain domain = RandomDomain::AGENT, uint64_t draw = 0);
+
+        /**
+         * @brief Get the amount of 32 bit words drawn so far (counting from the start of the stream)
+         *
+         * @return uint64_t
+         */
+        uint64_t position();
+
+        /**
+         * @brief Get 32 random bits
+         *
+         * @return uint32_t
+         */
+        inline uint32_t next_u32()
+        {
+            if (this->used == 4)
+            {
+                this->words = philox({this->block, this->stream, this->step, this->domain}, this->key);
+                this->block++;
+                this->used = 0;
+            }
+            return this->words[this->used++];
+        }
+
+        /**
+         * @brief Get 64 random bits
+         *
+         * @return uint64_t
+         */
+        inline uint64_t next_u64()
+        {
+            uint64_t high = this->next_u32();
+            return (high << 32) | this->next_u32();
+        }
+
+        /**
+         * @brief Get a double in [0, 1)
+         *
+         * @return double
+         */
+        inline double uniform()
+        {
+            return to_uniform(this->next_u64());
+        }
+
+        /**
+         * @brief Get a double in [low, high)
+         *
+         */
+        double uniform(double low, double high);
+
+        /**
+         * @brief Get an integer in [low, high] (both included, like python's randint)
+         *
+         */
+        int integer(int low, int high);
+
+        /**
+         * @brief Get a normally distributed double
+         *
+         * @param mean
+         * @param deviation The standard deviation
+         * @return double
+         */
+        double normal(double mean = 0, double deviation = 1);
+
+        /**
+         * @brief Get true with probability p
+         *
+         */
+        bool bernoulli(double p);
+
+        /**
+         * @brief Fill out with count doubles in [0, 1). Same numbers as calling uniform() count times, but faster.
+         *
+         * @param out The buffer to fill
+         * @param count The amount of doubles
+         */
+        void fill_uniform(double *out, size_t count);
+    };
+}
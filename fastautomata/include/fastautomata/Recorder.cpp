@@ -0,0 +1,708 @@
+#include "Recorder.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace fastautomata::Recording {
+    static inline void varint_write(std::vector<uint8_t> &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    // small negative numbers get small codes too (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...)
+    static inline void zigzag_write(std::vector<uint8_t> &out, int64_t value)
+    {
+        varint_write(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    static inline void string_write(std::vector<uint8_t> &out, const std::string &value)
+    {
+        varint_write(out, value.size());
+        out.insert(out.end(), value.begin(), value.end());
+    }
+
+    /**
+     * @brief Reads the numbers of a frame. Every read checks the end, so a broken file throws instead of reading past it.
+     *
+     */
+    struct Cursor
+    {
+        const uint8_t *data;
+        const uint8_t *end;
+
+        uint64_t varint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (this->data == this->end)
+                {
+                    throw std::invalid_argument("The recording is broken (a frame is shorter than its contents)");
+                }
+                uint8_t byte = *this->data++;
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                {
+                    return value;
+                }
+            }
+            throw std::invalid_argument("The recording is broken (a number is too long)");
+        }
+
+        int64_t zigzag()
+        {
+            uint64_t value = this->varint();
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        std::string string()
+        {
+            uint64_t length = this->varint();
+            if (length > static_cast<uint64_t>(this->end - this->data))
+            {
+                throw std::invalid_argument("The recording is broken (a frame is shorter than its contents)");
+            }
+            std::string value(reinterpret_cast<const char *>(this->data), static_cast<size_t>(length));
+            this->data += length;
+            return value;
+        }
+    };
+
+    Header header_make(int width, int height, int layers, int keyframeInterval)
+    {
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.byteOrder = Checkpoint::ENDIAN_MARK;
+        header.width = width;
+        header.height = height;
+        header.layers = layers;
+        header.keyframeInterval = static_cast<uint32_t>(keyframeInterval);
+        return header;
+    }
+
+    /*
+    ███████ ███    ██  ██████  ██████  ██████  ███████ ██████
+    ██      ████   ██ ██      ██    ██ ██   ██ ██      ██   ██
+    █████   ██ ██  ██ ██      ██    ██ ██   ██ █████   ██████
+    ██      ██  ██ ██ ██      ██    ██ ██   ██ ██      ██   ██
+    ███████ ██   ████  ██████  ██████  ██████  ███████ ██   ██
+    */
+
+    void Encoder::write(Frame &frame, std::vector<uint8_t> &bytes)
+    {
+        this->payload.clear();
+        this->encode(frame, this->payload);
+        bytes.push_back(frame.kind);
+        varint_write(bytes, this->payload.size());
+        bytes.insert(bytes.end(), this->payload.begin(), this->payload.end());
+    }
+
+    void Encoder::encode(Frame &frame, std::vector<uint8_t> &out)
+    {
+        zigzag_write(out, frame.step);
+        varint_write(out, frame.states.size());
+        for (auto &name : frame.states)
+        {
+            string_write(out, name);
+        }
+
+        if (frame.kind == COUNTS)
+        {
+            varint_write(out, frame.counts.size());
+            for (int count : frame.counts)
+            {
+                varint_write(out, static_cast<uint32_t>(count));
+            }
+            return;
+        }
+
+        if (is_keyframe(frame.kind))
+        {
+            varint_write(out, frame.fields.size());
+            for (auto &[layer, cells] : frame.fields)
+            {
+                // the whole layer, as runs of the same state
+                std::vector<uint8_t> runs;
+                size_t runCount = 0;
+                for (size_t start = 0; start < cells.size();)
+                {
+                    size_t end = start + 1;
+                    while (end < cells.size() && cells[end] == cells[start])
+                    {
+                        end++;
+                    }
+                    varint_write(runs, end - start);
+                    varint_write(runs, cells[start]);
+                    runCount++;
+                    start = end;
+                }
+                varint_write(out, layer);
+                varint_write(out, runCount);
+                out.insert(out.end(), runs.begin(), runs.end());
+                this->planes[layer] = std::move(cells);
+            }
+
+            std::sort(frame.items.begin(), frame.items.end(), [](const Item &a, const Item &b) {
+                return a.entity != b.entity ? a.entity < b.entity : a.id < b.id;
+            });
+            varint_write(out, frame.items.size());
+            int64_t lastId = 0;
+            for (auto &item : frame.items)
+            {
+                varint_write(out, item.entity);
+                zigzag_write(out, static_cast<int64_t>(item.id) - lastId);
+                zigzag_write(out, item.x);
+                zigzag_write(out, item.y);
+                varint_write(out, static_cast<uint32_t>(item.layer));
+                varint_write(out, item.state);
+                lastId = item.id;
+            }
+            return;
+        }
+
+        varint_write(out, frame.changes.size());
+        int64_t lastId = 0;
+        for (auto &change : frame.changes)
+        {
+            out.push_back(static_cast<uint8_t>(change.kind | (change.entity << 4)));
+            zigzag_write(out, static_cast<int64_t>(change.id) - lastId);
+            lastId = change.id;
+            switch (change.kind)
+            {
+            case Journal::ADD:
+                zigzag_write(out, change.x_new);
+                zigzag_write(out, change.y_new);
+                varint_write(out, static_cast<uint16_t>(change.layer_new));
+                varint_write(out, change.state_new);
+                break;
+            case Journal::MOVE:
+                zigzag_write(out, static_cast<int64_t>(change.x_new) - change.x_old);
+                zigzag_write(out, static_cast<int64_t>(change.y_new) - change.y_old);
+                break;
+            case Journal::STATE:
+                varint_write(out, change.state_new);
+                break;
+            case Journal::LAYER:
+                varint_write(out, static_cast<uint16_t>(change.layer_new));
+                break;
+            default:
+                break;
+            }
+        }
+
+        varint_write(out, frame.fields.size());
+        for (auto &[layer, cells] : frame.fields)
+        {
+            std::vector<uint16_t> &previous = this->planes[layer];
+            if (previous.size() != cells.size())
+            {
+                // a new field layer starts from 0 (so does the replay)
+                previous.assign(cells.size(), 0);
+            }
+
+            // only the cells that changed, as runs: cells skipped since the last run, the length, the states
+            std::vector<uint8_t> runs;
+            size_t runCount = 0;
+            size_t last = 0;
+            for (size_t start = 0; start < cells.size(); start++)
+            {
+                if (cells[start] == previous[start])
+                {
+                    continue;
+                }
+                size_t end = start + 1;
+                while (end < cells.size() && cells[end] != previous[end])
+                {
+                    end++;
+                }
+                varint_write(runs, start - last);
+                varint_write(runs, end - start);
+                for (size_t i = start; i < end; i++)
+                {
+                    varint_write(runs, cells[i]);
+                }
+                runCount++;
+                last = end;
+                start = end;
+            }
+            varint_write(out, layer);
+            varint_write(out, runCount);
+            out.insert(out.end(), runs.begin(), runs.end());
+            previous = std::move(cells);
+        }
+    }
+
+    /*
+    ██████  ███████  ██████  ██████  ██████  ██████  ███████ ██████
+    ██   ██ ██      ██      ██    ██ ██   ██ ██   ██ ██      ██   ██
+    ██████  █████   ██      ██    ██ ██████  ██   ██ █████   ██████
+    ██   ██ ██      ██      ██    ██ ██   ██ ██   ██ ██      ██   ██
+    ██   ██ ███████  ██████  ██████  ██   ██ ██████  ███████ ██   ██
+    */
+
+    Recorder::Recorder(const std::string &path, int width, int height, int layers, int keyframeInterval)
+    {
+        this->file.open(path, std::ios::binary | std::ios::trunc);
+        if (!this->file)
+        {
+            throw std::runtime_error("Could not open file: " + path);
+        }
+        this->keyframeInterval = keyframeInterval;
+
+        Header header = header_make(width, height, layers, keyframeInterval);
+        this->file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        this->writer = std::thread(&Recorder::writer_loop, this);
+    }
+
+    Recorder::~Recorder()
+    {
+        this->close();
+    }
+
+    void Recorder::push(Frame &&frame)
+    {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->written.wait(lock, [this] { return this->queue.size() < QUEUE_LIMIT; });
+            this->queue.push_back(std::move(frame));
+        }
+        this->queued.notify_one();
+    }
+
+    std::string Recorder::close()
+    {
+        if (!this->writer.joinable())
+        {
+            return this->error;
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->queued.notify_one();
+        this->writer.join();
+
+        this->file.close();
+        if (this->error.empty() && this->file.fail())
+        {
+            this->error = "Could not write the recording";
+        }
+        return this->error;
+    }
+
+    int Recorder::getKeyframeInterval()
+    {
+        return this->keyframeInterval;
+    }
+
+    void Recorder::writer_loop()
+    {
+        std::vector<uint8_t> bytes;
+        while (true)
+        {
+            Frame frame;
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->queued.wait(lock, [this] { return this->stopping || !this->queue.empty(); });
+                if (this->queue.empty())
+                {
+                    return;
+                }
+                frame = std::move(this->queue.front());
+                this->queue.pop_front();
+            }
+            this->written.notify_one();
+
+            if (!this->error.empty())
+            {
+                continue;
+            }
+
+            bytes.clear();
+            this->encoder.write(frame, bytes);
+            this->file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            if (!this->file)
+            {
+                this->error = "Could not write the recording";
+            }
+        }
+    }
+
+    /*
+    ██████  ███████ ██████  ██       █████  ██    ██
+    ██   ██ ██      ██   ██ ██      ██   ██  ██  ██
+    ██████  █████   ██████  ██      ███████   ████
+    ██   ██ ██      ██      ██      ██   ██    ██
+    ██   ██ ███████ ██      ███████ ██   ██    ██
+    */
+
+    Replay::Replay(const std::string &path) : file(path)
+    {
+        const uint8_t *data = this->file.getData();
+        size_t size = this->file.getSize();
+        if (size < sizeof(Header))
+        {
+            throw std::invalid_argument(path + " is not a recording");
+        }
+        std::memcpy(&this->header, data, sizeof(Header));
+        if (std::memcmp(this->header.magic, MAGIC, sizeof(this->header.magic)) != 0)
+        {
+            throw std::invalid_argument(path + " is not a recording");
+        }
+        if (this->header.byteOrder != Checkpoint::ENDIAN_MARK)
+        {
+            throw std::invalid_argument("The recording was written on a machine with another byte order");
+        }
+        if (this->header.version != VERSION)
+        {
+            throw std::invalid_argument("The recording has version " + std::to_string(this->header.version) + ", only version " + std::to_string(VERSION) + " can be replayed");
+        }
+
+        // the file might still be getting written: a frame that is not complete yet ends the index
+        size_t position = sizeof(Header);
+        while (position < size)
+        {
+            FrameKind kind = static_cast<FrameKind>(data[position]);
+            Cursor cursor{data + position + 1, data + size};
+            uint64_t frameSize;
+            int32_t frameStep;
+            try
+            {
+                frameSize = cursor.varint();
+                if (frameSize > static_cast<uint64_t>(cursor.end - cursor.data))
+                {
+                    break;
+                }
+                Cursor payload{cursor.data, cursor.data + frameSize};
+                frameStep = static_cast<int32_t>(payload.zigzag());
+            }
+            catch (const std::invalid_argument &)
+            {
+                break;
+            }
+
+            size_t offset = static_cast<size_t>(cursor.data - data);
+            if (kind == RESET && !this->frames.empty())
+            {
+                this->runs.push_back(this->frames.size());
+            }
+            if (is_keyframe(kind) || kind == STEP)
+            {
+                this->frames.push_back(FrameIndex{offset, static_cast<size_t>(frameSize), frameStep, kind, static_cast<int>(this->runs.size())});
+            }
+            position = offset + static_cast<size_t>(frameSize);
+        }
+
+        if (this->frames.empty() || !is_keyframe(this->frames[0].kind))
+        {
+            throw std::invalid_argument(path + " has no frames");
+        }
+        this->runs.insert(this->runs.begin(), 0);
+        this->apply(this->frames[0]);
+        this->position = 1;
+    }
+
+    void Replay::apply(const FrameIndex &frame)
+    {
+        Cursor cursor{this->file.getData() + frame.offset, this->file.getData() + frame.offset + frame.size};
+        this->step = static_cast<int32_t>(cursor.zigzag());
+        this->run = frame.run;
+
+        uint64_t stateCount = cursor.varint();
+        if (is_keyframe(frame.kind))
+        {
+            this->states.clear();
+        }
+        for (uint64_t i = 0; i < stateCount; i++)
+        {
+            this->states.push_back(cursor.string());
+        }
+
+        size_t agentSize = static_cast<size_t>(this->header.width) * this->header.height;
+        if (is_keyframe(frame.kind))
+        {
+            this->fields.clear();
+            uint64_t fieldCount = cursor.varint();
+            for (uint64_t i = 0; i < fieldCount; i++)
+            {
+                int layer = static_cast<int>(cursor.varint());
+                std::vector<uint16_t> &cells = this->fields[layer];
+                cells.clear();
+                cells.reserve(agentSize);
+                uint64_t runCount = cursor.varint();
+                for (uint64_t run = 0; run < runCount; run++)
+                {
+                    uint64_t length = cursor.varint();
+                    uint16_t state = static_cast<uint16_t>(cursor.varint());
+                    if (length > agentSize - cells.size())
+                    {
+                        throw std::invalid_argument("The recording is broken (a field layer is bigger than the board)");
+                    }
+                    cells.insert(cells.end(), static_cast<size_t>(length), state);
+                }
+                cells.resize(agentSize, 0);
+            }
+
+            this->items.clear();
+            uint64_t itemCount = cursor.varint();
+            int64_t lastId = 0;
+            for (uint64_t i = 0; i < itemCount; i++)
+            {
+                Item item;
+                item.entity = static_cast<uint8_t>(cursor.varint());
+                lastId += cursor.zigzag();
+                item.id = static_cast<int32_t>(lastId);
+                item.x = static_cast<int32_t>(cursor.zigzag());
+                item.y = static_cast<int32_t>(cursor.zigzag());
+                item.layer = static_cast<int32_t>(cursor.varint());
+                item.state = static_cast<uint16_t>(cursor.varint());
+                item.reserved = 0;
+                this->items[key(item.entity, item.id)] = item;
+            }
+            return;
+        }
+
+        uint64_t changeCount = cursor.varint();
+        int64_t lastId = 0;
+        for (uint64_t i = 0; i < changeCount; i++)
+        {
+            if (cursor.data == cursor.end)
+            {
+                throw std::invalid_argument("The recording is broken (a frame is shorter than its contents)");
+            }
+            uint8_t kindEntity = *cursor.data++;
+            uint8_t kind = kindEntity & 0x0F;
+            uint8_t entity = kindEntity >> 4;
+            lastId += cursor.zigzag();
+            int32_t id = static_cast<int32_t>(lastId);
+
+            auto found = this->items.find(key(entity, id));
+            switch (kind)
+            {
+            case Journal::ADD:
+            {
+                Item item;
+                item.id = id;
+                item.x = static_cast<int32_t>(cursor.zigzag());
+                item.y = static_cast<int32_t>(cursor.zigzag());
+                item.layer = static_cast<int32_t>(cursor.varint());
+                item.state = static_cast<uint16_t>(cursor.varint());
+                item.entity = entity;
+                item.reserved = 0;
+                this->items[key(entity, id)] = item;
+                break;
+            }
+            case Journal::REMOVE:
+                if (found != this->items.end())
+                {
+                    this->items.erase(found);
+                }
+                break;
+            case Journal::MOVE:
+            {
+                int64_t dx = cursor.zigzag();
+                int64_t dy = cursor.zigzag();
+                if (found != this->items.end())
+                {
+                    found->second.x += static_cast<int32_t>(dx);
+                    found->second.y += static_cast<int32_t>(dy);
+                }
+                break;
+            }
+            case Journal::STATE:
+            {
+                uint16_t state = static_cast<uint16_t>(cursor.varint());
+                if (found != this->items.end())
+                {
+                    found->second.state = state;
+                }
+                break;
+            }
+            case Journal::LAYER:
+            {
+                int32_t layer = static_cast<int32_t>(cursor.varint());
+                if (found != this->items.end())
+                {
+                    found->second.layer = layer;
+                }
+                break;
+            }
+            case Journal::RESET:
+                this->items.clear();
+                break;
+            default:
+                throw std::invalid_argument("The recording is broken (unknown change)");
+            }
+        }
+
+        uint64_t fieldCount = cursor.varint();
+        for (uint64_t i = 0; i < fieldCount; i++)
+        {
+            int layer = static_cast<int>(cursor.varint());
+            std::vector<uint16_t> &cells = this->fields[layer];
+            cells.resize(agentSize, 0);
+            uint64_t runCount = cursor.varint();
+            size_t index = 0;
+            for (uint64_t run = 0; run < runCount; run++)
+            {
+                index += static_cast<size_t>(cursor.varint());
+                uint64_t length = cursor.varint();
+                if (index > agentSize || length > agentSize - index)
+                {
+                    throw std::invalid_argument("The recording is broken (a field layer is bigger than the board)");
+                }
+                for (uint64_t cell = 0; cell < length; cell++)
+                {
+                    cells[index++] = static_cast<uint16_t>(cursor.varint());
+                }
+            }
+        }
+    }
+
+    int Replay::run_resolve(int run)
+    {
+        if (run == -1)
+        {
+            return this->run;
+        }
+        if (run < 0 || run >= static_cast<int>(this->runs.size()))
+        {
+            throw std::out_of_range("The recording has " + std::to_string(this->runs.size()) + " runs (run given: " + std::to_string(run) + ")");
+        }
+        return run;
+    }
+
+    void Replay::seek(int step, int run)
+    {
+        run = this->run_resolve(run);
+        if (step < this->getFirstStep(run) || step > this->getLastStep(run))
+        {
+            throw std::out_of_range("Run " + std::to_string(run) + " of the recording has the steps " + std::to_string(this->getFirstStep(run)) + " to " + std::to_string(this->getLastStep(run)));
+        }
+
+        // the frames of the run
+        size_t first = this->runs[run];
+        size_t end = run + 1 < static_cast<int>(this->runs.size()) ? this->runs[run + 1] : this->frames.size();
+
+        // the last keyframe at or before the step, unless going forward from here is shorter
+        size_t keyframe = first;
+        for (size_t i = first; i < end && this->frames[i].step <= step; i++)
+        {
+            if (is_keyframe(this->frames[i].kind))
+            {
+                keyframe = i;
+            }
+        }
+        if (!(this->run == run && this->step <= step && this->position > keyframe))
+        {
+            this->apply(this->frames[keyframe]);
+            this->position = keyframe + 1;
+        }
+
+        while (this->position < end && this->frames[this->position].step <= step)
+        {
+            this->apply(this->frames[this->position]);
+            this->position++;
+        }
+    }
+
+    bool Replay::next()
+    {
+        if (this->position >= this->frames.size())
+        {
+            return false;
+        }
+        this->apply(this->frames[this->position]);
+        this->position++;
+        return true;
+    }
+
+    int Replay::getStep()
+    {
+        return this->step;
+    }
+
+    int Replay::getRun()
+    {
+        return this->run;
+    }
+
+    int Replay::getRunCount()
+    {
+        return static_cast<int>(this->runs.size());
+    }
+
+    int Replay::getFirstStep(int run)
+    {
+        run = this->run_resolve(run);
+        return this->frames[this->runs[run]].step;
+    }
+
+    int Replay::getLastStep(int run)
+    {
+        run = this->run_resolve(run);
+        size_t end = run + 1 < static_cast<int>(this->runs.size()) ? this->runs[run + 1] : this->frames.size();
+        return this->frames[end - 1].step;
+    }
+
+    int Replay::getWidth()
+    {
+        return this->header.width;
+    }
+
+    int Replay::getHeight()
+    {
+        return this->header.height;
+    }
+
+    int Replay::getLayerCount()
+    {
+        return this->header.layers;
+    }
+
+    std::vector<Item> Replay::getItems()
+    {
+        std::vector<Item> result;
+        result.reserve(this->items.size());
+        for (auto &entry : this->items)
+        {
+            result.push_back(entry.second);
+        }
+        std::sort(result.begin(), result.end(), [](const Item &a, const Item &b) {
+            return a.entity != b.entity ? a.entity < b.entity : a.id < b.id;
+        });
+        return result;
+    }
+
+    const std::vector<uint16_t> &Replay::getField(int layer)
+    {
+        auto found = this->fields.find(layer);
+        if (found == this->fields.end())
+        {
+            throw std::out_of_range("Layer " + std::to_string(layer) + " is not a field layer in the recording");
+        }
+        return found->second;
+    }
+
+    std::vector<int> Replay::getFieldLayers()
+    {
+        std::vector<int> layers;
+        for (auto &entry : this->fields)
+        {
+            layers.push_back(entry.first);
+        }
+        std::sort(layers.begin(), layers.end());
+        return layers;
+    }
+
+    const std::vector<std::string> &Replay::getStates()
+    {
+        return this->states;
+    }
+}
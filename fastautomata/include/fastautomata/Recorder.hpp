@@ -0,0 +1,421 @@
+/**
+ * @file Recorder.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief Recording every step of a board to a file (written in the background), and replaying it without the agents
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include "Journal.hpp"
+#include "Checkpoint.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstdint>
+
+namespace fastautomata::Recording {
+    /**
+     * @brief The version of the format. Files of other versions do not replay.
+     *
+     */
+    static constexpr uint32_t VERSION = 1;
+
+    static constexpr char MAGIC[8] = {'F', 'A', 'U', 'T', 'O', 'R', 'E', 'C'};
+
+    /**
+     * @brief The start of every recording. Followed by frames until the end of the file.
+     *
+     */
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        int32_t width;
+        int32_t height;
+        int32_t layers;
+        uint32_t keyframeInterval;
+    };
+    static_assert(sizeof(Header) == 32, "The recording header must not have padding");
+
+    /**
+     * @brief What a frame holds
+     *
+     * Every frame is [uint8 kind][varint size][payload], and every payload starts with [varint step][varint new states][names: varint length, characters].
+     * Numbers are varints (7 bits per byte), signed ones zigzag encoded first.
+     */
+    enum FrameKind : uint8_t
+    {
+        /**
+         * @brief The whole board: [varint fields][per field: varint layer, varint runs, runs: varint length, varint state]
+         * [varint items][per item, sorted: varint entity, id - last id, x, y, varint layer, varint state]
+         *
+         */
+        KEYFRAME = 1,
+
+        /**
+         * @brief The changes of one step: [varint changes][per change: uint8 kind | entity << 4, id - last id, then
+         * ADD: x, y, varint layer, varint state. MOVE: x - x old, y - y old. STATE: varint state. LAYER: varint layer]
+         * [varint fields][per field: varint layer, varint runs, runs: varint cells skipped, varint length, varint state per cell]
+         *
+         */
+        STEP = 2,
+
+        /**
+         * @brief The amount of cells of each state: [varint states][varint count, per state]. Only in streams, replays skip it.
+         *
+         */
+        COUNTS = 3,
+
+        /**
+         * @brief The whole board after a reset or a load, like a KEYFRAME. It starts a new run: the steps after it start again from its step.
+         *
+         */
+        RESET = 4,
+    };
+
+    /**
+     * @brief Check if a frame holds the whole board (KEYFRAME or RESET)
+     *
+     * @param kind The kind of the frame
+     * @return true if it does not depend on the frames before it
+     */
+    inline bool is_keyframe(FrameKind kind)
+    {
+        return kind == KEYFRAME || kind == RESET;
+    }
+
+    /**
+     * @brief Build the header of a recording (also the start of a stream)
+     *
+     * @param width The width of the board
+     * @param height The height of the board
+     * @param layers The amount of layers of the board
+     * @param keyframeInterval The amount of steps between keyframes (0 if there is no fixed interval)
+     * @return Header
+     */
+    Header header_make(int width, int height, int layers, int keyframeInterval);
+
+    /**
+     * @brief An agent or an entity, as the replay knows it. Plain data (copied as is to numpy).
+     *
+     */
+    struct Item
+    {
+        int32_t id;
+        int32_t x;
+        int32_t y;
+        int32_t layer;
+        uint16_t state;
+
+        /**
+         * @brief A Journal::ChangeEntity (agent or entity)
+         *
+         */
+        uint8_t entity;
+        uint8_t reserved;
+    };
+    static_assert(sizeof(Item) == 20, "The recorded item must not have padding");
+
+    /**
+     * @brief What the board hands to the recorder after a step (moved into the queue, not copied)
+     *
+     */
+    struct Frame
+    {
+        FrameKind kind;
+        int32_t step;
+
+        /**
+         * @brief The names of the states registered since the last frame (every state for keyframes and resets)
+         *
+         */
+        std::vector<std::string> states;
+
+        /**
+         * @brief The journal of the step (STEP only)
+         *
+         */
+        std::vector<Journal::Change> changes;
+
+        /**
+         * @brief A copy of each field layer (layer, cells)
+         *
+         */
+        std::vector<std::pair<int, std::vector<uint16_t>>> fields;
+
+        /**
+         * @brief Every agent and entity (KEYFRAME and RESET only)
+         *
+         */
+        std::vector<Item> items;
+
+        /**
+         * @brief The amount of cells of each state (COUNTS only)
+         *
+         */
+        std::vector<int> counts;
+    };
+
+    /**
+     * @brief Turns frames into bytes. Remembers the field layers of the last frame, so STEP frames only hold the cells that changed.
+     *
+     */
+    class Encoder
+    {
+        private:
+        /**
+         * @brief The cells of each field layer in the last frame
+         *
+         */
+        std::unordered_map<int, std::vector<uint16_t>> planes;
+
+        /**
+         * @brief The payload of the frame being written (kept, so it does not get allocated every frame)
+         *
+         */
+        std::vector<uint8_t> payload;
+
+        void encode(Frame &frame, std::vector<uint8_t> &out);
+
+        public:
+        /**
+         * @brief Append a frame ([uint8 kind][varint size][payload]) to out
+         *
+         * @param frame The frame (its field layers and items get moved out of it)
+         * @param out The bytes
+         */
+        void write(Frame &frame, std::vector<uint8_t> &out);
+    };
+
+    /**
+     * @brief Writes the frames of a board to a file from its own thread, so the board only pays for moving them into a queue.
+     *
+     * Field layers get compared against the last frame in the writer thread. If the writer falls too far behind, push waits for it.
+     */
+    class Recorder
+    {
+        private:
+        std::ofstream file;
+        std::thread writer;
+
+        std::mutex mutex;
+        std::condition_variable queued;
+        std::condition_variable written;
+        std::deque<Frame> queue;
+        bool stopping = false;
+
+        /**
+         * @brief Set by the writer thread if the file could not be written (the frames after it get dropped)
+         *
+         */
+        std::string error;
+
+        int keyframeInterval;
+
+        /**
+         * @brief Owned by the writer thread
+         *
+         */
+        Encoder encoder;
+
+        void writer_loop();
+
+        public:
+        /**
+         * @brief The frames that can wait in the queue before push blocks
+         *
+         */
+        static constexpr size_t QUEUE_LIMIT = 64;
+
+        /**
+         * @brief Open the file and start the writer thread
+         *
+         * @param path The file, replaced if it exists
+         * @param width The width of the board
+         * @param height The height of the board
+         * @param layers The amount of layers of the board
+         * @param keyframeInterval The amount of steps between keyframes
+         */
+        Recorder(const std::string &path, int width, int height, int layers, int keyframeInterval);
+        Recorder(const Recorder &) = delete;
+        Recorder &operator=(const Recorder &) = delete;
+
+        /**
+         * @brief Write what is left in the queue, and close the file
+         *
+         */
+        ~Recorder();
+
+        /**
+         * @brief Queue a frame for writing
+         *
+         * @param frame The frame (moved)
+         */
+        void push(Frame &&frame);
+
+        /**
+         * @brief Write what is left in the queue, and close the file. Called by the destructor.
+         *
+         * @return std::string Why writing failed, empty if it did not
+         */
+        std::string close();
+
+        int getKeyframeInterval();
+    };
+
+    /**
+     * @brief Reads a recording, and rebuilds the board at any of its steps without stepping anything.
+     *
+     * The file gets mapped into memory and indexed once when opened (frames written after that are not seen, open it again).
+     * Seeking starts from the last keyframe before the step, and applies the changes of the steps in between.
+     * A recording holds one run per reset (or load) of the board while it recorded. Steps are counted inside a run.
+     */
+    class Replay
+    {
+        private:
+        Checkpoint::MappedFile file;
+        Header header;
+
+        struct FrameIndex
+        {
+            size_t offset;
+            size_t size;
+            int32_t step;
+            FrameKind kind;
+            int run;
+        };
+
+        std::vector<FrameIndex> frames;
+
+        /**
+         * @brief The first frame of each run ([run]). The frames of a run go until the first frame of the next one.
+         *
+         */
+        std::vector<size_t> runs;
+
+        /**
+         * @brief The frame that will be applied by next
+         *
+         */
+        size_t position = 0;
+        int32_t step = 0;
+        int run = 0;
+
+        std::vector<std::string> states;
+        std::unordered_map<uint64_t, Item> items;
+        std::unordered_map<int, std::vector<uint16_t>> fields;
+
+        void apply(const FrameIndex &frame);
+
+        /**
+         * @brief Check a run, -1 being the current one
+         *
+         * @param run The run
+         * @return int The run
+         */
+        int run_resolve(int run);
+
+        static inline uint64_t key(uint8_t entity, int32_t id)
+        {
+            return (static_cast<uint64_t>(entity) << 32) | static_cast<uint32_t>(id);
+        }
+
+        public:
+        /**
+         * @brief Open a recording, at its first step
+         *
+         * @param path The file written by SimulatedBoard::record_start
+         */
+        Replay(const std::string &path);
+
+        /**
+         * @brief Rebuild the board at a step
+         *
+         * @param step The step (between getFirstStep and getLastStep of the run)
+         * @param run [optional] The run. -1 stays in the current one [default: -1]
+         */
+        void seek(int step, int run = -1);
+
+        /**
+         * @brief Go to the next step (after the last step of a run, the start of the next run)
+         *
+         * @return bool false if there are no more steps
+         */
+        bool next();
+
+        int getStep();
+
+        /**
+         * @brief Get the run of the current step
+         *
+         * @return int
+         */
+        int getRun();
+
+        /**
+         * @brief Get the amount of runs (1 + the resets and loads recorded)
+         *
+         * @return int
+         */
+        int getRunCount();
+
+        /**
+         * @brief Get the first step of a run
+         *
+         * @param run [optional] The run. -1 is the current one [default: -1]
+         * @return int
+         */
+        int getFirstStep(int run = -1);
+
+        /**
+         * @brief Get the last step of a run
+         *
+         * @param run [optional] The run. -1 is the current one [default: -1]
+         * @return int
+         */
+        int getLastStep(int run = -1);
+        int getWidth();
+        int getHeight();
+        int getLayerCount();
+
+        /**
+         * @brief Get every agent and entity at the current step, sorted by entity and id
+         *
+         * @return std::vector<Item>
+         */
+        std::vector<Item> getItems();
+
+        /**
+         * @brief Get the cells of a field layer at the current step (y * width + x)
+         *
+         * @param layer The layer
+         * @return const std::vector<uint16_t>&
+         */
+        const std::vector<uint16_t> &getField(int layer);
+
+        /**
+         * @brief Get the field layers of the current step
+         *
+         * @return std::vector<int>
+         */
+        std::vector<int> getFieldLayers();
+
+        /**
+         * @brief Get the names of the states, by id
+         *
+         * @return const std::vector<std::string>&
+         */
+        const std::vector<std::string> &getStates();
+    };
+}
@@ -0,0 +1,224 @@
+#include "Rules.hpp"
+#include "Board.hpp"
+#include <optional>
+#include <stdexcept>
+
+namespace fastautomata::Rules {
+    RuleSet::RuleSet(Board::SimulatedBoard *board, int layer, Neighborhood::Stencil stencil, int countLayer, bool wrap) : neighborhood(board, stencil)
+    {
+        this->board = board;
+        this->layer = layer;
+        this->countLayer = countLayer;
+        this->wrap = wrap;
+    }
+
+    void RuleSet::add(const Rule &rule)
+    {
+        size_t stateCount = this->board->states.size();
+        auto checkState = [&](uint16_t state) {
+            if (state != StateRegistry::NONE && state >= stateCount)
+            {
+                throw std::out_of_range("State id out of range (id given: " + std::to_string(state) + ")");
+            }
+        };
+
+        checkState(rule.state);
+        checkState(rule.next);
+        for (auto &condition : rule.counts)
+        {
+            if (condition.state == StateRegistry::NONE)
+            {
+                throw std::invalid_argument("A count needs a state");
+            }
+            checkState(condition.state);
+            if (condition.min > condition.max)
+            {
+                throw std::invalid_argument("The minimum of a count is bigger than its maximum");
+            }
+        }
+        if (rule.layer < -1 || rule.layer >= this->board->getLayerCount())
+        {
+            throw std::out_of_range("Layer out of range");
+        }
+        if (rule.probability < 0 || rule.probability > 1)
+        {
+            throw std::invalid_argument("The probability of a rule must be between 0 and 1");
+        }
+
+        this->rules.push_back(rule);
+        this->compiled = false;
+    }
+
+    void RuleSet::clear()
+    {
+        this->rules.clear();
+        this->table.clear();
+        this->anyState.clear();
+        this->compiled = false;
+    }
+
+    size_t RuleSet::size()
+    {
+        return this->rules.size();
+    }
+
+    Board::SimulatedBoard *RuleSet::getBoard()
+    {
+        return this->board;
+    }
+
+    int RuleSet::getLayer()
+    {
+        return this->layer;
+    }
+
+    int RuleSet::getCountLayer()
+    {
+        return this->countLayer;
+    }
+
+    bool RuleSet::getWrap()
+    {
+        return this->wrap;
+    }
+
+    const Neighborhood::Stencil &RuleSet::getStencil()
+    {
+        return this->neighborhood.getStencil();
+    }
+
+    void RuleSet::compile()
+    {
+        // the buffers of a field get swapped every step
+        this->countCells = this->board->is_field(this->countLayer) ? this->board->field(this->countLayer)->current_data() : nullptr;
+
+        size_t stateCount = this->board->states.size();
+        if (this->compiled && this->compiledStates == stateCount)
+        {
+            return;
+        }
+
+        this->table.assign(stateCount, {});
+        this->anyState.clear();
+        this->needsCounts.assign(stateCount, 0);
+        this->slots.assign(stateCount, -1);
+        this->slotCount = 0;
+        this->conditionSlots.assign(this->rules.size(), {});
+
+        for (uint32_t index = 0; index < this->rules.size(); index++)
+        {
+            const Rule &rule = this->rules[index];
+
+            // every counted state gets a slot, so one pass over the stencil counts all of them
+            for (auto &condition : rule.counts)
+            {
+                if (this->slots[condition.state] == -1)
+                {
+                    this->slots[condition.state] = static_cast<int>(this->slotCount++);
+                }
+                this->conditionSlots[index].push_back(this->slots[condition.state]);
+            }
+
+            if (rule.state == StateRegistry::NONE)
+            {
+                this->anyState.push_back(index);
+                for (size_t state = 0; state < stateCount; state++)
+                {
+                    this->table[state].push_back(index);
+                    this->needsCounts[state] |= !rule.counts.empty();
+                }
+            }
+            else
+            {
+                this->table[rule.state].push_back(index);
+                this->needsCounts[rule.state] |= !rule.counts.empty();
+            }
+        }
+
+        this->compiled = true;
+        this->compiledStates = stateCount;
+    }
+
+    bool RuleSet::evaluate(Pos pos, uint16_t state, uint64_t streamId, RuleResult &result)
+    {
+        // states registered during the step only get the rules of any state
+        bool known = state < this->table.size();
+        const std::vector<uint32_t> &candidates = known ? this->table[state] : this->anyState;
+        if (candidates.empty())
+        {
+            return false;
+        }
+
+        // count the neighbors once, for every counted state
+        thread_local std::vector<int> counts;
+        if (this->slotCount > 0 && (!known || this->needsCounts[state]))
+        {
+            counts.assign(this->slotCount, 0);
+            auto board = this->board;
+            int countLayer = this->countLayer;
+            const std::vector<int> &slots = this->slots;
+            const uint16_t *cells = this->countCells;
+            this->neighborhood.for_each(pos, this->wrap, [&](Pos, int index) {
+                uint16_t neighbor = cells != nullptr ? cells[index] : board->cell_state(countLayer, index);
+                if (neighbor < slots.size() && slots[neighbor] != -1)
+                {
+                    counts[slots[neighbor]]++;
+                }
+                return true;
+            });
+        }
+
+        std::optional<Random::RandomStream> stream;
+        for (uint32_t index : candidates)
+        {
+            const Rule &rule = this->rules[index];
+
+            bool countsHold = true;
+            const std::vector<int> &ruleSlots = this->conditionSlots[index];
+            for (size_t i = 0; i < ruleSlots.size() && countsHold; i++)
+            {
+                int count = counts[ruleSlots[i]];
+                countsHold = count >= rule.counts[i].min && count <= rule.counts[i].max;
+            }
+            if (!countsHold)
+            {
+                continue;
+            }
+
+            if (rule.layer != -1 && this->board->cell_occupied_at(rule.layer, pos.toIndex(this->board->getWidth())) != rule.occupied)
+            {
+                continue;
+            }
+
+            // moves only match if the target is free (as the board was before the step)
+            Pos target = pos;
+            bool moves = rule.move.x != 0 || rule.move.y != 0;
+            if (moves)
+            {
+                target = Pos(pos.x + rule.move.x, pos.y + rule.move.y);
+                if (!this->board->pos_resolve(target, this->wrap) || this->board->move_blocked(target, this->layer, true))
+                {
+                    continue;
+                }
+            }
+
+            if (rule.probability < 1)
+            {
+                if (!stream)
+                {
+                    stream = this->board->random_stream(streamId, Random::RandomDomain::RULES);
+                }
+                if (stream->uniform() >= rule.probability)
+                {
+                    continue;
+                }
+            }
+
+            result.state = rule.next;
+            result.moves = moves;
+            result.target = target;
+            return true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,231 @@
+/**
+ * @file Rules.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief Transition tables (own state, neighbor counts, occupancy -> next state, move) that step a layer natively
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include "ClassTypes.hpp"
+#include "Neighborhood.hpp"
+#include "Random.hpp"
+#include <vector>
+#include <cstdint>
+
+using namespace fastautomata::ClassTypes;
+
+namespace fastautomata::Board {
+    class SimulatedBoard;
+}
+
+namespace fastautomata::Rules {
+    /**
+     * @brief The amount of neighbors in a state must be in [min, max]
+     *
+     */
+    struct CountCondition
+    {
+        uint16_t state;
+        int min;
+        int max;
+    };
+
+    /**
+     * @brief One line of a transition table
+     *
+     */
+    struct Rule
+    {
+        /**
+         * @brief The state of the cell. StateRegistry::NONE matches any state.
+         *
+         */
+        uint16_t state = StateRegistry::NONE;
+
+        /**
+         * @brief The neighbor counts (over the stencil of the rule set) that must hold. All of them.
+         *
+         */
+        std::vector<CountCondition> counts;
+
+        /**
+         * @brief A layer to look at in the same cell (-1 to not look). The cell must be occupied in it (or empty, if occupied is false).
+         *
+         */
+        int layer = -1;
+        bool occupied = true;
+
+        /**
+         * @brief The next state. StateRegistry::NONE keeps the state.
+         *
+         */
+        uint16_t next = StateRegistry::NONE;
+
+        /**
+         * @brief The move to make. (0, 0) does not move. The rule only matches if the target cell is free (and inside the board, or wraps).
+         *
+         */
+        Pos move = Pos(0, 0);
+
+        /**
+         * @brief The chance of the rule firing once it matches (drawn from the board seed). If it does not fire, the next rules get checked.
+         *
+         */
+        double probability = 1;
+    };
+
+    /**
+     * @brief What a rule decided for a cell
+     *
+     */
+    struct RuleResult
+    {
+        /**
+         * @brief The next state (StateRegistry::NONE to keep it)
+         *
+         */
+        uint16_t state;
+
+        /**
+         * @brief If the cell moves, and where to
+         *
+         */
+        bool moves;
+        Pos target;
+    };
+
+    /**
+     * @brief A transition table that steps every agent, entity or field cell of a layer, without calling step().
+     *
+     * Every step, for each cell of the layer, the rules get checked in the order they were added, and the first that matches (and fires) is used.
+     * Agents and entities get their change queued (like setState and setPos), field cells get written to the next buffer. Moves are ignored on field layers.
+     *
+     * The rules get compiled into a table indexed by state, so cells only check the rules of their own state, and the neighbors only get counted if one of those rules needs it.
+     * Created (and stepped) by SimulatedBoard::rules_add.
+     */
+    class RuleSet
+    {
+        private:
+        Board::SimulatedBoard *board;
+        int layer;
+
+        /**
+         * @brief The layer the neighbors get counted in
+         *
+         */
+        int countLayer;
+        bool wrap;
+
+        Neighborhood::Neighborhood neighborhood;
+
+        std::vector<Rule> rules;
+
+        /**
+         * @brief The rules of each state, in order ([state id][n] = index in rules). Built by compile().
+         *
+         */
+        std::vector<std::vector<uint32_t>> table;
+
+        /**
+         * @brief The rules that match any state, in order (used by states registered after compile())
+         *
+         */
+        std::vector<uint32_t> anyState;
+
+        /**
+         * @brief If one of the rules of each state counts neighbors ([state id])
+         *
+         */
+        std::vector<uint8_t> needsCounts;
+
+        /**
+         * @brief The slot of the count of each counted state ([state id], -1 if it is not counted)
+         *
+         */
+        std::vector<int> slots;
+        size_t slotCount = 0;
+
+        /**
+         * @brief The slot of each condition of each rule ([rule][condition])
+         *
+         */
+        std::vector<std::vector<int>> conditionSlots;
+
+        /**
+         * @brief The current buffer of the count layer, if it is a field layer (read directly instead of through the board). Set by compile().
+         *
+         */
+        const uint16_t *countCells = nullptr;
+
+        /**
+         * @brief False if rules got added (or states registered) since the last compile()
+         *
+         */
+        bool compiled = false;
+        size_t compiledStates = 0;
+
+        public:
+        /**
+         * @brief Construct a new Rule Set. Use SimulatedBoard::rules_add instead.
+         *
+         * @param board The board
+         * @param layer The layer that gets stepped
+         * @param stencil The neighbors that get counted
+         * @param countLayer The layer the neighbors get counted in
+         * @param wrap If the stencil and the moves wrap around the edges
+         */
+        RuleSet(Board::SimulatedBoard *board, int layer, Neighborhood::Stencil stencil, int countLayer, bool wrap);
+
+        /**
+         * @brief Add a rule at the end of the table
+         *
+         * @param rule The rule (its states must be registered in the board)
+         */
+        void add(const Rule &rule);
+
+        /**
+         * @brief Remove every rule
+         *
+         */
+        void clear();
+
+        /**
+         * @brief Get the amount of rules
+         *
+         * @return size_t
+         */
+        size_t size();
+
+        Board::SimulatedBoard *getBoard();
+
+        int getLayer();
+
+        int getCountLayer();
+
+        bool getWrap();
+
+        const Neighborhood::Stencil &getStencil();
+
+        /**
+         * @brief Build the table of the rules. Only does work if rules or states got added. Called by the board before each step, not thread safe.
+         *
+         */
+        void compile();
+
+        /**
+         * @brief Check the rules for a cell. Reads the board only, so cells can be checked in parallel (after compile()).
+         *
+         * @param pos The position of the cell
+         * @param state The state of the cell
+         * @param streamId The random stream of the cell (for the probabilities)
+         * @param result Where to write what the rule decided
+         * @return true if a rule fired
+         */
+        bool evaluate(Pos pos, uint16_t state, uint64_t streamId, RuleResult &result);
+    };
+}
@@ -0,0 +1,146 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace fastautomata::Threading {
+    /**
+     * @brief True for threads that are currently running a job of a pool
+     * 
+     */
+    static thread_local bool insideJob = false;
+
+    ThreadPool::ThreadPool(int threads)
+    {
+        this->nextIndex = 0;
+
+        // the caller of parallel_for works as well
+        for (int i = 1; i < threads; i++)
+        {
+            this->workers.emplace_back(&ThreadPool::worker_loop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+
+        for (auto &worker : this->workers)
+        {
+            worker.join();
+        }
+    }
+
+    int ThreadPool::getThreadCount()
+    {
+        return static_cast<int>(this->workers.size()) + 1;
+    }
+
+    void ThreadPool::worker_loop()
+    {
+        uint64_t seenGeneration = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->wake.wait(lock, [&]() { return this->stopping || this->generation != seenGeneration; });
+
+                if (this->stopping)
+                {
+                    return;
+                }
+                seenGeneration = this->generation;
+            }
+
+            this->run_chunks();
+
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->busyWorkers--;
+            }
+            this->finished.notify_one();
+        }
+    }
+
+    void ThreadPool::run_chunks()
+    {
+        insideJob = true;
+
+        while (true)
+        {
+            size_t begin = this->nextIndex.fetch_add(this->jobChunk);
+            if (begin >= this->jobCount)
+            {
+                break;
+            }
+            size_t end = std::min(begin + this->jobChunk, this->jobCount);
+
+            try
+            {
+                (*this->job)(begin, end);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                if (!this->error)
+                {
+                    this->error = std::current_exception();
+                }
+            }
+        }
+
+        insideJob = false;
+    }
+
+    void ThreadPool::parallel_for(size_t count, size_t chunk, const std::function<void(size_t, size_t)> &func)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        // nested calls and pools without workers run in the calling thread
+        if (insideJob || this->workers.empty())
+        {
+            func(0, count);
+            return;
+        }
+
+        if (chunk == 0)
+        {
+            // a few chunks per thread, so threads that finish early can take more work
+            chunk = std::max<size_t>(1, count / (this->getThreadCount() * 8));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->job = &func;
+            this->jobCount = count;
+            this->jobChunk = chunk;
+            this->nextIndex = 0;
+            this->error = nullptr;
+            this->busyWorkers = static_cast<int>(this->workers.size());
+            this->generation++;
+        }
+        this->wake.notify_all();
+
+        this->run_chunks();
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->finished.wait(lock, [&]() { return this->busyWorkers == 0; });
+            this->job = nullptr;
+            error = this->error;
+            this->error = nullptr;
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
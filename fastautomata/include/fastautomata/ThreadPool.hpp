@@ -0,0 +1,107 @@
+/**
+ * @file ThreadPool.hpp
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief A persistent pool of threads used to step boards in parallel
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+namespace fastautomata::Threading {
+    /**
+     * @brief A pool of threads that live as long as the pool. Work gets split in chunks, and every thread (the caller included) grabs the next free chunk until there are none left.
+     * 
+     */
+    class ThreadPool
+    {
+        private:
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+
+        /**
+         * @brief The job being run. Only valid while a parallel_for is running.
+         * 
+         */
+        const std::function<void(size_t, size_t)> *job = nullptr;
+        size_t jobCount = 0;
+        size_t jobChunk = 1;
+
+        /**
+         * @brief The start of the next chunk that has not been taken
+         * 
+         */
+        std::atomic<size_t> nextIndex;
+
+        /**
+         * @brief Incremented on every parallel_for, so workers know there is a new job
+         * 
+         */
+        uint64_t generation = 0;
+
+        /**
+         * @brief The amount of workers still running the current job
+         * 
+         */
+        int busyWorkers = 0;
+
+        bool stopping = false;
+
+        /**
+         * @brief The first exception thrown by the current job
+         * 
+         */
+        std::exception_ptr error;
+
+        void worker_loop();
+
+        /**
+         * @brief Take and run chunks of the current job until there are none left
+         * 
+         */
+        void run_chunks();
+
+        public:
+        /**
+         * @brief Construct a new Thread Pool object
+         * 
+         * @param threads The amount of threads that will run a job (the caller of parallel_for counts as one)
+         */
+        ThreadPool(int threads);
+
+        ~ThreadPool();
+
+        /**
+         * @brief Get the amount of threads that run a job (the caller included)
+         * 
+         * @return int 
+         */
+        int getThreadCount();
+
+        /**
+         * @brief Run func over [0, count), split in chunks of (at most) chunk elements. Blocks until every chunk is done.
+         * 
+         * If any chunk throws, the first exception gets rethrown here once every chunk finished.
+         * Calling it from inside a job runs the whole range in the calling thread.
+         * 
+         * @param count The amount of elements
+         * @param chunk The amount of elements per chunk. If 0, a size gets picked from count and the thread count.
+         * @param func The function to call with the range of each chunk (begin, end)
+         */
+        void parallel_for(size_t count, size_t chunk, const std::function<void(size_t, size_t)> &func);
+    };
+}
@@ -1,51 +1,318 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/functional.h>  
 #include <pybind11/stl.h>         
+#include <pybind11/numpy.h>
 #include "ClassTypes.hpp"
 #include "Board.hpp"
 #include "Agents.hpp"
+#include "Ensemble.hpp"
+#include "Neighborhood.hpp"
+#include "FlowField.hpp"
+#include "Journal.hpp"
+#include "Rules.hpp"
+#include "Kernels.hpp"
+#include "Recorder.hpp"
+#include <optional>
+#include <algorithm>
 
 namespace py = pybind11;
 
 using namespace fastautomata::Board;
 using namespace fastautomata::ClassTypes;
 using namespace fastautomata::Agents;
+using namespace fastautomata::Neighborhood;
+using namespace fastautomata::Paths;
+
+/**
+ * @brief agents_spawn from numpy: positions is an (n, 2) array of x, y. layers has one value per position, or a single one.
+ * 
+ * simulated agents are plain (native) Agents: they get stepped, and do nothing unless a rule set drives their layer.
+ * With a kernel (the address of a fa_agent_kernel), they are KernelAgents stepped by it.
+ * 
+ */
+static py::array_t<int32_t> spawn_agents(SimulatedBoard &board, py::array_t<int32_t, py::array::c_style | py::array::forcecast> positions, std::vector<uint16_t> states, py::array_t<int32_t, py::array::c_style | py::array::forcecast> layers, bool simulated, uintptr_t kernel, uintptr_t userData)
+{
+    if (positions.ndim() != 2 || positions.shape(1) != 2)
+    {
+        throw std::invalid_argument("The positions must be an array of shape (n, 2)");
+    }
+
+    std::vector<Pos> cells(positions.shape(0));
+    const int32_t *xy = positions.data();
+    for (size_t i = 0; i < cells.size(); i++)
+    {
+        cells[i] = Pos(xy[i * 2], xy[i * 2 + 1]);
+    }
+    std::vector<int> cellLayers(layers.data(), layers.data() + layers.size());
+
+    std::function<BaseAgent *()> factory = nullptr;
+    if (kernel != 0)
+    {
+        factory = [kernel, userData]() -> BaseAgent * {
+            auto agent = new fastautomata::Kernels::KernelAgent();
+            agent->setKernel(reinterpret_cast<fa_agent_kernel>(kernel), reinterpret_cast<void *>(userData));
+            return agent;
+        };
+    }
+    else if (simulated)
+    {
+        factory = []() -> BaseAgent * { return new Agent(); };
+    }
+    std::vector<int> ids = board.agents_spawn(cells, states, cellLayers, factory);
+    py::array_t<int32_t> result(static_cast<ssize_t>(ids.size()));
+    std::copy(ids.begin(), ids.end(), result.mutable_data());
+    return result;
+}
+
+/**
+ * @brief Check a buffer given to write results into: it is used as is, so it must be a writeable, c contiguous int32 array of the given shape.
+ * 
+ */
+static py::array_t<int32_t, py::array::c_style> output_check(py::array out, const std::vector<ssize_t> &shape, const std::string &shapeName)
+{
+    if (!out.dtype().is(py::dtype::of<int32_t>()))
+    {
+        throw std::invalid_argument("The output must be an int32 array, got " + py::str(out.dtype()).cast<std::string>());
+    }
+    if (!(out.flags() & py::array::c_style) || !out.writeable())
+    {
+        throw std::invalid_argument("The output must be a writeable, c contiguous array");
+    }
+    if (out.ndim() != static_cast<ssize_t>(shape.size()) || !std::equal(shape.begin(), shape.end(), out.shape()))
+    {
+        throw std::invalid_argument("The output must be an int32 array of shape " + shapeName);
+    }
+    return py::reinterpret_borrow<py::array_t<int32_t, py::array::c_style>>(out);
+}
+
+/**
+ * @brief A read only numpy view of a vector owned by a python object (no copy). The view keeps the owner alive.
+ * 
+ */
+template <typename T>
+static py::array_t<T> vector_view(py::object owner, const std::vector<T> &values)
+{
+    py::array_t<T> view(static_cast<ssize_t>(values.size()), values.data(), owner);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
 
 PYBIND11_MODULE(fastautomata_clib, m) {
+    // journal entries go to python as a structured numpy array (one record per change)
+    PYBIND11_NUMPY_DTYPE(fastautomata::Journal::Change, step, id, x_old, y_old, x_new, y_new, state_old, state_new, layer_old, layer_new, kind, entity);
+    PYBIND11_NUMPY_DTYPE(fastautomata::Recording::Item, id, x, y, layer, state, entity);
+
     py::class_<SimulatedBoard>(m, "SimulatedBoard")
         .def(py::init<int, int, int>())
         .def("getWidth", &SimulatedBoard::getWidth)
         .def("getHeight", &SimulatedBoard::getHeight)
         .def("getLayerCount", &SimulatedBoard::getLayerCount)
+        .def("setThreadCount", &SimulatedBoard::setThreadCount)
+        .def("getThreadCount", &SimulatedBoard::getThreadCount)
+        .def("setSeed", &SimulatedBoard::setSeed)
+        .def("getSeed", &SimulatedBoard::getSeed)
+        .def("setMovePolicy", &SimulatedBoard::setMovePolicy, py::arg("policy"), py::arg("allowSwaps") = false)
+        .def("getMovePolicy", &SimulatedBoard::getMovePolicy)
+        .def("random", &SimulatedBoard::random)
+        .def("random_int", &SimulatedBoard::random_int, py::arg("low"), py::arg("high"))
+        .def("random_uniform", [](SimulatedBoard &board, size_t count) {
+            py::array_t<double> values(count);
+            board.random_fill(values.mutable_data(), count);
+            return values;
+        }, py::arg("count"))
+        .def("setActiveScheduling", &SimulatedBoard::setActiveScheduling, py::arg("enabled"), py::arg("radius") = 1, py::arg("wrap") = false)
+        .def("getActiveScheduling", &SimulatedBoard::getActiveScheduling)
+        .def("getActiveCount", &SimulatedBoard::getActiveCount)
         .def("reset", &SimulatedBoard::reset)
-        .def("step", &SimulatedBoard::step)
-        .def("agent_get", &SimulatedBoard::agent_get)
+        .def("step", [](SimulatedBoard &board) {
+            // native boards do not need python while stepping, so other threads can run (python callbacks take the GIL back)
+            if (board.is_native())
+            {
+                py::gil_scoped_release release;
+                board.step();
+            }
+            else
+            {
+                board.step();
+            }
+        })
+        .def("step_n", [](SimulatedBoard &board, int n) {
+            for (int i = 0; i < n; i++)
+            {
+                if (board.is_native())
+                {
+                    py::gil_scoped_release release;
+                    board.step();
+                }
+                else
+                {
+                    board.step();
+                }
+            }
+        }, py::arg("n"))
+        .def("is_native", &SimulatedBoard::is_native)
+        .def("agent_get", &SimulatedBoard::agent_get, py::return_value_policy::reference)
         .def("agent_add", &SimulatedBoard::agent_add)
         .def("agent_remove", &SimulatedBoard::agent_remove)
+        .def("agent_by_id", &SimulatedBoard::agent_by_id, py::return_value_policy::reference)
+        .def("getAgentCount", &SimulatedBoard::getAgentCount)
+        .def("entities", &SimulatedBoard::entities, py::return_value_policy::reference_internal)
+        .def("entity_at", &SimulatedBoard::entity_at, py::arg("pos"), py::arg("layer") = 0)
         .def("agent_move", &SimulatedBoard::agent_move)
         .def("agent_move_layer", &SimulatedBoard::agent_move_layer)
         .def("update_agents", &SimulatedBoard::update_agents)
         .def("update_agents_end", &SimulatedBoard::update_agents_end)
-        .def("getCollisions", &SimulatedBoard::getCollisions)
+        .def("getCollisions", &SimulatedBoard::getCollisions, py::return_value_policy::reference)
+        .def("move_blocked", [](SimulatedBoard &board, Pos pos, int layer, bool includeSelf) {
+            // the c++ version does not check its arguments (it is called for every move)
+            if (pos.x < 0 || pos.y < 0 || pos.x >= board.getWidth() || pos.y >= board.getHeight())
+            {
+                throw std::out_of_range("Position out of range when trying to check for collisions. (Pos given: " + pos.toString() + ")");
+            }
+            if (layer < 0 || layer >= board.getLayerCount())
+            {
+                throw std::out_of_range("Layer out of range when trying to check for collisions. (Layer given: " + std::to_string(layer) + ")");
+            }
+            return board.move_blocked(pos, layer, includeSelf);
+        }, py::arg("pos"), py::arg("layer"), py::arg("includeSelf") = true)
+        .def("flow_field", &SimulatedBoard::flow_field, py::arg("targets"), py::arg("layer") = 0, py::arg("diagonal") = true, py::arg("wrap") = false, py::keep_alive<0, 1>())
+        .def("flow_fields_clear", &SimulatedBoard::flow_fields_clear)
         .def("getRandomColor", &SimulatedBoard::getRandomColor)
-        .def("updateColor", &SimulatedBoard::updateColor)
+        .def_static("getStateColor", &SimulatedBoard::getStateColor)
+        .def("updateColor", static_cast<void (SimulatedBoard::*)(std::string, std::string)>(&SimulatedBoard::updateColor))
         .def("addColor", &SimulatedBoard::addColor)
+        .def("getColor", &SimulatedBoard::getColor)
+        .def("getStateId", &SimulatedBoard::state_id)
+        .def("getStateName", &SimulatedBoard::state_name)
         .def("append_on_add", &SimulatedBoard::append_on_add)
         .def("append_on_delete", &SimulatedBoard::append_on_delete)
+        .def("append_on_spawn", &SimulatedBoard::append_on_spawn)
+        .def("agents_spawn", [](SimulatedBoard &board, py::array_t<int32_t, py::array::c_style | py::array::forcecast> positions, std::string state, py::array_t<int32_t, py::array::c_style | py::array::forcecast> layers, bool simulated, uintptr_t kernel, uintptr_t userData) {
+            return spawn_agents(board, positions, {board.state_id(state)}, layers, simulated, kernel, userData);
+        }, py::arg("positions"), py::arg("state"), py::arg("layers") = 0, py::arg("simulated") = false, py::arg("kernel") = 0, py::arg("userData") = 0)
+        .def("agents_spawn", [](SimulatedBoard &board, py::array_t<int32_t, py::array::c_style | py::array::forcecast> positions, py::array_t<uint16_t, py::array::c_style | py::array::forcecast> states, py::array_t<int32_t, py::array::c_style | py::array::forcecast> layers, bool simulated, uintptr_t kernel, uintptr_t userData) {
+            return spawn_agents(board, positions, std::vector<uint16_t>(states.data(), states.data() + states.size()), layers, simulated, kernel, userData);
+        }, py::arg("positions"), py::arg("states"), py::arg("layers") = 0, py::arg("simulated") = false, py::arg("kernel") = 0, py::arg("userData") = 0)
         .def("append_on_reset", &SimulatedBoard::append_on_reset)
         .def("step_instructions_add", &SimulatedBoard::step_instructions_add)
         .def("step_instructions_flush", &SimulatedBoard::step_instructions_flush)
+        .def("field_enable", &SimulatedBoard::field_enable, py::arg("layer"), py::arg("emptyState") = "None")
+        .def("is_field", &SimulatedBoard::is_field)
+        .def("field_get", &SimulatedBoard::field_get, py::arg("pos"), py::arg("layer"), py::arg("wrap") = false)
+        .def("field_get_id", &SimulatedBoard::field_get_id, py::arg("pos"), py::arg("layer"), py::arg("wrap") = false)
+        .def("field_set", &SimulatedBoard::field_set)
+        .def("field_set_id", &SimulatedBoard::field_set_id)
+        .def("field_put", &SimulatedBoard::field_put)
+        .def("field_put_id", &SimulatedBoard::field_put_id)
+        .def("neighbor_count", [](SimulatedBoard &board, int layer, std::string state, const Stencil &stencil, bool wrap, std::optional<py::array> out) {
+            // write into the caller's buffer when given (it must already have the right shape and dtype)
+            std::vector<ssize_t> shape{board.getHeight(), board.getWidth()};
+            py::array_t<int32_t, py::array::c_style> counts = out ? output_check(*out, shape, "(height, width)") : py::array_t<int32_t, py::array::c_style>(shape);
+            uint16_t stateId = board.state_id(state);
+            int32_t *data = counts.mutable_data();
+            {
+                py::gil_scoped_release release;
+                board.neighbor_count(layer, stateId, stencil, data, wrap);
+            }
+            return counts;
+        }, py::arg("layer"), py::arg("state"), py::arg("stencil"), py::arg("wrap") = false, py::arg("out").noconvert() = std::nullopt)
+        .def("neighbor_counts", [](SimulatedBoard &board, int layer, const Stencil &stencil, bool wrap, std::optional<py::array> out) {
+            // one plane per registered state, indexed by state id (see getStateId). A given buffer can have fewer planes.
+            ssize_t stateCount = out && out->ndim() == 3 ? out->shape(0) : static_cast<ssize_t>(board.states.size());
+            std::vector<ssize_t> shape{stateCount, board.getHeight(), board.getWidth()};
+            py::array_t<int32_t, py::array::c_style> counts = out ? output_check(*out, shape, "(states, height, width)") : py::array_t<int32_t, py::array::c_style>(shape);
+            int32_t *data = counts.mutable_data();
+            {
+                py::gil_scoped_release release;
+                board.neighbor_counts(layer, stencil, data, static_cast<size_t>(stateCount), wrap);
+            }
+            return counts;
+        }, py::arg("layer"), py::arg("stencil"), py::arg("wrap") = false, py::arg("out").noconvert() = std::nullopt)
+        .def("layer_view", [](py::object self, int layer) {
+            // a read only view of a buffer of the board (no copy). It keeps the board alive.
+            SimulatedBoard &board = self.cast<SimulatedBoard &>();
+            const uint16_t *data = board.layer_view(layer);
+            py::array_t<uint16_t> view({board.getHeight(), board.getWidth()}, data, self);
+            view.attr("setflags")(py::arg("write") = false);
+            return view;
+        }, py::arg("layer"))
+        .def("occupancy_view", [](py::object self) -> py::object {
+            SimulatedBoard &board = self.cast<SimulatedBoard &>();
+            const uint64_t *data = board.occupancy_data();
+            if (data == nullptr)
+            {
+                return py::none();
+            }
+            py::array_t<uint64_t> view({board.getHeight(), board.getWidth()}, data, self);
+            view.attr("setflags")(py::arg("write") = false);
+            return view;
+        })
+        .def("views_sync", &SimulatedBoard::views_sync)
+        .def("journal_enable", &SimulatedBoard::journal_enable, py::arg("enabled") = true)
+        .def("getJournalEnabled", &SimulatedBoard::getJournalEnabled)
+        .def("getJournalSize", &SimulatedBoard::getJournalSize)
+        .def("journal_take", [](SimulatedBoard &board) {
+            std::vector<fastautomata::Journal::Change> changes = board.journal_take();
+            py::array_t<fastautomata::Journal::Change> result(static_cast<ssize_t>(changes.size()));
+            std::copy(changes.begin(), changes.end(), result.mutable_data());
+            return result;
+        })
+        .def("life_add", &SimulatedBoard::life_add, py::arg("layer"), py::arg("rule"), py::arg("wrap") = false, py::arg("aliveState") = "Alive", py::arg("deadState") = "Dead", py::return_value_policy::reference_internal)
+        .def("rules_add", &SimulatedBoard::rules_add, py::arg("layer"), py::arg("stencil"), py::arg("countLayer") = -1, py::arg("wrap") = false, py::return_value_policy::reference_internal)
+        .def("kernel_add", [](SimulatedBoard &board, uintptr_t kernel, uintptr_t userData) {
+            // addresses, as given by a numba cfunc (.address), ctypes or kernel_load
+            board.kernel_add(reinterpret_cast<fa_board_kernel>(kernel), reinterpret_cast<void *>(userData));
+        }, py::arg("kernel"), py::arg("userData") = 0)
+        .def("kernels_clear", &SimulatedBoard::kernels_clear)
+        .def("save", &SimulatedBoard::save, py::arg("path"))
+        .def("load", &SimulatedBoard::load, py::arg("path"), py::arg("restore") = nullptr)
+        .def("record_start", &SimulatedBoard::record_start, py::arg("path"), py::arg("keyframeInterval") = 100)
+        .def("record_stop", &SimulatedBoard::record_stop)
+        .def("getRecording", &SimulatedBoard::getRecording)
+        .def("stream_enable", &SimulatedBoard::stream_enable, py::arg("enabled") = true)
+        .def("getStreamEnabled", &SimulatedBoard::getStreamEnabled)
+        .def("stream_take", [](SimulatedBoard &board) {
+            std::vector<uint8_t> frames = board.stream_take();
+            return py::bytes(reinterpret_cast<const char *>(frames.data()), frames.size());
+        })
+        .def("stream_keyframe", [](SimulatedBoard &board, bool header) {
+            std::vector<uint8_t> frames = board.stream_keyframe(header);
+            return py::bytes(reinterpret_cast<const char *>(frames.data()), frames.size());
+        }, py::arg("header") = false)
+        .def("scalar_add", &SimulatedBoard::scalar_add, py::arg("name"), py::arg("wrap") = false, py::return_value_policy::reference_internal)
+        .def("scalar", &SimulatedBoard::scalar, py::arg("name"), py::return_value_policy::reference_internal)
         .def("__del__", &SimulatedBoard::delete_this)
-        .def_readonly("color_map_count", &SimulatedBoard::color_map_count)
+        .def_property_readonly("color_map_count", &SimulatedBoard::getColorMapCount)
         .def_property_readonly("step_count", &SimulatedBoard::getStepCount)
+        .def_readwrite("simulated", &SimulatedBoard::simulated)
         .def_readwrite("layer_collisions", &SimulatedBoard::layer_collisions)
         .def_readwrite("step_instructions", &SimulatedBoard::step_instructions)
-        .def_readwrite("color_map", &SimulatedBoard::color_map)
+        .def_property("color_map", &SimulatedBoard::getColorMap, &SimulatedBoard::setColorMap)
         .def_readwrite("on_reset", &SimulatedBoard::on_reset)
         .def_readwrite("on_add", &SimulatedBoard::on_add)
         .def_readwrite("on_delete", &SimulatedBoard::on_delete)
+        .def_readwrite("on_spawn", &SimulatedBoard::on_spawn)
         .def_readwrite("python_on_delete", &SimulatedBoard::python_on_delete);
 
+    py::class_<AgentStore>(m, "AgentStore")
+        .def("spawn", [](AgentStore &store, Pos pos, std::string state, int layer) {
+            return store.spawn(pos, store.getBoard()->state_id(state), layer);
+        }, py::arg("pos"), py::arg("state"), py::arg("layer") = 0)
+        .def("spawn_id", &AgentStore::spawn, py::arg("pos"), py::arg("state"), py::arg("layer") = 0)
+        .def("kill", &AgentStore::kill)
+        .def("size", &AgentStore::size)
+        .def("__len__", &AgentStore::size)
+        .def("index", &AgentStore::index)
+        .def("attribute_add", &AgentStore::attribute_add, py::arg("name"), py::arg("value") = 0.0)
+        .def("attribute_get", &AgentStore::attribute_get)
+        .def("attribute_set", &AgentStore::attribute_set)
+        .def("getPos", &AgentStore::getPos)
+        .def("getStateId", &AgentStore::getStateId)
+        .def("getState", [](AgentStore &store, uint32_t id) {
+            return store.getBoard()->state_name(store.getStateId(id));
+        })
+        .def("kernel_flush", &AgentStore::kernel_flush);
+
     py::class_<BaseAgent, BaseAgentPy>(m, "BaseAgent")
         .def(py::init<>(), py::return_value_policy::take_ownership)
         .def(py::init<SimulatedBoard*, Pos, std::string, int, bool>(), py::return_value_policy::take_ownership)
@@ -55,6 +322,7 @@ PYBIND11_MODULE(fastautomata_clib, m) {
         .def("getId", &BaseAgent::getId)
         .def("getLayer", &BaseAgent::getLayer)
         .def_property("state", &BaseAgent::getState, py::cpp_function())
+        .def_property_readonly("state_id", &BaseAgent::getStateId)
         .def("kill", &BaseAgent::kill)
         .def_readonly("board", &BaseAgent::board)
         .def("checkCollisions", &BaseAgent::checkCollisions);
@@ -68,12 +336,158 @@ PYBIND11_MODULE(fastautomata_clib, m) {
             py::cpp_function(&Agent::getPos, py::return_value_policy::copy),
             py::cpp_function(&Agent::setPos))
         .def_property("state", &Agent::getState, &Agent::setState)
-        .def("get_neighbors", &Agent::get_neighbors)
+        .def_property("state_id", &Agent::getStateId, &Agent::setStateId)
+        .def("get_neighbors", &Agent::get_neighbors, py::return_value_policy::reference)
+        .def("wake", &Agent::wake)
+        .def("random", &Agent::random)
+        .def("random_int", &Agent::random_int, py::arg("low"), py::arg("high"))
+        .def("random_normal", &Agent::random_normal, py::arg("mean") = 0.0, py::arg("deviation") = 1.0)
         .def_readwrite("on_update", &Agent::on_update)
         .def("append_on_update", &Agent::append_on_update)
         .def("__repr__", &Agent::toString)
         .def("__str__", &Agent::objInfo);
         
+    py::class_<fastautomata::Kernels::KernelAgent, Agent>(m, "KernelAgent")
+        .def(py::init([](SimulatedBoard *board, Pos pos, std::string state, int layer, uintptr_t kernel, uintptr_t userData, bool allowOverriding) {
+            return new fastautomata::Kernels::KernelAgent(board, pos, state, layer, reinterpret_cast<fa_agent_kernel>(kernel), reinterpret_cast<void *>(userData), allowOverriding);
+        }), py::arg("board"), py::arg("pos"), py::arg("state"), py::arg("layer"), py::arg("kernel"), py::arg("userData") = 0, py::arg("allowOverriding") = false, py::return_value_policy::take_ownership)
+        .def("setKernel", [](fastautomata::Kernels::KernelAgent &agent, uintptr_t kernel, uintptr_t userData) {
+            agent.setKernel(reinterpret_cast<fa_agent_kernel>(kernel), reinterpret_cast<void *>(userData));
+        }, py::arg("kernel"), py::arg("userData") = 0)
+        .def_property_readonly("kernel", [](fastautomata::Kernels::KernelAgent &agent) {
+            return reinterpret_cast<uintptr_t>(agent.getKernel());
+        });
+
+    m.def("kernel_load", [](std::string path, std::string symbol) {
+        return reinterpret_cast<uintptr_t>(fastautomata::Kernels::symbol_load(path, symbol));
+    }, py::arg("path"), py::arg("symbol"));
+
+    m.attr("CAPI_VERSION") = FASTAUTOMATA_CAPI_VERSION;
+
+    py::class_<fastautomata::Life::LifeRule>(m, "LifeRule")
+        .def_property_readonly("rule", &fastautomata::Life::LifeRule::getRule)
+        .def_property_readonly("wrap", &fastautomata::Life::LifeRule::getWrap)
+        .def("population", &fastautomata::Life::LifeRule::population);
+
+    py::class_<fastautomata::Rules::RuleSet>(m, "RuleSet")
+        .def("add", [](fastautomata::Rules::RuleSet &rules, std::optional<std::string> state, std::optional<std::string> next, std::map<std::string, std::pair<int, int>> counts, Pos move, double probability, int layer, bool occupied) {
+            // states by name (unknown ones get registered, like setState)
+            auto board = rules.getBoard();
+            fastautomata::Rules::Rule rule;
+            rule.state = state ? board->state_id(*state) : StateRegistry::NONE;
+            rule.next = next ? board->state_id(*next) : StateRegistry::NONE;
+            for (auto &count : counts)
+            {
+                rule.counts.push_back({board->state_id(count.first), count.second.first, count.second.second});
+            }
+            rule.move = move;
+            rule.probability = probability;
+            rule.layer = layer;
+            rule.occupied = occupied;
+            rules.add(rule);
+        }, py::arg("state") = std::nullopt, py::arg("next") = std::nullopt, py::arg("counts") = std::map<std::string, std::pair<int, int>>(), py::arg("move") = Pos(0, 0), py::arg("probability") = 1.0, py::arg("layer") = -1, py::arg("occupied") = true)
+        .def("clear", &fastautomata::Rules::RuleSet::clear)
+        .def("__len__", &fastautomata::Rules::RuleSet::size)
+        .def_property_readonly("layer", &fastautomata::Rules::RuleSet::getLayer)
+        .def_property_readonly("countLayer", &fastautomata::Rules::RuleSet::getCountLayer)
+        .def_property_readonly("wrap", &fastautomata::Rules::RuleSet::getWrap);
+
+    py::class_<fastautomata::Fields::ScalarField>(m, "ScalarField", py::buffer_protocol())
+        .def_buffer([](fastautomata::Fields::ScalarField &field) -> py::buffer_info {
+            // numpy.asarray(field) is a (height, width) float32 view, no copy
+            return py::buffer_info(
+                field.data(),
+                sizeof(float),
+                py::format_descriptor<float>::format(),
+                2,
+                {static_cast<ssize_t>(field.getHeight()), static_cast<ssize_t>(field.getWidth())},
+                {static_cast<ssize_t>(sizeof(float) * field.getWidth()), static_cast<ssize_t>(sizeof(float))});
+        })
+        .def_property_readonly("wrap", &fastautomata::Fields::ScalarField::getWrap)
+        .def_property_readonly("diffusion", &fastautomata::Fields::ScalarField::getDiffusion)
+        .def_property_readonly("evaporation", &fastautomata::Fields::ScalarField::getEvaporation)
+        .def("setRates", &fastautomata::Fields::ScalarField::setRates, py::arg("diffusion"), py::arg("evaporation"))
+        .def("setStencil", &fastautomata::Fields::ScalarField::setStencil, py::arg("stencil"))
+        .def("sample", &fastautomata::Fields::ScalarField::sample, py::arg("pos"))
+        .def("deposit", &fastautomata::Fields::ScalarField::deposit, py::arg("pos"), py::arg("amount"))
+        .def("deposit_layer", [](fastautomata::Fields::ScalarField &field, int layer, float amount, std::optional<std::string> state) {
+            field.deposit_layer(layer, amount, state ? field.getBoard()->state_id(*state) : StateRegistry::NONE);
+        }, py::arg("layer"), py::arg("amount"), py::arg("state") = std::nullopt)
+        .def("fill", &fastautomata::Fields::ScalarField::fill, py::arg("value"))
+        .def("total", &fastautomata::Fields::ScalarField::total)
+        .def("diffuse", &fastautomata::Fields::ScalarField::diffuse, py::arg("rate"), py::arg("stencil"), py::call_guard<py::gil_scoped_release>())
+        .def("evaporate", &fastautomata::Fields::ScalarField::evaporate, py::arg("rate"), py::call_guard<py::gil_scoped_release>())
+        .def("gradient", &fastautomata::Fields::ScalarField::gradient, py::arg("pos"))
+        .def("uphill", &fastautomata::Fields::ScalarField::uphill, py::arg("pos"));
+
+    py::class_<fastautomata::Checkpoint::AgentRecord>(m, "AgentRecord")
+        .def_readonly("id", &fastautomata::Checkpoint::AgentRecord::id)
+        .def_readonly("layer", &fastautomata::Checkpoint::AgentRecord::layer)
+        .def_readonly("state", &fastautomata::Checkpoint::AgentRecord::state)
+        .def_readonly("type", &fastautomata::Checkpoint::AgentRecord::type)
+        .def_property_readonly("awake", [](const fastautomata::Checkpoint::AgentRecord &record) {
+            return (record.flags & fastautomata::Checkpoint::AgentRecord::AWAKE) != 0;
+        })
+        .def_property_readonly("pos", [](const fastautomata::Checkpoint::AgentRecord &record) {
+            return Pos(record.x, record.y);
+        });
+
+    py::class_<fastautomata::Recording::Replay>(m, "Replay")
+        .def(py::init<std::string>(), py::arg("path"))
+        .def("seek", &fastautomata::Recording::Replay::seek, py::arg("step"), py::arg("run") = -1)
+        .def("next", &fastautomata::Recording::Replay::next)
+        .def("getStep", &fastautomata::Recording::Replay::getStep)
+        .def("getRun", &fastautomata::Recording::Replay::getRun)
+        .def("getRunCount", &fastautomata::Recording::Replay::getRunCount)
+        .def("getFirstStep", &fastautomata::Recording::Replay::getFirstStep, py::arg("run") = -1)
+        .def("getLastStep", &fastautomata::Recording::Replay::getLastStep, py::arg("run") = -1)
+        .def("getWidth", &fastautomata::Recording::Replay::getWidth)
+        .def("getHeight", &fastautomata::Recording::Replay::getHeight)
+        .def("getLayerCount", &fastautomata::Recording::Replay::getLayerCount)
+        .def("getFieldLayers", &fastautomata::Recording::Replay::getFieldLayers)
+        .def("getStates", &fastautomata::Recording::Replay::getStates)
+        .def("items", [](fastautomata::Recording::Replay &replay) {
+            std::vector<fastautomata::Recording::Item> items = replay.getItems();
+            py::array_t<fastautomata::Recording::Item> result(static_cast<ssize_t>(items.size()));
+            std::copy(items.begin(), items.end(), result.mutable_data());
+            return result;
+        })
+        .def("field", [](fastautomata::Recording::Replay &replay, int layer) {
+            // a copy: the cells change with the next seek
+            const std::vector<uint16_t> &cells = replay.getField(layer);
+            py::array_t<uint16_t> result({replay.getHeight(), replay.getWidth()});
+            std::copy(cells.begin(), cells.end(), result.mutable_data());
+            return result;
+        }, py::arg("layer"));
+
+    py::class_<fastautomata::Ensemble::EnsembleResult>(m, "EnsembleResult")
+        .def_property_readonly("run", [](py::object self) { return vector_view(self, self.cast<fastautomata::Ensemble::EnsembleResult &>().run); })
+        .def_property_readonly("seed", [](py::object self) { return vector_view(self, self.cast<fastautomata::Ensemble::EnsembleResult &>().seed); })
+        .def_property_readonly("steps", [](py::object self) { return vector_view(self, self.cast<fastautomata::Ensemble::EnsembleResult &>().steps); })
+        .def_property_readonly("time", [](py::object self) { return vector_view(self, self.cast<fastautomata::Ensemble::EnsembleResult &>().time); })
+        .def_property_readonly("step_time_mean", [](py::object self) { return vector_view(self, self.cast<fastautomata::Ensemble::EnsembleResult &>().step_time_mean); })
+        .def_property_readonly("step_time_max", [](py::object self) { return vector_view(self, self.cast<fastautomata::Ensemble::EnsembleResult &>().step_time_max); })
+        .def_property_readonly("state_counts", [](py::object self) {
+            py::dict counts;
+            for (auto &kv : self.cast<fastautomata::Ensemble::EnsembleResult &>().state_counts)
+            {
+                counts[py::str(kv.first)] = vector_view(self, kv.second);
+            }
+            return counts;
+        })
+        .def("columns", &fastautomata::Ensemble::EnsembleResult::columns)
+        .def("to_csv", &fastautomata::Ensemble::EnsembleResult::to_csv, py::arg("filename"), py::arg("append") = false)
+        .def("__len__", &fastautomata::Ensemble::EnsembleResult::size);
+
+    py::class_<fastautomata::Ensemble::EnsembleRunner>(m, "Ensemble")
+        .def(py::init<int>(), py::arg("threads") = 0)
+        .def("add", &fastautomata::Ensemble::EnsembleRunner::add, py::arg("board"), py::arg("seed") = 0, py::arg("maxSteps") = 0, py::keep_alive<1, 2>())
+        .def("setStop", &fastautomata::Ensemble::EnsembleRunner::setStop)
+        .def("size", &fastautomata::Ensemble::EnsembleRunner::size)
+        .def("clear", &fastautomata::Ensemble::EnsembleRunner::clear)
+        .def("getThreadCount", &fastautomata::Ensemble::EnsembleRunner::getThreadCount)
+        .def("run", &fastautomata::Ensemble::EnsembleRunner::run, py::call_guard<py::gil_scoped_release>());
+
     py::class_<Pos>(m, "Pos")
         .def(py::init<>())
         .def(py::init<int, int>())
@@ -110,6 +524,74 @@ PYBIND11_MODULE(fastautomata_clib, m) {
         .value("TRIGGER", CollisionType::TRIGGER)
         .export_values();
 
+    py::enum_<MovePolicy>(m, "MovePolicy")
+        .value("SEQUENTIAL", MovePolicy::SEQUENTIAL)
+        .value("LOWEST_ID", MovePolicy::LOWEST_ID)
+        .value("RANDOM", MovePolicy::RANDOM);
+
+    py::enum_<fastautomata::Journal::ChangeKind>(m, "ChangeKind")
+        .value("ADD", fastautomata::Journal::ADD)
+        .value("REMOVE", fastautomata::Journal::REMOVE)
+        .value("MOVE", fastautomata::Journal::MOVE)
+        .value("STATE", fastautomata::Journal::STATE)
+        .value("LAYER", fastautomata::Journal::LAYER)
+        .value("RESET", fastautomata::Journal::RESET);
+
+    py::enum_<fastautomata::Journal::ChangeEntity>(m, "ChangeEntity")
+        .value("AGENT", fastautomata::Journal::AGENT)
+        .value("ENTITY", fastautomata::Journal::ENTITY);
+
+    py::enum_<StencilType>(m, "StencilType")
+        .value("MOORE", StencilType::MOORE)
+        .value("VON_NEUMANN", StencilType::VON_NEUMANN)
+        .value("HEX", StencilType::HEX)
+        .value("CUSTOM", StencilType::CUSTOM);
+
+    py::class_<Stencil>(m, "Stencil")
+        .def_static("moore", &Stencil::moore, py::arg("radius") = 1, py::arg("includeCenter") = false)
+        .def_static("von_neumann", &Stencil::von_neumann, py::arg("radius") = 1, py::arg("includeCenter") = false)
+        .def_static("hex", &Stencil::hex, py::arg("radius") = 1, py::arg("includeCenter") = false)
+        .def_static("custom", &Stencil::custom, py::arg("offsets"))
+        .def_static("from_mask", &Stencil::from_mask, py::arg("mask"))
+        .def_property_readonly("type", &Stencil::getType)
+        .def_property_readonly("radius", &Stencil::getRadius)
+        .def("getOffsets", &Stencil::getOffsets, py::arg("y") = 0)
+        .def("__len__", &Stencil::size);
+
+    py::class_<Neighborhood>(m, "Neighborhood")
+        .def(py::init<SimulatedBoard*, Stencil>(), py::keep_alive<1, 2>())
+        .def_property_readonly("stencil", &Neighborhood::getStencil)
+        .def("count", [](Neighborhood &neighborhood, Pos pos, int layer, std::string state, bool wrap) {
+            return neighborhood.count(pos, layer, neighborhood.getBoard()->state_id(state), wrap);
+        }, py::arg("pos"), py::arg("layer"), py::arg("state"), py::arg("wrap") = false)
+        .def("count_id", &Neighborhood::count, py::arg("pos"), py::arg("layer"), py::arg("state"), py::arg("wrap") = false)
+        .def("count_occupied", &Neighborhood::count_occupied, py::arg("pos"), py::arg("layer"), py::arg("wrap") = false)
+        .def("first_empty", [](Neighborhood &neighborhood, Pos pos, int layer, bool wrap) -> std::optional<Pos> {
+            Pos found;
+            if (neighborhood.first_empty(pos, layer, found, wrap))
+            {
+                return found;
+            }
+            return std::nullopt;
+        }, py::arg("pos"), py::arg("layer"), py::arg("wrap") = false)
+        .def("agents", static_cast<std::vector<BaseAgent *> (Neighborhood::*)(Pos, int, bool) const>(&Neighborhood::agents), py::arg("pos"), py::arg("layer"), py::arg("wrap") = false, py::return_value_policy::reference);
+
+    // shared with the cache of the board: python can keep a field after the board drops it (it keeps the board alive)
+    py::class_<FlowField, std::shared_ptr<FlowField>>(m, "FlowField")
+        .def_readonly_static("UNREACHABLE", &FlowField::UNREACHABLE)
+        .def_property_readonly("layer", &FlowField::getLayer)
+        .def_property_readonly("computations", &FlowField::getComputations)
+        .def("getDistance", &FlowField::getDistance, py::arg("pos"))
+        .def("next_step", &FlowField::next_step, py::arg("pos"))
+        .def("update", &FlowField::update)
+        .def("distances", [](FlowField &flowField) {
+            // a copy, the field changes with the board
+            py::array_t<int32_t, py::array::c_style> distances({flowField.getHeight(), flowField.getWidth()});
+            const int32_t *data = flowField.data();
+            std::copy(data, data + static_cast<size_t>(flowField.getWidth()) * flowField.getHeight(), distances.mutable_data());
+            return distances;
+        });
+
     py::class_<CollisionList>(m, "CollisionList")
         .def(py::init<>())
         .def("getCollision", &CollisionList::getCollision)
@@ -120,6 +602,8 @@ PYBIND11_MODULE(fastautomata_clib, m) {
         .def(py::init<int>())
         .def(py::init<CollisionList*, int>())
         .def("getCollision", &CollisionMap::getCollision)
+        .def("getLength", &CollisionMap::getLength)
+        .def("getRevision", &CollisionMap::getRevision)
         .def("addCollision", &CollisionMap::addCollision);
 
 }
\ No newline at end of file
@@ -0,0 +1,192 @@
+/**
+ * @file fastautomata_capi.h
+ * @author MrDrHax (alexfh2001@gmail.com)
+ * @brief The C ABI of step kernels: functions compiled outside of fastautomata (a shared object, a numba cfunc, cffi, ...) that step agents or the whole board
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * This header is plain C, and does not include anything from fastautomata. Copy it next to the kernels.
+ *
+ * The layout of fa_board and fa_agent only changes with FASTAUTOMATA_CAPI_VERSION (fields only get added at the end).
+ * Kernels should check board->version before reading fields added in later versions.
+ *
+ * A kernel must not throw or unwind through fastautomata, and must not call into python.
+ *
+ */
+
+#ifndef FASTAUTOMATA_CAPI_H
+#define FASTAUTOMATA_CAPI_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The version of the layout of fa_board and fa_agent
+ *
+ */
+#define FASTAUTOMATA_CAPI_VERSION 1
+
+/**
+ * @brief The state of an empty cell (or a cell outside of the board), and "no change" in fa_agent.state_next
+ *
+ */
+#define FA_STATE_NONE 65535
+
+/**
+ * @brief A view of the board, given to every kernel. Read only: changes go through the functions.
+ *
+ * Offsets (64 bit): version 0, width 4, height 8, layers 12, step 16, cells 24, handle 32, then the functions every 8 bytes from 40. Size 88.
+ *
+ */
+typedef struct fa_board
+{
+    /**
+     * @brief FASTAUTOMATA_CAPI_VERSION of the board
+     *
+     */
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t layers;
+
+    /**
+     * @brief The step being computed
+     *
+     */
+    int64_t step;
+
+    /**
+     * @brief The state of every cell of every layer, as the board was at the end of the last step (or reset): cells[layer][y * width + x]
+     *
+     * Agents and entities hold their state, field layers hold the state of the field, and empty cells FA_STATE_NONE.
+     * Reading it is the fastest way to look at the neighbors (and the only one from numba).
+     *
+     */
+    const uint16_t *const *cells;
+
+    /**
+     * @brief The board. Pass it to the functions below.
+     *
+     */
+    void *handle;
+
+    /**
+     * @brief Get the state of a cell as it is now (FA_STATE_NONE if it is empty or outside of the board)
+     *
+     */
+    uint16_t (*cell_state)(void *handle, int32_t layer, int32_t x, int32_t y);
+
+    /**
+     * @brief Get the id of a state by name (FA_STATE_NONE if the board does not know it). Does not register new states.
+     *
+     */
+    uint16_t (*state_id)(void *handle, const char *name);
+
+    /**
+     * @brief Write the state of a cell of a field layer for the next step. Returns 0, or -1 if the cell or the layer are not valid.
+     *
+     * Board kernels only: agent kernels run in parallel, they always get -1.
+     *
+     */
+    int32_t (*field_set)(void *handle, int32_t layer, int32_t x, int32_t y, uint16_t state);
+
+    /**
+     * @brief Queue the state of a simulated agent, applied at the end of the step. Returns 0, or -1 if there is no such agent (or the state is not valid).
+     *
+     * Board kernels only: agent kernels always get -1 (they write their own fa_agent instead).
+     *
+     */
+    int32_t (*agent_set_state)(void *handle, int32_t id, uint16_t state);
+
+    /**
+     * @brief Queue a move of a simulated agent, resolved at the end of the step. Returns 0, or -1 if there is no such agent.
+     *
+     * Board kernels only: agent kernels always get -1.
+     *
+     */
+    int32_t (*agent_set_pos)(void *handle, int32_t id, int32_t x, int32_t y);
+
+    /**
+     * @brief Get a random double in [0, 1) from the board generator (keyed by the board seed).
+     *
+     * Board kernels only: agent kernels always get -1 (use fa_agent.random, which does not depend on the threads).
+     *
+     */
+    double (*random)(void *handle);
+} fa_board;
+
+/**
+ * @brief A view of an agent, given to agent kernels. The kernel writes what the agent should do in the *_next fields.
+ *
+ * Offsets (64 bit): id 0, x 4, y 8, layer 12, x_next 16, y_next 20, state 24, state_next 26, moves 28, wake 29, handle 32, random 40. Size 48.
+ *
+ */
+typedef struct fa_agent
+{
+    int32_t id;
+    int32_t x;
+    int32_t y;
+    int32_t layer;
+
+    /**
+     * @brief Where to move to, if moves is not 0
+     *
+     */
+    int32_t x_next;
+    int32_t y_next;
+
+    uint16_t state;
+
+    /**
+     * @brief The state to change to at the end of the step (FA_STATE_NONE to keep it)
+     *
+     */
+    uint16_t state_next;
+
+    /**
+     * @brief Set to 1 to move to (x_next, y_next)
+     *
+     */
+    uint8_t moves;
+
+    /**
+     * @brief Set to 1 to get stepped in the next step, even if nothing changes around the agent (active scheduling)
+     *
+     */
+    uint8_t wake;
+
+    /**
+     * @brief The agent. Pass it to the functions below.
+     *
+     */
+    void *handle;
+
+    /**
+     * @brief Get a random double in [0, 1) from the agent's stream (keyed by the board seed, the step and the id, so it does not depend on the threads)
+     *
+     */
+    double (*random)(void *handle);
+} fa_agent;
+
+/**
+ * @brief Steps one agent. Called in parallel, from the board threads.
+ *
+ */
+typedef void (*fa_agent_kernel)(const fa_board *board, fa_agent *agent, void *user_data);
+
+/**
+ * @brief Steps the whole board, once per step, before the agents get stepped
+ *
+ */
+typedef void (*fa_board_kernel)(const fa_board *board, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
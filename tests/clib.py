@@ -1,7 +1,1422 @@
+import ctypes
+import os
+import shutil
+import subprocess
+import tempfile
+import threading
+
+import numpy
+
 from fastautomata import fastautomata_clib
 
 # create a board and test it
 board = fastautomata_clib.SimulatedBoard(10, 10, 1)
 
 # Test that it actually worked
-print(board.getWidth())
\ No newline at end of file
+print(board.getWidth())
+
+# Cells: each layer keeps its own cells, and the edges only wrap when asked to
+def neighbor_ids(agent, radius, wrap, layer):
+    return [None if neighbor is None else neighbor.getId() for neighbor in agent.get_neighbors(radius, wrap, layer)]
+
+board = fastautomata_clib.SimulatedBoard(4, 3, 3)
+grid = [(x, y) for y in range(3) for x in range(4)]
+rocks = [int(id) for id in board.agents_spawn(numpy.array(grid), "Rock", 1)]
+corner, middle = [board.agent_by_id(int(id)) for id in board.agents_spawn(numpy.array([[0, 0], [1, 1]]), "Sheep", 2, True)]
+for (x, y), id in zip(grid, rocks):
+    assert board.agent_get(fastautomata_clib.Pos(x, y), 1).getId() == id
+    assert board.agent_get(fastautomata_clib.Pos(x, y), 0) is None
+assert board.agent_get(fastautomata_clib.Pos(3, 2), 2) is None and board.agent_get(fastautomata_clib.Pos(1, 1), 2).getId() == middle.getId()
+assert board.agent_get(fastautomata_clib.Pos(-1, 0), 1) is None
+assert board.agent_get(fastautomata_clib.Pos(-1, 0), 1, True).getId() == rocks[3]
+assert board.agent_get(fastautomata_clib.Pos(4, 3), 1, True).getId() == rocks[0]
+try:
+    board.agent_get(fastautomata_clib.Pos(0, 0), 3)
+    assert False, "getting an agent from layer 3 of a board with 3 layers should fail"
+except IndexError:
+    pass
+
+# neighbors come from the top row to the bottom one, left to right (inside the board, and at the edges)
+def brute_neighbors(center, radius, wrap, layer):
+    cells = [fastautomata_clib.Pos(x, y) for y in range(center.y + radius, center.y - radius - 1, -1) for x in range(center.x - radius, center.x + radius + 1)]
+    return [None if board.agent_get(pos, layer, wrap) is None else board.agent_get(pos, layer, wrap).getId() for pos in cells]
+
+for agent in [corner, middle]:
+    for wrap in [False, True]:
+        assert neighbor_ids(agent, 1, wrap, 1) == brute_neighbors(agent.pos, 1, wrap, 1)
+assert neighbor_ids(corner, 1, False, 1).count(None) == 5
+assert neighbor_ids(middle, 1, False, -1) == [None] * 4 + [middle.getId(), None, corner.getId(), None, None]
+
+# a reset empties every layer, and the board fills again
+board.reset()
+assert board.getAgentCount() == 0
+assert all(board.agent_get(fastautomata_clib.Pos(x, y), layer) is None for x, y in grid for layer in range(3))
+board.agents_spawn(numpy.array(grid), "Rock", 1)
+assert board.getAgentCount() == 12 and board.agent_get(fastautomata_clib.Pos(2, 1), 1).pos == fastautomata_clib.Pos(2, 1)
+
+# Colors: color_map is a copy of the colors, assigning a dict replaces them
+board.addColor("Sheep", [1, 2, 3])
+colors = board.color_map
+colors["Sheep"] = [9, 9, 9]
+assert board.getColor("Sheep") == [1, 2, 3]
+wolf = board.getStateId("Wolf")
+default = board.getColor("Wolf")
+board.addColor("Wolf", [4, 5, 6])
+board.color_map = {"Sheep": [7, 8, 9], "Fox": [10, 11, 12]}
+assert board.getColor("Sheep") == [7, 8, 9] and board.getColor("Fox") == [10, 11, 12]
+assert board.getColor("Wolf") == default and board.getStateId("Wolf") == wolf
+
+# Field layers: field_put writes right away, field_set writes the next step
+board = fastautomata_clib.SimulatedBoard(5, 5, 2)
+board.agents_spawn(numpy.array([[0, 0]]), "Sheep", 0)
+try:
+    board.field_enable(0, "Dead")
+    assert False, "a layer with agents should not turn into a field layer"
+except ValueError:
+    pass
+board.field_enable(1, "Dead")
+assert board.is_field(1) and not board.is_field(0)
+assert board.field_get(fastautomata_clib.Pos(2, 2), 1) == "Dead"
+assert board.color_map_count.get("Dead", 0) == 0 # empty cells do not count
+
+board.field_put(fastautomata_clib.Pos(1, 1), "Alive", 1)
+board.field_set(fastautomata_clib.Pos(2, 2), "Alive", 1)
+assert board.field_get(fastautomata_clib.Pos(1, 1), 1) == "Alive" and board.field_get(fastautomata_clib.Pos(2, 2), 1) == "Dead"
+assert board.color_map_count["Alive"] == 1
+board.step()
+assert board.field_get(fastautomata_clib.Pos(2, 2), 1) == "Alive" and board.color_map_count["Alive"] == 2
+board.field_set(fastautomata_clib.Pos(1, 1), "Dead", 1)
+board.step()
+assert board.field_get(fastautomata_clib.Pos(1, 1), 1) == "Dead" and board.color_map_count["Alive"] == 1
+
+# outside of the board: nothing to read (unless it wraps), and nothing to write
+assert board.field_get(fastautomata_clib.Pos(5, 2), 1) == "" and board.field_get_id(fastautomata_clib.Pos(-1, 0), 1) == 65535
+assert board.field_get(fastautomata_clib.Pos(-3, 7), 1, True) == "Alive"
+for write in [board.field_set, board.field_put]:
+    try:
+        write(fastautomata_clib.Pos(5, 0), "Alive", 1)
+        assert False, "writing outside of the board should fail"
+    except IndexError:
+        pass
+for layer in [0, 2]:
+    try:
+        board.field_get(fastautomata_clib.Pos(0, 0), layer)
+        assert False, "layer " + str(layer) + " is not a field layer"
+    except ValueError:
+        pass
+try:
+    board.agents_spawn(numpy.array([[3, 3]]), "Sheep", 1)
+    assert False, "agents can not be added to a field layer"
+except ValueError:
+    pass
+
+
+# Life: a glider moves one cell right and one cell down every 4 steps
+glider = [(1, 0), (2, 1), (0, 2), (1, 2), (2, 2)]
+
+def alive_cells(board: fastautomata_clib.SimulatedBoard, layer: int):
+    return sorted((x, y) for y in range(board.getHeight()) for x in range(board.getWidth()) if board.field_get(fastautomata_clib.Pos(x, y), layer) == "Alive")
+
+board = fastautomata_clib.SimulatedBoard(10, 10, 1)
+life = board.life_add(0, "B3/S23")
+assert life.rule == "B3/S23" and not life.wrap
+for x, y in glider:
+    board.field_put(fastautomata_clib.Pos(x, y), "Alive", 0)
+for i in range(4):
+    board.step()
+assert alive_cells(board, 0) == sorted((x + 1, y + 1) for x, y in glider)
+assert life.population() == 5
+assert board.color_map_count["Alive"] == 5
+assert board.step_count == 4
+
+# a layer runs one rule, and bad rulestrings are refused
+try:
+    board.life_add(0, "B3/S23")
+    assert False, "a second Life rule on the same layer should fail"
+except ValueError:
+    pass
+try:
+    fastautomata_clib.SimulatedBoard(5, 5, 1).life_add(0, "B3/X23")
+    assert False, "a bad rulestring should fail"
+except ValueError:
+    pass
+
+# with wrap (and the S/B notation), the glider goes around a 6 x 6 board in 24 steps
+board = fastautomata_clib.SimulatedBoard(6, 6, 1)
+board.life_add(0, "23/3", True)
+for x, y in glider:
+    board.field_put(fastautomata_clib.Pos(x, y), "Alive", 0)
+for i in range(24):
+    board.step()
+assert alive_cells(board, 0) == sorted(glider)
+
+# field_set writes the next step: a block missing a corner is an L, which grows the corner back
+block = [(1, 1), (2, 1), (1, 2), (2, 2)]
+board = fastautomata_clib.SimulatedBoard(6, 6, 1)
+life = board.life_add(0, "B3/S23")
+for x, y in block:
+    board.field_put(fastautomata_clib.Pos(x, y), "Alive", 0)
+board.step()
+board.field_set(fastautomata_clib.Pos(1, 1), "Dead", 0)
+assert alive_cells(board, 0) == block
+board.step()
+assert alive_cells(board, 0) == block[1:]
+board.step()
+assert alive_cells(board, 0) == block and life.population() == 4
+
+# a Life layer can not have a rule set (and the other way around)
+try:
+    board.rules_add(0, fastautomata_clib.Stencil.moore(1))
+    assert False, "a rule set on a Life layer should fail"
+except ValueError:
+    pass
+board = fastautomata_clib.SimulatedBoard(6, 6, 1)
+board.field_enable(0, "Dead")
+board.rules_add(0, fastautomata_clib.Stencil.moore(1))
+try:
+    board.life_add(0, "B3/S23")
+    assert False, "a Life rule on a layer with a rule set should fail"
+except ValueError:
+    pass
+print("life ok")
+
+
+# Threads: a seeded board steps the same with any thread count (with a move policy that does not depend on the order)
+def walkers(threads: int, policy: fastautomata_clib.MovePolicy, seed: int = 3, spacing: int = 4, steps: int = 20):
+    board = fastautomata_clib.SimulatedBoard(16, 16, 2)
+    board.setSeed(seed)
+    board.setThreadCount(threads)
+    board.setMovePolicy(policy)
+    for layer in range(2):
+        rules = board.rules_add(layer, fastautomata_clib.Stencil.moore(), wrap=True)
+        rules.add(state="Sheep", next="Goat", probability=0.05)
+        rules.add(state="Goat", next="Sheep", probability=0.1)
+        for move, probability in [((1, 0), 0.25), ((-1, 0), 1 / 3), ((0, 1), 0.5), ((0, -1), 1.0)]:
+            rules.add(state="Sheep", move=fastautomata_clib.Pos(*move), probability=probability)
+    positions = [(x, y) for y in range(16) for x in range(16) if (x * 5 + y * 3) % spacing == 0]
+    ids = [int(id) for id in board.agents_spawn(numpy.array(positions), "Sheep", 0, True)]
+    store = board.entities()
+    entityIds = [store.spawn(fastautomata_clib.Pos(x, y), "Sheep", 1) for x, y in positions]
+    for i in range(steps):
+        board.step()
+    agents = [(board.agent_by_id(id).pos.x, board.agent_by_id(id).pos.y, board.agent_by_id(id).state) for id in ids]
+    entities = [(store.getPos(id).x, store.getPos(id).y, store.getState(id)) for id in entityIds]
+    return (board.color_map_count, agents, entities)
+
+serial = walkers(1, fastautomata_clib.MovePolicy.LOWEST_ID)
+assert serial[0]["Goat"] > 0 and serial[0]["Sheep"] > 0
+for threads in [2, 4]:
+    assert walkers(threads, fastautomata_clib.MovePolicy.LOWEST_ID) == serial, "stepping with " + str(threads) + " threads changed the result"
+
+
+# Moves: when two agents want the same cell, one gets it (picked by the move policy) and the other stays
+def move_conflict(policy: fastautomata_clib.MovePolicy, seed: int = 0):
+    board = fastautomata_clib.SimulatedBoard(3, 1, 1)
+    board.setSeed(seed)
+    board.setMovePolicy(policy)
+    assert board.getMovePolicy() == policy
+    rules = board.rules_add(0, fastautomata_clib.Stencil.moore())
+    rules.add(state="Right", move=fastautomata_clib.Pos(1, 0))
+    rules.add(state="Left", move=fastautomata_clib.Pos(-1, 0))
+    right = int(board.agents_spawn(numpy.array([[0, 0]]), "Right", 0, True)[0])
+    left = int(board.agents_spawn(numpy.array([[2, 0]]), "Left", 0, True)[0])
+    board.step()
+    return (board.agent_by_id(right).pos.x, board.agent_by_id(left).pos.x)
+
+# the first agent added (and the lowest id) wins
+assert move_conflict(fastautomata_clib.MovePolicy.SEQUENTIAL) == (1, 2)
+assert move_conflict(fastautomata_clib.MovePolicy.LOWEST_ID) == (1, 2)
+
+# a random winner, the same for the same seed
+winners = set()
+for seed in range(20):
+    result = move_conflict(fastautomata_clib.MovePolicy.RANDOM, seed)
+    assert result in [(1, 2), (0, 1)]
+    assert result == move_conflict(fastautomata_clib.MovePolicy.RANDOM, seed)
+    winners.add(result)
+assert len(winners) == 2
+
+# on a crowded board (lots of conflicts) neither policy depends on the threads, and the policy changes who wins
+crowded = {}
+for policy in [fastautomata_clib.MovePolicy.LOWEST_ID, fastautomata_clib.MovePolicy.RANDOM]:
+    crowded[policy] = walkers(1, policy, spacing=2)
+    assert walkers(4, policy, spacing=2) == crowded[policy]
+assert crowded[fastautomata_clib.MovePolicy.LOWEST_ID] != crowded[fastautomata_clib.MovePolicy.RANDOM]
+print("moves ok")
+
+
+# Active scheduling: agents that only react to their neighbors step the same with it, but get stepped less
+class Patient(fastautomata_clib.Agent):
+    steps = 0
+
+    def __init__(self, board, pos, state):
+        super().__init__(board, pos, state, 0, False)
+        self.sickFor = 0
+
+    def step(self):
+        Patient.steps += 1
+        if self.state == "Sick":
+            self.sickFor += 1
+            if self.sickFor == 3:
+                self.state = "Immune"
+            else:
+                self.wake() # nothing around might change while it counts
+        elif self.state == "Healthy" and any(neighbor is not None and neighbor.state == "Sick" for neighbor in self.get_neighbors(1, False, 0)):
+            self.state = "Sick"
+
+def epidemic(active: bool):
+    board = fastautomata_clib.SimulatedBoard(12, 12, 1)
+    board.setActiveScheduling(active)
+    assert board.getActiveScheduling() == active
+    patients = [Patient(board, fastautomata_clib.Pos(x, y), "Sick" if (x, y) in [(2, 3), (9, 8)] else "Healthy") for y in range(12) for x in range(12) if (x + 2 * y) % 3]
+    Patient.steps = 0
+    history = []
+    for i in range(30):
+        board.step()
+        history.append([patient.state for patient in patients])
+    return history, Patient.steps
+
+scheduled, scheduledSteps = epidemic(True)
+full, fullSteps = epidemic(False)
+assert scheduled == full and scheduledSteps < fullSteps
+assert set(full[-1]) == {"Immune"}
+
+
+# Parallel boards: boards stepped from python threads at the same time step like boards stepped one after the other
+def pasture(seed: int):
+    board = fastautomata_clib.SimulatedBoard(24, 24, 2)
+    board.setSeed(seed)
+    board.field_enable(1, "Dirt")
+    grass = board.rules_add(1, fastautomata_clib.Stencil.moore())
+    grass.add(state="Dirt", next="Grass", probability=0.1)
+    grass.add(state="Grass", next="Dirt", probability=0.05)
+    sheep = board.rules_add(0, fastautomata_clib.Stencil.moore(), wrap=True)
+    for move, probability in [((1, 0), 0.25), ((0, 1), 1 / 3), ((-1, 0), 0.5), ((0, -1), 1.0)]:
+        sheep.add(state="Sheep", move=fastautomata_clib.Pos(*move), probability=probability)
+    ids = [int(id) for id in board.agents_spawn(numpy.array([(x, y) for y in range(0, 24, 3) for x in range(0, 24, 4)]), "Sheep", 0, True)]
+    return board, ids
+
+def pasture_cells(board: fastautomata_clib.SimulatedBoard, ids):
+    grass = [board.field_get_id(fastautomata_clib.Pos(x, y), 1) for y in range(24) for x in range(24)]
+    sheep = [(board.agent_by_id(id).pos.x, board.agent_by_id(id).pos.y) for id in ids]
+    return grass, sheep
+
+expected = []
+for seed in range(8):
+    board, ids = pasture(seed)
+    assert board.is_native()
+    board.step_n(30)
+    assert board.getStepCount() == 30
+    expected.append(pasture_cells(board, ids))
+assert expected[0] != expected[1]
+
+# the boards get built in the threads too: agent ids belong to each board, not to the process
+results = [None] * 8
+def run_pasture(seed: int):
+    board, ids = pasture(seed)
+    assert ids[0] == 0
+    for i in range(3):
+        board.step_n(10)
+    results[seed] = pasture_cells(board, ids)
+
+threads = [threading.Thread(target=run_pasture, args=(seed,)) for seed in range(8)]
+for thread in threads:
+    thread.start()
+for thread in threads:
+    thread.join()
+assert results == expected
+
+# a python step instruction makes the board need python, and still gets called from the threads
+calls = []
+boards = [pasture(seed)[0] for seed in range(4)]
+for board in boards:
+    board.step_instructions_add(lambda stepped: calls.append(stepped.getStepCount()))
+    assert not board.is_native()
+threads = [threading.Thread(target=board.step_n, args=(5,)) for board in boards]
+for thread in threads:
+    thread.start()
+for thread in threads:
+    thread.join()
+assert sorted(calls) == sorted(list(range(5)) * 4)
+
+
+# Ensembles: each board gets its seed and a reset, and runs like it would alone until its step limit or the stop function
+def flock(seed: int):
+    board, ids = pasture(seed)
+    sheep = [(board.agent_by_id(id).pos.x, board.agent_by_id(id).pos.y) for id in ids]
+    board.append_on_reset(lambda reset: reset.agents_spawn(numpy.array(sheep), "Sheep", 0, True))
+    return board
+
+def lush(board: fastautomata_clib.SimulatedBoard):
+    return board.color_map_count["Grass"] >= 200
+
+ensemble = fastautomata_clib.Ensemble(4)
+assert ensemble.getThreadCount() == 4
+seeds = [7, 8, 9, 10, 11, 12]
+limits = [3, 25] * 3
+for run, seed in enumerate(seeds):
+    assert ensemble.add(flock(seed), seed, limits[run]) == run
+ensemble.setStop(lush)
+result = ensemble.run()
+assert len(result) == ensemble.size() == 6
+assert list(result.run) == list(range(6)) and list(result.seed) == seeds
+assert all(result.state_counts["Sheep"] == 48)
+assert all(result.step_time_max <= result.time)
+
+for run, seed in enumerate(seeds):
+    board = flock(seed)
+    board.setSeed(seed)
+    board.reset()
+    while board.getStepCount() < limits[run] and not lush(board):
+        board.step()
+    assert result.steps[run] == board.getStepCount()
+    for state, count in board.color_map_count.items():
+        assert result.state_counts[state][run] == count
+# grass covers 200 cells after about 5 steps: the stop function ends the long runs, the limit the short ones
+assert list(result.steps[0::2]) == [3, 3, 3] and all(3 < steps < 25 for steps in result.steps[1::2])
+
+# running again starts over (the boards get reset), without a stop function only the limits end the runs
+ensemble.setStop(None)
+assert list(ensemble.run().steps) == limits
+
+# the results get written in one go, a row per run
+with tempfile.TemporaryDirectory() as directory:
+    path = os.path.join(directory, "ensemble.csv")
+    result.to_csv(path)
+    result.to_csv(path, True)
+    with open(path) as file:
+        rows = file.read().splitlines()
+assert rows[0].startswith("run,seed,steps,") and "state.Grass" in rows[0].split(",")
+assert len(rows) == 13 and rows[1].split(",")[:3] == ["0", "7", "3"]
+
+
+# Random streams: agent 5 and entity 5 draw from streams that only differ in their high bits, they must not draw the same
+board = fastautomata_clib.SimulatedBoard(8, 8, 2)
+for layer in range(2):
+    board.rules_add(layer, fastautomata_clib.Stencil.moore()).add(state="A", next="B", probability=0.5)
+positions = [(i % 8, i // 8) for i in range(64)]
+board.agents_spawn(numpy.array(positions), "A", 0, True)
+store = board.entities()
+for x, y in positions:
+    store.spawn(fastautomata_clib.Pos(x, y), "A", 1)
+board.step()
+agents_fired = [board.agent_by_id(i).state == "B" for i in range(64)]
+entities_fired = [store.getState(i) == "B" for i in range(64)]
+same = sum(a == e for a, e in zip(agents_fired, entities_fired))
+assert 16 <= same <= 48, "agents and entities with the same id drew alike " + str(same) + " times out of 64"
+
+# a seed always gives the same run, another seed another one
+assert walkers(1, fastautomata_clib.MovePolicy.RANDOM, seed=5) == walkers(4, fastautomata_clib.MovePolicy.RANDOM, seed=5)
+assert walkers(1, fastautomata_clib.MovePolicy.RANDOM, seed=5) != walkers(1, fastautomata_clib.MovePolicy.RANDOM, seed=6)
+
+# the draws of an agent only depend on the seed, the step and its id: extra draws of another agent do not shift them
+class Dice(fastautomata_clib.Agent):
+    def __init__(self, board, pos, extraDraws):
+        super().__init__(board, pos, "Dice", 0, False)
+        self.extraDraws = extraDraws
+        self.rolls = []
+
+    def step(self):
+        self.rolls.append(self.random())
+        for i in range(self.extraDraws):
+            self.random()
+
+def roll(extraDraws):
+    board = fastautomata_clib.SimulatedBoard(3, 1, 1)
+    board.setSeed(11)
+    dice = [Dice(board, fastautomata_clib.Pos(x, 0), extra) for x, extra in enumerate(extraDraws)]
+    for i in range(5):
+        board.step()
+    return [die.rolls for die in dice]
+
+rolls = roll([0, 0, 0])
+assert rolls == roll([0, 3, 0]) == roll([2, 0, 1])
+assert len(set(rolls[0])) == 5 and rolls[0] != rolls[1]
+
+
+# Agent ids: the id of a removed agent is not given again, and a reset starts the ids from 0
+board = fastautomata_clib.SimulatedBoard(5, 5, 1)
+assert list(board.agents_spawn(numpy.array([[0, 0], [1, 0], [2, 0]]), "A")) == [0, 1, 2]
+board.agent_by_id(1).kill()
+board.step()
+assert board.agent_by_id(1) is None
+assert board.agent_by_id(2).pos == fastautomata_clib.Pos(2, 0)
+assert board.agents_spawn(numpy.array([[1, 0]]), "A")[0] == 3
+assert board.agent_by_id(1) is None and board.agent_by_id(3).pos == fastautomata_clib.Pos(1, 0)
+assert board.agent_by_id(-1) is None and board.agent_by_id(100) is None
+assert board.getAgentCount() == 3
+
+board.reset()
+assert board.getAgentCount() == 0 and board.agent_by_id(0) is None
+assert board.agents_spawn(numpy.array([[4, 4]]), "A")[0] == 0
+print("ids ok")
+
+
+# Entities: kept by column, a killed entity leaves at the end of the step and the last one takes its index
+board = fastautomata_clib.SimulatedBoard(6, 6, 2)
+store = board.entities()
+assert store is board.entities() and len(store) == 0
+assert store.attribute_add("energy", 5.0) == 0
+herd = [store.spawn(fastautomata_clib.Pos(x, 0), "Cow", 0) for x in range(4)]
+assert herd == [0, 1, 2, 3] and store.size() == 4
+assert [store.index(id) for id in herd] == [0, 1, 2, 3]
+assert store.attribute_add("age") == 1 and store.attribute_add("energy", 9.0) == 0 # declaring it again keeps the column
+assert store.attribute_get(2, "energy") == 5.0 and store.attribute_get(2, "age") == 0.0
+for id in herd:
+    store.attribute_set(id, "age", id * 10)
+assert board.entity_at(fastautomata_clib.Pos(3, 0)) == 3 and board.entity_at(fastautomata_clib.Pos(3, 0), 1) == -1
+assert board.entity_at(fastautomata_clib.Pos(9, 9)) == -1
+assert board.color_map_count["Cow"] == 4
+
+store.kill(1)
+assert store.size() == 4 and store.index(1) == 1
+board.step()
+assert store.size() == 3 and store.index(1) == -1 and board.entity_at(fastautomata_clib.Pos(1, 0)) == -1
+assert store.index(3) == 1 and store.getPos(3) == fastautomata_clib.Pos(3, 0) and store.attribute_get(3, "age") == 30.0
+assert board.color_map_count["Cow"] == 3
+for read in [store.getPos, store.getState, store.kill]:
+    try:
+        read(1)
+        assert False, "entity 1 is gone"
+    except IndexError:
+        pass
+try:
+    store.attribute_get(0, "weight")
+    assert False, "weight was never declared"
+except ValueError:
+    pass
+
+# entities and agents can not share a cell, and ids are not given again
+for spawn in [lambda: store.spawn(fastautomata_clib.Pos(0, 0), "Cow", 0), lambda: board.agents_spawn(numpy.array([[2, 0]]), "Sheep", 0)]:
+    try:
+        spawn()
+        assert False, "the cell is taken by an entity"
+    except ValueError:
+        pass
+board.agents_spawn(numpy.array([[1, 0]]), "Sheep", 0)
+try:
+    store.spawn(fastautomata_clib.Pos(1, 0), "Cow", 0)
+    assert False, "the cell is taken by an agent"
+except ValueError:
+    pass
+calf = store.spawn(fastautomata_clib.Pos(1, 1), "Cow", 0)
+assert calf == 4 and store.attribute_get(calf, "energy") == 5.0 and store.getState(calf) == "Cow"
+
+# a reset removes every entity, the attributes stay declared
+board.reset()
+assert len(store) == 0 and board.entity_at(fastautomata_clib.Pos(0, 0)) == -1
+assert store.attribute_get(store.spawn(fastautomata_clib.Pos(0, 0), "Cow", 0), "age") == 0.0
+
+
+# Stencils: the offsets of each shape, top row first
+assert [len(fastautomata_clib.Stencil.moore(radius)) for radius in range(4)] == [0, 8, 24, 48]
+assert len(fastautomata_clib.Stencil.moore(1, True)) == 9 and len(fastautomata_clib.Stencil.von_neumann(2)) == 12
+assert [len(fastautomata_clib.Stencil.hex(radius)) for radius in range(1, 4)] == [6, 18, 36]
+hexagon = fastautomata_clib.Stencil.hex()
+assert hexagon.type == fastautomata_clib.StencilType.HEX and hexagon.radius == 1
+assert [(offset.x, offset.y) for offset in hexagon.getOffsets(0)] == [(-1, 1), (0, 1), (-1, 0), (1, 0), (-1, -1), (0, -1)]
+assert [(offset.x, offset.y) for offset in hexagon.getOffsets(3)] == [(0, 1), (1, 1), (-1, 0), (1, 0), (0, -1), (1, -1)]
+hook = fastautomata_clib.Stencil.from_mask([[0, 1, 0], [1, 0, 1], [0, 1, 1]])
+assert hook.type == fastautomata_clib.StencilType.CUSTOM and [(offset.x, offset.y) for offset in hook.getOffsets()] == [(0, 1), (-1, 0), (1, 0), (0, -1), (1, -1)]
+for broken in [lambda: fastautomata_clib.Stencil.from_mask([[1, 1], [1, 1]]), lambda: fastautomata_clib.Stencil.from_mask([[1], [1, 1, 1], [1]]), lambda: fastautomata_clib.Stencil.moore(-1)]:
+    try:
+        broken()
+        assert False, "the stencil should be refused"
+    except ValueError:
+        pass
+
+# Neighborhoods answer like a walk over the offsets, at the edges, with and without wrap, on agent and field layers
+board = fastautomata_clib.SimulatedBoard(7, 6, 2)
+cells = [(x, y) for y in range(6) for x in range(7)]
+board.agents_spawn(numpy.array([cell for cell in cells if (cell[0] * 3 + cell[1]) % 4 == 0]), "Red")
+board.agents_spawn(numpy.array([cell for cell in cells if (cell[0] * 3 + cell[1]) % 4 == 2]), "Blue")
+store = board.entities()
+for x, y in cells:
+    if (x + 2 * y) % 5 == 1 and board.agent_get(fastautomata_clib.Pos(x, y), 0) is None:
+        store.spawn(fastautomata_clib.Pos(x, y), "Red", 0)
+board.field_enable(1, "Dirt")
+for x, y in cells:
+    if (x * y) % 3 == 0:
+        board.field_put(fastautomata_clib.Pos(x, y), "Grass", 1)
+
+def cell_state(x, y, layer):
+    if layer == 1:
+        return board.field_get(fastautomata_clib.Pos(x, y), 1)
+    agent = board.agent_get(fastautomata_clib.Pos(x, y), 0)
+    if agent is not None:
+        return agent.state
+    entity = board.entity_at(fastautomata_clib.Pos(x, y), 0)
+    return None if entity == -1 else store.getState(entity)
+
+def stencil_cells(stencil, x, y, wrap):
+    for offset in stencil.getOffsets(y):
+        nx, ny = x + offset.x, y + offset.y
+        if wrap:
+            yield nx % 7, ny % 6
+        elif 0 <= nx < 7 and 0 <= ny < 6:
+            yield nx, ny
+
+stencils = [fastautomata_clib.Stencil.moore(), fastautomata_clib.Stencil.moore(2), fastautomata_clib.Stencil.von_neumann(2, True), hexagon, hook, fastautomata_clib.Stencil.custom([fastautomata_clib.Pos(3, 0), fastautomata_clib.Pos(-1, -2)])]
+for stencil in stencils:
+    neighborhood = fastautomata_clib.Neighborhood(board, stencil)
+    for (x, y), wrap in [(cell, wrap) for cell in cells for wrap in [False, True]]:
+        pos = fastautomata_clib.Pos(x, y)
+        around = list(stencil_cells(stencil, x, y, wrap))
+        for layer, state, empty in [(0, "Red", None), (1, "Grass", "Dirt")]:
+            states = [cell_state(nx, ny, layer) for nx, ny in around]
+            assert neighborhood.count(pos, layer, state, wrap) == states.count(state)
+            assert neighborhood.count_occupied(pos, layer, wrap) == sum(cell != empty for cell in states)
+            free = [cell for cell, cellState in zip(around, states) if cellState == empty]
+            found = neighborhood.first_empty(pos, layer, wrap)
+            assert (found is None and not free) or (found.x, found.y) == free[0]
+        agents = [board.agent_get(fastautomata_clib.Pos(nx, ny), 0) for nx, ny in around]
+        assert [agent.getId() for agent in neighborhood.agents(pos, 0, wrap)] == [agent.getId() for agent in agents if agent is not None]
+assert fastautomata_clib.Neighborhood(board, fastautomata_clib.Stencil.moore()).count(fastautomata_clib.Pos(3, 3), 0, "Blue") > 0
+
+
+# Neighbor counts: one pass over the board gives what counting the stencil of every cell by hand gives
+board = fastautomata_clib.SimulatedBoard(9, 8, 2)
+cells = [(x, y) for y in range(8) for x in range(9)]
+board.agents_spawn(numpy.array([cell for cell in cells if (cell[0] * 7 + cell[1] * 3) % 5 < 2]), "Wolf")
+board.agents_spawn(numpy.array([cell for cell in cells if (cell[0] * 7 + cell[1] * 3) % 5 == 3]), "Sheep")
+board.field_enable(1, "Dirt")
+for x, y in cells:
+    if (x + y * y) % 3 == 0:
+        board.field_put(fastautomata_clib.Pos(x, y), "Grass", 1)
+states = numpy.full((2, 8, 9), 65535)
+for x, y in cells:
+    agent = board.agent_get(fastautomata_clib.Pos(x, y), 0)
+    states[0, y, x] = 65535 if agent is None else agent.state_id
+    states[1, y, x] = board.field_get_id(fastautomata_clib.Pos(x, y), 1)
+
+def brute_count(layer, stateId, stencil, wrap):
+    counts = numpy.zeros((8, 9), numpy.int32)
+    for x, y in cells:
+        for offset in stencil.getOffsets(y):
+            nx, ny = x + offset.x, y + offset.y
+            if wrap:
+                nx, ny = nx % 9, ny % 8
+            elif not (0 <= nx < 9 and 0 <= ny < 8):
+                continue
+            counts[y, x] += states[layer, ny, nx] == stateId
+    return counts
+
+stencils = [fastautomata_clib.Stencil.moore(), fastautomata_clib.Stencil.moore(2, True), fastautomata_clib.Stencil.von_neumann(), fastautomata_clib.Stencil.hex(2), fastautomata_clib.Stencil.custom([fastautomata_clib.Pos(10, 0), fastautomata_clib.Pos(-1, -9)])]
+for threads in [1, 3]:
+    board.setThreadCount(threads)
+    for stencil in stencils:
+        for wrap in [False, True]:
+            for layer, state in [(0, "Wolf"), (0, "Sheep"), (1, "Grass")]:
+                assert (board.neighbor_count(layer, state, stencil, wrap) == brute_count(layer, board.getStateId(state), stencil, wrap)).all()
+            planes = board.neighbor_counts(0, stencil, wrap)
+            assert planes.shape == (len(board.color_map_count), 8, 9)
+            for stateId in range(planes.shape[0]):
+                assert (planes[stateId] == brute_count(0, stateId, stencil, wrap)).all()
+
+# an out buffer gets written in place (old values are overwritten), and has to be an int32 (states, height, width) or (height, width) array
+out = numpy.full((8, 9), 99, numpy.int32)
+assert board.neighbor_count(1, "Grass", stencils[0], True, out) is out
+assert (out == brute_count(1, board.getStateId("Grass"), stencils[0], True)).all()
+few = numpy.full((2, 8, 9), 99, numpy.int32)
+board.neighbor_counts(1, stencils[0], False, few)
+assert (few[1] == brute_count(1, 1, stencils[0], False)).all()
+for bad in [numpy.zeros((8, 9), numpy.int64), numpy.zeros((9, 8), numpy.int32), numpy.zeros((8, 18), numpy.int32)[:, ::2]]:
+    try:
+        board.neighbor_count(0, "Wolf", stencils[0], False, bad)
+        assert False, "the out buffer should be refused"
+    except ValueError:
+        pass
+
+
+# Collisions: move_blocked says what looking for SOLID in getCollisions says, for agents, entities and field cells
+def collision_board(layers: int):
+    board = fastautomata_clib.SimulatedBoard(5, 4, layers)
+    collisions = fastautomata_clib.CollisionMap(layers)
+    for start, end, collision in [(0, 1, "SOLID"), (0, 2, "SOLID"), (0, 3, "SOLID"), (1, 0, "SOLID"), (2, 0, "TRIGGER"), (3, 1, "SOLID")]:
+        collisions.addCollision(getattr(fastautomata_clib.CollisionType, collision), start, end)
+    board.layer_collisions = collisions
+    board.agents_spawn(numpy.array([[0, 0], [2, 1], [4, 3]]), "Sheep", 0, True)
+    board.agents_spawn(numpy.array([[1, 0], [2, 1], [3, 2]]), "Fence", 1)
+    store = board.entities()
+    for x, y in [(0, 1), (3, 2), (4, 0)]:
+        store.spawn(fastautomata_clib.Pos(x, y), "Cow", 2)
+    board.field_enable(3, "Dirt")
+    for x, y in [(1, 1), (4, 3), (0, 3)]:
+        board.field_put(fastautomata_clib.Pos(x, y), "Mud", 3)
+    return board
+
+def collision_blocked(board: fastautomata_clib.SimulatedBoard, pos, layer, includeSelf):
+    return any(collision == fastautomata_clib.CollisionType.SOLID for collision, agent in board.getCollisions(pos, layer, includeSelf).values())
+
+# 70 layers do not fit the bitmask: the layers get checked one by one, with the same answers
+for layers in [4, 70]:
+    board = collision_board(layers)
+    assert (board.occupancy_view() is None) == (layers > 64)
+    for (x, y), layer, includeSelf in [((x, y), layer, includeSelf) for y in range(4) for x in range(5) for layer in range(4) for includeSelf in [True, False]]:
+        pos = fastautomata_clib.Pos(x, y)
+        assert board.move_blocked(pos, layer, includeSelf) == collision_blocked(board, pos, layer, includeSelf), str((x, y, layer, includeSelf, layers))
+board = collision_board(4)
+assert board.move_blocked(fastautomata_clib.Pos(1, 1), 0) and not board.move_blocked(fastautomata_clib.Pos(1, 1), 2)
+assert board.move_blocked(fastautomata_clib.Pos(0, 1), 0, False) and not board.move_blocked(fastautomata_clib.Pos(0, 1), 1, False)
+for pos, layer in [(fastautomata_clib.Pos(5, 0), 0), (fastautomata_clib.Pos(0, -1), 0), (fastautomata_clib.Pos(0, 0), 4)]:
+    try:
+        board.move_blocked(pos, layer)
+        assert False, "outside of the board"
+    except IndexError:
+        pass
+
+# the occupancy follows the agents and entities (field layers get no bit), and moves into a SOLID cell do not happen
+view = board.occupancy_view()
+assert view[0, 0] == 0b1 and view[1, 2] == 0b11 and view[2, 3] == 0b110 and view[3, 4] == 0b1 and view[3, 0] == 0
+rules = board.rules_add(0, fastautomata_clib.Stencil.moore())
+rules.add(state="Sheep", move=fastautomata_clib.Pos(1, 0))
+board.rules_add(2, fastautomata_clib.Stencil.moore()).add(state="Cow", move=fastautomata_clib.Pos(0, 1))
+board.step()
+sheep = sorted((agent.pos.x, agent.pos.y) for agent in [board.agent_get(fastautomata_clib.Pos(x, y), 0) for y in range(4) for x in range(5)] if agent is not None)
+assert sheep == [(0, 0), (3, 1), (4, 3)] # (1, 0) has a fence, (5, 3) is outside
+assert view[1, 2] == 0b10 and view[1, 3] == 0b1 and view[2, 0] == 0b100 and view[1, 0] == 0 and view[0, 4] == 0 and view[1, 4] == 0b100
+assert board.entity_at(fastautomata_clib.Pos(3, 3), 2) == 1 # cows only have a TRIGGER with the sheep, and mud is not in their way
+
+
+# Flow fields: the distances are a breadth first search around the walls (cells of SOLID layers, and static agents of the walking layer)
+walls = [(4, y) for y in range(6)] + [(7, y) for y in range(1, 7)] + [(8, 6), (8, 5), (9, 5)]
+board = fastautomata_clib.SimulatedBoard(10, 7, 2)
+collisions = fastautomata_clib.CollisionMap(2)
+collisions.addCollision(fastautomata_clib.CollisionType.SOLID, 0, 1)
+board.layer_collisions = collisions
+fence = [int(id) for id in board.agents_spawn(numpy.array(walls), "Wall", 1)]
+board.agents_spawn(numpy.array([[2, 3]]), "Rock", 0)
+walkerIds = [int(id) for id in board.agents_spawn(numpy.array([[1, 5], [6, 2], [9, 0]]), "Walker", 0, True)]
+walls.append((2, 3))
+
+def path_lengths(walls, targets, diagonal, wrap):
+    moves = [(1, 0), (-1, 0), (0, 1), (0, -1)] + ([(1, 1), (-1, 1), (1, -1), (-1, -1)] if diagonal else [])
+    distances = numpy.full((7, 10), fastautomata_clib.FlowField.UNREACHABLE, numpy.int32)
+    queue = [target for target in targets if target not in walls]
+    for x, y in queue:
+        distances[y, x] = 0
+    for x, y in queue:
+        for dx, dy in moves:
+            nx, ny = x + dx, y + dy
+            if not (0 <= nx < 10 and 0 <= ny < 7):
+                if not wrap:
+                    continue
+                nx, ny = nx % 10, ny % 7
+            if (nx, ny) not in walls and distances[ny, nx] == fastautomata_clib.FlowField.UNREACHABLE:
+                distances[ny, nx] = distances[y, x] + 1
+                queue.append((nx, ny))
+    return distances
+
+for targets in [[(0, 0)], [(0, 6), (9, 0), (4, 3)]]:
+    for diagonal in [False, True]:
+        neighbors = {(dx % 10, dy % 7) for dx in [-1, 0, 1] for dy in [-1, 0, 1] if (dx != 0 or dy != 0) and (diagonal or dx == 0 or dy == 0)}
+        for wrap in [False, True]:
+            field = board.flow_field([fastautomata_clib.Pos(*target) for target in targets], 0, diagonal, wrap)
+            expected = path_lengths(walls, targets, diagonal, wrap)
+            assert (field.distances() == expected).all(), str((targets, diagonal, wrap))
+            for x, y in [(x, y) for y in range(7) for x in range(10)]:
+                step = field.next_step(fastautomata_clib.Pos(x, y))
+                if expected[y, x] > 0:
+                    assert expected[step.y, step.x] == expected[y, x] - 1 and ((step.x - x) % 10, (step.y - y) % 7) in neighbors
+                else:
+                    assert (step.x, step.y) == (x, y)
+
+# right of the wall the way goes around its end: 6 down, 2 across and 9 back (12 with diagonal moves, nothing with wrap)
+origin = [fastautomata_clib.Pos(0, 0)]
+assert board.flow_field(origin, 0, False).getDistance(fastautomata_clib.Pos(5, 0)) == 17
+assert board.flow_field(origin, 0, True).getDistance(fastautomata_clib.Pos(5, 0)) == 12
+assert board.flow_field(origin, 0, True, True).getDistance(fastautomata_clib.Pos(5, 0)) == 5
+assert board.flow_field(origin, 0, False).getDistance(fastautomata_clib.Pos(3, 3)) == 6 # the rock is in the way
+assert board.flow_field(origin, 0, True).getDistance(fastautomata_clib.Pos(9, 6)) == fastautomata_clib.FlowField.UNREACHABLE
+assert board.flow_field(origin, 0, True).getDistance(fastautomata_clib.Pos(4, 0)) == fastautomata_clib.FlowField.UNREACHABLE
+assert board.flow_field(origin, 0, True).getDistance(fastautomata_clib.Pos(-1, 0)) == fastautomata_clib.FlowField.UNREACHABLE
+assert board.flow_field(origin, 0, True).next_step(fastautomata_clib.Pos(-1, 0)) == fastautomata_clib.Pos(-1, 0)
+
+# fields are cached, walkers moving in the walking layer do not change them, a wall that goes away does
+field = board.flow_field(origin, 0, True)
+assert field.computations == 1
+board.rules_add(0, fastautomata_clib.Stencil.moore()).add(state="Walker", move=fastautomata_clib.Pos(0, -1))
+for i in range(3):
+    board.step()
+    assert field.getDistance(fastautomata_clib.Pos(5, 0)) == 12
+assert board.agent_by_id(walkerIds[0]).pos == fastautomata_clib.Pos(1, 2) and field.computations == 1
+board.agent_by_id(fence[0]).kill() # the wall cell (4, 0)
+board.step()
+assert field.getDistance(fastautomata_clib.Pos(5, 0)) == 5 and field.computations == 2
+assert (field.distances() == path_lengths(walls[1:], [(0, 0)], True, False)).all()
+
+
+# Scalar fields: diffusing moves the values around without losing any (the edges give a cell its own share back), evaporating scales them
+board = fastautomata_clib.SimulatedBoard(12, 9, 1)
+heat = board.scalar_add("heat")
+assert board.scalar("heat") is heat and not heat.wrap and board.is_native()
+values = numpy.asarray(heat)
+assert values.shape == (9, 12) and values.dtype == numpy.float32 and values.sum() == 0
+start = numpy.random.RandomState(5).rand(9, 12).astype(numpy.float32)
+
+def diffused(values, rate, stencil, wrap):
+    result = (1 - rate) * values.astype(numpy.float64)
+    for y in range(values.shape[0]):
+        offsets = stencil.getOffsets(y)
+        for x in range(values.shape[1]):
+            for offset in offsets:
+                nx, ny = x + offset.x, y + offset.y
+                if wrap:
+                    nx, ny = nx % values.shape[1], ny % values.shape[0]
+                elif not (0 <= nx < values.shape[1] and 0 <= ny < values.shape[0]):
+                    nx, ny = x, y
+                result[y, x] += rate / len(offsets) * values[ny, nx]
+    return result
+
+stencils = [fastautomata_clib.Stencil.moore(), fastautomata_clib.Stencil.moore(2, True), fastautomata_clib.Stencil.von_neumann(2), fastautomata_clib.Stencil.hex(), fastautomata_clib.Stencil.hex(2)]
+for stencil in stencils:
+    values[:] = start
+    heat.deposit(fastautomata_clib.Pos(0, 0), 50.0)
+    heat.deposit(fastautomata_clib.Pos(11, 4), 25.0)
+    mass = heat.total()
+    expected = diffused(values, 0.3, stencil, False)
+    heat.diffuse(0.3, stencil)
+    assert numpy.allclose(values, expected, rtol=1e-5)
+    for i in range(100):
+        heat.diffuse(0.8, stencil)
+    assert abs(heat.total() - mass) < mass * 1e-4 and values.min() >= 0
+    assert values[0, 0] < 5.0 # the corner spread out
+heat.evaporate(0.25)
+assert abs(heat.total() - 0.75 * mass) < mass * 1e-4
+heat.evaporate(1)
+assert heat.total() == 0
+
+# a wrapping field diffuses across the edges
+ring = board.scalar_add("ring", True)
+ringValues = numpy.asarray(ring)
+ringValues[:] = start
+ring.deposit(fastautomata_clib.Pos(-1, -1), 10.0)
+assert ring.sample(fastautomata_clib.Pos(11, 8)) == ringValues[8, 11] and ringValues[8, 11] > 10.0
+expected = diffused(ringValues, 0.5, stencils[0], True)
+ring.diffuse(0.5, stencils[0])
+assert numpy.allclose(ringValues, expected, rtol=1e-5) and ringValues[0, 0] > start[0, 0]
+
+# every step diffuses with the rates of the field, then evaporates. The view stays valid, and writes into the field
+heat.fill(0.0)
+heat.deposit(fastautomata_clib.Pos(5, 4), 8.0)
+heat.setRates(0.2, 0.1)
+heat.setStencil(fastautomata_clib.Stencil.von_neumann())
+assert heat.diffusion == numpy.float32(0.2) and heat.evaporation == numpy.float32(0.1)
+expected = diffused(values, 0.2, fastautomata_clib.Stencil.von_neumann(), False) * 0.9
+board.step()
+assert numpy.allclose(values, expected, rtol=1e-5) and numpy.shares_memory(numpy.asarray(heat), values)
+values[0, 0] = 3.0
+assert heat.sample(fastautomata_clib.Pos(0, 0)) == 3.0 and heat.sample(fastautomata_clib.Pos(-1, 0)) == 0.0
+
+# gradients and hills (cells outside of the board count as the cell itself)
+heat.fill(0.0)
+heat.deposit(fastautomata_clib.Pos(5, 4), 8.0)
+assert heat.gradient(fastautomata_clib.Pos(4, 4)) == [4.0, 0.0] and heat.gradient(fastautomata_clib.Pos(5, 3)) == [0.0, 4.0]
+assert heat.gradient(fastautomata_clib.Pos(0, 0)) == [0.0, 0.0]
+assert heat.uphill(fastautomata_clib.Pos(4, 3)) == fastautomata_clib.Pos(5, 4) and heat.uphill(fastautomata_clib.Pos(5, 4)) == fastautomata_clib.Pos(5, 4)
+
+# deposits at the agents, only in a state if given
+board.agents_spawn(numpy.array([[1, 1], [2, 2], [3, 3]]), "Ant")
+board.agents_spawn(numpy.array([[6, 6]]), "Queen")
+heat.fill(0.0)
+heat.deposit_layer(0, 2.0, "Ant")
+heat.deposit_layer(0, 1.0)
+assert [values[y, x] for x, y in [(1, 1), (3, 3), (6, 6), (0, 0)]] == [3.0, 3.0, 1.0, 0.0] and heat.total() == 10.0
+
+for broken, error in [(lambda: heat.diffuse(1.5, stencils[0]), ValueError), (lambda: heat.evaporate(-0.1), ValueError), (lambda: heat.setRates(0.5, 2), ValueError),
+                      (lambda: board.scalar_add("heat"), ValueError), (lambda: board.scalar("cold"), ValueError), (lambda: heat.deposit(fastautomata_clib.Pos(12, 0), 1.0), IndexError)]:
+    try:
+        broken()
+        assert False, "should fail"
+    except error:
+        pass
+
+
+# Layer views: taken once, they show every step (and every reset) of the board without being taken again
+board = fastautomata_clib.SimulatedBoard(6, 5, 2)
+board.rules_add(0, fastautomata_clib.Stencil.moore(), wrap=True).add(state="Ant", move=fastautomata_clib.Pos(1, 0), probability=0.5)
+board.life_add(1, "B3/S23", True)
+for x in range(1, 4):
+    board.field_put(fastautomata_clib.Pos(x, 2), "Alive", 1)
+board.agents_spawn(numpy.array([[0, 0], [2, 1], [5, 4]]), "Ant", 0, True)
+ants, life = board.layer_view(0), board.layer_view(1)
+assert ants.shape == (5, 6) and ants.dtype == numpy.uint16 and not ants.flags.writeable
+try:
+    ants[0, 0] = 1
+    assert False, "views are read only"
+except ValueError:
+    pass
+
+def layer_cells(board: fastautomata_clib.SimulatedBoard, layer: int):
+    cells = numpy.full((5, 6), 65535, numpy.uint16)
+    for x, y in [(x, y) for y in range(5) for x in range(6)]:
+        if board.is_field(layer):
+            cells[y, x] = board.field_get_id(fastautomata_clib.Pos(x, y), layer)
+        elif board.agent_get(fastautomata_clib.Pos(x, y), layer) is not None:
+            cells[y, x] = board.agent_get(fastautomata_clib.Pos(x, y), layer).state_id
+    return cells
+
+address = ants.ctypes.data
+snapshots = []
+for i in range(6):
+    board.step()
+    assert (ants == layer_cells(board, 0)).all() and (life == layer_cells(board, 1)).all()
+    snapshots.append(ants.copy())
+assert ants.ctypes.data == address and numpy.shares_memory(board.layer_view(0), ants)
+assert any((before != after).any() for before, after in zip(snapshots, snapshots[1:])) # the ants moved
+assert (life == board.getStateId("Alive")).sum() == 3 # a blinker
+
+# changes between steps show up with the next step or views_sync, taking a view again syncs its layer
+board.agents_spawn(numpy.array([[3, 3]]), "Queen", 0)
+assert ants[3, 3] == 65535
+board.views_sync()
+assert ants[3, 3] == board.getStateId("Queen")
+board.field_put(fastautomata_clib.Pos(0, 4), "Alive", 1)
+assert life[4, 0] != board.getStateId("Alive")
+board.layer_view(1)
+assert life[4, 0] == board.getStateId("Alive")
+
+# a reset empties them, and a view keeps working (and keeps the board alive) after the board is dropped
+board.reset()
+assert (ants == 65535).all() and (life == board.getStateId("Dead")).all()
+board.agents_spawn(numpy.array([[4, 4]]), "Ant", 0)
+board.step()
+assert ants[4, 4] == board.getStateId("Ant")
+del board
+assert ants.sum() == 65535 * 29 + ants[4, 4]
+try:
+    fastautomata_clib.SimulatedBoard(6, 5, 2).layer_view(2)
+    assert False, "there is no layer 2"
+except IndexError:
+    pass
+
+
+# Bulk spawn: one on_spawn call with every id, and every cell gets checked before anything is added
+board = fastautomata_clib.SimulatedBoard(4, 4, 2)
+spawned = []
+board.append_on_spawn(lambda ids: spawned.append(list(ids)))
+ids = board.agents_spawn(numpy.array([[x, y] for y in range(4) for x in range(4)]), "Grass", 1)
+assert len(ids) == 16 and spawned == [list(ids)]
+assert board.color_map_count["Grass"] == 16
+
+# a state and a layer per agent, and simulated agents instead of static ones
+states = numpy.array([board.getStateId("A"), board.getStateId("B")], dtype=numpy.uint16)
+ids = board.agents_spawn(numpy.array([[0, 0], [1, 1]]), states, numpy.array([0, 0]), True)
+assert board.agent_by_id(int(ids[1])).state == "B" and board.agent_by_id(int(ids[1])).getLayer() == 0
+assert isinstance(board.agent_by_id(int(ids[0])), fastautomata_clib.Agent)
+assert not isinstance(board.agent_by_id(0), fastautomata_clib.Agent)
+
+# a taken cell, a repeated cell or a cell outside of the board add nothing
+for positions, error in [([[2, 2], [0, 0]], ValueError), ([[2, 2], [2, 2]], ValueError), ([[2, 2], [9, 9]], IndexError)]:
+    try:
+        board.agents_spawn(numpy.array(positions), "A")
+        assert False, "spawning at " + str(positions) + " should fail"
+    except error:
+        pass
+assert board.getAgentCount() == 18 and len(spawned) == 2
+assert board.color_map_count["A"] == 1
+print("spawn ok")
+
+
+# Journal: the changes of the agents and entities, in order, until they get taken
+kinds = fastautomata_clib.ChangeKind
+board = fastautomata_clib.SimulatedBoard(5, 5, 1)
+board.journal_enable()
+assert board.getJournalEnabled()
+rules = board.rules_add(0, fastautomata_clib.Stencil.moore())
+rules.add(state="A", next="B", move=fastautomata_clib.Pos(1, 0))
+agent = int(board.agents_spawn(numpy.array([[0, 0]]), "A", 0, True)[0])
+board.step()
+changes = board.journal_take()
+assert [int(kind) for kind in changes["kind"]] == [int(kinds.ADD), int(kinds.MOVE), int(kinds.STATE)]
+assert list(changes["id"]) == [agent] * 3 and list(changes["step"]) == [0] * 3
+move = changes[1]
+assert (move["x_old"], move["y_old"], move["x_new"], move["y_new"]) == (0, 0, 1, 0)
+state = changes[2]
+assert board.getStateName(int(state["state_old"])) == "A" and board.getStateName(int(state["state_new"])) == "B"
+assert board.getJournalSize() == 0 and len(board.journal_take()) == 0
+
+# nothing changes in the second step, the agent gets removed in the third
+board.step()
+assert board.getJournalSize() == 0
+board.agent_by_id(agent).kill()
+board.step()
+changes = board.journal_take()
+assert len(changes) == 1 and changes[0]["kind"] == int(kinds.REMOVE) and changes[0]["step"] == 2
+
+board.entities().spawn(fastautomata_clib.Pos(3, 3), "E")
+changes = board.journal_take()
+assert changes[0]["kind"] == int(kinds.ADD) and changes[0]["entity"] == int(fastautomata_clib.ChangeEntity.ENTITY)
+
+# a reset empties it, and starts it with a RESET change (before the agents of on_reset)
+board.append_on_reset(lambda resetBoard: resetBoard.agents_spawn(numpy.array([[2, 2]]), "A"))
+board.reset()
+changes = board.journal_take()
+assert [int(kind) for kind in changes["kind"]] == [int(kinds.RESET), int(kinds.ADD)] and changes[0]["id"] == -1
+
+board.journal_enable(False)
+assert not board.getJournalEnabled()
+board.step()
+assert board.getJournalSize() == 0
+print("journal ok")
+
+
+# Rule tables: Life written as a table steps like the Life engine
+cells = [(x, y) for y in range(12) for x in range(12) if (x * 7 + y * 13) % 5 < 2]
+engine = fastautomata_clib.SimulatedBoard(12, 12, 1)
+engine.life_add(0, "B3/S23")
+table = fastautomata_clib.SimulatedBoard(12, 12, 1)
+table.field_enable(0, "Dead")
+rules = table.rules_add(0, fastautomata_clib.Stencil.moore())
+rules.add(state="Dead", next="Alive", counts={"Alive": (3, 3)})
+rules.add(state="Alive", next="Dead", counts={"Alive": (0, 1)})
+rules.add(state="Alive", next="Dead", counts={"Alive": (4, 8)})
+assert len(rules) == 3 and rules.layer == 0 and rules.countLayer == 0 and not rules.wrap
+for x, y in cells:
+    engine.field_put(fastautomata_clib.Pos(x, y), "Alive", 0)
+    table.field_put(fastautomata_clib.Pos(x, y), "Alive", 0)
+for i in range(10):
+    engine.step()
+    table.step()
+    assert alive_cells(engine, 0) == alive_cells(table, 0)
+
+# the first rule that matches and fires is used, a rule with probability 0 never fires
+board = fastautomata_clib.SimulatedBoard(5, 5, 1)
+rules = board.rules_add(0, fastautomata_clib.Stencil.moore())
+rules.add(state="A", next="B", probability=0.0)
+rules.add(state="A", next="C")
+board.agents_spawn(numpy.array([[0, 0], [4, 4]]), "A", 0, True)
+board.step()
+assert board.color_map_count["C"] == 2 and board.color_map_count.get("B", 0) == 0
+
+# one rule set per layer
+try:
+    board.rules_add(0, fastautomata_clib.Stencil.moore())
+    assert False, "a second rule set on the same layer should fail"
+except ValueError:
+    pass
+
+# agents, entities and field cells have their own random streams: the same index does not fire alike
+for seed in range(3):
+    board = fastautomata_clib.SimulatedBoard(8, 8, 3)
+    board.setSeed(seed)
+    board.field_enable(2, "None")
+    for layer in range(3):
+        board.rules_add(layer, fastautomata_clib.Stencil.moore()).add(state="A", next="B", probability=0.5)
+    board.agents_spawn(numpy.array(positions), "A", 0, True)
+    store = board.entities()
+    for x, y in positions:
+        store.spawn(fastautomata_clib.Pos(x, y), "A", 1)
+        board.field_put(fastautomata_clib.Pos(x, y), "A", 2)
+    board.step()
+    fired = [
+        [board.agent_by_id(i).state == "B" for i in range(64)],
+        [store.getState(i) == "B" for i in range(64)],
+        [board.field_get(fastautomata_clib.Pos(x, y), 2) == "B" for x, y in positions],
+    ]
+    for a, b in [(0, 1), (0, 2), (1, 2)]:
+        same = sum(x == y for x, y in zip(fired[a], fired[b]))
+        assert 16 <= same <= 48, "seed " + str(seed) + ": " + str(same) + " of 64 cells fired alike"
+print("rules ok")
+
+
+# C ABI kernels: a board kernel and an agent kernel from a shared library (needs a C compiler)
+kernel_source = """
+#include "fastautomata_capi.h"
+
+/* moves every agent one cell to the right, until the edge */
+void walk_right(const fa_board *board, fa_agent *agent, void *userData)
+{
+    if (agent->x + 1 < board->width)
+    {
+        agent->moves = 1;
+        agent->x_next = agent->x + 1;
+        agent->y_next = agent->y;
+    }
+}
+
+/* counts its calls (userData is an int), and paints the cell of the step in the first row of layer 1 */
+void paint(const fa_board *board, void *userData)
+{
+    int *calls = (int *)userData;
+    (*calls)++;
+    board->field_set(board->handle, 1, (int)board->step, 0, board->state_id(board->handle, "Paint"));
+}
+
+/* tries what only board kernels can do, and turns "Refused" if none of it worked */
+void try_board(const fa_board *board, fa_agent *agent, void *userData)
+{
+    int refused = board->field_set(board->handle, 1, agent->x, agent->y, agent->state) == -1
+        && board->agent_set_state(board->handle, agent->id, agent->state) == -1
+        && board->agent_set_pos(board->handle, agent->id, 0, 0) == -1
+        && board->random(board->handle) < 0;
+    agent->state_next = board->state_id(board->handle, refused ? "Refused" : "Allowed");
+}
+"""
+
+compiler = shutil.which("cc") or shutil.which("gcc") or shutil.which("clang")
+if compiler is None:
+    print("kernels skipped (no C compiler)")
+else:
+    with tempfile.TemporaryDirectory() as directory:
+        source = os.path.join(directory, "kernels.c")
+        library = os.path.join(directory, "kernels.so")
+        with open(source, "w") as file:
+            file.write(kernel_source)
+        include = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "fastautomata", "include", "fastautomata")
+        subprocess.run([compiler, "-shared", "-fPIC", "-I", include, source, "-o", library], check=True)
+
+        assert fastautomata_clib.CAPI_VERSION == 1
+        walk_right = fastautomata_clib.kernel_load(library, "walk_right")
+        paint = fastautomata_clib.kernel_load(library, "paint")
+        for path, symbol in [(library, "missing"), (os.path.join(directory, "missing.so"), "paint")]:
+            try:
+                fastautomata_clib.kernel_load(path, symbol)
+                assert False, "loading " + symbol + " from " + path + " should fail"
+            except ValueError:
+                pass
+
+        board = fastautomata_clib.SimulatedBoard(5, 2, 2)
+        board.setThreadCount(2)
+        board.field_enable(1, "None")
+        board.getStateId("Paint")
+        calls = ctypes.c_int(0)
+        board.kernel_add(paint, ctypes.addressof(calls))
+        ids = board.agents_spawn(numpy.array([[0, 0], [0, 1]]), "Walker", 0, kernel=walk_right)
+        assert isinstance(board.agent_by_id(int(ids[0])), fastautomata_clib.KernelAgent)
+        assert board.agent_by_id(int(ids[0])).kernel == walk_right
+        assert board.is_native()
+
+        for i in range(3):
+            board.step()
+        assert calls.value == 3
+        assert [board.field_get(fastautomata_clib.Pos(x, 0), 1) for x in range(5)] == ["Paint"] * 3 + ["None"] * 2
+        assert [board.agent_by_id(int(id)).pos.x for id in ids] == [3, 3]
+
+        # the agents stop at the edge
+        for i in range(3):
+            board.step()
+        assert calls.value == 6
+        assert [board.field_get(fastautomata_clib.Pos(x, 0), 1) for x in range(5)] == ["Paint"] * 5
+        assert [board.agent_by_id(int(id)).pos.x for id in ids] == [4, 4]
+
+        board.kernels_clear()
+        board.step()
+        assert calls.value == 6
+
+        # agent kernels run in parallel, they can not write the board
+        try_board = fastautomata_clib.kernel_load(library, "try_board")
+        board = fastautomata_clib.SimulatedBoard(4, 1, 2)
+        board.setThreadCount(2)
+        board.field_enable(1, "None")
+        board.getStateId("Refused")
+        board.getStateId("Allowed")
+        ids = board.agents_spawn(numpy.array([[x, 0] for x in range(4)]), "Walker", 0, kernel=try_board)
+        board.step()
+        assert [board.agent_by_id(int(id)).state for id in ids] == ["Refused"] * 4
+        assert [board.agent_by_id(int(id)).pos.x for id in ids] == [0, 1, 2, 3]
+        assert board.color_map_count.get("Walker", 0) == 0
+    print("kernels ok")
+
+
+# Checkpoints: a loaded board continues like the saved one, with its states mapped by name
+def add_code(board: fastautomata_clib.SimulatedBoard):
+    # code is not saved: both boards add it
+    board.life_add(0, "B3/S23")
+    rules = board.rules_add(1, fastautomata_clib.Stencil.moore())
+    rules.add(state="Sheep", move=fastautomata_clib.Pos(1, 0), probability=0.5)
+
+def agent_cells(board: fastautomata_clib.SimulatedBoard, ids):
+    return [(board.agent_by_id(id).pos.x, board.agent_by_id(id).pos.y) for id in ids]
+
+with tempfile.TemporaryDirectory() as directory:
+    path = os.path.join(directory, "board.ckp")
+    saved = fastautomata_clib.SimulatedBoard(12, 12, 3)
+    saved.setSeed(7)
+    saved.getStateId("Unused") # shifts the state ids against the board that loads
+    add_code(saved)
+    saved.addColor("Sheep", [1, 2, 3])
+    for x, y in cells:
+        saved.field_put(fastautomata_clib.Pos(x, y), "Alive", 0)
+    saved.agents_spawn(numpy.array([[1, 1], [5, 5]]), "Sheep", 1, True)
+    saved.agents_spawn(numpy.array([[3, 3]]), "Rock", 1)
+    saved.entities().spawn(fastautomata_clib.Pos(7, 7), "Wolf", 2)
+    saved.setMovePolicy(fastautomata_clib.MovePolicy.RANDOM, True)
+    for i in range(3):
+        saved.step()
+    saved.save(path)
+
+    loaded = fastautomata_clib.SimulatedBoard(12, 12, 3)
+    add_code(loaded)
+    records = []
+    loaded.load(path, lambda record: records.append((record.id, record.pos, record.layer, loaded.getStateName(record.state), record.type)))
+    records.sort(key=lambda record: record[0])
+    assert [(record[0], record[2], record[3], record[4]) for record in records] == [(0, 1, "Sheep", 1), (1, 1, "Sheep", 1), (2, 1, "Rock", 0)]
+    assert all(saved.agent_by_id(record[0]).pos == record[1] for record in records)
+
+    # nothing got restored by the callback: simulated agents come back as Agents, static ones as BaseAgents
+    assert loaded.getStateId("Sheep") != saved.getStateId("Sheep")
+    assert isinstance(loaded.agent_by_id(0), fastautomata_clib.Agent) and loaded.agent_by_id(0).state == "Sheep"
+    assert not isinstance(loaded.agent_by_id(2), fastautomata_clib.Agent) and loaded.agent_by_id(2).pos == fastautomata_clib.Pos(3, 3)
+    assert loaded.entities().getState(0) == "Wolf"
+    assert loaded.getColor("Sheep") == [1, 2, 3]
+    assert loaded.step_count == 3 and loaded.getMovePolicy() == fastautomata_clib.MovePolicy.RANDOM
+
+    for i in range(5):
+        saved.step()
+        loaded.step()
+        assert alive_cells(saved, 0) == alive_cells(loaded, 0)
+        assert agent_cells(saved, range(3)) == agent_cells(loaded, range(3))
+    assert saved.random() == loaded.random()
+
+    # what restore adds gets the id of the record (here static agents come back simulated)
+    def restore(record):
+        if record.type == 0:
+            loaded.agents_spawn(numpy.array([[record.pos.x, record.pos.y]]), numpy.array([record.state], dtype=numpy.uint16), record.layer, True)
+    loaded.load(path, restore)
+    assert isinstance(loaded.agent_by_id(2), fastautomata_clib.Agent) and loaded.agent_by_id(2).state == "Rock"
+    assert loaded.agent_by_id(2).pos == fastautomata_clib.Pos(3, 3) and loaded.getAgentCount() == 3
+
+    try:
+        fastautomata_clib.SimulatedBoard(13, 12, 3).load(path)
+        assert False, "loading into a board of another size should fail"
+    except ValueError:
+        pass
+    try:
+        loaded.load(os.path.join(directory, "missing.ckp"))
+        assert False, "loading a missing file should fail"
+    except RuntimeError:
+        pass
+
+    # python agents only come back through restore, and an agent that called wake() keeps getting stepped (active scheduling)
+    class Counter(fastautomata_clib.Agent):
+        def __init__(self, board, pos):
+            super().__init__(board, pos, "Counter", 0, False)
+            self.steps = 0
+
+        def step(self):
+            self.steps += 1
+            self.wake()
+
+    saved = fastautomata_clib.SimulatedBoard(6, 1, 1)
+    saved.setActiveScheduling(True)
+    counters = [Counter(saved, fastautomata_clib.Pos(0, 0))]
+    for i in range(3):
+        saved.step()
+    saved.save(path)
+
+    loaded = fastautomata_clib.SimulatedBoard(6, 1, 1)
+    try:
+        loaded.load(path)
+        assert False, "loading a python agent without restore should fail"
+    except ValueError:
+        pass
+    assert loaded.getAgentCount() == 0
+
+    def restore_counter(record):
+        assert record.type == 2 and record.awake
+        counters.append(Counter(loaded, record.pos))
+    loaded.load(path, restore_counter)
+    for i in range(3):
+        saved.step()
+        loaded.step()
+    assert [counter.steps for counter in counters] == [6, 3]
+print("checkpoints ok")
+
+
+# Recordings: a replay rebuilds every recorded step, and a reset starts a new run
+def board_snapshot(board: fastautomata_clib.SimulatedBoard):
+    field = [[board.field_get_id(fastautomata_clib.Pos(x, y), 0) for x in range(board.getWidth())] for y in range(board.getHeight())]
+    agents = [(agentId, board.agent_by_id(agentId).pos.x, board.agent_by_id(agentId).pos.y) for agentId in range(10) if board.agent_by_id(agentId) is not None]
+    return (field, agents)
+
+def replay_snapshot(replay: fastautomata_clib.Replay):
+    agents = sorted((int(item["id"]), int(item["x"]), int(item["y"])) for item in replay.items() if item["entity"] == int(fastautomata_clib.ChangeEntity.AGENT))
+    return (replay.field(0).tolist(), agents)
+
+def generate(resetBoard: fastautomata_clib.SimulatedBoard):
+    for x, y in cells:
+        resetBoard.field_put(fastautomata_clib.Pos(x, y), "Alive", 0)
+    resetBoard.agents_spawn(numpy.array([[0, y] for y in range(0, 12, 3)]), "Sheep", 1, True)
+
+with tempfile.TemporaryDirectory() as directory:
+    path = os.path.join(directory, "board.rec")
+    board = fastautomata_clib.SimulatedBoard(12, 12, 2)
+    board.setSeed(3)
+    add_code(board)
+    board.append_on_reset(generate)
+    board.reset()
+
+    board.record_start(path, 3)
+    assert board.getRecording()
+    runs = [[board_snapshot(board)]]
+    for i in range(7):
+        board.step()
+        runs[0].append(board_snapshot(board))
+    board.reset()
+    assert board.getRecording()
+    runs.append([board_snapshot(board)])
+    for i in range(4):
+        board.step()
+        runs[1].append(board_snapshot(board))
+    board.record_stop()
+    assert not board.getRecording()
+
+    replay = fastautomata_clib.Replay(path)
+    assert (replay.getWidth(), replay.getHeight(), replay.getLayerCount()) == (12, 12, 2)
+    assert replay.getRunCount() == 2 and replay.getRun() == 0
+    assert [(replay.getFirstStep(run), replay.getLastStep(run)) for run in range(2)] == [(0, 7), (0, 4)]
+    assert replay.getFieldLayers() == [0] and "Sheep" in replay.getStates()
+
+    # next goes through every step of every run
+    for run, snapshots in enumerate(runs):
+        for step, expected in enumerate(snapshots):
+            if run or step:
+                assert replay.next()
+            assert (replay.getRun(), replay.getStep()) == (run, step)
+            assert replay_snapshot(replay) == expected
+    assert not replay.next()
+
+    # seeks go back and forth, across runs (-1 stays in the current one)
+    for run, step in [(0, 5), (1, 2), (0, 0), (1, 4), (0, 7)]:
+        replay.seek(step, run)
+        assert replay.getRun() == run and replay_snapshot(replay) == runs[run][step]
+    replay.seek(1)
+    assert replay.getRun() == 0 and replay_snapshot(replay) == runs[0][1]
+    for run, step in [(1, 5), (2, 0)]:
+        try:
+            replay.seek(step, run)
+            assert False, "seeking to step " + str(step) + " of run " + str(run) + " should fail"
+        except IndexError:
+            pass
+    del replay
+
+    text = os.path.join(directory, "board.txt")
+    with open(text, "w") as file:
+        file.write("this is not a recording, just some text\n")
+    try:
+        fastautomata_clib.Replay(text)
+        assert False, "replaying a text file should fail"
+    except ValueError:
+        pass
+print("recordings ok")
+
+
+# Streams: the messages of a viewer, one after the other, replay like a recording of the board
+def read_varint(data: bytes, position: int):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[position]
+        position += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return (value, position)
+        shift += 7
+
+def read_frames(message: bytes):
+    # [kind][size][payload], every payload starts with the step (zigzag) and the new state names
+    frames = []
+    position = 0
+    while position < len(message):
+        kind = message[position]
+        size, position = read_varint(message, position + 1)
+        payload = message[position:position + size]
+        position += size
+        code, offset = read_varint(payload, 0)
+        step = (code >> 1) ^ -(code & 1)
+        names, offset = read_varint(payload, offset)
+        for i in range(names):
+            length, offset = read_varint(payload, offset)
+            offset += length
+        frames.append((kind, step, payload[offset:]))
+    return frames
+
+def read_counts(payload: bytes):
+    total, offset = read_varint(payload, 0)
+    counts = []
+    for i in range(total):
+        count, offset = read_varint(payload, offset)
+        counts.append(count)
+    return counts
+
+def check_message(board: fastautomata_clib.SimulatedBoard, message: bytes, kind: int):
+    # one frame of the given kind and the counts of every state, both at the step of the board
+    frames = read_frames(message)
+    assert [frame[0] for frame in frames] == [kind, 3]
+    assert [frame[1] for frame in frames] == [board.getStepCount()] * 2
+    counts = read_counts(frames[1][2])
+    expected = {board.getStateId(name): count for name, count in board.color_map_count.items()}
+    assert counts == [expected[state] for state in range(len(expected))]
+
+board = fastautomata_clib.SimulatedBoard(12, 12, 2)
+board.setSeed(5)
+add_code(board)
+board.append_on_reset(generate)
+board.reset()
+assert not board.getStreamEnabled()
+try:
+    board.stream_take()
+    assert False, "taking from a board that does not stream should fail"
+except ValueError:
+    pass
+
+# the first viewer is there from the start, the second joins after three steps (right after a take)
+board.stream_enable()
+assert board.getStreamEnabled()
+first = board.stream_keyframe(True)
+assert first[:8] == b"FAUTOREC"
+check_message(board, first[32:], 1)
+viewers = [[first], []]
+snapshots = [[board_snapshot(board)], []]
+for i in range(8):
+    if i == 5:
+        # a reset reaches the viewers as a change: the step count starts again in the same run
+        board.reset()
+    else:
+        board.step()
+    message = board.stream_take()
+    check_message(board, message, 2)
+    for viewer, messages in enumerate(viewers):
+        if messages:
+            messages.append(message)
+            snapshots[viewer].append(board_snapshot(board))
+    if i == 2:
+        joined = board.stream_keyframe(True)
+        check_message(board, joined[32:], 1)
+        viewers[1].append(joined)
+        snapshots[1].append(board_snapshot(board))
+assert [len(messages) for messages in viewers] == [9, 6]
+
+with tempfile.TemporaryDirectory() as directory:
+    for viewer, messages in enumerate(viewers):
+        path = os.path.join(directory, "viewer" + str(viewer) + ".rec")
+        with open(path, "wb") as file:
+            file.write(b"".join(messages))
+        replay = fastautomata_clib.Replay(path)
+        assert (replay.getWidth(), replay.getHeight(), replay.getLayerCount()) == (12, 12, 2)
+        assert replay.getRunCount() == 1
+        steps = []
+        for index, expected in enumerate(snapshots[viewer]):
+            if index:
+                assert replay.next()
+            steps.append(replay.getStep())
+            assert replay_snapshot(replay) == expected
+        assert not replay.next()
+        assert steps == [0, 1, 2, 3, 4, 5, 0, 1, 2][-len(steps):]
+        del replay
+
+# stopping forgets the changes, starting again begins from the board as it is then
+board.step()
+board.stream_enable(False)
+assert not board.getStreamEnabled()
+try:
+    board.stream_keyframe()
+    assert False, "a keyframe of a board that does not stream should fail"
+except ValueError:
+    pass
+board.stream_enable()
+board.step()
+frames = read_frames(board.stream_take())
+assert [(frame[0], frame[1]) for frame in frames] == [(2, 4), (3, 4)]
+print("streams ok")